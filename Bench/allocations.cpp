@@ -0,0 +1,72 @@
+/*
+ * This file is part of GDSII.
+ *
+ * allocations.cpp -- Count the bytes allocated by the benchmarks.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "allocations.h"
+
+namespace {
+
+std::atomic<long long> gLiveBytes(0);
+
+// Each block starts with its size, in a header which keeps the alignment.
+const size_t HEADER_SIZE = 16;
+
+}
+
+void *operator new(size_t size)
+{
+    void *block = std::malloc(size + HEADER_SIZE);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    *static_cast<size_t*>(block) = size;
+    gLiveBytes += (long long)size;
+    return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+void operator delete(void *ptr) throw()
+{
+    if (ptr == nullptr)
+        return;
+    void *block = static_cast<char*>(ptr) - HEADER_SIZE;
+    gLiveBytes -= (long long)*static_cast<size_t*>(block);
+    std::free(block);
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void *ptr) throw()
+{
+    operator delete(ptr);
+}
+
+namespace GDS {
+
+long long LiveBytes()
+{
+    return gLiveBytes;
+}
+
+}
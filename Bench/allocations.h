@@ -0,0 +1,38 @@
+/*
+ * This file is part of GDSII.
+ *
+ * allocations.h -- The header file which declare the count of the bytes
+ *                  allocated by the benchmarks.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_BENCH_ALLOCATIONS_H
+#define GDS_BENCH_ALLOCATIONS_H
+
+namespace GDS {
+
+/*!
+ * The bytes allocated by operator new and not yet deleted, in all threads.
+ * The operators are replaced in allocations.cpp, so the difference of two
+ * counts is exact for the objects of the library, without the overhead
+ * of the heap.
+ */
+long long LiveBytes();
+
+}
+
+#endif // GDS_BENCH_ALLOCATIONS_H
@@ -0,0 +1,346 @@
+/*
+ * This file is part of GDSII.
+ *
+ * benchmark.cpp -- A small harness to time the library, in the manner of
+ *                  Google Benchmark.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <thread>
+#include "benchmark.h"
+
+namespace GDS {
+namespace {
+
+struct Registered
+{
+    std::string         Name;
+    BenchmarkFunction   Body;
+};
+
+std::vector<Registered> &Benchmarks()
+{
+    static std::vector<Registered> benchmarks;
+    return benchmarks;
+}
+
+struct Result
+{
+    std::string         Name;
+    size_t              Iterations;
+    double              RealTime;   //< Nanoseconds per iteration.
+    double              CpuTime;    //< Nanoseconds per iteration.
+    double              BytesPerSecond;
+    double              ItemsPerSecond;
+    std::map<std::string, double> Counters;
+    std::string         Error;
+};
+
+const size_t MAX_ITERATIONS = 1000000000;
+
+std::string Escape(const std::string &str)
+{
+    std::string out;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char buffer[8];
+            sprintf(buffer, "\\u%04x", (unsigned char)c);
+            out += buffer;
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+std::string FormatTime(double ns)
+{
+    char buffer[32];
+    if (ns < 1e4)
+        sprintf(buffer, "%.1f ns", ns);
+    else if (ns < 1e7)
+        sprintf(buffer, "%.1f us", ns / 1e3);
+    else if (ns < 1e10)
+        sprintf(buffer, "%.1f ms", ns / 1e6);
+    else
+        sprintf(buffer, "%.2f s", ns / 1e9);
+    return buffer;
+}
+
+std::string FormatRate(double rate, const char *unit)
+{
+    char buffer[32];
+    if (rate >= 1e9)
+        sprintf(buffer, "%.2fG%s/s", rate / 1e9, unit);
+    else if (rate >= 1e6)
+        sprintf(buffer, "%.2fM%s/s", rate / 1e6, unit);
+    else if (rate >= 1e3)
+        sprintf(buffer, "%.2fk%s/s", rate / 1e3, unit);
+    else
+        sprintf(buffer, "%.2f%s/s", rate, unit);
+    return buffer;
+}
+
+void WriteReport(const BenchmarkOptions &options, const std::vector<Result> &results, std::ostream &out)
+{
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"";
+#else
+    out << "    \"library_build_type\": \"debug\"";
+#endif
+    for (auto &entry : options.Context)
+        out << ",\n    \"" << Escape(entry.first) << "\": \"" << Escape(entry.second) << "\"";
+    out << "\n  },\n  \"benchmarks\": [";
+    char buffer[64];
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &result = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\n";
+        out << "      \"name\": \"" << Escape(result.Name) << "\",\n";
+        out << "      \"run_name\": \"" << Escape(result.Name) << "\",\n";
+        out << "      \"run_type\": \"iteration\",\n";
+        if (!result.Error.empty())
+        {
+            out << "      \"error_occurred\": true,\n";
+            out << "      \"error_message\": \"" << Escape(result.Error) << "\"\n    }";
+            continue;
+        }
+        out << "      \"iterations\": " << result.Iterations << ",\n";
+        sprintf(buffer, "%.6g", result.RealTime);
+        out << "      \"real_time\": " << buffer << ",\n";
+        sprintf(buffer, "%.6g", result.CpuTime);
+        out << "      \"cpu_time\": " << buffer << ",\n";
+        out << "      \"time_unit\": \"ns\"";
+        if (result.BytesPerSecond > 0)
+        {
+            sprintf(buffer, "%.6g", result.BytesPerSecond);
+            out << ",\n      \"bytes_per_second\": " << buffer;
+        }
+        if (result.ItemsPerSecond > 0)
+        {
+            sprintf(buffer, "%.6g", result.ItemsPerSecond);
+            out << ",\n      \"items_per_second\": " << buffer;
+        }
+        for (auto &counter : result.Counters)
+        {
+            sprintf(buffer, "%.6g", counter.second);
+            out << ",\n      \"" << Escape(counter.first) << "\": " << buffer;
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
+
+class BenchmarkRunner
+{
+public:
+    static Result Run(const Registered &benchmark, double min_time);
+};
+
+Result BenchmarkRunner::Run(const Registered &benchmark, double min_time)
+{
+    Result result;
+    result.Name = benchmark.Name;
+    size_t iterations = 1;
+    while (true)
+    {
+        BenchmarkState state(iterations);
+        benchmark.Body(state);
+        if (!state.mError.empty())
+        {
+            result.Error = state.mError;
+            return result;
+        }
+        state.PauseTiming();    // In case the body left the loop early.
+        // Run again with enough iterations to reach the time, with some
+        // margin, but grow at most 100 times at once.
+        if (state.mRealTime < min_time && iterations < MAX_ITERATIONS)
+        {
+            double scale = state.mRealTime > 0 ? min_time * 1.4 / state.mRealTime : 100;
+            scale = std::min(std::max(scale, 2.0), 100.0);
+            iterations = std::min(MAX_ITERATIONS, size_t(iterations * scale));
+            continue;
+        }
+        size_t done = std::max(state.mDone, size_t(1));
+        result.Iterations = done;
+        result.RealTime = state.mRealTime * 1e9 / done;
+        result.CpuTime = state.mCpuTime * 1e9 / done;
+        result.BytesPerSecond = state.mRealTime > 0 ? state.mBytes / state.mRealTime : 0;
+        result.ItemsPerSecond = state.mRealTime > 0 ? state.mItems / state.mRealTime : 0;
+        result.Counters = state.mCounters;
+        return result;
+    }
+}
+
+BenchmarkState::BenchmarkState(size_t iterations)
+{
+    mIterations = iterations;
+    mDone = 0;
+    mRunning = false;
+    mCpuStart = 0;
+    mRealTime = 0;
+    mCpuTime = 0;
+    mBytes = 0;
+    mItems = 0;
+}
+
+bool BenchmarkState::KeepRunning()
+{
+    if (!mError.empty())
+        return false;
+    if (mDone == 0 && !mRunning)
+    {
+        ResumeTiming();
+        return true;
+    }
+    if (++mDone < mIterations)
+        return true;
+    PauseTiming();
+    return false;
+}
+
+void BenchmarkState::PauseTiming()
+{
+    if (!mRunning)
+        return;
+    mRealTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+    mCpuTime += double(std::clock() - mCpuStart) / CLOCKS_PER_SEC;
+    mRunning = false;
+}
+
+void BenchmarkState::ResumeTiming()
+{
+    if (mRunning)
+        return;
+    mStart = std::chrono::steady_clock::now();
+    mCpuStart = std::clock();
+    mRunning = true;
+}
+
+void BenchmarkState::SetBytesProcessed(unsigned long long bytes)
+{
+    mBytes = bytes;
+}
+
+void BenchmarkState::SetItemsProcessed(unsigned long long items)
+{
+    mItems = items;
+}
+
+void BenchmarkState::SetCounter(const std::string &name, double value)
+{
+    mCounters[name] = value;
+}
+
+void BenchmarkState::SkipWithError(const std::string &error)
+{
+    mError = error.empty() ? "error" : error;
+    PauseTiming();
+}
+
+size_t BenchmarkState::Iterations() const
+{
+    return mIterations;
+}
+
+void UseValue(const volatile char *)
+{
+}
+
+void RegisterBenchmark(const std::string &name, const BenchmarkFunction &body)
+{
+    Registered benchmark = { name, body };
+    Benchmarks().push_back(benchmark);
+}
+
+BenchmarkOptions::BenchmarkOptions()
+{
+    MinTime = 0.5;
+}
+
+int RunBenchmarks(const BenchmarkOptions &options)
+{
+    std::vector<Result> results;
+    std::regex filter(options.Filter.empty() ? std::string(".") : options.Filter);
+    printf("%-44s %12s %12s %12s  %s\n", "Benchmark", "Time", "CPU", "Iterations", "Rate");
+    for (auto &benchmark : Benchmarks())
+    {
+        if (!std::regex_search(benchmark.Name, filter))
+            continue;
+        Result result = BenchmarkRunner::Run(benchmark, options.MinTime);
+        results.push_back(result);
+        if (!result.Error.empty())
+        {
+            printf("%-44s ERROR: %s\n", result.Name.c_str(), result.Error.c_str());
+            continue;
+        }
+        std::string rates;
+        if (result.BytesPerSecond > 0)
+            rates += FormatRate(result.BytesPerSecond, "B") + " ";
+        if (result.ItemsPerSecond > 0)
+            rates += FormatRate(result.ItemsPerSecond, "items") + " ";
+        for (auto &counter : result.Counters)
+        {
+            char buffer[64];
+            sprintf(buffer, "%s=%.4g ", counter.first.c_str(), counter.second);
+            rates += buffer;
+        }
+        printf("%-44s %12s %12s %12llu  %s\n", result.Name.c_str(), FormatTime(result.RealTime).c_str(),
+               FormatTime(result.CpuTime).c_str(), (unsigned long long)result.Iterations, rates.c_str());
+        fflush(stdout);
+    }
+
+    if (!options.Output.empty())
+    {
+        std::ofstream out(options.Output.c_str());
+        if (!out)
+        {
+            printf("Can not write %s\n", options.Output.c_str());
+            return 1;
+        }
+        WriteReport(options, results, out);
+    }
+    for (auto &result : results)
+    {
+        if (!result.Error.empty())
+            return 1;
+    }
+    return 0;
+}
+
+}
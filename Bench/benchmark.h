@@ -0,0 +1,134 @@
+/*
+ * This file is part of GDSII.
+ *
+ * benchmark.h -- The header file which declare a small harness to time
+ *                the library, in the manner of Google Benchmark.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_BENCHMARK_H
+#define GDS_BENCHMARK_H
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GDS {
+
+/*!
+ * \brief The state of a benchmark while it runs.
+ *
+ * The body of a benchmark runs its timed work in
+ *     while (state.KeepRunning()) { ... }
+ * and is called again with more iterations until it runs long enough.
+ */
+class BenchmarkState
+{
+public:
+    BenchmarkState(size_t iterations);
+
+    /*!
+    Start the timer on the first call, and stop it after the last iteration.
+    */
+    bool KeepRunning();
+    /*!
+    Leave the work between PauseTiming and ResumeTiming out of the time.
+    */
+    void PauseTiming();
+    void ResumeTiming();
+    /*!
+    Set the bytes or items processed by all the iterations, which give
+    the rates of the report.
+    */
+    void SetBytesProcessed(unsigned long long bytes);
+    void SetItemsProcessed(unsigned long long items);
+    /*!
+    Set a value of the report, such as the memory per element.
+    */
+    void SetCounter(const std::string &name, double value);
+    /*!
+    Stop the benchmark with an error; KeepRunning returns false.
+    */
+    void SkipWithError(const std::string &error);
+
+    size_t Iterations() const;
+
+private:
+    friend class BenchmarkRunner;
+
+    size_t                      mIterations;
+    size_t                      mDone;
+    bool                        mRunning;
+    std::chrono::steady_clock::time_point mStart;
+    std::clock_t                mCpuStart;
+    double                      mRealTime;      //< Seconds.
+    double                      mCpuTime;       //< Seconds.
+    unsigned long long          mBytes;
+    unsigned long long          mItems;
+    std::map<std::string, double> mCounters;
+    std::string                 mError;
+};
+
+/*!
+ * Store a value out of sight of the optimizer, so the work which computes
+ * it is kept, as DoNotOptimize of Google Benchmark.
+ */
+void UseValue(const volatile char *value);
+
+template <typename T>
+inline void DoNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    UseValue(&reinterpret_cast<const volatile char &>(value));
+#endif
+}
+
+typedef std::function<void(BenchmarkState &)> BenchmarkFunction;
+
+/*!
+ * Add a benchmark to the ones RunBenchmarks runs, in order.
+ */
+void RegisterBenchmark(const std::string &name, const BenchmarkFunction &body);
+
+/*!
+ * \brief The settings of RunBenchmarks.
+ */
+struct BenchmarkOptions
+{
+    std::string     Filter;     //< A regular expression of the names to run; empty for all.
+    double          MinTime;    //< The least time of the final run, in seconds.
+    std::string     Output;     //< The path of the JSON report; empty for none.
+    std::map<std::string, std::string> Context;    //< Added to "context" of the report.
+
+    BenchmarkOptions();
+};
+
+/*!
+ * Run the registered benchmarks, print a table of the results and write
+ * the JSON report, in the format of Google Benchmark, so the results can
+ * be compared from release to release by the same tools.
+ * @return 0 if every benchmark succeeded, or 1.
+ */
+int RunBenchmarks(const BenchmarkOptions &options);
+
+}
+
+#endif // GDS_BENCHMARK_H
@@ -0,0 +1,196 @@
+/*
+ * This file is part of GDSII.
+ *
+ * generator.cpp -- The generator of synthetic layouts for the benchmarks.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "generator.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/boundary.h"
+#include "CGDS/box.h"
+#include "CGDS/path.h"
+#include "CGDS/sref.h"
+#include "CGDS/aref.h"
+
+namespace GDS {
+namespace {
+
+const int CELL_SIZE = 10000;    // The shapes of a cell are in [0, CELL_SIZE).
+
+/*
+ * A linear congruential generator, so a seed gives the same layout on
+ * every platform.
+ */
+class Random
+{
+public:
+    Random(unsigned int seed) : mState(seed * 2654435761ULL + 1) {}
+
+    int Next(int bound)
+    {
+        mState = mState * 6364136223846793005ULL + 1442695040888963407ULL;
+        return bound <= 1 ? 0 : int((mState >> 33) % (unsigned int)bound);
+    }
+
+private:
+    unsigned long long  mState;
+};
+
+std::string CellName(int level, int index)
+{
+    char buffer[32];
+    sprintf(buffer, "C%d_%d", level, index);
+    return buffer;
+}
+
+void AddShapes(Structure *cell, const GeneratorOptions &options, Random &random)
+{
+    int vertices = std::max(options.Vertices, 3);
+    // Keep the points of a polygon apart.
+    int radius = std::max(200, vertices * 2);
+    for (int i = 0; i < options.Shapes; i++)
+    {
+        short layer = short(1 + random.Next(8));
+        int kind = random.Next(4);
+        if (kind < 2)
+        {
+            Box *box = new Box;
+            box->SetLayer(layer);
+            box->SetDataType(0);
+            box->SetRect(random.Next(CELL_SIZE - 400), random.Next(CELL_SIZE - 400),
+                         10 + random.Next(390), 10 + random.Next(390));
+            cell->Add(box);
+        }
+        else if (kind == 2)
+        {
+            int cx = radius + random.Next(std::max(1, CELL_SIZE - 2 * radius));
+            int cy = radius + random.Next(std::max(1, CELL_SIZE - 2 * radius));
+            std::vector<Point> pts;
+            for (int k = 0; k < vertices; k++)
+            {
+                double angle = 2 * 3.14159265358979323846 * k / vertices;
+                pts.push_back(Point(cx + int(std::lround(radius * std::cos(angle))),
+                                    cy + int(std::lround(radius * std::sin(angle)))));
+            }
+            pts.push_back(pts.front());
+            Boundary *boundary = new Boundary;
+            boundary->SetLayer(layer);
+            boundary->SetDataType(0);
+            boundary->SetXY(std::move(pts));
+            cell->Add(boundary);
+        }
+        else
+        {
+            int x = random.Next(CELL_SIZE - 1000);
+            int y = random.Next(CELL_SIZE - 1000);
+            std::vector<Point> pts;
+            pts.push_back(Point(x, y));
+            pts.push_back(Point(x + 200 + random.Next(800), y));
+            pts.push_back(Point(pts.back().X, y + 200 + random.Next(800)));
+            pts.push_back(Point(x, pts.back().Y));
+            Path *path = new Path;
+            path->SetLayer(layer);
+            path->SetDataType(0);
+            path->SetWidth(10 + 2 * random.Next(20));
+            path->SetPathType(short(random.Next(3)));
+            path->SetXY(std::move(pts));
+            cell->Add(path);
+        }
+    }
+}
+
+}
+
+GeneratorOptions::GeneratorOptions()
+{
+    Cells = 200;
+    Depth = 4;
+    Shapes = 200;
+    Vertices = 8;
+    References = 4;
+    ArrayRows = 8;
+    ArrayCols = 8;
+    Seed = 1;
+}
+
+void GenerateLibrary(const GeneratorOptions &options, Library &lib)
+{
+    Random random(options.Seed);
+    int depth = std::max(options.Depth, 1);
+    int per_level = std::max(options.Cells / depth, 1);
+    lib.SetLibName("BENCH");
+    lib.SetUnits(0.001, 1e-9);
+
+    for (int level = 0; level < depth; level++)
+    {
+        for (int i = 0; i < per_level; i++)
+        {
+            Structure *cell = lib.Add(CellName(level, i));
+            AddShapes(cell, options, random);
+            if (level == 0)
+                continue;
+            for (int k = 0; k < options.References; k++)
+            {
+                SRef *sref = new SRef;
+                sref->SetSName(CellName(level - 1, random.Next(per_level)));
+                sref->SetXY(Point(random.Next(CELL_SIZE), random.Next(CELL_SIZE)));
+                sref->SetAnagle(90.0 * random.Next(4));
+                if (random.Next(4) == 0)
+                    sref->SetStrans(REFLECTION);
+                cell->Add(sref);
+            }
+            if (options.ArrayRows > 0 && options.ArrayCols > 0)
+            {
+                int pitch = CELL_SIZE + random.Next(CELL_SIZE / 10);
+                std::vector<Point> pts;
+                pts.push_back(Point(0, 0));
+                pts.push_back(Point(pitch * options.ArrayCols, 0));
+                pts.push_back(Point(0, pitch * options.ArrayRows));
+                ARef *aref = new ARef;
+                aref->SetSName(CellName(level - 1, random.Next(per_level)));
+                aref->SetRowCol(options.ArrayRows, options.ArrayCols);
+                aref->SetXY(std::move(pts));
+                cell->Add(aref);
+            }
+        }
+    }
+
+    Structure *top = lib.Add("TOP");
+    int side = int(std::ceil(std::sqrt(double(per_level))));
+    for (int i = 0; i < per_level; i++)
+    {
+        SRef *sref = new SRef;
+        sref->SetSName(CellName(depth - 1, i));
+        sref->SetXY(Point((i % side) * CELL_SIZE * 2, (i / side) * CELL_SIZE * 2));
+        top->Add(sref);
+    }
+}
+
+bool GenerateGDSII(const std::string &file_name, const GeneratorOptions &options, std::string &err)
+{
+    Library lib;
+    GenerateLibrary(options, lib);
+    return lib.WriteGDS(file_name, err);
+}
+
+}
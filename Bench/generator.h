@@ -0,0 +1,65 @@
+/*
+ * This file is part of GDSII.
+ *
+ * generator.h -- The header file which declare the generator of synthetic
+ *                layouts for the benchmarks.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_GENERATOR_H
+#define GDS_GENERATOR_H
+#include <string>
+
+namespace GDS {
+class Library;
+
+/*!
+ * \brief The shape of a synthetic layout.
+ *
+ * The cells are spread over Depth levels under the top cell TOP. A cell
+ * of the lowest level only has shapes; a cell above has shapes, SREFs of
+ * cells of the level below and an AREF of one of them. TOP refers to the
+ * cells of the highest level. Half of the shapes are boxes, a quarter
+ * polygons and a quarter paths, on layers 1 to 8.
+ */
+struct GeneratorOptions
+{
+    int         Cells;          //< The cells under TOP.
+    int         Depth;          //< The levels of cells under TOP.
+    int         Shapes;         //< The shapes of each cell.
+    int         Vertices;       //< The points of each polygon, at least 3.
+    int         References;     //< The SREFs of each cell above the lowest level.
+    int         ArrayRows;      //< The AREF of each cell above the lowest level;
+    int         ArrayCols;      //< no AREF if either is 0.
+    unsigned    Seed;
+
+    GeneratorOptions();
+};
+
+/*!
+ * Build a synthetic layout. The same options give the same layout.
+ * @param lib[out] The library, which should be empty.
+ */
+void GenerateLibrary(const GeneratorOptions &options, Library &lib);
+/*!
+ * Build a synthetic layout and write it to a GDSII file.
+ */
+bool GenerateGDSII(const std::string &file_name, const GeneratorOptions &options, std::string &err);
+
+}
+
+#endif // GDS_GENERATOR_H
@@ -0,0 +1,636 @@
+/*
+ * This file is part of GDSII.
+ *
+ * main.cpp -- The benchmarks of the CGDS library on a synthetic layout.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/*
+ * Usage: Bench [--cells=N] [--depth=N] [--shapes=N] [--vertices=N]
+ *              [--refs=N] [--array=ROWSxCOLS] [--seed=N] [--threads=N]
+ *              [--dir=DIR] [--filter=TEXT] [--min_time=SECONDS] [--out=FILE]
+ *              [--trace=FILE]
+ *
+ * The layout is generated into DIR, and the databases converted from it
+ * are kept there. --out writes the results as JSON, in the format of
+ * Google Benchmark. With a library built with GDS_ENABLE_STATS, the
+ * counters of the library are printed after the benchmarks and --trace
+ * writes the timers as a Chrome trace.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sqlite3.h>
+#include "benchmark.h"
+#include "generator.h"
+#include "allocations.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/elements.h"
+#include "CGDS/boundary.h"
+#include "CGDS/path.h"
+#include "CGDS/sref.h"
+#include "CGDS/aref.h"
+#include "CGDS/gdsio.h"
+#include "CGDS/oasis.h"
+#include "CGDS/outline.h"
+#include "CGDS/parallel.h"
+#include "CGDS/stats.h"
+
+using namespace GDS;
+
+namespace {
+
+struct Settings
+{
+    GeneratorOptions    Layout;
+    std::string         Dir;
+    unsigned int        Threads;
+};
+
+Settings gSettings;
+
+std::string FilePath(const std::string &name)
+{
+    return gSettings.Dir + "/" + name;
+}
+
+unsigned long long FileSize(const std::string &file_name)
+{
+    std::ifstream in(file_name.c_str(), std::ios::binary | std::ios::ate);
+    return in ? (unsigned long long)in.tellg() : 0;
+}
+
+size_t CountElements(Library &lib)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < lib.Size(); i++)
+        count += lib.Get(int(i))->Size();
+    return count;
+}
+
+/*
+ * The generated GDSII file, written once.
+ */
+const std::string &LayoutFile()
+{
+    static std::string file_name;
+    if (file_name.empty())
+    {
+        std::string err;
+        file_name = FilePath("bench.gds");
+        if (!GenerateGDSII(file_name, gSettings.Layout, err))
+        {
+            fprintf(stderr, "Failed to generate %s: %s", file_name.c_str(), err.c_str());
+            exit(1);
+        }
+    }
+    return file_name;
+}
+
+/*
+ * A database of the generated layout in a cell format, converted once.
+ */
+std::string LayoutDatabase(CELL_FORMAT format)
+{
+    static bool converted[2] = { false, false };
+    std::string db_name = FilePath(format == CELL_FORMAT_COMPACT ? "bench_compact.db" : "bench.db");
+    if (!converted[format])
+    {
+        std::string err;
+        remove(db_name.c_str());
+        if (ConvertGDSII2DB(LayoutFile(), db_name, err, format))
+        {
+            fprintf(stderr, "Failed to convert %s: %s", LayoutFile().c_str(), err.c_str());
+            exit(1);
+        }
+        converted[format] = true;
+    }
+    return db_name;
+}
+
+/*
+ * The generated layout loaded once, for the benchmarks which only read it.
+ */
+Library &LayoutLibrary()
+{
+    static Library *lib = nullptr;
+    if (lib == nullptr)
+    {
+        lib = new Library;
+        std::string err;
+        if (!lib->LoadGDS(LayoutFile(), err))
+        {
+            fprintf(stderr, "Failed to load %s: %s", LayoutFile().c_str(), err.c_str());
+            exit(1);
+        }
+    }
+    return *lib;
+}
+
+void Convert(BenchmarkState &state, CELL_FORMAT format, const StorageProfile &profile)
+{
+    const std::string &gds_name = LayoutFile();
+    std::string db_name = FilePath("bench_convert.db");
+    std::string err;
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        remove(db_name.c_str());
+        state.ResumeTiming();
+        if (ConvertGDSII2DB(gds_name, db_name, err, format, profile))
+            state.SkipWithError(err);
+    }
+    state.SetBytesProcessed(FileSize(gds_name) * state.Iterations());
+    remove(db_name.c_str());
+}
+
+void OpenDatabase(BenchmarkState &state, const StorageProfile &profile)
+{
+    std::string db_name = LayoutDatabase(CELL_FORMAT_GDSII);
+    std::string err;
+    size_t elements = 0;
+    long long bytes = 0;
+    while (state.KeepRunning())
+    {
+        Library lib;
+        lib.SetStorageProfile(profile);
+        long long before = LiveBytes();
+        if (!lib.OpenDB(db_name, err))
+        {
+            state.SkipWithError(err);
+            break;
+        }
+        state.PauseTiming();
+        elements = CountElements(lib);
+        bytes = LiveBytes() - before;
+        state.ResumeTiming();
+        lib.CloseDB();
+    }
+    state.SetItemsProcessed(elements * state.Iterations());
+    if (elements > 0)
+        state.SetCounter("bytes_per_element", double(bytes) / elements);
+}
+
+/*
+ * Read and parse every cell of the database once, in a shuffled order, as
+ * an editor does when it opens cells at random.
+ */
+void LoadCellsAtRandom(BenchmarkState &state, const StorageProfile &profile)
+{
+    std::string db_name = LayoutDatabase(CELL_FORMAT_GDSII);
+    Library &layout = LayoutLibrary();
+    std::vector<std::string> names;
+    for (size_t i = 0; i < layout.Size(); i++)
+        names.push_back(layout.Get(int(i))->Name());
+    std::mt19937 random(gSettings.Layout.Seed);
+    std::shuffle(names.begin(), names.end(), random);
+
+    std::string err;
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    const char *sql = "SELECT DATA FROM cell_table WHERE ID=? LIMIT 1;";
+    if (sqlite3_open(db_name.c_str(), &db) != SQLITE_OK
+        || ApplyStorageProfile(db, profile, err)
+        || sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0) != SQLITE_OK)
+    {
+        state.SkipWithError(err.empty() ? std::string(sqlite3_errmsg(db)) : err);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        return;
+    }
+
+    unsigned long long bytes = 0;
+    while (state.KeepRunning())
+    {
+        bytes = 0;
+        for (auto &name : names)
+        {
+            sqlite3_reset(stmt);
+            sqlite3_bind_text(stmt, 1, name.c_str(), (int)name.size(), SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_ROW)
+            {
+                state.SkipWithError("Cell " + name + " is missing.");
+                break;
+            }
+            const char *data = (const char *)sqlite3_column_blob(stmt, 0);
+            int size = sqlite3_column_bytes(stmt, 0);
+            Structure cell;
+            if (cell.Read(data, size, err))
+            {
+                state.SkipWithError(err);
+                break;
+            }
+            bytes += size;
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    state.SetItemsProcessed(names.size() * state.Iterations());
+    state.SetBytesProcessed(bytes * state.Iterations());
+}
+
+void LoadGDS(BenchmarkState &state, unsigned int threads)
+{
+    const std::string &gds_name = LayoutFile();
+    std::string err;
+    size_t elements = 0;
+    long long bytes = 0;
+    while (state.KeepRunning())
+    {
+        Library lib;
+        long long before = LiveBytes();
+        if (!lib.LoadGDS(gds_name, err, threads))
+        {
+            state.SkipWithError(err);
+            break;
+        }
+        state.PauseTiming();
+        elements = CountElements(lib);
+        bytes = LiveBytes() - before;
+        lib.Clear();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(FileSize(gds_name) * state.Iterations());
+    if (elements > 0)
+        state.SetCounter("bytes_per_element", double(bytes) / elements);
+}
+
+void LibraryGet(BenchmarkState &state)
+{
+    Library &lib = LayoutLibrary();
+    std::vector<std::string> names;
+    for (size_t i = 0; i < lib.Size(); i++)
+        names.push_back(lib.Get(int(i))->Name());
+    size_t found = 0;
+    while (state.KeepRunning())
+    {
+        for (auto &name : names)
+            found += lib.Get(name) != nullptr;
+    }
+    state.SetItemsProcessed(names.size() * state.Iterations());
+    if (found != names.size() * state.Iterations())
+        state.SkipWithError("a cell is not found by its name");
+}
+
+void StructureBBox(BenchmarkState &state)
+{
+    Structure *top = LayoutLibrary().Get("TOP");
+    int x, y, w, h;
+    while (state.KeepRunning())
+        top->BBox(x, y, w, h);
+    state.SetItemsProcessed(state.Iterations());
+}
+
+void ReferenceBBox(BenchmarkState &state, Record_type tag)
+{
+    Library &lib = LayoutLibrary();
+    std::vector<const Element*> references;
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        Structure *cell = lib.Get(int(i));
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            if (cell->Get(int(k))->Tag() == tag)
+                references.push_back(cell->Get(int(k)));
+        }
+    }
+    if (references.empty())
+    {
+        state.SkipWithError("the layout has no such references");
+        return;
+    }
+    int x, y, w, h;
+    while (state.KeepRunning())
+    {
+        for (auto e : references)
+            e->BBox(x, y, w, h);
+    }
+    state.SetItemsProcessed(references.size() * state.Iterations());
+}
+
+template <typename T>
+void DecodeValues(BenchmarkState &state)
+{
+    const size_t COUNT = 1 << 20;
+    std::vector<char> data(COUNT * sizeof(T));
+    for (size_t i = 0; i < COUNT; i++)
+        Encode(T(i * 7 + 1), data.data() + i * sizeof(T));
+    T value;
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            Decode(data.data() + i * sizeof(T), value);
+            DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(COUNT * state.Iterations());
+    state.SetBytesProcessed(data.size() * state.Iterations());
+}
+
+void PointAccessor(BenchmarkState &state)
+{
+    Library &lib = LayoutLibrary();
+    std::vector<const Boundary*> boundaries;
+    size_t points = 0;
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        Structure *cell = lib.Get(int(i));
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            if (cell->Get(int(k))->Tag() == BOUNDARY)
+            {
+                boundaries.push_back(static_cast<const Boundary*>(cell->Get(int(k))));
+                points += boundaries.back()->XY().size();
+            }
+        }
+    }
+    long long sum = 0;
+    while (state.KeepRunning())
+    {
+        for (auto boundary : boundaries)
+        {
+            for (auto &pt : boundary->XY())
+                sum += pt.X ^ pt.Y;
+        }
+    }
+    state.SetItemsProcessed(points * state.Iterations());
+    if (sum == -1)
+        state.SetCounter("sum", double(sum));
+}
+
+void WriteGDS(BenchmarkState &state)
+{
+    Library &lib = LayoutLibrary();
+    std::string file_name = FilePath("bench_write.gds");
+    std::string err;
+    while (state.KeepRunning())
+    {
+        if (!lib.WriteGDS(file_name, err, gSettings.Threads))
+            state.SkipWithError(err);
+    }
+    state.SetBytesProcessed(FileSize(file_name) * state.Iterations());
+    remove(file_name.c_str());
+}
+
+void WriteOAS(BenchmarkState &state, bool compress)
+{
+    Library &lib = LayoutLibrary();
+    std::string file_name = FilePath("bench_write.oas");
+    std::string err;
+    while (state.KeepRunning())
+    {
+        if (WriteOASIS(file_name, lib, err, compress, gSettings.Threads))
+            state.SkipWithError(err);
+    }
+    state.SetBytesProcessed(FileSize(LayoutFile()) * state.Iterations());
+    state.SetCounter("file_bytes", double(FileSize(file_name)));
+    remove(file_name.c_str());
+}
+
+void ReadOAS(BenchmarkState &state)
+{
+    std::string file_name = FilePath("bench_read.oas");
+    std::string err;
+    if (WriteOASIS(file_name, LayoutLibrary(), err, false, gSettings.Threads))
+    {
+        state.SkipWithError(err);
+        return;
+    }
+    while (state.KeepRunning())
+    {
+        Library lib;
+        if (ReadOASIS(file_name, lib, err))
+            state.SkipWithError(err);
+    }
+    // The rate is of the equivalent GDSII data, to compare with LoadGDS.
+    state.SetBytesProcessed(FileSize(LayoutFile()) * state.Iterations());
+    remove(file_name.c_str());
+}
+
+void ScanSummaries(BenchmarkState &state)
+{
+    // The records of the cells, read from the GDSII file once.
+    std::vector<char> data;
+    {
+        std::ifstream in(LayoutFile().c_str(), std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::vector<CellOffset> index;
+    std::string err;
+    if (IndexGDSII(data.data(), data.size(), index, err))
+    {
+        state.SkipWithError(err);
+        return;
+    }
+    unsigned long long bytes = 0;
+    for (auto &cell : index)
+        bytes += cell.End - cell.Start;
+    CellSummary summary;
+    while (state.KeepRunning())
+    {
+        for (auto &cell : index)
+            ScanCellSummary(data.data() + cell.Start, size_t(cell.End - cell.Start), CELL_FORMAT_GDSII, summary);
+    }
+    state.SetBytesProcessed(bytes * state.Iterations());
+    state.SetItemsProcessed(index.size() * state.Iterations());
+}
+
+void ReadSummaries(BenchmarkState &state)
+{
+    std::string db_name = LayoutDatabase(CELL_FORMAT_GDSII);
+    std::vector<CellSummary> summaries;
+    std::string err;
+    while (state.KeepRunning())
+    {
+        if (ReadCellSummaries(db_name, summaries, err))
+            state.SkipWithError(err);
+    }
+    state.SetItemsProcessed(summaries.size() * state.Iterations());
+}
+
+void OutlineAllPaths(BenchmarkState &state)
+{
+    Library &lib = LayoutLibrary();
+    size_t segments = 0;
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        Structure *cell = lib.Get(int(i));
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            if (cell->Get(int(k))->Tag() == PATH)
+                segments += static_cast<const Path*>(cell->Get(int(k)))->XY().size() - 1;
+        }
+    }
+    std::vector<Polygon> polygons;
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < lib.Size(); i++)
+        {
+            polygons.clear();
+            OutlinePaths(lib.Get(int(i)), polygons);
+        }
+    }
+    state.SetItemsProcessed(segments * state.Iterations());
+}
+
+void RegisterAll()
+{
+    RegisterBenchmark("BM_ConvertGDSII2DB/gdsii/Default", [](BenchmarkState &state) {
+        Convert(state, CELL_FORMAT_GDSII, StorageProfile::Default());
+    });
+    RegisterBenchmark("BM_ConvertGDSII2DB/gdsii/BulkLoad", [](BenchmarkState &state) {
+        Convert(state, CELL_FORMAT_GDSII, StorageProfile::BulkLoad());
+    });
+    RegisterBenchmark("BM_ConvertGDSII2DB/compact/Default", [](BenchmarkState &state) {
+        Convert(state, CELL_FORMAT_COMPACT, StorageProfile::Default());
+    });
+    RegisterBenchmark("BM_ConvertGDSII2DB/compact/BulkLoad", [](BenchmarkState &state) {
+        Convert(state, CELL_FORMAT_COMPACT, StorageProfile::BulkLoad());
+    });
+    RegisterBenchmark("BM_OpenDB/Default", [](BenchmarkState &state) {
+        OpenDatabase(state, StorageProfile::Default());
+    });
+    RegisterBenchmark("BM_OpenDB/ReadMostly", [](BenchmarkState &state) {
+        OpenDatabase(state, StorageProfile::ReadMostly());
+    });
+    RegisterBenchmark("BM_LoadCellsAtRandom/Default", [](BenchmarkState &state) {
+        LoadCellsAtRandom(state, StorageProfile::Default());
+    });
+    RegisterBenchmark("BM_LoadCellsAtRandom/ReadMostly", [](BenchmarkState &state) {
+        LoadCellsAtRandom(state, StorageProfile::ReadMostly());
+    });
+    for (unsigned int threads = 1; ; threads *= 2)
+    {
+        threads = std::min(threads, gSettings.Threads);
+        RegisterBenchmark("BM_LoadGDS/threads:" + std::to_string(threads), [threads](BenchmarkState &state) {
+            LoadGDS(state, threads);
+        });
+        if (threads == gSettings.Threads)
+            break;
+    }
+    RegisterBenchmark("BM_LibraryGet", LibraryGet);
+    RegisterBenchmark("BM_StructureBBox/TOP", StructureBBox);
+    RegisterBenchmark("BM_SRefBBox", [](BenchmarkState &state) { ReferenceBBox(state, SREF); });
+    RegisterBenchmark("BM_ARefBBox", [](BenchmarkState &state) { ReferenceBBox(state, AREF); });
+    RegisterBenchmark("BM_DecodeReal8", DecodeValues<double>);
+    RegisterBenchmark("BM_DecodeInt4", DecodeValues<int>);
+    RegisterBenchmark("BM_DecodeInt2", DecodeValues<short>);
+    RegisterBenchmark("BM_BoundaryXY", PointAccessor);
+    RegisterBenchmark("BM_WriteGDS", WriteGDS);
+    RegisterBenchmark("BM_WriteOASIS", [](BenchmarkState &state) { WriteOAS(state, false); });
+    RegisterBenchmark("BM_WriteOASIS/cblock", [](BenchmarkState &state) { WriteOAS(state, true); });
+    RegisterBenchmark("BM_ReadOASIS", ReadOAS);
+    RegisterBenchmark("BM_ScanCellSummary", ScanSummaries);
+    RegisterBenchmark("BM_ReadCellSummaries", ReadSummaries);
+    RegisterBenchmark("BM_OutlinePaths", OutlineAllPaths);
+}
+
+bool Option(const char *arg, const char *name, std::string &value)
+{
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+        return false;
+    value = arg + length + 1;
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    gSettings.Dir = ".";
+    gSettings.Threads = DefaultThreadCount();
+    BenchmarkOptions options;
+    std::string trace;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string value;
+        if (Option(argv[i], "--cells", value))
+            gSettings.Layout.Cells = atoi(value.c_str());
+        else if (Option(argv[i], "--depth", value))
+            gSettings.Layout.Depth = atoi(value.c_str());
+        else if (Option(argv[i], "--shapes", value))
+            gSettings.Layout.Shapes = atoi(value.c_str());
+        else if (Option(argv[i], "--vertices", value))
+            gSettings.Layout.Vertices = atoi(value.c_str());
+        else if (Option(argv[i], "--refs", value))
+            gSettings.Layout.References = atoi(value.c_str());
+        else if (Option(argv[i], "--array", value))
+            sscanf(value.c_str(), "%dx%d", &gSettings.Layout.ArrayRows, &gSettings.Layout.ArrayCols);
+        else if (Option(argv[i], "--seed", value))
+            gSettings.Layout.Seed = (unsigned int)atoi(value.c_str());
+        else if (Option(argv[i], "--threads", value))
+            gSettings.Threads = std::max(atoi(value.c_str()), 1);
+        else if (Option(argv[i], "--dir", value))
+            gSettings.Dir = value;
+        else if (Option(argv[i], "--filter", value))
+            options.Filter = value;
+        else if (Option(argv[i], "--min_time", value))
+            options.MinTime = atof(value.c_str());
+        else if (Option(argv[i], "--out", value))
+            options.Output = value;
+        else if (Option(argv[i], "--trace", value))
+            trace = value;
+        else
+        {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    const GeneratorOptions &layout = gSettings.Layout;
+    options.Context["cells"] = std::to_string(layout.Cells);
+    options.Context["depth"] = std::to_string(layout.Depth);
+    options.Context["shapes"] = std::to_string(layout.Shapes);
+    options.Context["vertices"] = std::to_string(layout.Vertices);
+    options.Context["references"] = std::to_string(layout.References);
+    options.Context["array"] = std::to_string(layout.ArrayRows) + "x" + std::to_string(layout.ArrayCols);
+    options.Context["seed"] = std::to_string(layout.Seed);
+    options.Context["threads"] = std::to_string(gSettings.Threads);
+    options.Context["gds_bytes"] = std::to_string(FileSize(LayoutFile()));
+    options.Context["library_stats"] = Library::Stats().Enabled ? "enabled" : "disabled";
+
+    RegisterAll();
+    ResetStats();
+    if (!trace.empty())
+        StartTrace();
+    int rc = RunBenchmarks(options);
+    StopTrace();
+    if (Library::Stats().Enabled)
+        printf("\n%s", Library::Stats().ToString().c_str());
+    std::string err;
+    if (!trace.empty() && WriteTrace(trace, err))
+    {
+        printf("%s", err.c_str());
+        rc = 1;
+    }
+    remove(LayoutFile().c_str());
+    // A read-only connection closed last keeps the files of the WAL.
+    const char *suffixes[] = { "", "-wal", "-shm" };
+    for (auto suffix : suffixes)
+    {
+        remove(FilePath(std::string("bench.db") + suffix).c_str());
+        remove(FilePath(std::string("bench_compact.db") + suffix).c_str());
+    }
+    return rc;
+}
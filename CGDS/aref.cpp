@@ -34,7 +34,7 @@ namespace GDS
 ARef::ARef(Structure *parent) :Element(AREF, parent)
 {
     mEflags = 0;
-    mSName = "";
+    mSName = StringTable::EMPTY;
     mStrans = 0;
     mRow = 0;
     mCol = 0;
@@ -46,7 +46,12 @@ ARef::~ARef()
 {
 }
 
-std::string ARef::SName() const
+const std::string &ARef::SName() const
+{
+    return StringTable::Instance().Str(mSName);
+}
+
+StringTable::Id ARef::SNameId() const
 {
     return mSName;
 }
@@ -61,11 +66,22 @@ short ARef::Col() const
     return mCol;
 }
 
-std::vector<Point> ARef::XY() const
+const std::vector<Point> &ARef::XY() const
 {
     return mPts;
 }
 
+bool ARef::Pitch(Point &col_pitch, Point &row_pitch) const
+{
+    if (mPts.size() != 3 || mRow <= 0 || mCol <= 0)
+        return false;
+    col_pitch = Point((int)(((long long)mPts[1].X - mPts[0].X) / mCol),
+                      (int)(((long long)mPts[1].Y - mPts[0].Y) / mCol));
+    row_pitch = Point((int)(((long long)mPts[2].X - mPts[0].X) / mRow),
+                      (int)(((long long)mPts[2].Y - mPts[0].Y) / mRow));
+    return true;
+}
+
 double ARef::Angle() const
 {
     return mAngle;
@@ -76,6 +92,11 @@ double ARef::Mag() const
     return mMag;
 }
 
+short ARef::Eflags() const
+{
+    return mEflags;
+}
+
 short ARef::Strans() const
 {
     return mStrans;
@@ -86,40 +107,65 @@ bool ARef::StransFlag(STRANS_FLAG flag) const
     return (mStrans & flag) != 0;
 }
 
-void ARef::SetSName(std::string name)
+void ARef::SetSName(const std::string &name)
+{
+    mSName = StringTable::Instance().Intern(name);
+    Changed();
+}
+
+void ARef::SetSNameId(StringTable::Id name)
 {
     mSName = name;
+    Changed();
 }
 
 void ARef::SetRowCol(int row, int col)
 {
     mRow = row;
     mCol = col;
+    Changed();
 }
 
-void ARef::SetXY(std::vector<Point> pts)
+void ARef::SetXY(const std::vector<Point> &pts)
 {
     mPts = pts;
+    Changed();
+}
+
+void ARef::SetXY(std::vector<Point> &&pts)
+{
+    mPts = std::move(pts);
+    Changed();
 }
 
 void ARef::SetAngle(double angle)
 {
     mAngle = angle;
+    Changed();
 }
 
 void ARef::SetMag(double mag)
 {
     mMag = mag;
+    Changed();
+}
+
+void ARef::SetEflags(short eflags)
+{
+    mEflags = eflags;
+    Changed();
 }
 
 void ARef::SetStrans(short strans)
 {
     mStrans = strans;
+    Changed();
 }
 
 void ARef::SetStrans(STRANS_FLAG flag, bool enable)
 {
     mStrans = enable ? (mStrans | flag) : (mStrans & (~flag));
+    Changed();
 }
 
 
@@ -131,7 +177,7 @@ bool ARef::BBox(int &x, int &y, int &w, int &h) const
     gds = Parent()->Parent();
     if (gds == nullptr)
         return false;
-    Structure *reference = gds->Get(SName());
+    Structure *reference = gds->GetById(mSName);
     if (reference == nullptr)
         return false;
 
@@ -139,17 +185,15 @@ bool ARef::BBox(int &x, int &y, int &w, int &h) const
     if (!reference->BBox(ref_x, ref_y, ref_w, ref_h))
         return false;
 
-    assert(mPts.size() == 3);
-    int row_pitch_x = (mPts[2].X - mPts[0].X) / Row();
-    int row_pitch_y = (mPts[2].Y - mPts[0].Y) / Row();
-    int col_pitch_x = (mPts[1].X - mPts[0].X) / Col();
-    int col_pitch_y = (mPts[1].Y - mPts[0].Y) / Col();
+    Point col_pitch, row_pitch;
+    if (!Pitch(col_pitch, row_pitch))
+        return false;
     Point translate_pts[] = {
         Point(mPts[0].X, mPts[0].Y),
-        Point(mPts[0].X + col_pitch_x * (Col() - 1), mPts[0].Y + col_pitch_y * (Col() - 1)),
-        Point(mPts[0].X + row_pitch_x * (Row() - 1), mPts[0].Y + row_pitch_y * (Row() - 1)),
-        Point(mPts[0].X + row_pitch_x * (Row() - 1) + col_pitch_x * (Col() - 1),
-              mPts[0].Y + row_pitch_y * (Row() - 1) + col_pitch_y * (Col() - 1))
+        Point(mPts[0].X + col_pitch.X * (Col() - 1), mPts[0].Y + col_pitch.Y * (Col() - 1)),
+        Point(mPts[0].X + row_pitch.X * (Row() - 1), mPts[0].Y + row_pitch.Y * (Row() - 1)),
+        Point(mPts[0].X + row_pitch.X * (Row() - 1) + col_pitch.X * (Col() - 1),
+              mPts[0].Y + row_pitch.Y * (Row() - 1) + col_pitch.Y * (Col() - 1))
     };
 
     int llx = GDS_MAX_INT;
@@ -190,6 +234,31 @@ bool ARef::BBox(int &x, int &y, int &w, int &h) const
     return true;
 }
 
+bool ARef::Write(std::vector<char> &out) const
+{
+    if (mPts.size() != 3)
+        return false;
+    PutRecord(out, AREF);
+    if (mEflags != 0)
+        PutShortRecord(out, EFLAGS, BitArray, mEflags);
+    if (!PutStringRecord(out, SNAME, SName()))
+        return false;
+    if (mStrans != 0 || mMag != 1 || mAngle != 0)
+    {
+        PutShortRecord(out, STRANS, BitArray, mStrans);
+        if (mMag != 1)
+            PutDoubleRecord(out, MAG, &mMag, 1);
+        if (mAngle != 0)
+            PutDoubleRecord(out, ANGLE, &mAngle, 1);
+    }
+    short colrow[] = { mCol, mRow };
+    PutShortRecord(out, COLROW, Integer_2, colrow, 2);
+    PutXYRecord(out, mPts.data(), mPts.size());
+    PutRecord(out, ENDEL);
+
+    return true;
+}
+
 //int ARef::read(std::ifstream &in, std::string &msg)
 //{
 //    bool finished = false;
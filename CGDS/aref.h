@@ -22,6 +22,7 @@
 #ifndef AREF_H
 #define AREF_H
 #include "elements.h"
+#include "strtable.h"
 
 namespace GDS {
 class Structure;
@@ -41,7 +42,7 @@ class Structure;
     */
 class ARef : public Element {
     short               mEflags;
-    std::string         mSName;
+    StringTable::Id     mSName;
     short               mStrans;
     short               mRow, mCol;
     std::vector<Point>  mPts;
@@ -52,19 +53,33 @@ public:
     ARef(Structure *parent = nullptr);
     virtual ~ARef();
 
-    std::string SName() const;
+    /*!
+    The EFLAGS bits of the element, kept as they were read.
+    */
+    short Eflags() const;
+    const std::string &SName() const;
+    StringTable::Id SNameId() const;
     short Row() const;
     short Col() const;
-    std::vector<Point> XY() const;
+    const std::vector<Point> &XY() const;
+    /*!
+    Get the steps between neighbouring columns and rows of the array.
+    @return False if the array has not 3 points, or no column or row.
+    */
+    bool Pitch(Point &col_pitch, Point &row_pitch) const;
     double Angle() const;
     double Mag() const;
     short Strans() const;
     bool StransFlag(STRANS_FLAG flag) const;
     virtual bool BBox(int &x, int &y, int &w, int &h) const;
+    virtual bool Write(std::vector<char> &out) const;
 
-    void SetSName(std::string name);
+    void SetEflags(short eflags);
+    void SetSName(const std::string &name);
+    void SetSNameId(StringTable::Id name);
     void SetRowCol(int row,  int col);
-    void SetXY(std::vector<Point> pts);
+    void SetXY(const std::vector<Point> &pts);
+    void SetXY(std::vector<Point> &&pts);
     void SetAngle(double angle);
     void SetMag(double mag);
     void SetStrans(short strans);
@@ -0,0 +1,384 @@
+/*
+ * This file is part of GDSII.
+ *
+ * arrays.cpp -- The recognition of arrays in repeated SREFs and their
+ *               expansion.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include "arrays.h"
+#include "parallel.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "sref.h"
+#include "aref.h"
+
+namespace GDS {
+namespace {
+
+const int MAX_COUNT = 32767;    // COLROW holds 2-byte integers.
+
+typedef std::tuple<StringTable::Id, short, double, double> GroupKey;   // name, strans, angle, mag
+
+struct Placement
+{
+    int     X, Y;
+    size_t  Element;
+};
+
+/*
+ * A run of placements on a row, at [First, First + Count) of the sorted
+ * placements.
+ */
+struct Run
+{
+    int     X, Y;
+    int     Pitch;
+    int     Count;
+    size_t  First;
+};
+
+bool InRange(long long v)
+{
+    return v >= GDS_MIN_INT && v <= GDS_MAX_INT;
+}
+
+size_t RecordSize(const Element *e)
+{
+    std::vector<char> out;
+    e->Write(out);
+    return out.size();
+}
+
+class ArrayFinder
+{
+public:
+    ArrayFinder(const GroupKey &key, std::vector<Placement> &placements, int min_count)
+        : mKey(key), mPlacements(placements), mMinCount(min_count), mUsed(placements.size(), false)
+    {
+    }
+
+    /*!
+    Find the arrays of the placements.
+    @param replaced[out] The elements of the placements in an array are flagged.
+    @param arrays[out] The arrays are appended.
+    */
+    void Find(std::vector<bool> &replaced, std::vector<ARef*> &arrays);
+
+private:
+    void FindRuns(std::vector<Run> &runs) const;
+    void StackRuns(std::vector<Run> &runs);
+    void FindColumns();
+    /*!
+    Add an array unless its corners are out of range; flag its placements.
+    */
+    bool Emit(const Placement &origin, int col_dx, int col_dy, int cols,
+              int row_dx, int row_dy, int rows, const std::vector<size_t> &members);
+
+    const GroupKey          &mKey;
+    std::vector<Placement>  &mPlacements;
+    int                     mMinCount;
+    std::vector<bool>       mUsed;
+    std::vector<ARef*>      mArrays;
+};
+
+void ArrayFinder::Find(std::vector<bool> &replaced, std::vector<ARef*> &arrays)
+{
+    std::sort(mPlacements.begin(), mPlacements.end(), [](const Placement &a, const Placement &b) {
+        return a.Y != b.Y ? a.Y < b.Y : (a.X != b.X ? a.X < b.X : a.Element < b.Element);
+    });
+    std::vector<Run> runs;
+    FindRuns(runs);
+    StackRuns(runs);
+    FindColumns();
+    for (size_t i = 0; i < mPlacements.size(); i++)
+    {
+        if (mUsed[i])
+            replaced[mPlacements[i].Element] = true;
+    }
+    arrays.insert(arrays.end(), mArrays.begin(), mArrays.end());
+}
+
+void ArrayFinder::FindRuns(std::vector<Run> &runs) const
+{
+    size_t count = mPlacements.size();
+    size_t k = 0;
+    while (k < count)
+    {
+        size_t j = k + 1;
+        if (j < count && mPlacements[j].Y == mPlacements[k].Y && mPlacements[j].X != mPlacements[k].X)
+        {
+            long long pitch = (long long)mPlacements[j].X - mPlacements[k].X;
+            if (pitch <= GDS_MAX_INT)
+            {
+                while (j + 1 < count && j + 1 - k < MAX_COUNT && mPlacements[j + 1].Y == mPlacements[k].Y
+                       && (long long)mPlacements[j + 1].X - mPlacements[j].X == pitch)
+                    j++;
+                Run run = { mPlacements[k].X, mPlacements[k].Y, int(pitch), int(j - k + 1), k };
+                runs.push_back(run);
+                k = j + 1;
+                continue;
+            }
+        }
+        k = j;
+    }
+}
+
+void ArrayFinder::StackRuns(std::vector<Run> &runs)
+{
+    std::sort(runs.begin(), runs.end(), [](const Run &a, const Run &b) {
+        return std::tie(a.X, a.Pitch, a.Count, a.Y) < std::tie(b.X, b.Pitch, b.Count, b.Y);
+    });
+    std::vector<size_t> members;
+    size_t k = 0;
+    while (k < runs.size())
+    {
+        const Run &first = runs[k];
+        size_t j = k + 1;
+        long long pitch = 0;
+        auto stacks = [&](size_t a, size_t b) {
+            return runs[b].X == runs[a].X && runs[b].Pitch == runs[a].Pitch && runs[b].Count == runs[a].Count;
+        };
+        if (j < runs.size() && stacks(k, j))
+        {
+            long long dy = (long long)runs[j].Y - first.Y;
+            if (dy <= GDS_MAX_INT)
+            {
+                pitch = dy;
+                while (j + 1 < runs.size() && j + 1 - k < MAX_COUNT && stacks(k, j + 1)
+                       && (long long)runs[j + 1].Y - runs[j].Y == pitch)
+                    j++;
+                j++;
+            }
+        }
+        int rows = int(j - k);
+        if ((long long)rows * first.Count >= mMinCount)
+        {
+            members.clear();
+            for (size_t r = k; r < j; r++)
+            {
+                for (int c = 0; c < runs[r].Count; c++)
+                    members.push_back(runs[r].First + c);
+            }
+            Emit(mPlacements[first.First], first.Pitch, 0, first.Count, 0, int(pitch), rows, members);
+        }
+        k = j;
+    }
+}
+
+void ArrayFinder::FindColumns()
+{
+    std::vector<size_t> left;
+    for (size_t i = 0; i < mPlacements.size(); i++)
+    {
+        if (!mUsed[i])
+            left.push_back(i);
+    }
+    std::stable_sort(left.begin(), left.end(), [this](size_t a, size_t b) {
+        return mPlacements[a].X < mPlacements[b].X;
+    });
+    std::vector<size_t> members;
+    size_t k = 0;
+    while (k < left.size())
+    {
+        const Placement &first = mPlacements[left[k]];
+        size_t j = k + 1;
+        long long pitch = 0;
+        if (j < left.size() && mPlacements[left[j]].X == first.X && mPlacements[left[j]].Y != first.Y)
+        {
+            long long dy = (long long)mPlacements[left[j]].Y - first.Y;
+            if (dy <= GDS_MAX_INT)
+            {
+                pitch = dy;
+                while (j + 1 < left.size() && j + 1 - k < MAX_COUNT && mPlacements[left[j + 1]].X == first.X
+                       && (long long)mPlacements[left[j + 1]].Y - mPlacements[left[j]].Y == pitch)
+                    j++;
+                j++;
+            }
+        }
+        if (int(j - k) >= mMinCount)
+        {
+            members.assign(left.begin() + k, left.begin() + j);
+            Emit(first, 0, 0, 1, 0, int(pitch), int(j - k), members);
+        }
+        k = j;
+    }
+}
+
+bool ArrayFinder::Emit(const Placement &origin, int col_dx, int col_dy, int cols,
+                       int row_dx, int row_dy, int rows, const std::vector<size_t> &members)
+{
+    long long col_x = origin.X + (long long)col_dx * cols;
+    long long col_y = origin.Y + (long long)col_dy * cols;
+    long long row_x = origin.X + (long long)row_dx * rows;
+    long long row_y = origin.Y + (long long)row_dy * rows;
+    if (!InRange(col_x) || !InRange(col_y) || !InRange(row_x) || !InRange(row_y))
+        return false;
+
+    ARef *aref = new ARef();
+    aref->SetSNameId(std::get<0>(mKey));
+    aref->SetStrans(std::get<1>(mKey));
+    aref->SetAngle(std::get<2>(mKey));
+    aref->SetMag(std::get<3>(mKey));
+    aref->SetRowCol(rows, cols);
+    std::vector<Point> pts;
+    pts.push_back(Point(origin.X, origin.Y));
+    pts.push_back(Point(int(col_x), int(col_y)));
+    pts.push_back(Point(int(row_x), int(row_y)));
+    aref->SetXY(std::move(pts));
+    mArrays.push_back(aref);
+    for (auto i : members)
+        mUsed[i] = true;
+    return true;
+}
+
+}
+
+ArrayReport::ArrayReport()
+{
+    ElementsBefore = 0;
+    ElementsAfter = 0;
+    SRefsReplaced = 0;
+    ArraysAdded = 0;
+    BytesSaved = 0;
+}
+
+void RecognizeArrays(Structure *cell, ArrayReport &report, int min_count)
+{
+    if (cell == nullptr)
+        return;
+    if (min_count < 2)
+        min_count = 2;
+
+    std::map<GroupKey, std::vector<Placement>> groups;
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        Element *e = cell->Get(int(i));
+        if (e->Tag() != SREF)
+            continue;
+        SRef *sref = static_cast<SRef*>(e);
+        Placement placement = { sref->XY().X, sref->XY().Y, i };
+        groups[GroupKey(sref->SNameId(), sref->Strans(), sref->Angle(), sref->Mag())].push_back(placement);
+    }
+
+    std::vector<bool> replaced(cell->Size(), false);
+    std::vector<ARef*> arrays;
+    for (auto &group : groups)
+    {
+        if (group.second.size() < size_t(min_count))
+            continue;
+        ArrayFinder finder(group.first, group.second, min_count);
+        finder.Find(replaced, arrays);
+    }
+
+    report.ElementsBefore += cell->Size();
+    for (size_t i = 0; i < replaced.size(); i++)
+    {
+        if (!replaced[i])
+            continue;
+        report.SRefsReplaced++;
+        report.BytesSaved += RecordSize(cell->Get(int(i)));
+    }
+    for (auto aref : arrays)
+    {
+        report.BytesSaved -= RecordSize(aref);
+        cell->Add(aref);
+    }
+    report.ArraysAdded += arrays.size();
+    // The arrays are added first so that the flags do not cover them.
+    cell->Remove(replaced);
+    report.ElementsAfter += cell->Size();
+}
+
+void RecognizeArrays(Library &lib, ArrayReport &report, int min_count, unsigned int threads)
+{
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    std::vector<ArrayReport> reports(threads);
+    ParallelFor(lib.Size(), threads, [&](size_t index, unsigned int thread) {
+        RecognizeArrays(lib.Get(int(index)), reports[thread], min_count);
+    });
+    report = ArrayReport();
+    for (auto &part : reports)
+    {
+        report.ElementsBefore += part.ElementsBefore;
+        report.ElementsAfter += part.ElementsAfter;
+        report.SRefsReplaced += part.SRefsReplaced;
+        report.ArraysAdded += part.ArraysAdded;
+        report.BytesSaved += part.BytesSaved;
+    }
+}
+
+size_t ExpandArrays(Structure *cell)
+{
+    if (cell == nullptr)
+        return 0;
+
+    std::vector<bool> expanded(cell->Size(), false);
+    std::vector<SRef*> srefs;
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        Element *e = cell->Get(int(i));
+        if (e->Tag() != AREF)
+            continue;
+        ARef *aref = static_cast<ARef*>(e);
+        Point col_pitch, row_pitch;
+        if (!aref->Pitch(col_pitch, row_pitch))
+            continue;
+        const std::vector<Point> &pts = aref->XY();
+        int rows = aref->Row();
+        int cols = aref->Col();
+        for (int r = 0; r < rows; r++)
+        {
+            for (int c = 0; c < cols; c++)
+            {
+                SRef *sref = new SRef();
+                sref->SetSNameId(aref->SNameId());
+                sref->SetStrans(aref->Strans());
+                sref->SetAnagle(aref->Angle());
+                sref->SetMag(aref->Mag());
+                sref->SetXY(Point(pts[0].X + col_pitch.X * c + row_pitch.X * r, pts[0].Y + col_pitch.Y * c + row_pitch.Y * r));
+                srefs.push_back(sref);
+            }
+        }
+        expanded[i] = true;
+    }
+    for (auto sref : srefs)
+        cell->Add(sref);
+    cell->Remove(expanded);
+    return srefs.size();
+}
+
+size_t ExpandArrays(Library &lib, unsigned int threads)
+{
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    std::vector<size_t> counts(threads, 0);
+    ParallelFor(lib.Size(), threads, [&](size_t index, unsigned int thread) {
+        counts[thread] += ExpandArrays(lib.Get(int(index)));
+    });
+    size_t count = 0;
+    for (auto n : counts)
+        count += n;
+    return count;
+}
+
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of GDSII.
+ *
+ * arrays.h -- The header file which declare the recognition of arrays in
+ *             repeated SREFs and their expansion.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_ARRAYS_H
+#define GDS_ARRAYS_H
+#include <cstddef>
+
+namespace GDS {
+class Structure;
+class Library;
+
+/*!
+ * \brief What the recognition of arrays changed.
+ */
+struct ArrayReport
+{
+    size_t      ElementsBefore;
+    size_t      ElementsAfter;
+    size_t      SRefsReplaced;
+    size_t      ArraysAdded;
+    long long   BytesSaved;     //< The GDSII records of the SREFs replaced less those of the AREFs.
+
+    ArrayReport();
+};
+
+/*
+ * SREFs of the same cell, transformation and magnification are sorted by
+ * their origins. Each row of origins is cut into runs of a constant pitch,
+ * and runs of the same start, pitch and length on rows of a constant pitch
+ * are stacked into arrays. The origins left over are cut into runs of a
+ * constant pitch along each column. An array of at least min_count SREFs
+ * replaces them; it is appended after the other elements, which keep
+ * their order. The flat placements do not change.
+ */
+
+/*!
+ * Replace the SREFs of a cell which lie on a regular grid by AREFs.
+ * @param report[out] The counts of the cell are added.
+ * @param min_count The fewest SREFs an array replaces; at least 2.
+ */
+void RecognizeArrays(Structure *cell, ArrayReport &report, int min_count = 4);
+/*!
+ * Replace the regular SREFs of all cells of a library by AREFs.
+ * @param report[out] The counts are reset and set for the library.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void RecognizeArrays(Library &lib, ArrayReport &report, int min_count = 4, unsigned int threads = 0);
+
+/*!
+ * Replace the AREFs of a cell by an SREF for each of their instances.
+ * @return The number of SREFs added.
+ */
+size_t ExpandArrays(Structure *cell);
+/*!
+ * Replace the AREFs of all cells of a library by SREFs.
+ * @return The number of SREFs added.
+ */
+size_t ExpandArrays(Library &lib, unsigned int threads = 0);
+
+}
+
+#endif // GDS_ARRAYS_H
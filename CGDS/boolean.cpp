@@ -0,0 +1,865 @@
+/*
+ * This file is part of GDSII.
+ *
+ * boolean.cpp -- The source file which defines the Boolean operations on
+ *                polygons.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "boolean.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "boundary.h"
+#include "path.h"
+#include "box.h"
+#include "sref.h"
+#include "aref.h"
+#include "transform.h"
+#include "parallel.h"
+
+namespace GDS
+{
+
+namespace
+{
+
+const size_t TILE_EDGES = 1 << 14;  // Edges per tile on average.
+const int MAX_TILES = 256;          // Tiles along each axis at most.
+const double CROSS_EPS = 1e-6;      // Crossings closer than this to a stop are at the stop.
+
+struct DPoint
+{
+    double X, Y;
+    DPoint(double x, double y)
+    {
+        X = x;
+        Y = y;
+    }
+};
+typedef std::vector<DPoint> DPolygon;
+
+struct Rect
+{
+    long long Left, Bottom, Right, Top;
+};
+
+// The bounds of a polygon, and 1 for counterclockwise or -1.
+struct Extent
+{
+    Rect Bounds;
+    int Dir;
+};
+
+struct Edge
+{
+    double X0, Y0, X1, Y1;  //< Y0 < Y1
+    int Dir;                //< 1 if the polygon goes up along the edge, or -1.
+    int Set;                //< 0 for a, 1 for b.
+
+    double XAt(double y) const
+    {
+        if (y <= Y0)
+            return X0;
+        if (y >= Y1)
+            return X1;
+        return X0 + (X1 - X0) * (y - Y0) / (Y1 - Y0);
+    }
+};
+
+bool IsInside(BOOLEAN_OP op, int wa, int wb)
+{
+    switch (op)
+    {
+    case BOOLEAN_OR:
+        return wa != 0 || wb != 0;
+    case BOOLEAN_AND:
+        return wa != 0 && wb != 0;
+    case BOOLEAN_NOT:
+        return wa != 0 && wb == 0;
+    case BOOLEAN_XOR:
+        return (wa != 0) != (wb != 0);
+    default:
+        return false;
+    }
+}
+
+int Round(double value)
+{
+    return (int)std::floor(value + 0.5);
+}
+
+Extent GetExtent(const Polygon &polygon)
+{
+    Extent extent;
+    Rect &rect = extent.Bounds;
+    rect.Left = GDS_MAX_INT;
+    rect.Bottom = GDS_MAX_INT;
+    rect.Right = GDS_MIN_INT;
+    rect.Top = GDS_MIN_INT;
+    double area = 0;
+    for (size_t i = 0; i < polygon.size(); i++)
+    {
+        const Point &p = polygon[i];
+        const Point &q = polygon[i + 1 == polygon.size() ? 0 : i + 1];
+        rect.Left = p.X < rect.Left ? p.X : rect.Left;
+        rect.Bottom = p.Y < rect.Bottom ? p.Y : rect.Bottom;
+        rect.Right = p.X > rect.Right ? p.X : rect.Right;
+        rect.Top = p.Y > rect.Top ? p.Y : rect.Top;
+        area += (double)p.X * q.Y - (double)q.X * p.Y;
+    }
+    extent.Dir = area < 0 ? -1 : 1;
+    return extent;
+}
+
+// One step of Sutherland-Hodgman: keep the part of a polygon on the inner
+// side of a line. The winding numbers inside are kept.
+template <typename Inside, typename Cross>
+void ClipSide(const DPolygon &in, DPolygon &out, Inside inside, Cross cross)
+{
+    out.clear();
+    if (in.empty())
+        return;
+    DPoint prev = in.back();
+    bool prev_inside = inside(prev);
+    for (auto &p : in)
+    {
+        bool cur_inside = inside(p);
+        if (cur_inside != prev_inside)
+            out.push_back(cross(prev, p));
+        if (cur_inside)
+            out.push_back(p);
+        prev = p;
+        prev_inside = cur_inside;
+    }
+}
+
+void ClipPolygon(const Polygon &polygon, const Rect &rect, DPolygon &out, DPolygon &tmp)
+{
+    double left = (double)rect.Left;
+    double bottom = (double)rect.Bottom;
+    double right = (double)rect.Right;
+    double top = (double)rect.Top;
+    tmp.clear();
+    for (auto &p : polygon)
+        tmp.push_back(DPoint(p.X, p.Y));
+    ClipSide(tmp, out, [&](const DPoint &p) { return p.X >= left; },
+             [&](const DPoint &p, const DPoint &q) { return DPoint(left, p.Y + (q.Y - p.Y) * (left - p.X) / (q.X - p.X)); });
+    ClipSide(out, tmp, [&](const DPoint &p) { return p.X <= right; },
+             [&](const DPoint &p, const DPoint &q) { return DPoint(right, p.Y + (q.Y - p.Y) * (right - p.X) / (q.X - p.X)); });
+    ClipSide(tmp, out, [&](const DPoint &p) { return p.Y >= bottom; },
+             [&](const DPoint &p, const DPoint &q) { return DPoint(p.X + (q.X - p.X) * (bottom - p.Y) / (q.Y - p.Y), bottom); });
+    ClipSide(out, tmp, [&](const DPoint &p) { return p.Y <= top; },
+             [&](const DPoint &p, const DPoint &q) { return DPoint(p.X + (q.X - p.X) * (top - p.Y) / (q.Y - p.Y), top); });
+    out.swap(tmp);
+}
+
+/*
+ * Horizontal edges do not change the winding numbers, so they are dropped.
+ * The directions are multiplied by dir, which makes the inside of every
+ * polygon positive; polygons of other orientations would cancel out.
+ */
+template <typename P>
+void AddEdges(const std::vector<P> &polygon, int set, int dir, std::vector<Edge> &edges)
+{
+    size_t n = polygon.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        const P &p = polygon[i];
+        const P &q = polygon[i + 1 == n ? 0 : i + 1];
+        if (p.Y == q.Y)
+            continue;
+        Edge edge;
+        if (p.Y < q.Y)
+        {
+            edge.X0 = p.X;
+            edge.Y0 = p.Y;
+            edge.X1 = q.X;
+            edge.Y1 = q.Y;
+            edge.Dir = dir;
+        }
+        else
+        {
+            edge.X0 = q.X;
+            edge.Y0 = q.Y;
+            edge.X1 = p.X;
+            edge.Y1 = p.Y;
+            edge.Dir = -dir;
+        }
+        edge.Set = set;
+        edges.push_back(edge);
+    }
+}
+
+void AddTrapezoid(std::vector<Polygon> &out, double bottom, double left0, double right0,
+                  double top, double left1, double right1)
+{
+    int y0 = Round(bottom);
+    int y1 = Round(top);
+    if (y0 == y1)
+        return;
+    int l0 = Round(left0);
+    int r0 = Round(right0);
+    int l1 = Round(left1);
+    int r1 = Round(right1);
+    r0 = r0 < l0 ? l0 : r0;
+    r1 = r1 < l1 ? l1 : r1;
+
+    Point corners[] = { Point(l0, y0), Point(r0, y0), Point(r1, y1), Point(l1, y1) };
+    Polygon polygon;
+    polygon.reserve(5);
+    for (auto &p : corners)
+    {
+        if (polygon.empty() || p.X != polygon.back().X || p.Y != polygon.back().Y)
+            polygon.push_back(p);
+    }
+    if (polygon.size() < 3)
+        return;
+    polygon.push_back(polygon.front());
+    out.push_back(std::move(polygon));
+}
+
+void GetStops(const std::vector<Edge> &edges, std::vector<double> &stops)
+{
+    stops.clear();
+    stops.reserve(edges.size() * 2);
+    for (auto &e : edges)
+    {
+        stops.push_back(e.Y0);
+        stops.push_back(e.Y1);
+    }
+    std::sort(stops.begin(), stops.end());
+    stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+}
+
+// Replace the edges which end at y with the ones which start there.
+void UpdateActive(std::vector<Edge> &edges, size_t &next, double y, std::vector<const Edge*> &active)
+{
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [&](const Edge *e) { return e->Y1 <= y; }),
+                 active.end());
+    for (; next < edges.size() && edges[next].Y0 <= y; next++)
+        active.push_back(&edges[next]);
+}
+
+/*
+ * Sort the active edges, which are nearly sorted: new edges are at the
+ * end, and the order changes little from one stop to the next.
+ */
+template <typename Less>
+void InsertionSort(std::vector<const Edge*> &active, Less less)
+{
+    for (size_t i = 1; i < active.size(); i++)
+    {
+        const Edge *e = active[i];
+        size_t j = i;
+        for (; j > 0 && less(e, active[j - 1]); j--)
+            active[j] = active[j - 1];
+        active[j] = e;
+    }
+}
+
+/*
+ * Every edge is vertical: the spans of the result change only at the
+ * stops, and a rectangle stays open while its span is the same.
+ */
+void SweepManhattan(std::vector<Edge> &edges, BOOLEAN_OP op, std::vector<Polygon> &out)
+{
+    struct Span
+    {
+        long long Left, Right;
+        double Bottom;
+    };
+    auto close = [&](const Span &span, double top)
+    {
+        AddTrapezoid(out, span.Bottom, (double)span.Left, (double)span.Right,
+                     top, (double)span.Left, (double)span.Right);
+    };
+
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.Y0 < b.Y0; });
+    std::vector<double> stops;
+    GetStops(edges, stops);
+
+    std::vector<const Edge*> active;
+    std::vector<long long> bounds;
+    std::vector<Span> open, next_open;
+    size_t next = 0;
+    for (auto y : stops)
+    {
+        UpdateActive(edges, next, y, active);
+        InsertionSort(active, [](const Edge *a, const Edge *b) { return a->X0 < b->X0; });
+
+        // The spans of the result above y.
+        bounds.clear();
+        int wind[2] = { 0, 0 };
+        bool inside = false;
+        for (size_t i = 0; i < active.size();)
+        {
+            double x = active[i]->X0;
+            for (; i < active.size() && active[i]->X0 == x; i++)
+                wind[active[i]->Set] += active[i]->Dir;
+            if (IsInside(op, wind[0], wind[1]) != inside)
+            {
+                inside = !inside;
+                bounds.push_back((long long)x);
+            }
+        }
+
+        // Keep the rectangles of the same spans open, and close the others.
+        next_open.clear();
+        size_t j = 0;
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2)
+        {
+            for (; j < open.size() && open[j].Left < bounds[i]; j++)
+                close(open[j], y);
+            if (j < open.size() && open[j].Left == bounds[i])
+            {
+                if (open[j].Right == bounds[i + 1])
+                {
+                    next_open.push_back(open[j++]);
+                    continue;
+                }
+                close(open[j++], y);
+            }
+            Span span = { bounds[i], bounds[i + 1], y };
+            next_open.push_back(span);
+        }
+        for (; j < open.size(); j++)
+            close(open[j], y);
+        open.swap(next_open);
+    }
+}
+
+/*
+ * The stops of the sweep are the ends of the edges and their crossings.
+ * A trapezoid stays open while it is between the same two edges.
+ */
+void SweepGeneral(std::vector<Edge> &edges, BOOLEAN_OP op, std::vector<Polygon> &out)
+{
+    struct Span
+    {
+        double Bottom, Left, Right;
+    };
+    typedef std::pair<const Edge*, const Edge*> Sides;
+    auto close = [&](const Sides &sides, const Span &span, double top)
+    {
+        AddTrapezoid(out, span.Bottom, span.Left, span.Right,
+                     top, sides.first->XAt(top), sides.second->XAt(top));
+    };
+
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.Y0 < b.Y0; });
+    std::vector<double> stops;
+    GetStops(edges, stops);
+
+    std::vector<const Edge*> active;
+    std::vector<double> crossings;
+    std::map<Sides, Span> open, next_open;
+    size_t next = 0;
+    for (size_t s = 0; s < stops.size(); s++)
+    {
+        double y = stops[s];
+        UpdateActive(edges, next, y, active);
+        double end = s + 1 < stops.size() ? stops[s + 1] : y;
+        if (active.empty())
+        {
+            for (auto &e : open)
+                close(e.first, e.second, y);
+            open.clear();
+            continue;
+        }
+
+        // The order just above y. The edges which swap before the next stop
+        // cross in between, and each crossing is a stop too.
+        InsertionSort(active, [&](const Edge *a, const Edge *b)
+        {
+            double xa = a->XAt(y);
+            double xb = b->XAt(y);
+            return xa != xb ? xa < xb : a->XAt(end) < b->XAt(end);
+        });
+        crossings.clear();
+        InsertionSort(active, [&](const Edge *a, const Edge *b)
+        {
+            double d1 = a->XAt(end) - b->XAt(end);
+            if (d1 >= 0)
+                return false;
+            double d0 = b->XAt(y) - a->XAt(y);
+            if (d0 < 0)
+            {
+                double cross = y + (end - y) * (-d0) / (-d1 - d0);
+                if (cross > y + CROSS_EPS && cross < end - CROSS_EPS)
+                    crossings.push_back(cross);
+            }
+            return true;
+        });
+        std::sort(crossings.begin(), crossings.end());
+        crossings.erase(std::unique(crossings.begin(), crossings.end()), crossings.end());
+        crossings.push_back(end);
+
+        for (auto top : crossings)
+        {
+            double mid = (y + top) / 2;
+            InsertionSort(active, [&](const Edge *a, const Edge *b)
+            {
+                return a->XAt(mid) < b->XAt(mid);
+            });
+
+            next_open.clear();
+            int wind[2] = { 0, 0 };
+            const Edge *left = nullptr;
+            for (size_t i = 0; i < active.size();)
+            {
+                const Edge *first = active[i];
+                double x = first->XAt(mid);
+                for (; i < active.size() && active[i]->XAt(mid) == x; i++)
+                    wind[active[i]->Set] += active[i]->Dir;
+                bool inside = IsInside(op, wind[0], wind[1]);
+                if (inside && left == nullptr)
+                {
+                    left = active[i - 1];
+                }
+                else if (!inside && left != nullptr)
+                {
+                    Sides sides(left, first);
+                    auto iter = open.find(sides);
+                    if (iter != open.end())
+                    {
+                        next_open.insert(*iter);
+                        open.erase(iter);
+                    }
+                    else
+                    {
+                        Span span = { y, left->XAt(y), first->XAt(y) };
+                        next_open.insert(std::make_pair(sides, span));
+                    }
+                    left = nullptr;
+                }
+            }
+            for (auto &e : open)
+                close(e.first, e.second, y);
+            open.swap(next_open);
+            y = top;
+        }
+    }
+}
+
+// A horizontal or vertical edge of a trapezoid.
+struct AxisEdge
+{
+    int Line;       //< y of a horizontal edge, or x of a vertical one.
+    int Low, High;
+    int Side;       //< 1 if the trapezoid is on the side of larger coordinates, or 0.
+};
+
+/*
+ * The parts of a line covered on one side only are on the boundary. The
+ * edges are sorted by line, and each line is swept along its coordinate.
+ */
+void AddAxisEdges(std::vector<AxisEdge> &axis_edges, bool horizontal, std::vector<Segment> &edges)
+{
+    std::sort(axis_edges.begin(), axis_edges.end(), [](const AxisEdge &a, const AxisEdge &b)
+    {
+        return a.Line != b.Line ? a.Line < b.Line : a.Low < b.Low;
+    });
+    auto add = [&](int line, int from, int to, int side)
+    {
+        // The union is on the left: above a horizontal edge going right,
+        // and to the right of a vertical edge going down.
+        Segment segment;
+        if (horizontal)
+        {
+            segment.Start = Point(side ? from : to, line);
+            segment.End = Point(side ? to : from, line);
+        }
+        else
+        {
+            segment.Start = Point(line, side ? to : from);
+            segment.End = Point(line, side ? from : to);
+        }
+        edges.push_back(segment);
+    };
+
+    std::vector<std::pair<int, int> > events;   // (coordinate, +1/-1 for side 0, +2/-2 for side 1)
+    for (size_t i = 0; i < axis_edges.size();)
+    {
+        int line = axis_edges[i].Line;
+        events.clear();
+        for (; i < axis_edges.size() && axis_edges[i].Line == line; i++)
+        {
+            int weight = axis_edges[i].Side ? 2 : 1;
+            events.push_back(std::make_pair(axis_edges[i].Low, weight));
+            events.push_back(std::make_pair(axis_edges[i].High, -weight));
+        }
+        std::sort(events.begin(), events.end());
+
+        int cover[2] = { 0, 0 };
+        int state = -1;     // The side covered alone, or -1.
+        int from = 0;
+        for (size_t k = 0; k < events.size();)
+        {
+            int x = events[k].first;
+            for (; k < events.size() && events[k].first == x; k++)
+            {
+                int weight = events[k].second;
+                cover[weight == 2 || weight == -2] += weight > 0 ? 1 : -1;
+            }
+            int next = (cover[0] > 0) == (cover[1] > 0) ? -1 : (cover[1] > 0 ? 1 : 0);
+            if (next != state)
+            {
+                if (state >= 0 && x > from)
+                    add(line, from, x, state);
+                state = next;
+                from = x;
+            }
+        }
+    }
+}
+
+struct Tile
+{
+    Rect Bounds;
+    std::vector<size_t> Members[2];
+};
+
+void SweepTile(const Tile &tile, const std::vector<Polygon> *sets[2], const std::vector<Extent> *extents[2],
+               BOOLEAN_OP op, std::vector<Polygon> &out)
+{
+    std::vector<Edge> edges;
+    DPolygon clipped, tmp;
+    for (int set = 0; set < 2; set++)
+    {
+        for (auto index : tile.Members[set])
+        {
+            const Extent &extent = (*extents[set])[index];
+            const Rect &rect = extent.Bounds;
+            if (rect.Left >= tile.Bounds.Left && rect.Right <= tile.Bounds.Right
+                && rect.Bottom >= tile.Bounds.Bottom && rect.Top <= tile.Bounds.Top)
+            {
+                AddEdges((*sets[set])[index], set, extent.Dir, edges);
+            }
+            else
+            {
+                ClipPolygon((*sets[set])[index], tile.Bounds, clipped, tmp);
+                AddEdges(clipped, set, extent.Dir, edges);
+            }
+        }
+    }
+
+    bool manhattan = true;
+    for (auto &e : edges)
+    {
+        if (e.X0 != e.X1)
+        {
+            manhattan = false;
+            break;
+        }
+    }
+    if (manhattan)
+        SweepManhattan(edges, op, out);
+    else
+        SweepGeneral(edges, op, out);
+}
+
+void AddPath(const Path *path, const Transform *transform, std::vector<Polygon> &polygons)
+{
+    polygons.push_back(Polygon());
+    if (!OutlinePath(path, polygons.back()))
+    {
+        polygons.pop_back();
+        return;
+    }
+    if (transform != nullptr)
+    {
+        for (auto &p : polygons.back())
+            p = transform->Map(p);
+    }
+}
+
+void AddPoints(const std::vector<Point> &pts, const Transform *transform, std::vector<Polygon> &polygons)
+{
+    polygons.push_back(pts);
+    if (transform != nullptr)
+    {
+        for (auto &p : polygons.back())
+            p = transform->Map(p);
+    }
+}
+
+Transform PlacementTransform(bool reflection, double mag, double angle, Point pt)
+{
+    Transform transform;
+    if (reflection)
+        transform.Scale(1, -1);
+    transform.Scale(mag, mag);
+    transform.Rotate(angle);
+    transform.Translate(pt.X, pt.Y);
+    return transform;
+}
+
+void CollectCell(const Structure *cell, const std::vector<LayerKey> &layers, const Transform *transform,
+                 std::vector<const Structure*> &path, std::vector<Polygon> &polygons)
+{
+    auto wanted = [&](short layer, short data_type)
+    {
+        return std::binary_search(layers.begin(), layers.end(), LayerKey(layer, data_type));
+    };
+    Library *lib = cell->Parent();
+    path.push_back(cell);
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        const Element *e = cell->Get((int)i);
+        switch (e->Tag())
+        {
+        case BOUNDARY:
+        {
+            const Boundary *boundary = static_cast<const Boundary*>(e);
+            if (wanted(boundary->Layer(), boundary->DataType()))
+                AddPoints(boundary->XY(), transform, polygons);
+            break;
+        }
+        case BOX_BOUNDARY:
+        {
+            const Box *box = static_cast<const Box*>(e);
+            if (wanted(box->Layer(), box->DataType()))
+                AddPoints(box->XY(), transform, polygons);
+            break;
+        }
+        case PATH:
+        {
+            const Path *p = static_cast<const Path*>(e);
+            if (wanted(p->Layer(), p->DataType()))
+                AddPath(p, transform, polygons);
+            break;
+        }
+        case SREF:
+        {
+            const SRef *ref = static_cast<const SRef*>(e);
+            const Structure *child = lib == nullptr ? nullptr : lib->GetById(ref->SNameId());
+            if (child == nullptr || std::find(path.begin(), path.end(), child) != path.end())
+                break;
+            Transform placement = PlacementTransform(ref->StransFlag(REFLECTION), ref->Mag(), ref->Angle(), ref->XY());
+            if (transform != nullptr)
+                placement.Multiply(*transform);
+            CollectCell(child, layers, &placement, path, polygons);
+            break;
+        }
+        case AREF:
+        {
+            const ARef *ref = static_cast<const ARef*>(e);
+            const Structure *child = lib == nullptr ? nullptr : lib->GetById(ref->SNameId());
+            Point col_pitch, row_pitch;
+            if (child == nullptr || std::find(path.begin(), path.end(), child) != path.end()
+                || !ref->Pitch(col_pitch, row_pitch))
+                break;
+            const Point &origin = ref->XY()[0];
+            for (int row = 0; row < ref->Row(); row++)
+            {
+                for (int col = 0; col < ref->Col(); col++)
+                {
+                    Point pt(origin.X + row_pitch.X * row + col_pitch.X * col,
+                             origin.Y + row_pitch.Y * row + col_pitch.Y * col);
+                    Transform placement = PlacementTransform(ref->StransFlag(REFLECTION), ref->Mag(), ref->Angle(), pt);
+                    if (transform != nullptr)
+                        placement.Multiply(*transform);
+                    CollectCell(child, layers, &placement, path, polygons);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    path.pop_back();
+}
+
+}
+
+void Boolean(const std::vector<Polygon> &a, const std::vector<Polygon> &b, BOOLEAN_OP op,
+             std::vector<Polygon> &result, unsigned int threads)
+{
+    result.clear();
+    const std::vector<Polygon> *sets[2] = { &a, &b };
+    std::vector<Extent> polygon_extents[2];
+    const std::vector<Extent> *extents[2] = { &polygon_extents[0], &polygon_extents[1] };
+    Rect all = { GDS_MAX_INT, GDS_MAX_INT, GDS_MIN_INT, GDS_MIN_INT };
+    size_t edges = 0;
+    for (int set = 0; set < 2; set++)
+    {
+        polygon_extents[set].reserve(sets[set]->size());
+        for (auto &polygon : *sets[set])
+        {
+            polygon_extents[set].push_back(GetExtent(polygon));
+            const Rect &rect = polygon_extents[set].back().Bounds;
+            if (polygon.empty())
+                continue;
+            all.Left = std::min(all.Left, rect.Left);
+            all.Bottom = std::min(all.Bottom, rect.Bottom);
+            all.Right = std::max(all.Right, rect.Right);
+            all.Top = std::max(all.Top, rect.Top);
+            edges += polygon.size();
+        }
+    }
+    if (edges == 0)
+        return;
+
+    // Split the area into a grid of tiles with about TILE_EDGES edges each,
+    // and at least a few tiles for each thread.
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    size_t count = edges / TILE_EDGES;
+    if (threads > 1 && edges > TILE_EDGES)
+        count = std::max(count, (size_t)threads * 4);
+    long long n = (long long)std::ceil(std::sqrt((double)std::max(count, (size_t)1)));
+    long long nx = std::max(1LL, std::min(std::min(n, (long long)MAX_TILES), all.Right - all.Left));
+    long long ny = std::max(1LL, std::min(std::min(n, (long long)MAX_TILES), all.Top - all.Bottom));
+    std::vector<long long> xs(nx + 1), ys(ny + 1);
+    for (long long i = 0; i <= nx; i++)
+        xs[i] = all.Left + (all.Right - all.Left) * i / nx;
+    for (long long i = 0; i <= ny; i++)
+        ys[i] = all.Bottom + (all.Top - all.Bottom) * i / ny;
+
+    std::vector<Tile> tiles((size_t)(nx * ny));
+    for (long long j = 0; j < ny; j++)
+    {
+        for (long long i = 0; i < nx; i++)
+        {
+            Rect &rect = tiles[(size_t)(j * nx + i)].Bounds;
+            rect.Left = xs[i];
+            rect.Right = xs[i + 1];
+            rect.Bottom = ys[j];
+            rect.Top = ys[j + 1];
+        }
+    }
+    for (int set = 0; set < 2; set++)
+    {
+        for (size_t k = 0; k < polygon_extents[set].size(); k++)
+        {
+            const Rect &rect = polygon_extents[set][k].Bounds;
+            if ((*sets[set])[k].empty())
+                continue;
+            long long i0 = std::upper_bound(xs.begin() + 1, xs.end() - 1, rect.Left) - xs.begin() - 1;
+            long long i1 = std::lower_bound(xs.begin() + 1, xs.end() - 1, rect.Right) - xs.begin() - 1;
+            long long j0 = std::upper_bound(ys.begin() + 1, ys.end() - 1, rect.Bottom) - ys.begin() - 1;
+            long long j1 = std::lower_bound(ys.begin() + 1, ys.end() - 1, rect.Top) - ys.begin() - 1;
+            for (long long j = j0; j <= j1; j++)
+            {
+                for (long long i = i0; i <= i1; i++)
+                    tiles[(size_t)(j * nx + i)].Members[set].push_back(k);
+            }
+        }
+    }
+
+    std::vector<std::vector<Polygon> > parts(tiles.size());
+    ParallelFor(tiles.size(), threads, [&](size_t i, unsigned int)
+    {
+        SweepTile(tiles[i], sets, extents, op, parts[i]);
+    });
+
+    size_t total = 0;
+    for (auto &part : parts)
+        total += part.size();
+    result.reserve(total);
+    for (auto &part : parts)
+    {
+        for (auto &polygon : part)
+            result.push_back(std::move(polygon));
+    }
+}
+
+void Merge(const std::vector<Polygon> &polygons, std::vector<Polygon> &result, unsigned int threads)
+{
+    Boolean(polygons, std::vector<Polygon>(), BOOLEAN_OR, result, threads);
+}
+
+void MergeEdges(const std::vector<Polygon> &polygons, std::vector<Segment> &edges, unsigned int threads)
+{
+    std::vector<Polygon> merged;
+    Merge(polygons, merged, threads);
+
+    // Axis-parallel edges are collected by their line: 1 if the union is
+    // on the side of larger coordinates, or 0.
+    std::vector<AxisEdge> horizontal, vertical;
+    edges.clear();
+    for (auto &polygon : merged)
+    {
+        for (size_t i = 0; i + 1 < polygon.size(); i++)
+        {
+            const Point &p = polygon[i];
+            const Point &q = polygon[i + 1];
+            if (p.Y == q.Y)
+            {
+                AxisEdge e = { p.Y, std::min(p.X, q.X), std::max(p.X, q.X), q.X > p.X ? 1 : 0 };
+                horizontal.push_back(e);
+            }
+            else if (p.X == q.X)
+            {
+                AxisEdge e = { p.X, std::min(p.Y, q.Y), std::max(p.Y, q.Y), q.Y < p.Y ? 1 : 0 };
+                vertical.push_back(e);
+            }
+            else
+            {
+                Segment segment = { p, q };
+                edges.push_back(segment);
+            }
+        }
+    }
+    AddAxisEdges(horizontal, true, edges);
+    AddAxisEdges(vertical, false, edges);
+}
+
+void CollectPolygons(const Structure *cell, const std::vector<LayerKey> &layers,
+                     std::vector<Polygon> &polygons)
+{
+    std::vector<LayerKey> sorted(layers);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<const Structure*> path;
+    CollectCell(cell, sorted, nullptr, path, polygons);
+}
+
+void Boolean(const Structure *cell, const std::vector<LayerKey> &a, const std::vector<LayerKey> &b,
+             BOOLEAN_OP op, Structure *target, LayerKey layer, unsigned int threads)
+{
+    std::vector<Polygon> pa, pb, result;
+    CollectPolygons(cell, a, pa);
+    CollectPolygons(cell, b, pb);
+    Boolean(pa, pb, op, result, threads);
+
+    for (auto &polygon : result)
+    {
+        if (Box::IsRectangle(polygon))
+        {
+            Box *box = new Box;
+            box->SetLayer(layer.first);
+            box->SetDataType(layer.second);
+            box->SetXY(polygon);
+            target->Add(box);
+        }
+        else
+        {
+            Boundary *boundary = new Boundary;
+            boundary->SetLayer(layer.first);
+            boundary->SetDataType(layer.second);
+            boundary->SetXY(std::move(polygon));
+            target->Add(boundary);
+        }
+    }
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+ * This file is part of GDSII.
+ *
+ * boolean.h -- The header file which declare the Boolean operations on
+ *              polygons.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_BOOLEAN_H
+#define GDS_BOOLEAN_H
+#include <vector>
+#include "tags.h"
+#include "census.h"
+#include "outline.h"
+
+namespace GDS {
+class Structure;
+
+/*!
+ * \brief An edge of the boundary of a region, which is on its left.
+ */
+struct Segment
+{
+    Point Start, End;
+};
+
+enum BOOLEAN_OP
+{
+    BOOLEAN_OR,
+    BOOLEAN_AND,
+    BOOLEAN_NOT,    //< a minus b
+    BOOLEAN_XOR,
+};
+
+/*
+ * The operations sweep a horizontal line over the edges of the polygons.
+ * Between two stops of the line the edges do not cross, so the area is a
+ * row of trapezoids, each of which is inside or outside the result by the
+ * winding numbers of the two sets on its left side. The polygons of a set
+ * may overlap in any orientation: each one is turned counterclockwise, and
+ * a point is inside a set where its winding number is not 0.
+ *
+ * When every edge is horizontal or vertical, the sweep runs on integers
+ * and returns rectangles. Otherwise the crossings of the edges become
+ * stops too, and the corners of the trapezoids are rounded to the grid.
+ *
+ * Large inputs are split into tiles, which are swept on several threads.
+ * The polygons are clipped to each tile, so the result does not continue
+ * across the borders of the tiles.
+ */
+
+/*!
+ * Compute a Boolean operation between two sets of polygons.
+ * @param a, b The sets of polygons.
+ * @param op The operation.
+ * @param result[out] Trapezoids which do not overlap, merged where one
+ *                    continues another.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void Boolean(const std::vector<Polygon> &a, const std::vector<Polygon> &b, BOOLEAN_OP op,
+             std::vector<Polygon> &result, unsigned int threads = 0);
+/*!
+ * Merge a set of polygons, which is Boolean(polygons, {}, BOOLEAN_OR).
+ */
+void Merge(const std::vector<Polygon> &polygons, std::vector<Polygon> &result, unsigned int threads = 0);
+/*!
+ * Get the boundary of the union of a set of polygons. The edges between
+ * the trapezoids of Merge are dropped, and the horizontal and vertical
+ * edges on a line are joined where they continue each other.
+ * @param edges[out] The edges, with the union on their left.
+ */
+void MergeEdges(const std::vector<Polygon> &polygons, std::vector<Segment> &edges, unsigned int threads = 0);
+
+/*!
+ * Get the polygons on some layers of a cell and of the cells under it,
+ * in the coordinates of the cell. Boundary and Box are taken as they are,
+ * and a Path becomes its outline from OutlinePath.
+ * @param cell The cell.
+ * @param layers The (layer, datatype) pairs.
+ * @param polygons[out] The polygons are appended.
+ */
+void CollectPolygons(const Structure *cell, const std::vector<LayerKey> &layers,
+                     std::vector<Polygon> &polygons);
+/*!
+ * Compute a Boolean operation between two sets of layers of a cell, and
+ * add the result to a cell as Box and Boundary elements.
+ * @param cell The cell to read, with the cells under it.
+ * @param a, b The (layer, datatype) pairs of the two sets.
+ * @param target The cell to add the result to, which may be cell itself.
+ * @param layer The (layer, datatype) of the result.
+ */
+void Boolean(const Structure *cell, const std::vector<LayerKey> &a, const std::vector<LayerKey> &b,
+             BOOLEAN_OP op, Structure *target, LayerKey layer, unsigned int threads = 0);
+
+}
+
+#endif // GDS_BOOLEAN_H
@@ -40,6 +40,11 @@ Boundary::~Boundary()
 
 }
 
+short Boundary::Eflags() const
+{
+	return mEflags;
+}
+
 short Boundary::Layer() const
 {
 	return mLayer;
@@ -50,25 +55,66 @@ short Boundary::DataType() const
 	return mDataType;
 }
 
-std::vector<Point> Boundary::XY() const
+const std::vector<Point> &Boundary::XY() const
 {
 	return mPts;
 }
 
+void Boundary::SetEflags(short eflags)
+{
+	mEflags = eflags;
+	Changed();
+}
+
 void Boundary::SetLayer(short layer)
 {
 	mLayer = layer;
+	Changed();
 }
 
 void Boundary::SetDataType(short data_type)
 {
 	mDataType = data_type;
+	Changed();
 }
 
 void Boundary::SetXY(const std::vector<Point> &pts)
 {
-	mPts.clear();
 	mPts = pts;
+	Changed();
+}
+
+void Boundary::SetXY(std::vector<Point> &&pts)
+{
+	mPts = std::move(pts);
+	Changed();
+}
+
+bool Boundary::SetPoint(int index, Point pt)
+{
+	if (index < 0 || index >= (int)mPts.size())
+		return false;
+	mPts[index] = pt;
+	Changed();
+	return true;
+}
+
+bool Boundary::InsertPoint(int index, Point pt)
+{
+	if (index < 0 || index > (int)mPts.size())
+		return false;
+	mPts.insert(mPts.begin() + index, pt);
+	Changed();
+	return true;
+}
+
+bool Boundary::RemovePoint(int index)
+{
+	if (index < 0 || index >= (int)mPts.size())
+		return false;
+	mPts.erase(mPts.begin() + index);
+	Changed();
+	return true;
 }
 
 bool Boundary::BBox(int &x, int &y, int &w, int &h) const
@@ -77,7 +123,7 @@ bool Boundary::BBox(int &x, int &y, int &w, int &h) const
 	int lly = GDS_MAX_INT;
 	int urx = GDS_MIN_INT;
 	int ury = GDS_MIN_INT;
-	for (auto pt : mPts)
+	for (const auto &pt : mPts)
 	{
 		llx = pt.X < llx ? pt.X : llx;
 		lly = pt.Y < lly ? pt.Y : lly;
@@ -92,6 +138,20 @@ bool Boundary::BBox(int &x, int &y, int &w, int &h) const
 	return true;
 }
 
+bool Boundary::Write(std::vector<char> &out) const
+{
+	PutRecord(out, BOUNDARY);
+	if (mEflags != 0)
+		PutShortRecord(out, EFLAGS, BitArray, mEflags);
+	PutShortRecord(out, LAYER, Integer_2, mLayer);
+	PutShortRecord(out, DATATYPE, Integer_2, mDataType);
+	if (!PutXYRecord(out, mPts.data(), mPts.size()))
+		return false;
+	PutRecord(out, ENDEL);
+
+	return true;
+}
+
 //int Boundary::read(std::ifstream &in, std::string &msg)
 //{
 //	msg = "";
@@ -44,21 +44,35 @@ public:
     Boundary(Structure *parent = nullptr);
     virtual ~Boundary();
 
+    /*!
+    The EFLAGS bits of the element, kept as they were read.
+    */
+    short Eflags() const;
     short Layer() const;
     short DataType() const;
-    std::vector<Point> XY() const;
+    const std::vector<Point> &XY() const;
     virtual bool BBox(int &x, int &y, int &w, int &h) const;
+    virtual bool Write(std::vector<char> &out) const;
 
+    void SetEflags(short eflags);
     void SetLayer(short layer);
     void SetDataType(short data_type);
     void SetXY(const std::vector<Point> &pts);
+    void SetXY(std::vector<Point> &&pts);
+    /*!
+    Edit a vertex in place.
+    @return False if the index is out of range.
+    */
+    bool SetPoint(int index, Point pt);
+    bool InsertPoint(int index, Point pt);
+    bool RemovePoint(int index);
 
     /*virtual int read(std::ifstream &in, std::string &msg);
     virtual int write(std::ofstream &out, std::string &msg);*/
 
 private:
 
-    short               mEflags;         //< 2 bytes of bit flags. Not support yet.
+    short               mEflags;         //< 2 bytes of bit flags.
     short               mLayer;
     short               mDataType;
     std::vector<Point>  mPts;
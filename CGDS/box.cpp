@@ -0,0 +1,184 @@
+/*
+ * This file is part of GDSII.
+ *
+ * box.cpp -- The source file which defines the rectangular BOUNDARY.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "box.h"
+#include "gdsio.h"
+
+namespace GDS
+{
+
+Box::Box(Structure *parent) :Element(BOX_BOUNDARY, parent)
+{
+    mLayer = -1;
+    mDataType = -1;
+    mLeft = 0;
+    mBottom = 0;
+    mRight = 0;
+    mTop = 0;
+    mOrder = 0;
+}
+
+Box::~Box()
+{
+
+}
+
+short Box::Layer() const
+{
+    return mLayer;
+}
+
+short Box::DataType() const
+{
+    return mDataType;
+}
+
+int Box::Left() const
+{
+    return mLeft;
+}
+
+int Box::Bottom() const
+{
+    return mBottom;
+}
+
+int Box::Right() const
+{
+    return mRight;
+}
+
+int Box::Top() const
+{
+    return mTop;
+}
+
+void Box::FillXY(Point *pts) const
+{
+    // Corners in counterclockwise order, starting from the left bottom one.
+    Point corners[] = {
+        Point(mLeft, mBottom),
+        Point(mRight, mBottom),
+        Point(mRight, mTop),
+        Point(mLeft, mTop)
+    };
+    int start = mOrder & 0x3;
+    int step = (mOrder & 0x4) ? 3 : 1;
+
+    for (int i = 0; i < 4; i++)
+        pts[i] = corners[(start + i * step) % 4];
+    pts[4] = corners[start];
+}
+
+std::vector<Point> Box::XY() const
+{
+    std::vector<Point> pts(5);
+    FillXY(pts.data());
+    return pts;
+}
+
+bool Box::BBox(int &x, int &y, int &w, int &h) const
+{
+    x = mLeft;
+    y = mBottom;
+    w = mRight - mLeft;
+    h = mTop - mBottom;
+
+    return true;
+}
+
+bool Box::Write(std::vector<char> &out) const
+{
+    Point pts[5];
+    FillXY(pts);
+
+    PutRecord(out, BOUNDARY);
+    PutShortRecord(out, LAYER, Integer_2, mLayer);
+    PutShortRecord(out, DATATYPE, Integer_2, mDataType);
+    PutXYRecord(out, pts, 5);
+    PutRecord(out, ENDEL);
+
+    return true;
+}
+
+void Box::SetLayer(short layer)
+{
+    mLayer = layer;
+    Changed();
+}
+
+void Box::SetDataType(short data_type)
+{
+    mDataType = data_type;
+    Changed();
+}
+
+void Box::SetRect(int x, int y, int w, int h)
+{
+    mLeft = w >= 0 ? x : x + w;
+    mRight = w >= 0 ? x + w : x;
+    mBottom = h >= 0 ? y : y + h;
+    mTop = h >= 0 ? y + h : y;
+    mOrder = 0;
+    Changed();
+}
+
+bool Box::SetXY(const std::vector<Point> &pts)
+{
+    if (!IsRectangle(pts))
+        return false;
+
+    mLeft = pts[0].X < pts[2].X ? pts[0].X : pts[2].X;
+    mRight = pts[0].X < pts[2].X ? pts[2].X : pts[0].X;
+    mBottom = pts[0].Y < pts[2].Y ? pts[0].Y : pts[2].Y;
+    mTop = pts[0].Y < pts[2].Y ? pts[2].Y : pts[0].Y;
+
+    int start;
+    if (pts[0].Y == mBottom)
+        start = pts[0].X == mLeft ? 0 : 1;
+    else
+        start = pts[0].X == mRight ? 2 : 3;
+    // The next corner counterclockwise shares X with the start corner
+    // when the start corner is on the right side, or Y otherwise.
+    bool ccw = (start == 1 || start == 3) ? pts[1].X == pts[0].X : pts[1].Y == pts[0].Y;
+    mOrder = (unsigned char)(start | (ccw ? 0 : 0x4));
+
+    Changed();
+    return true;
+}
+
+bool Box::IsRectangle(const std::vector<Point> &pts)
+{
+    if (pts.size() != 5)
+        return false;
+    if (pts[4].X != pts[0].X || pts[4].Y != pts[0].Y)
+        return false;
+    if (pts[0].X == pts[2].X || pts[0].Y == pts[2].Y)
+        return false;
+
+    bool vertical_first = pts[0].X == pts[1].X && pts[1].Y == pts[2].Y
+        && pts[2].X == pts[3].X && pts[3].Y == pts[0].Y;
+    bool horizontal_first = pts[0].Y == pts[1].Y && pts[1].X == pts[2].X
+        && pts[2].Y == pts[3].Y && pts[3].X == pts[0].X;
+    return vertical_first || horizontal_first;
+}
+
+}
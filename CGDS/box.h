@@ -0,0 +1,81 @@
+/*
+ * This file is part of GDSII.
+ *
+ * box.h -- The header file which declare the rectangular BOUNDARY.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_BOX_H
+#define GDS_BOX_H
+#include "elements.h"
+
+namespace GDS {
+
+/*!
+    * \brief Compact form of an axis-aligned rectangular 'BOUNDARY'.
+    *
+    * Most of the BOUNDARY records in a layout are 5-point rectangles.
+    * They are kept as the two corners instead of a point vector, and
+    * are written back as a standard 5-point BOUNDARY. The start corner
+    * and the winding of the original point list are remembered, so the
+    * written record is identical to the one which was read.
+    */
+class Box : public Element
+{
+public:
+    Box(Structure *parent = nullptr);
+    virtual ~Box();
+
+    short Layer() const;
+    short DataType() const;
+    int Left() const;
+    int Bottom() const;
+    int Right() const;
+    int Top() const;
+    /*!
+    Get the points of the rectangle as a closed 5-point BOUNDARY.
+    */
+    std::vector<Point> XY() const;
+    virtual bool BBox(int &x, int &y, int &w, int &h) const;
+    virtual bool Write(std::vector<char> &out) const;
+
+    void SetLayer(short layer);
+    void SetDataType(short data_type);
+    void SetRect(int x, int y, int w, int h);
+    /*!
+    Set the rectangle from the points of a BOUNDARY.
+    @return False if the points are not an axis-aligned rectangle.
+    */
+    bool SetXY(const std::vector<Point> &pts);
+
+    /*!
+    Check whether the points of a BOUNDARY can be kept as a Box.
+    */
+    static bool IsRectangle(const std::vector<Point> &pts);
+
+private:
+    void FillXY(Point *pts) const;
+
+    short               mLayer;
+    short               mDataType;
+    int                 mLeft, mBottom, mRight, mTop;
+    unsigned char       mOrder;         //< Start corner (bit 0-1) and clockwise flag (bit 2) of the original points.
+};
+
+}
+
+#endif // GDS_BOX_H
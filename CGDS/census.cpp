@@ -0,0 +1,174 @@
+/*
+ * This file is part of GDSII.
+ *
+ * census.cpp -- The source file which defines the layer census of cells.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <vector>
+#include "census.h"
+#include "tags.h"
+#include "elements.h"
+#include "boundary.h"
+#include "path.h"
+#include "outline.h"
+#include "box.h"
+#include "transform.h"
+
+namespace GDS
+{
+
+LayerStats::LayerStats()
+{
+    Shapes = 0;
+    Vertices = 0;
+    Left = GDS_MAX_INT;
+    Bottom = GDS_MAX_INT;
+    Right = GDS_MIN_INT;
+    Top = GDS_MIN_INT;
+}
+
+void LayerStats::AddShape(int left, int bottom, int right, int top, unsigned long long vertices)
+{
+    Shapes++;
+    Vertices += vertices;
+    Left = left < Left ? left : Left;
+    Bottom = bottom < Bottom ? bottom : Bottom;
+    Right = right > Right ? right : Right;
+    Top = top > Top ? top : Top;
+}
+
+void LayerStats::AddInstance(const LayerStats &child, const Transform &transform, unsigned long long copies)
+{
+    if (child.Shapes == 0)
+        return;
+    Shapes += child.Shapes * copies;
+    Vertices += child.Vertices * copies;
+
+    Point corners[] = {
+        Point(child.Left, child.Bottom),
+        Point(child.Right, child.Bottom),
+        Point(child.Right, child.Top),
+        Point(child.Left, child.Top)
+    };
+    for (auto p : corners)
+    {
+        Point tmp = transform.Map(p);
+        Left = tmp.X < Left ? tmp.X : Left;
+        Bottom = tmp.Y < Bottom ? tmp.Y : Bottom;
+        Right = tmp.X > Right ? tmp.X : Right;
+        Top = tmp.Y > Top ? tmp.Y : Top;
+    }
+}
+
+namespace
+{
+
+void AddPoints(LayerStats &stats, const std::vector<Point> &pts)
+{
+    int llx = GDS_MAX_INT;
+    int lly = GDS_MAX_INT;
+    int urx = GDS_MIN_INT;
+    int ury = GDS_MIN_INT;
+    for (const auto &pt : pts)
+    {
+        llx = pt.X < llx ? pt.X : llx;
+        lly = pt.Y < lly ? pt.Y : lly;
+        urx = pt.X > urx ? pt.X : urx;
+        ury = pt.Y > ury ? pt.Y : ury;
+    }
+    stats.AddShape(llx, lly, urx, ury, pts.size());
+}
+
+}
+
+void AddToCensus(LayerCensus &census, const Element *element)
+{
+    switch (element->Tag())
+    {
+    case BOUNDARY:
+    {
+        const Boundary *boundary = static_cast<const Boundary*>(element);
+        if (!boundary->XY().empty())
+            AddPoints(census[LayerKey(boundary->Layer(), boundary->DataType())], boundary->XY());
+        break;
+    }
+    case PATH:
+    {
+        // The extents of the outline, with its miters and extensions. A
+        // path without area is counted at its points.
+        const Path *path = static_cast<const Path*>(element);
+        int left, bottom, right, top;
+        if (OutlineBounds(path, left, bottom, right, top))
+            census[LayerKey(path->Layer(), path->DataType())]
+                .AddShape(left, bottom, right, top, path->XY().size());
+        else if (!path->XY().empty())
+            AddPoints(census[LayerKey(path->Layer(), path->DataType())], path->XY());
+        break;
+    }
+    case BOX_BOUNDARY:
+    {
+        const Box *box = static_cast<const Box*>(element);
+        census[LayerKey(box->Layer(), box->DataType())]
+            .AddShape(box->Left(), box->Bottom(), box->Right(), box->Top(), 5);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+LayerFilter::LayerFilter()
+{
+}
+
+LayerFilter::LayerFilter(const std::vector<short> &layers)
+{
+    for (auto layer : layers)
+        Add(layer);
+}
+
+void LayerFilter::Add(short layer)
+{
+    if (mLayers.empty())
+        mLayers.resize(1 << 16, false);
+    mLayers[(unsigned short)layer] = true;
+}
+
+void LayerFilter::Clear()
+{
+    mLayers.clear();
+}
+
+bool LayerFilter::IsEmpty() const
+{
+    return mLayers.empty();
+}
+
+bool LayerFilter::Accept(short layer) const
+{
+    return mLayers.empty() || mLayers[(unsigned short)layer];
+}
+
+void AddToCensus(LayerCensus &census, const LayerCensus &child,
+                 const Transform &transform, unsigned long long copies)
+{
+    for (auto &e : child)
+        census[e.first].AddInstance(e.second, transform, copies);
+}
+
+}
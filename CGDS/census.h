@@ -0,0 +1,90 @@
+/*
+ * This file is part of GDSII.
+ *
+ * census.h -- The header file which declare the layer census of cells.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_CENSUS_H
+#define GDS_CENSUS_H
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace GDS {
+class Element;
+class Transform;
+
+/*!
+ * \brief The shapes of a (layer, datatype) pair.
+ */
+struct LayerStats
+{
+    unsigned long long  Shapes;
+    unsigned long long  Vertices;   //< Points of the XY records; a Box has 5.
+    int                 Left, Bottom, Right, Top;   //< Extents of the shapes.
+
+    LayerStats();
+    void AddShape(int left, int bottom, int right, int top, unsigned long long vertices);
+    /*!
+    Add the shapes of an instance: the counts are multiplied by copies,
+    and the extents are mapped by transform.
+    */
+    void AddInstance(const LayerStats &child, const Transform &transform, unsigned long long copies);
+};
+
+typedef std::pair<short, short> LayerKey;       //< (layer, datatype)
+typedef std::map<LayerKey, LayerStats> LayerCensus;
+
+/*!
+ * \brief The layers to keep when cells are read.
+ *
+ * A filter without layers keeps every layer. The elements other than SREF
+ * and AREF on the other layers are skipped by Structure::Read before they
+ * are parsed.
+ */
+class LayerFilter
+{
+public:
+    LayerFilter();
+    LayerFilter(const std::vector<short> &layers);
+
+    void Add(short layer);
+    void Clear();
+    /*!
+    Whether the filter keeps every layer.
+    */
+    bool IsEmpty() const;
+    bool Accept(short layer) const;
+
+private:
+    std::vector<bool>   mLayers;    //< Indexed by the layer as unsigned short; empty for every layer.
+};
+
+/*!
+ * Add a Boundary, Path or Box to a census. Other elements are ignored.
+ */
+void AddToCensus(LayerCensus &census, const Element *element);
+/*!
+ * Add the census of a cell placed by transform copies times.
+ */
+void AddToCensus(LayerCensus &census, const LayerCensus &child,
+                 const Transform &transform, unsigned long long copies);
+
+}
+
+#endif // GDS_CENSUS_H
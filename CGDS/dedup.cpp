@@ -0,0 +1,666 @@
+/*
+ * This file is part of GDSII.
+ *
+ * dedup.cpp -- The merging of identical cells.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include "dedup.h"
+#include "gdsio.h"
+#include "parallel.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "sref.h"
+#include "aref.h"
+
+namespace GDS {
+namespace {
+
+typedef unsigned long long Hash;
+
+Hash Mix(Hash h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+Hash Combine(Hash seed, Hash value)
+{
+    return Mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+Hash HashBytes(const char *data, size_t size)
+{
+    Hash h = Mix(size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        Hash word;
+        memcpy(&word, data + i, 8);
+        h = Combine(h, word);
+    }
+    Hash tail = 0;
+    for (; i < size; i++)
+        tail = (tail << 8) | (unsigned char)data[i];
+    return Combine(h, tail);
+}
+
+/*
+ * Visit the nodes of a graph children first. A child which is being
+ * visited, on a cycle, is skipped.
+ */
+void PostOrder(const std::vector<std::vector<size_t>> &children, std::vector<size_t> &order)
+{
+    enum { NEW, OPEN, DONE };
+    size_t count = children.size();
+    std::vector<char> state(count, NEW);
+    std::vector<std::pair<size_t, size_t>> stack;
+    order.clear();
+    for (size_t root = 0; root < count; root++)
+    {
+        if (state[root] != NEW)
+            continue;
+        state[root] = OPEN;
+        stack.push_back(std::make_pair(root, size_t(0)));
+        while (!stack.empty())
+        {
+            size_t node = stack.back().first;
+            size_t &next = stack.back().second;
+            if (next < children[node].size())
+            {
+                size_t child = children[node][next++];
+                if (child < count && state[child] == NEW)
+                {
+                    state[child] = OPEN;
+                    stack.push_back(std::make_pair(child, size_t(0)));
+                }
+                continue;
+            }
+            state[node] = DONE;
+            order.push_back(node);
+            stack.pop_back();
+        }
+    }
+}
+
+/*
+ * The records of a cell in cell_table without BGNSTR, STRNAME and SNAME;
+ * the names in SNAME are listed in order instead.
+ */
+bool BaseRecords(const char *data, size_t size, std::vector<char> &out, std::vector<std::string> &names)
+{
+    out.clear();
+    names.clear();
+    const char *cursor = data;
+    const char *end = data + size;
+    while (cursor < end)
+    {
+        const char *record = cursor;
+        int record_size;
+        Byte type, dt;
+        if (!ReadRecordHeader(cursor, end, record_size, type, dt))
+            return false;
+        cursor = record + record_size;
+        if (type == BGNSTR || type == STRNAME)
+            continue;
+        if (type == SNAME)
+        {
+            std::string name;
+            for (const char *p = record + 4; p < cursor; p++)
+            {
+                if (*p != '\0')
+                    name.push_back(*p);
+            }
+            names.push_back(name);
+            continue;
+        }
+        out.insert(out.end(), record, cursor);
+    }
+    return true;
+}
+
+class DatabaseCells
+{
+public:
+    DatabaseCells() : mDB(nullptr), mRead(nullptr), mFormat(CELL_FORMAT_GDSII), mNameCount(0) {}
+    ~DatabaseCells();
+
+    int Open(const std::string &dbName, std::string &err);
+    int Find(std::vector<std::vector<std::string>> &groups, std::string &err);
+
+private:
+    struct Cell
+    {
+        std::string             Name;
+        long long               RowId;
+        Hash                    Base;       //< The hash of BaseRecords.
+        std::vector<size_t>     References; //< Cells, or names beyond the cells which are not in cell_table.
+    };
+
+    int Scan(std::string &err);
+    int ReadBase(const Cell &cell, std::vector<char> &out, std::string &err);
+
+    sqlite3             *mDB;
+    sqlite3_stmt        *mRead;
+    short               mFormat;
+    std::vector<Cell>   mCells;
+    std::vector<char>   mDecoded;
+    size_t              mNameCount;     //< The cells and the names of missing cells.
+};
+
+DatabaseCells::~DatabaseCells()
+{
+    sqlite3_finalize(mRead);
+    if (mDB != nullptr)
+        sqlite3_close(mDB);
+}
+
+int DatabaseCells::Open(const std::string &dbName, std::string &err)
+{
+    if (sqlite3_open_v2(dbName.c_str(), &mDB, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(mDB));
+        return DB_ERROR;
+    }
+
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT DATA FROM db_info_table WHERE ID=? LIMIT 1;";
+    int rc = sqlite3_prepare_v2(mDB, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_bind_text(stmt, 1, CELL_FORMAT_ID, -1, SQLITE_STATIC);
+    if (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_bytes(stmt, 0) >= 2)
+        Decode((const char *)sqlite3_column_blob(stmt, 0), mFormat);
+    sqlite3_finalize(stmt);
+
+    sql = "SELECT DATA FROM cell_table WHERE rowid=?;";
+    if (sqlite3_prepare_v2(mDB, sql, (int)strlen(sql), &mRead, 0) != SQLITE_OK)
+    {
+        err = "SQL error: failed to read cell data from cell_table.\n";
+        return DB_ERROR;
+    }
+    return 0;
+}
+
+int DatabaseCells::Scan(std::string &err)
+{
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT rowid, ID, DATA FROM cell_table;";
+    int rc = sqlite3_prepare_v2(mDB, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt);
+    std::vector<char> base;
+    std::vector<std::vector<std::string>> names;
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        const char *data = (const char *)sqlite3_column_blob(stmt, 2);
+        size_t size = sqlite3_column_bytes(stmt, 2);
+        if (mFormat == CELL_FORMAT_COMPACT)
+        {
+            if (!DecodeCompactCell(data, size, mDecoded))
+            {
+                sqlite3_finalize(stmt);
+                err = "Database format error: the data of a cell is corrupted.\n";
+                return FORMAT_ERROR;
+            }
+            data = mDecoded.data();
+            size = mDecoded.size();
+        }
+        names.push_back(std::vector<std::string>());
+        if (!BaseRecords(data, size, base, names.back()))
+        {
+            sqlite3_finalize(stmt);
+            err = "Database format error: the data of a cell is corrupted.\n";
+            return FORMAT_ERROR;
+        }
+        Cell cell;
+        cell.RowId = sqlite3_column_int64(stmt, 0);
+        cell.Name.assign((const char *)sqlite3_column_text(stmt, 1), sqlite3_column_bytes(stmt, 1));
+        cell.Base = HashBytes(base.data(), base.size());
+        mCells.push_back(cell);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE)
+    {
+        err = "SQL error: failed to read cell data from cell_table.\n";
+        return DB_ERROR;
+    }
+
+    // A name refers to the first cell of that name, like Library::GetById.
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < mCells.size(); i++)
+        index.insert(std::make_pair(mCells[i].Name, i));
+    size_t missing = mCells.size();
+    for (size_t i = 0; i < mCells.size(); i++)
+    {
+        for (auto &name : names[i])
+        {
+            auto iter = index.find(name);
+            if (iter == index.end())
+                iter = index.insert(std::make_pair(name, missing++)).first;
+            mCells[i].References.push_back(iter->second);
+        }
+    }
+    mNameCount = missing;
+    return 0;
+}
+
+int DatabaseCells::ReadBase(const Cell &cell, std::vector<char> &out, std::string &err)
+{
+    sqlite3_reset(mRead);
+    sqlite3_bind_int64(mRead, 1, cell.RowId);
+    if (sqlite3_step(mRead) != SQLITE_ROW)
+    {
+        err = "SQL error: failed to read cell data from cell_table.\n";
+        return DB_ERROR;
+    }
+    const char *data = (const char *)sqlite3_column_blob(mRead, 0);
+    size_t size = sqlite3_column_bytes(mRead, 0);
+    if (mFormat == CELL_FORMAT_COMPACT)
+    {
+        if (!DecodeCompactCell(data, size, mDecoded))
+        {
+            err = "Database format error: the data of a cell is corrupted.\n";
+            return FORMAT_ERROR;
+        }
+        data = mDecoded.data();
+        size = mDecoded.size();
+    }
+    std::vector<std::string> names;
+    if (!BaseRecords(data, size, out, names))
+    {
+        err = "Database format error: the data of a cell is corrupted.\n";
+        return FORMAT_ERROR;
+    }
+    return 0;
+}
+
+int DatabaseCells::Find(std::vector<std::vector<std::string>> &groups, std::string &err)
+{
+    int rc = Scan(err);
+    if (rc != 0)
+        return rc;
+
+    std::vector<std::vector<size_t>> children(mCells.size());
+    for (size_t i = 0; i < mCells.size(); i++)
+        children[i] = mCells[i].References;
+    std::vector<size_t> order;
+    PostOrder(children, order);
+
+    // The class of a cell is the first cell found identical to it.
+    std::vector<size_t> classes(mNameCount);
+    for (size_t i = 0; i < classes.size(); i++)
+        classes[i] = i;
+    std::unordered_map<Hash, std::vector<size_t>> buckets;
+    std::vector<char> records, other;
+    for (auto i : order)
+    {
+        const Cell &cell = mCells[i];
+        Hash h = cell.Base;
+        for (auto ref : cell.References)
+            h = Combine(h, classes[ref]);
+        auto &bucket = buckets[h];
+        bool read = false;
+        for (auto first : bucket)
+        {
+            const Cell &candidate = mCells[first];
+            if (candidate.Base != cell.Base || candidate.References.size() != cell.References.size())
+                continue;
+            bool same = true;
+            for (size_t k = 0; k < cell.References.size() && same; k++)
+                same = classes[candidate.References[k]] == classes[cell.References[k]];
+            if (!same)
+                continue;
+            if (!read)
+            {
+                if ((rc = ReadBase(cell, records, err)) != 0)
+                    return rc;
+                read = true;
+            }
+            if ((rc = ReadBase(candidate, other, err)) != 0)
+                return rc;
+            if (records == other)
+            {
+                classes[i] = first;
+                break;
+            }
+        }
+        if (classes[i] == i)
+            bucket.push_back(i);
+    }
+
+    // The first cell of a class in cell_table leads its group.
+    std::vector<size_t> members(classes.size(), 0);
+    for (size_t i = 0; i < mCells.size(); i++)
+        members[classes[i]]++;
+    groups.clear();
+    std::unordered_map<size_t, size_t> positions;
+    for (size_t i = 0; i < mCells.size(); i++)
+    {
+        if (members[classes[i]] < 2)
+            continue;
+        auto iter = positions.find(classes[i]);
+        if (iter == positions.end())
+        {
+            iter = positions.insert(std::make_pair(classes[i], groups.size())).first;
+            groups.push_back(std::vector<std::string>());
+        }
+        groups[iter->second].push_back(mCells[i].Name);
+    }
+    return 0;
+}
+
+typedef std::unordered_map<StringTable::Id, StringTable::Id> MergedNames;
+
+/*
+ * The records of an element, naming the cell an SREF or an AREF refers to
+ * by the cell it is merged into.
+ */
+void ElementRecords(const Element *e, const MergedNames &merged, std::vector<char> &out)
+{
+    if (e->Tag() == SREF)
+    {
+        const SRef *sref = static_cast<const SRef*>(e);
+        auto iter = merged.find(sref->SNameId());
+        if (iter != merged.end())
+        {
+            SRef copy(*sref);
+            copy.SetSNameId(iter->second);
+            copy.Write(out);
+            return;
+        }
+    }
+    else if (e->Tag() == AREF)
+    {
+        const ARef *aref = static_cast<const ARef*>(e);
+        auto iter = merged.find(aref->SNameId());
+        if (iter != merged.end())
+        {
+            ARef copy(*aref);
+            copy.SetSNameId(iter->second);
+            copy.Write(out);
+            return;
+        }
+    }
+    e->Write(out);
+}
+
+Hash CellHash(const Structure *cell, const MergedNames &merged)
+{
+    std::vector<Hash> hashes(cell->Size());
+    std::vector<char> out;
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        out.clear();
+        ElementRecords(cell->Get(int(i)), merged, out);
+        hashes[i] = HashBytes(out.data(), out.size());
+    }
+    std::sort(hashes.begin(), hashes.end());
+    Hash h = Mix(hashes.size());
+    for (auto value : hashes)
+        h = Combine(h, value);
+    return h;
+}
+
+void CellRecords(const Structure *cell, const MergedNames &merged, std::vector<std::string> &records)
+{
+    records.resize(cell->Size());
+    std::vector<char> out;
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        out.clear();
+        ElementRecords(cell->Get(int(i)), merged, out);
+        records[i].assign(out.begin(), out.end());
+    }
+    std::sort(records.begin(), records.end());
+}
+
+bool IsReference(const Element *e, StringTable::Id &name)
+{
+    if (e->Tag() == SREF)
+        name = static_cast<const SRef*>(e)->SNameId();
+    else if (e->Tag() == AREF)
+        name = static_cast<const ARef*>(e)->SNameId();
+    else
+        return false;
+    return true;
+}
+
+}
+
+DedupReport::DedupReport()
+{
+    CellsBefore = 0;
+    CellsMerged = 0;
+    ReferencesChanged = 0;
+    ElementsFreed = 0;
+}
+
+int FindDuplicateCells(std::string dbName, std::vector<std::vector<std::string>> &groups, std::string &err)
+{
+    DatabaseCells cells;
+    int rc = cells.Open(dbName, err);
+    if (rc != 0)
+        return rc;
+    return cells.Find(groups, err);
+}
+
+void FindDuplicateCells(Library &lib, std::vector<std::vector<std::string>> &groups, unsigned int threads)
+{
+    size_t count = lib.Size();
+    std::unordered_map<const Structure*, size_t> index;
+    for (size_t i = 0; i < count; i++)
+        index.insert(std::make_pair(lib.Get(int(i)), i));
+    std::vector<std::vector<size_t>> children(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Structure *cell = lib.Get(int(i));
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            StringTable::Id name;
+            if (!IsReference(cell->Get(int(k)), name))
+                continue;
+            auto iter = index.find(lib.GetById(name));
+            if (iter != index.end())
+                children[i].push_back(iter->second);
+        }
+    }
+
+    // Identical cells have identical children, so they are on the same
+    // level, counted from the cells without children. The cells of a
+    // level only refer to the cells below, whose classes are known.
+    std::vector<size_t> order;
+    PostOrder(children, order);
+    std::vector<int> levels(count, -1);
+    int top = 0;
+    for (auto i : order)
+    {
+        int level = 0;
+        for (auto child : children[i])
+            level = std::max(level, levels[child] + 1);
+        levels[i] = level;
+        top = std::max(top, level);
+    }
+    std::vector<std::vector<size_t>> cells(top + 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Structure *cell = lib.Get(int(i));
+        if (!cell->IsFiltered() && lib.GetById(cell->NameId()) == cell)
+            cells[levels[i]].push_back(i);
+    }
+
+    std::vector<size_t> classes(count);
+    for (size_t i = 0; i < count; i++)
+        classes[i] = i;
+    MergedNames merged;
+    std::vector<Hash> hashes;
+    std::vector<std::string> records, other;
+    for (auto &level : cells)
+    {
+        hashes.resize(level.size());
+        ParallelFor(level.size(), threads, [&](size_t i, unsigned int) {
+            hashes[i] = CellHash(lib.Get(int(level[i])), merged);
+        });
+        std::unordered_map<Hash, std::vector<size_t>> buckets;
+        for (size_t i = 0; i < level.size(); i++)
+        {
+            const Structure *cell = lib.Get(int(level[i]));
+            auto &bucket = buckets[hashes[i]];
+            if (!bucket.empty())
+                CellRecords(cell, merged, records);
+            for (auto first : bucket)
+            {
+                const Structure *candidate = lib.Get(int(first));
+                if (candidate->Size() != cell->Size())
+                    continue;
+                CellRecords(candidate, merged, other);
+                if (records == other)
+                {
+                    classes[level[i]] = first;
+                    break;
+                }
+            }
+            if (classes[level[i]] == level[i])
+                bucket.push_back(level[i]);
+        }
+        // The classes of this level take effect after it is hashed.
+        for (auto i : level)
+        {
+            if (classes[i] != i)
+                merged[lib.Get(int(i))->NameId()] = lib.Get(int(classes[i]))->NameId();
+        }
+    }
+
+    std::vector<size_t> members(count, 0);
+    for (size_t i = 0; i < count; i++)
+        members[classes[i]]++;
+    groups.clear();
+    std::unordered_map<size_t, size_t> positions;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (members[classes[i]] < 2)
+            continue;
+        auto iter = positions.find(classes[i]);
+        if (iter == positions.end())
+        {
+            iter = positions.insert(std::make_pair(classes[i], groups.size())).first;
+            groups.push_back(std::vector<std::string>());
+        }
+        groups[iter->second].push_back(lib.Get(int(i))->Name());
+    }
+}
+
+void MergeCells(Library &lib, const std::vector<std::vector<std::string>> &groups, DedupReport &report)
+{
+    // The cells referred to by filtered cells are kept.
+    std::unordered_set<StringTable::Id> kept;
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        const Structure *cell = lib.Get(int(i));
+        if (!cell->IsFiltered())
+            continue;
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            StringTable::Id name;
+            if (IsReference(cell->Get(int(k)), name))
+                kept.insert(name);
+        }
+    }
+
+    MergedNames merged;
+    std::vector<Structure*> deleted;
+    for (auto &group : groups)
+    {
+        if (group.size() < 2)
+            continue;
+        Structure *first = lib.Get(group[0]);
+        if (first == nullptr)
+            continue;
+        for (size_t i = 1; i < group.size(); i++)
+        {
+            Structure *cell = lib.Get(group[i]);
+            if (cell == nullptr || cell == first || kept.count(cell->NameId()) > 0
+                || merged.count(cell->NameId()) > 0)
+                continue;
+            merged[cell->NameId()] = first->NameId();
+            deleted.push_back(cell);
+        }
+    }
+    // A cell kept by one group may be merged by another.
+    for (auto &entry : merged)
+    {
+        for (size_t step = 0; step < merged.size(); step++)
+        {
+            auto iter = merged.find(entry.second);
+            if (iter == merged.end() || iter->second == entry.first)
+                break;
+            entry.second = iter->second;
+        }
+    }
+
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        Structure *cell = lib.Get(int(i));
+        if (cell->IsFiltered() || merged.count(cell->NameId()) > 0)
+            continue;
+        bool changed = false;
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            Element *e = cell->Get(int(k));
+            StringTable::Id name;
+            if (!IsReference(e, name))
+                continue;
+            auto iter = merged.find(name);
+            if (iter == merged.end())
+                continue;
+            if (e->Tag() == SREF)
+                static_cast<SRef*>(e)->SetSNameId(iter->second);
+            else
+                static_cast<ARef*>(e)->SetSNameId(iter->second);
+            report.ReferencesChanged++;
+            changed = true;
+        }
+        if (changed)
+            cell->SetChanged(true);
+    }
+
+    for (auto cell : deleted)
+    {
+        report.ElementsFreed += cell->Remove(std::vector<bool>(cell->Size(), true));
+        lib.Del(cell->Name());
+        report.CellsMerged++;
+    }
+}
+
+void DeduplicateCells(Library &lib, DedupReport &report, unsigned int threads)
+{
+    report = DedupReport();
+    report.CellsBefore = lib.Size();
+    std::vector<std::vector<std::string>> groups;
+    FindDuplicateCells(lib, groups, threads);
+    MergeCells(lib, groups, report);
+}
+
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is part of GDSII.
+ *
+ * dedup.h -- The header file which declare the merging of identical cells.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_DEDUP_H
+#define GDS_DEDUP_H
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace GDS {
+class Library;
+
+/*!
+ * \brief What the merging of cells changed.
+ */
+struct DedupReport
+{
+    size_t  CellsBefore;
+    size_t  CellsMerged;        //< The cells deleted in favour of an identical cell.
+    size_t  ReferencesChanged;  //< The SREFs and AREFs renamed to the cell kept.
+    size_t  ElementsFreed;      //< The elements of the cells deleted.
+
+    DedupReport();
+};
+
+/*
+ * Two cells are identical when their elements are the same apart from the
+ * names of the cells they refer to, and the cells referred to are
+ * identical in turn. The cells are hashed children first, a reference
+ * hashing by the cell it is merged into, and cells of the same hash are
+ * compared record by record before they are taken as identical.
+ *
+ * A group lists the names of identical cells; the first one is kept.
+ */
+
+/*!
+ * Find the identical cells of a layout database from the data in
+ * cell_table, without parsing the cells. The records of two cells must be
+ * the same, in the same order, except for BGNSTR, STRNAME and the names
+ * in SNAME; only the cells of the same hash are read twice.
+ * @param groups[out] The groups of two cells or more, in the order of cell_table.
+ * @return 0 if succeeded, or DB_ERROR, FORMAT_ERROR.
+ */
+int FindDuplicateCells(std::string dbName, std::vector<std::vector<std::string>> &groups, std::string &err);
+/*!
+ * Find the identical cells of a library. The elements of two cells may be
+ * in any order. Cells which lost elements to a layer filter are not
+ * compared.
+ * @param groups[out] The groups of two cells or more, in the order of the library.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void FindDuplicateCells(Library &lib, std::vector<std::vector<std::string>> &groups, unsigned int threads = 0);
+
+/*!
+ * Merge each group of cells into its first cell: the SREFs and AREFs of
+ * the other cells are renamed to it, and the other cells are deleted
+ * from the library. A cell referred to by a cell which lost elements to a
+ * layer filter is kept, since that cell can not be changed.
+ * @param report[out] The counts are added.
+ */
+void MergeCells(Library &lib, const std::vector<std::vector<std::string>> &groups, DedupReport &report);
+
+/*!
+ * Find the identical cells of a library and merge them.
+ * @param report[out] The counts are reset and set for the library.
+ */
+void DeduplicateCells(Library &lib, DedupReport &report, unsigned int threads = 0);
+
+}
+
+#endif // GDS_DEDUP_H
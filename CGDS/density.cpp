@@ -0,0 +1,788 @@
+/*
+ * This file is part of GDSII.
+ *
+ * density.cpp -- The source file which defines the density maps of layers.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include "density.h"
+#include "boolean.h"
+#include "outline.h"
+#include "gdsio.h"
+#include "parallel.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "boundary.h"
+#include "box.h"
+#include "path.h"
+#include "sref.h"
+#include "aref.h"
+#include "transform.h"
+#include "placement.h"
+#include "stats.h"
+#include <sqlite3.h>
+
+namespace GDS
+{
+
+namespace
+{
+
+const unsigned int BANDS_PER_THREAD = 4;
+const size_t MAX_PHASES = 256;          // Maps of a cell at most, each with its tiles shifted.
+const size_t MAX_PLACED = 1 << 16;      // Placed shapes kept before they are added.
+
+const std::string CREATE_DENSITY_TABLE =
+" \
+CREATE TABLE IF NOT EXISTS density_map_table (NAME TEXT NOT NULL, X0 INTEGER NOT NULL, Y0 INTEGER NOT NULL, \
+TILE_SIZE INTEGER NOT NULL, COLS INTEGER NOT NULL, ROWS INTEGER NOT NULL, AREA BLOB NOT NULL);\
+";
+
+/*
+ * The orientation of an instance at magnification 1 and a multiple of 90
+ * degrees: (x, y) becomes (XX * x + YX * y, XY * x + YY * y).
+ */
+struct Orientation
+{
+    int XX, XY, YX, YY;
+};
+
+/*
+ * The placement of an SREF or an AREF, with its orientation when it keeps
+ * the grid.
+ */
+struct Instance : Placement
+{
+    bool                Aligned;        //< Magnification 1 and a multiple of 90 degrees.
+    Orientation         Orient;
+};
+
+bool ReadInstance(const Element *e, Library *lib, Instance &inst)
+{
+    if (!ReadPlacement(e, lib, inst))
+        return false;
+    inst.Aligned = inst.Mag == 1 && std::fmod(inst.Angle, 90) == 0;
+    if (inst.Aligned)
+    {
+        int quarter = ((int)(inst.Angle / 90) % 4 + 4) % 4;
+        int ry = inst.Reflection ? -1 : 1;
+        // The images of (1, 0) and (0, 1) after the reflection and the rotation.
+        static const int COS[] = { 1, 0, -1, 0 };
+        static const int SIN[] = { 0, 1, 0, -1 };
+        inst.Orient.XX = COS[quarter];
+        inst.Orient.XY = SIN[quarter];
+        inst.Orient.YX = -SIN[quarter] * ry;
+        inst.Orient.YY = COS[quarter] * ry;
+    }
+    return true;
+}
+
+// The bounds of a cell placed by an instance at (0, 0). A rotation off
+// the axes is widened by a unit for the rounding of the corners.
+Rect PlaceBounds(const Instance &inst, const Rect &r)
+{
+    if (!inst.Aligned)
+        return Grow(MapRect(Place(inst, Point(0, 0)), r), 1);
+    long long xs[] = { r.Left, r.Right, r.Left, r.Right };
+    long long ys[] = { r.Bottom, r.Bottom, r.Top, r.Top };
+    Rect placed = { 0, 0, 0, 0 };
+    bool empty = true;
+    for (int i = 0; i < 4; i++)
+    {
+        Rect corner;
+        corner.Left = corner.Right = inst.Orient.XX * xs[i] + inst.Orient.YX * ys[i];
+        corner.Bottom = corner.Top = inst.Orient.XY * xs[i] + inst.Orient.YY * ys[i];
+        Extend(placed, corner, empty);
+    }
+    return placed;
+}
+
+// Whether origin + i * pitch is in (lo, hi) for an i in [0, count).
+bool AnyIndex(long long origin, long long pitch, int count, long long lo, long long hi)
+{
+    if (pitch < 0)
+    {
+        origin += (count - 1) * pitch;
+        pitch = -pitch;
+    }
+    if (pitch == 0 || count == 1)
+        return lo < origin && origin < hi;
+    long long first = std::max(0LL, FloorDiv(lo - origin, pitch) + 1);
+    return first < count && origin + first * pitch < hi;
+}
+
+/*
+ * The pitches of an array along x and y, when one of its pitches is
+ * horizontal and the other one vertical.
+ */
+bool AxisPitches(const Instance &inst, long long &x_pitch, int &x_count, long long &y_pitch, int &y_count)
+{
+    const Point &c = inst.ColPitch;
+    const Point &r = inst.RowPitch;
+    if ((c.Y == 0 || inst.Cols == 1) && (r.X == 0 || inst.Rows == 1))
+    {
+        x_pitch = c.X;
+        x_count = inst.Cols;
+        y_pitch = r.Y;
+        y_count = inst.Rows;
+        return true;
+    }
+    if ((c.X == 0 || inst.Cols == 1) && (r.Y == 0 || inst.Rows == 1))
+    {
+        x_pitch = r.X;
+        x_count = inst.Rows;
+        y_pitch = c.Y;
+        y_count = inst.Cols;
+        return true;
+    }
+    return false;
+}
+
+// Whether the instances of an array may overlap each other.
+bool SelfOverlaps(const Instance &inst)
+{
+    if (inst.Cols * inst.Rows == 1)
+        return false;
+    long long x_pitch, y_pitch;
+    int x_count, y_count;
+    if (!AxisPitches(inst, x_pitch, x_count, y_pitch, y_count))
+        return true;
+    long long width = inst.Bounds.Right - inst.Bounds.Left;
+    long long height = inst.Bounds.Top - inst.Bounds.Bottom;
+    return (x_count > 1 && std::abs(x_pitch) < width) || (y_count > 1 && std::abs(y_pitch) < height);
+}
+
+// Whether an instance of an array overlaps a box.
+bool HitsInstance(const Instance &inst, const Rect &box)
+{
+    if (!Overlaps(inst.AllBounds, box))
+        return false;
+    long long x_pitch, y_pitch;
+    int x_count, y_count;
+    if (!AxisPitches(inst, x_pitch, x_count, y_pitch, y_count))
+        return true;
+    const Rect &b = inst.Bounds;
+    return AnyIndex(inst.Origin.X, x_pitch, x_count, box.Left - b.Right, box.Right - b.Left)
+        && AnyIndex(inst.Origin.Y, y_pitch, y_count, box.Bottom - b.Top, box.Top - b.Bottom);
+}
+
+/*
+ * Add the area of polygons which do not overlap to the tiles of a map,
+ * split into bands of rows.
+ */
+class Rasterizer
+{
+public:
+    Rasterizer(DensityMap &map, int row0, int row1)
+        : mMap(map), mRow0(row0), mRow1(row1), mCover((size_t)(row1 - row0) * (map.Cols + 1), 0.0)
+    {
+    }
+
+    void AddPolygon(const Polygon &polygon, double sign)
+    {
+        for (size_t i = 0; i + 1 < polygon.size(); i++)
+            AddEdge(polygon[i], polygon[i + 1], sign);
+        if (polygon.size() > 2 && (polygon.back().X != polygon[0].X || polygon.back().Y != polygon[0].Y))
+            AddEdge(polygon.back(), polygon[0], sign);
+    }
+
+    // Add the heights on the left of each tile to it.
+    void Finish()
+    {
+        size_t stride = (size_t)mMap.Cols + 1;
+        for (int row = mRow0; row < mRow1; row++)
+        {
+            const double *cover = &mCover[(row - mRow0) * stride];
+            double *area = &mMap.Area[(size_t)row * mMap.Cols];
+            double sum = 0;
+            for (int col = 0; col < mMap.Cols; col++)
+            {
+                sum += cover[col];
+                area[col] += sum;
+            }
+        }
+    }
+
+private:
+    void AddEdge(const Point &p, const Point &q, double sign)
+    {
+        if (p.Y == q.Y)
+            return;
+        double tile = mMap.TileSize;
+        double bottom = mMap.Bottom + (double)mRow0 * tile;
+        double top = mMap.Bottom + (double)mRow1 * tile;
+        double lo = std::max<double>(std::min(p.Y, q.Y), bottom);
+        double hi = std::min<double>(std::max(p.Y, q.Y), top);
+        if (lo >= hi)
+            return;
+        // The area right of an upward edge is outside a counterclockwise polygon.
+        double dir = q.Y > p.Y ? -sign : sign;
+        double slope = ((double)q.X - p.X) / ((double)q.Y - p.Y);
+        int row = (int)std::floor((lo - mMap.Bottom) / tile);
+        for (; row < mRow1; row++)
+        {
+            double row_bottom = mMap.Bottom + (double)row * tile;
+            double ya = std::max(lo, row_bottom);
+            double yb = std::min(hi, row_bottom + tile);
+            if (ya >= yb)
+                break;
+            double xa = p.X + (ya - p.Y) * slope;
+            double xb = p.X + (yb - p.Y) * slope;
+            AddPiece(row, std::min(xa, xb), std::max(xa, xb), (yb - ya) * dir);
+        }
+    }
+
+    // A piece of an edge in one row, which goes up by height.
+    void AddPiece(int row, double x0, double x1, double height)
+    {
+        double tile = mMap.TileSize;
+        double left = mMap.Left;
+        double right = left + (double)mMap.Cols * tile;
+        double *cover = &mCover[(size_t)(row - mRow0) * (mMap.Cols + 1)];
+        double *area = &mMap.Area[(size_t)row * mMap.Cols];
+        if (x1 <= x0)
+        {
+            if (x0 < left)
+            {
+                cover[0] += height * tile;
+            }
+            else if (x0 < right)
+            {
+                int col = (int)std::floor((x0 - left) / tile);
+                area[col] += height * (left + (col + 1) * tile - x0);
+                cover[col + 1] += height * tile;
+            }
+            return;
+        }
+        double per_x = height / (x1 - x0);
+        if (x0 < left)
+            cover[0] += per_x * (std::min(x1, left) - x0) * tile;
+        double a = std::max(x0, left);
+        double b = std::min(x1, right);
+        if (a >= b)
+            return;
+        for (int col = (int)std::floor((a - left) / tile); col < mMap.Cols; col++)
+        {
+            double col_right = left + (col + 1) * tile;
+            double c = std::min(b, col_right);
+            double h = per_x * (c - a);
+            area[col] += h * (col_right - (a + c) / 2);
+            cover[col + 1] += h * tile;
+            if (c >= b)
+                break;
+            a = c;
+        }
+    }
+
+    DensityMap             &mMap;
+    int                     mRow0, mRow1;
+    std::vector<double>     mCover;     //< The heights crossed on the left of each tile, Cols + 1 per row.
+};
+
+// Twice the signed area.
+double SignedArea(const Polygon &polygon)
+{
+    double sum = 0;
+    for (size_t i = 0; i < polygon.size(); i++)
+    {
+        const Point &p = polygon[i];
+        const Point &q = polygon[(i + 1) % polygon.size()];
+        sum += (double)p.X * q.Y - (double)q.X * p.Y;
+    }
+    return sum;
+}
+
+void Rasterize(const std::vector<Polygon> &polygons, DensityMap &map, unsigned int threads)
+{
+    if (polygons.empty() || map.Cols <= 0 || map.Rows <= 0)
+        return;
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    int bands = std::min<int>(map.Rows, threads * BANDS_PER_THREAD);
+    int band_rows = (map.Rows + bands - 1) / bands;
+    bands = (map.Rows + band_rows - 1) / band_rows;
+
+    std::vector<std::vector<size_t> > members(bands);
+    std::vector<double> signs(polygons.size(), 0);
+    for (size_t i = 0; i < polygons.size(); i++)
+    {
+        const Polygon &polygon = polygons[i];
+        if (polygon.size() < 3)
+            continue;
+        double area = SignedArea(polygon);
+        if (area == 0)
+            continue;
+        signs[i] = area > 0 ? 1 : -1;
+        Rect r = Bounds(polygon);
+        long long first = FloorDiv(r.Bottom - map.Bottom, (long long)map.TileSize * band_rows);
+        long long last = FloorDiv(r.Top - 1 - map.Bottom, (long long)map.TileSize * band_rows);
+        for (long long band = std::max(first, 0LL); band <= last && band < bands; band++)
+            members[(size_t)band].push_back(i);
+    }
+
+    ParallelFor((size_t)bands, threads, [&](size_t band, unsigned int)
+    {
+        int row0 = (int)band * band_rows;
+        Rasterizer rasterizer(map, row0, std::min(row0 + band_rows, map.Rows));
+        for (size_t i : members[band])
+            rasterizer.AddPolygon(polygons[i], signs[i]);
+        rasterizer.Finish();
+    });
+}
+
+// Add the map of a cell placed at origin to a map whose grid it is on.
+void AddMap(const DensityMap &child, const Orientation &o, const Point &origin, DensityMap &map)
+{
+    long long tile = map.TileSize;
+    for (int row = 0; row < child.Rows; row++)
+    {
+        for (int col = 0; col < child.Cols; col++)
+        {
+            double area = child.Area[(size_t)row * child.Cols + col];
+            if (area == 0)
+                continue;
+            long long x0 = child.Left + col * tile;
+            long long y0 = child.Bottom + row * tile;
+            long long x1 = x0 + tile;
+            long long y1 = y0 + tile;
+            long long x = std::min(o.XX * x0 + o.YX * y0, o.XX * x1 + o.YX * y1) + origin.X;
+            long long y = std::min(o.XY * x0 + o.YY * y0, o.XY * x1 + o.YY * y1) + origin.Y;
+            long long c = FloorDiv(x - map.Left, tile);
+            long long r = FloorDiv(y - map.Bottom, tile);
+            if (c >= 0 && c < map.Cols && r >= 0 && r < map.Rows)
+                map.Area[(size_t)r * map.Cols + (size_t)c] += area;
+        }
+    }
+}
+
+void SetGrid(DensityMap &map, long long left, long long bottom, int tile_size, long long cols, long long rows)
+{
+    map.Left = (int)left;
+    map.Bottom = (int)bottom;
+    map.TileSize = tile_size;
+    map.Cols = (int)std::max(cols, 0LL);
+    map.Rows = (int)std::max(rows, 0LL);
+    map.Area.assign((size_t)map.Cols * map.Rows, 0.0);
+}
+
+class DensityBuilder
+{
+public:
+    DensityBuilder(const std::vector<LayerKey> &layers, int tile_size, unsigned int threads)
+        : mLayers(layers), mTileSize(tile_size), mThreads(threads)
+    {
+        std::sort(mLayers.begin(), mLayers.end());
+    }
+
+    /*
+    Read a cell and the cells under it: the merged shapes of the cell, its
+    instances, its bounds and whether its sources overlap.
+    */
+    void Prepare(const Structure *cell)
+    {
+        CellInfo &info = mCells[cell];
+        if (info.State != NEW)
+            return;
+        info.State = VISITING;
+
+        std::vector<Polygon> local;
+        Library *lib = cell->Parent();
+        for (size_t i = 0; i < cell->Size(); i++)
+        {
+            const Element *e = cell->Get((int)i);
+            switch (e->Tag())
+            {
+            case BOUNDARY:
+            {
+                const Boundary *boundary = static_cast<const Boundary*>(e);
+                if (Wanted(boundary->Layer(), boundary->DataType()))
+                    local.push_back(boundary->XY());
+                break;
+            }
+            case BOX_BOUNDARY:
+            {
+                const Box *box = static_cast<const Box*>(e);
+                if (Wanted(box->Layer(), box->DataType()))
+                    local.push_back(box->XY());
+                break;
+            }
+            case PATH:
+            {
+                const Path *path = static_cast<const Path*>(e);
+                local.push_back(Polygon());
+                if (!Wanted(path->Layer(), path->DataType()) || !OutlinePath(path, local.back()))
+                    local.pop_back();
+                break;
+            }
+            case SREF:
+            case AREF:
+            {
+                Instance inst;
+                if (!ReadInstance(e, lib, inst))
+                    break;
+                Prepare(inst.Cell);
+                const CellInfo &child = mCells[inst.Cell];
+                if (child.State != DONE || !child.HasBounds)
+                    break;
+                SetInstanceBounds(inst, PlaceBounds(inst, child.Bounds));
+                info.Instances.push_back(inst);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        Merge(local, info.Local, mThreads);
+
+        bool empty = true;
+        for (auto &polygon : info.Local)
+            Extend(info.Bounds, Bounds(polygon), empty);
+        for (auto &inst : info.Instances)
+            Extend(info.Bounds, inst.AllBounds, empty);
+        info.HasBounds = !empty;
+        info.Flat = SourcesOverlap(info);
+        info.State = DONE;
+    }
+
+    /*
+    Fill the tiles of a map with the area of a cell.
+    */
+    void Fill(const Structure *cell, DensityMap &map)
+    {
+        CellInfo &info = mCells[cell];
+        if (info.Flat)
+        {
+            Rasterize(Flat(cell), map, mThreads);
+            return;
+        }
+        std::vector<Polygon> placed(info.Local);
+        for (auto &inst : info.Instances)
+        {
+            for (int row = 0; row < inst.Rows; row++)
+            {
+                for (int col = 0; col < inst.Cols; col++)
+                {
+                    Point origin = ElementOrigin(inst, col, row);
+                    if (inst.Aligned)
+                    {
+                        // The tiles of the parent seen from the cell.
+                        long long dx = (long long)map.Left - origin.X;
+                        long long dy = (long long)map.Bottom - origin.Y;
+                        const Orientation &o = inst.Orient;
+                        Point phase((int)(((o.XX * dx + o.XY * dy) % mTileSize + mTileSize) % mTileSize),
+                                    (int)(((o.YX * dx + o.YY * dy) % mTileSize + mTileSize) % mTileSize));
+                        const DensityMap *child = Map(inst.Cell, phase);
+                        if (child != nullptr)
+                        {
+                            AddMap(*child, o, origin, map);
+                            continue;
+                        }
+                    }
+                    Transform transform = Place(inst, origin);
+                    for (auto &polygon : Flat(inst.Cell))
+                    {
+                        placed.push_back(Polygon());
+                        placed.back().reserve(polygon.size());
+                        for (auto &p : polygon)
+                            placed.back().push_back(transform.Map(p));
+                    }
+                    if (placed.size() >= MAX_PLACED)
+                    {
+                        Rasterize(placed, map, mThreads);
+                        placed.clear();
+                    }
+                }
+            }
+        }
+        Rasterize(placed, map, mThreads);
+    }
+
+    /*
+    The map of a cell over the tiles whose corners are at phase plus
+    multiples of the tile size, or null if the cell has too many maps.
+    */
+    const DensityMap *Map(const Structure *cell, const Point &phase)
+    {
+        CellInfo &info = mCells[cell];
+        std::pair<int, int> key(phase.X, phase.Y);
+        auto found = info.Maps.find(key);
+        if (found != info.Maps.end())
+        {
+            GDS_STATS_ADD(STAT_DENSITY_MAP_HITS, 1);
+            return &found->second;
+        }
+        if (info.Maps.size() >= MAX_PHASES)
+            return nullptr;
+        GDS_STATS_ADD(STAT_DENSITY_MAP_MISSES, 1);
+        DensityMap &map = info.Maps[key];
+        if (info.HasBounds)
+        {
+            long long tile = mTileSize;
+            long long left = FloorDiv(info.Bounds.Left - phase.X, tile) * tile + phase.X;
+            long long bottom = FloorDiv(info.Bounds.Bottom - phase.Y, tile) * tile + phase.Y;
+            SetGrid(map, left, bottom, mTileSize, FloorDiv(info.Bounds.Right - left + tile - 1, tile),
+                    FloorDiv(info.Bounds.Top - bottom + tile - 1, tile));
+            Fill(cell, map);
+        }
+        else
+        {
+            SetGrid(map, 0, 0, mTileSize, 0, 0);
+        }
+        return &map;
+    }
+
+private:
+    enum STATE
+    {
+        NEW,
+        VISITING,
+        DONE,
+    };
+
+    struct CellInfo
+    {
+        STATE                   State;
+        std::vector<Polygon>    Local;      //< The merged shapes of the cell itself.
+        std::vector<Instance>   Instances;  //< The instances with shapes.
+        bool                    HasBounds;
+        Rect                    Bounds;
+        bool                    Flat;       //< The sources may overlap.
+        std::map<std::pair<int, int>, DensityMap>   Maps;   //< By the phase of the tiles.
+        bool                    HasFlat;
+        std::vector<Polygon>    FlatShapes; //< The merged shapes of the cell and the cells under it.
+
+        CellInfo()
+            : State(NEW), HasBounds(false), Flat(false), HasFlat(false)
+        {
+        }
+    };
+
+    bool Wanted(short layer, short data_type) const
+    {
+        return std::binary_search(mLayers.begin(), mLayers.end(), LayerKey(layer, data_type));
+    }
+
+    const std::vector<Polygon> &Flat(const Structure *cell)
+    {
+        CellInfo &info = mCells[cell];
+        if (!info.HasFlat)
+        {
+            info.HasFlat = true;
+            if (info.Instances.empty())
+            {
+                info.FlatShapes = info.Local;
+            }
+            else
+            {
+                std::vector<Polygon> polygons;
+                CollectPolygons(cell, mLayers, polygons);
+                Merge(polygons, info.FlatShapes, mThreads);
+            }
+        }
+        return info.FlatShapes;
+    }
+
+    /*
+    Whether the shapes of the cell itself and its instances may overlap
+    each other, by their bounds.
+    */
+    bool SourcesOverlap(const CellInfo &info) const
+    {
+        const std::vector<Instance> &insts = info.Instances;
+        for (size_t i = 0; i < insts.size(); i++)
+        {
+            if (SelfOverlaps(insts[i]))
+                return true;
+            for (size_t j = i + 1; j < insts.size(); j++)
+            {
+                if (!Overlaps(insts[i].AllBounds, insts[j].AllBounds))
+                    continue;
+                if (insts[i].Cols * insts[i].Rows == 1 && HitsInstance(insts[j], insts[i].AllBounds))
+                    return true;
+                if (insts[j].Cols * insts[j].Rows == 1 && HitsInstance(insts[i], insts[j].AllBounds))
+                    return true;
+                if (insts[i].Cols * insts[i].Rows > 1 && insts[j].Cols * insts[j].Rows > 1)
+                    return true;
+            }
+        }
+        if (insts.empty() || info.Local.empty())
+            return false;
+
+        // The shapes sorted by their left sides, searched from the widest one.
+        std::vector<Rect> boxes;
+        boxes.reserve(info.Local.size());
+        long long widest = 0;
+        for (auto &polygon : info.Local)
+        {
+            boxes.push_back(Bounds(polygon));
+            widest = std::max(widest, boxes.back().Right - boxes.back().Left);
+        }
+        std::sort(boxes.begin(), boxes.end(), [](const Rect &a, const Rect &b) { return a.Left < b.Left; });
+        for (auto &inst : insts)
+        {
+            const Rect &all = inst.AllBounds;
+            auto first = std::lower_bound(boxes.begin(), boxes.end(), all.Left - widest,
+                                          [](const Rect &r, long long x) { return r.Left < x; });
+            for (auto it = first; it != boxes.end() && it->Left < all.Right; ++it)
+            {
+                if (HitsInstance(inst, *it))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<LayerKey>                   mLayers;
+    int                                     mTileSize;
+    unsigned int                            mThreads;
+    std::map<const Structure*, CellInfo>    mCells;
+};
+
+}
+
+DensityMap::DensityMap()
+    : Left(0), Bottom(0), TileSize(1), Cols(0), Rows(0)
+{
+}
+
+double DensityMap::Density(int col, int row) const
+{
+    return Area[(size_t)row * Cols + col] / ((double)TileSize * TileSize);
+}
+
+void ComputeDensity(const Structure *cell, const std::vector<LayerKey> &layers, int tile_size,
+                    DensityMap &map, unsigned int threads)
+{
+    SetGrid(map, 0, 0, tile_size, 0, 0);
+    if (tile_size <= 0)
+        return;
+    DensityBuilder builder(layers, tile_size, threads);
+    builder.Prepare(cell);
+    map = *builder.Map(cell, Point(0, 0));
+}
+
+void ComputeDensity(const Structure *cell, const std::vector<LayerKey> &layers, int left, int bottom,
+                    int tile_size, int cols, int rows, DensityMap &map, unsigned int threads)
+{
+    SetGrid(map, left, bottom, tile_size, cols, rows);
+    if (tile_size <= 0)
+        return;
+    DensityBuilder builder(layers, tile_size, threads);
+    builder.Prepare(cell);
+    builder.Fill(cell, map);
+}
+
+void WindowDensity(const DensityMap &map, int window, std::vector<double> &density)
+{
+    density.clear();
+    if (window <= 0 || window > map.Cols || window > map.Rows)
+        return;
+    // Sums of the tiles below and left of each corner.
+    size_t stride = (size_t)map.Cols + 1;
+    std::vector<double> sums(stride * (map.Rows + 1), 0.0);
+    for (int row = 0; row < map.Rows; row++)
+    {
+        double line = 0;
+        for (int col = 0; col < map.Cols; col++)
+        {
+            line += map.Area[(size_t)row * map.Cols + col];
+            sums[(row + 1) * stride + col + 1] = sums[row * stride + col + 1] + line;
+        }
+    }
+    double area = (double)map.TileSize * map.TileSize * window * window;
+    density.reserve((size_t)(map.Cols - window + 1) * (map.Rows - window + 1));
+    for (int row = 0; row + window <= map.Rows; row++)
+    {
+        for (int col = 0; col + window <= map.Cols; col++)
+        {
+            double sum = sums[(row + window) * stride + col + window] - sums[row * stride + col + window]
+                - sums[(row + window) * stride + col] + sums[row * stride + col];
+            density.push_back(sum / area);
+        }
+    }
+}
+
+int WriteDensityMap(std::string dbName, std::string name, const DensityMap &map, std::string &err)
+{
+    std::vector<unsigned char> blob(map.Area.size() * 8);
+    for (size_t i = 0; i < map.Area.size(); i++)
+    {
+        unsigned long long bits;
+        memcpy(&bits, &map.Area[i], 8);
+        for (int k = 0; k < 8; k++)
+            blob[i * 8 + k] = (unsigned char)(bits >> (8 * k));
+    }
+
+    sqlite3 *db;
+    int rc = sqlite3_open(dbName.c_str(), &db);
+    if (rc != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    rc = sqlite3_exec(db, CREATE_DENSITY_TABLE.c_str(), 0, 0, 0);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        err = "SQL error: failed to create density_map_table.\n";
+        return DB_ERROR;
+    }
+
+    sqlite3_exec(db, "begin;", 0, 0, 0);
+    sqlite3_stmt *stmt = 0;
+    const char *sql = "DELETE FROM density_map_table WHERE NAME = ?";
+    rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    sqlite3_finalize(stmt);
+    stmt = 0;
+
+    sql = "INSERT INTO density_map_table VALUES(?,?,?,?,?,?,?)";
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+    int values[] = { map.Left, map.Bottom, map.TileSize, map.Cols, map.Rows };
+    for (int k = 0; rc == SQLITE_OK && k < 5; k++)
+        rc = sqlite3_bind_int(stmt, 2 + k, values[k]);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_bind_blob(stmt, 7, blob.data(), (int)blob.size(), SQLITE_STATIC);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_exec(db, "rollback;", 0, 0, 0);
+        sqlite3_close(db);
+        err = "SQL error: failed to add the map into density_map_table.\n";
+        return DB_ERROR;
+    }
+    sqlite3_exec(db, "commit;", 0, 0, 0);
+    sqlite3_close(db);
+
+    return 0;
+}
+
+}
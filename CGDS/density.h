@@ -0,0 +1,99 @@
+/*
+ * This file is part of GDSII.
+ *
+ * density.h -- The header file which declare the density maps of layers.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_DENSITY_H
+#define GDS_DENSITY_H
+#include <string>
+#include <vector>
+#include "census.h"
+
+namespace GDS {
+class Structure;
+
+/*!
+ * \brief The area covered by some layers in each tile of a grid.
+ */
+struct DensityMap
+{
+    int                 Left, Bottom;   //< The lower left corner of tile (0, 0).
+    int                 TileSize;       //< The side of the square tiles.
+    int                 Cols, Rows;
+    std::vector<double> Area;           //< The area in each tile, row by row from the bottom.
+
+    DensityMap();
+    /*!
+    The area of a tile over the area of the tile.
+    */
+    double Density(int col, int row) const;
+};
+
+/*
+ * The area of a tile is the area of the union of the shapes in it, so
+ * shapes which overlap are counted once. The shapes of each cell are
+ * merged, and the area of each merged polygon is added to the tiles edge
+ * by edge: an edge adds the signed area between itself and the right
+ * side of its tile, and the signed height it crosses to the tiles on its
+ * right. The rows of tiles are split among several threads.
+ *
+ * An instance at magnification 1 and a multiple of 90 degrees adds a map
+ * of its cell whose tiles fall on the tiles of the parent. The map is made
+ * once for each shift of the tiles the instances need, and an instance
+ * whose origin is on the grid of the parent needs no shift. A cell has at
+ * most 256 such maps; other instances add the merged shapes of their
+ * cell, moved into place. This is exact as long as the sources of a cell,
+ * its own shapes and its instances, do not overlap; a cell whose sources
+ * may overlap, by their extents, is merged flat instead.
+ */
+
+/*!
+ * Compute the density map of some layers of a cell, with the cells under it.
+ * @param layers The (layer, datatype) pairs.
+ * @param tile_size The side of the tiles, which are at multiples of it.
+ * @param map[out] The tiles over the shapes on the layers, or no tiles.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void ComputeDensity(const Structure *cell, const std::vector<LayerKey> &layers, int tile_size,
+                    DensityMap &map, unsigned int threads = 0);
+/*!
+ * Compute the density map of some layers of a cell over a given grid.
+ * Shapes outside the grid are ignored.
+ */
+void ComputeDensity(const Structure *cell, const std::vector<LayerKey> &layers, int left, int bottom,
+                    int tile_size, int cols, int rows, DensityMap &map, unsigned int threads = 0);
+
+/*!
+ * Get the density of the windows of window x window tiles, stepped one
+ * tile at a time.
+ * @param density[out] The density of each window, row by row from the
+ *                     bottom; (Cols - window + 1) x (Rows - window + 1).
+ */
+void WindowDensity(const DensityMap &map, int window, std::vector<double> &density);
+
+/*!
+ * Write a map into density_map_table of a database, replacing the map of
+ * the same name. AREA is a blob of the areas as little-endian doubles.
+ * @return 0 if succeeded, or DB_ERROR.
+ */
+int WriteDensityMap(std::string dbName, std::string name, const DensityMap &map, std::string &err);
+
+}
+
+#endif // GDS_DENSITY_H
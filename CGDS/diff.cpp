@@ -0,0 +1,604 @@
+/*
+ * This file is part of GDSII.
+ *
+ * diff.cpp -- The comparison of two versions of a layout cell by cell.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include "diff.h"
+#include "gdsio.h"
+#include "mapfile.h"
+#include "parallel.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "boundary.h"
+#include "box.h"
+#include "path.h"
+#include "sref.h"
+#include "aref.h"
+
+namespace GDS {
+namespace {
+
+typedef unsigned long long Hash;
+
+/*
+ * The cells of one version of a layout.
+ */
+class CellSource
+{
+public:
+    virtual ~CellSource() {}
+
+    /*!
+    Get the hash and the references of each cell.
+    */
+    virtual int Scan(std::string &err) = 0;
+    /*!
+    Get the GDSII records of a cell. Calls with different threads may run
+    at the same time; the data is valid until the next call of the thread.
+    */
+    virtual int Records(size_t cell, unsigned int thread, const char *&data, size_t &size, std::string &err) = 0;
+
+    std::vector<std::string>                Names;
+    std::vector<Hash>                       Hashes;
+    std::vector<std::vector<std::string>>   References;
+};
+
+class FileSource : public CellSource
+{
+public:
+    FileSource(unsigned int threads) : mThreads(threads) {}
+
+    int Open(const std::string &file_name, std::string &err);
+    virtual int Scan(std::string &err);
+    virtual int Records(size_t cell, unsigned int thread, const char *&data, size_t &size, std::string &err);
+
+private:
+    unsigned int            mThreads;
+    MappedFile              mFile;
+    std::vector<CellOffset> mIndex;
+};
+
+int FileSource::Open(const std::string &file_name, std::string &err)
+{
+    if (!mFile.Open(file_name))
+    {
+        err = "Can not open " + file_name + '\n';
+        return FILE_ERROR;
+    }
+    int rc = IndexGDSII(mFile.Data(), mFile.Size(), mIndex, err);
+    if (rc != 0)
+        return rc;
+    for (auto &cell : mIndex)
+        Names.push_back(cell.Name);
+    return 0;
+}
+
+int FileSource::Scan(std::string &err)
+{
+    Hashes.resize(Names.size());
+    References.resize(Names.size());
+    std::vector<char> failed(Names.size(), 0);
+    ParallelFor(Names.size(), mThreads, [&](size_t i, unsigned int) {
+        const char *data = mFile.Data() + mIndex[i].Start;
+        size_t size = size_t(mIndex[i].End - mIndex[i].Start);
+        Hashes[i] = HashCellRecords(data, size);
+        failed[i] = !ScanCellReferences(data, size, CELL_FORMAT_GDSII, References[i]);
+    });
+    for (size_t i = 0; i < Names.size(); i++)
+    {
+        if (failed[i])
+        {
+            err = "GDSII format error: the data of cell " + Names[i] + " is corrupted.\n";
+            return FORMAT_ERROR;
+        }
+    }
+    return 0;
+}
+
+int FileSource::Records(size_t cell, unsigned int, const char *&data, size_t &size, std::string &)
+{
+    data = mFile.Data() + mIndex[cell].Start;
+    size = size_t(mIndex[cell].End - mIndex[cell].Start);
+    return 0;
+}
+
+class DatabaseSource : public CellSource
+{
+public:
+    DatabaseSource(unsigned int threads);
+    ~DatabaseSource();
+
+    int Open(const std::string &db_name, std::string &err);
+    virtual int Scan(std::string &err);
+    virtual int Records(size_t cell, unsigned int thread, const char *&data, size_t &size, std::string &err);
+
+private:
+    /*!
+    A connection of a thread, opened on its first read.
+    */
+    struct Reader
+    {
+        sqlite3             *DB;
+        sqlite3_stmt        *Read;
+        std::vector<char>   Data;
+    };
+
+    std::string                 mName;
+    short                       mFormat;
+    std::vector<long long>      mRowIds;
+    std::vector<Reader>         mReaders;
+};
+
+DatabaseSource::DatabaseSource(unsigned int threads)
+    : mFormat(CELL_FORMAT_GDSII)
+{
+    Reader reader = { nullptr, nullptr, std::vector<char>() };
+    mReaders.resize(threads, reader);
+}
+
+DatabaseSource::~DatabaseSource()
+{
+    for (auto &reader : mReaders)
+    {
+        sqlite3_finalize(reader.Read);
+        if (reader.DB != nullptr)
+            sqlite3_close(reader.DB);
+    }
+}
+
+int DatabaseSource::Open(const std::string &db_name, std::string &err)
+{
+    mName = db_name;
+    sqlite3 *db;
+    if (sqlite3_open_v2(db_name.c_str(), &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT DATA FROM db_info_table WHERE ID=? LIMIT 1;";
+    int rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_bind_text(stmt, 1, CELL_FORMAT_ID, -1, SQLITE_STATIC);
+    if (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_bytes(stmt, 0) >= 2)
+        Decode((const char *)sqlite3_column_blob(stmt, 0), mFormat);
+    sqlite3_finalize(stmt);
+
+    sql = "SELECT rowid, ID FROM cell_table;";
+    rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt);
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        mRowIds.push_back(sqlite3_column_int64(stmt, 0));
+        Names.push_back(std::string((const char *)sqlite3_column_text(stmt, 1), sqlite3_column_bytes(stmt, 1)));
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    if (rc != SQLITE_DONE)
+    {
+        err = "SQL error: failed to read cell data from cell_table.\n";
+        return DB_ERROR;
+    }
+    return 0;
+}
+
+int DatabaseSource::Scan(std::string &err)
+{
+    std::vector<CellSummary> summaries;
+    int rc = ReadCellSummaries(mName, summaries, err);
+    if (rc != 0)
+        return rc;
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < Names.size(); i++)
+        index.insert(std::make_pair(Names[i], i));
+    References.resize(Names.size());
+    for (auto &summary : summaries)
+    {
+        auto iter = index.find(summary.Name);
+        if (iter == index.end())
+            continue;
+        for (auto &reference : summary.References)
+            References[iter->second].push_back(reference.first);
+    }
+
+    // Databases of older versions have no cell_hash_table.
+    Hashes.resize(Names.size());
+    std::vector<char> hashed(Names.size(), 0);
+    sqlite3 *db;
+    if (sqlite3_open_v2(mName.c_str(), &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT ID, HASH FROM cell_hash_table;";
+    rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt);
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        auto iter = index.find(std::string((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0)));
+        if (iter == index.end())
+            continue;
+        Hashes[iter->second] = (Hash)sqlite3_column_int64(stmt, 1);
+        hashed[iter->second] = 1;
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < Names.size(); i++)
+    {
+        if (!hashed[i])
+            missing.push_back(i);
+    }
+    std::vector<int> codes(mReaders.size(), 0);
+    std::vector<std::string> errors(mReaders.size());
+    ParallelFor(missing.size(), (unsigned int)mReaders.size(), [&](size_t k, unsigned int thread) {
+        const char *data;
+        size_t size;
+        if (codes[thread] == 0)
+            codes[thread] = Records(missing[k], thread, data, size, errors[thread]);
+        if (codes[thread] == 0)
+            Hashes[missing[k]] = HashCellRecords(data, size);
+    });
+    for (size_t i = 0; i < codes.size(); i++)
+    {
+        if (codes[i] != 0)
+        {
+            err = errors[i];
+            return codes[i];
+        }
+    }
+    return 0;
+}
+
+int DatabaseSource::Records(size_t cell, unsigned int thread, const char *&data, size_t &size, std::string &err)
+{
+    Reader &reader = mReaders[thread];
+    if (reader.DB == nullptr)
+    {
+        const char *sql = "SELECT DATA FROM cell_table WHERE rowid=?;";
+        if (sqlite3_open_v2(mName.c_str(), &reader.DB, SQLITE_OPEN_READONLY, 0) != SQLITE_OK
+            || sqlite3_prepare_v2(reader.DB, sql, (int)strlen(sql), &reader.Read, 0) != SQLITE_OK)
+        {
+            err = "Can't open database: " + std::string(sqlite3_errmsg(reader.DB));
+            return DB_ERROR;
+        }
+    }
+    sqlite3_reset(reader.Read);
+    sqlite3_bind_int64(reader.Read, 1, mRowIds[cell]);
+    if (sqlite3_step(reader.Read) != SQLITE_ROW)
+    {
+        err = "SQL error: failed to read cell data from cell_table.\n";
+        return DB_ERROR;
+    }
+    const char *blob = (const char *)sqlite3_column_blob(reader.Read, 0);
+    size_t bytes = sqlite3_column_bytes(reader.Read, 0);
+    if (mFormat == CELL_FORMAT_COMPACT)
+    {
+        if (!DecodeCompactCell(blob, bytes, reader.Data))
+        {
+            err = "Database format error: the data of cell " + Names[cell] + " is corrupted.\n";
+            return FORMAT_ERROR;
+        }
+    }
+    else
+    {
+        reader.Data.assign(blob, blob + bytes);
+    }
+    data = reader.Data.data();
+    size = reader.Data.size();
+    return 0;
+}
+
+/*
+ * The hashes of the shapes of a cell by layer and of its references,
+ * each sorted.
+ */
+struct CellShapes
+{
+    std::map<LayerKey, std::vector<Hash>>   Layers;
+    std::vector<Hash>                       References;
+};
+
+Hash RecordHash(const Element &e, std::vector<char> &buffer)
+{
+    buffer.clear();
+    e.Write(buffer);
+    // Records which do not start with BGNSTR are hashed as they are.
+    return HashCellRecords(buffer.data(), buffer.size());
+}
+
+/*
+ * Start a BOUNDARY at its least point, going towards the lesser of its
+ * neighbours, so the same polygon has the same points.
+ */
+void NormalizeBoundary(const std::vector<Point> &pts, std::vector<Point> &out)
+{
+    size_t count = pts.size();
+    if (count > 1 && pts.front().X == pts.back().X && pts.front().Y == pts.back().Y)
+        count--;
+    auto less = [](const Point &a, const Point &b) {
+        return a.X != b.X ? a.X < b.X : a.Y < b.Y;
+    };
+    size_t first = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        if (less(pts[i], pts[first]))
+            first = i;
+    }
+    const Point &next = pts[(first + 1) % count];
+    const Point &prev = pts[(first + count - 1) % count];
+    bool forward = !less(prev, next);
+    out.clear();
+    for (size_t i = 0; i < count; i++)
+        out.push_back(pts[forward ? (first + i) % count : (first + count - i) % count]);
+    out.push_back(out.front());
+}
+
+int ReadShapes(CellSource &source, size_t cell, unsigned int thread, CellShapes &shapes, std::string &err)
+{
+    const char *data;
+    size_t size;
+    int rc = source.Records(cell, thread, data, size, err);
+    if (rc != 0)
+        return rc;
+    Structure structure(source.Names[cell]);
+    std::string msg;
+    if (structure.Read(data, size, msg) != 0)
+    {
+        err = "Failed to read the data of cell " + source.Names[cell] + ": " + msg;
+        return FORMAT_ERROR;
+    }
+
+    std::vector<char> buffer;
+    std::vector<Point> pts;
+    for (size_t i = 0; i < structure.Size(); i++)
+    {
+        const Element *e = structure.Get(int(i));
+        switch (e->Tag())
+        {
+        case BOUNDARY:
+        {
+            const Boundary *boundary = static_cast<const Boundary*>(e);
+            Boundary normalized(*boundary);
+            NormalizeBoundary(boundary->XY(), pts);
+            normalized.SetXY(pts);
+            shapes.Layers[LayerKey(boundary->Layer(), boundary->DataType())].push_back(RecordHash(normalized, buffer));
+            break;
+        }
+        case BOX_BOUNDARY:
+        {
+            const Box *box = static_cast<const Box*>(e);
+            shapes.Layers[LayerKey(box->Layer(), box->DataType())].push_back(RecordHash(*box, buffer));
+            break;
+        }
+        case PATH:
+        {
+            const Path *path = static_cast<const Path*>(e);
+            shapes.Layers[LayerKey(path->Layer(), path->DataType())].push_back(RecordHash(*path, buffer));
+            break;
+        }
+        case SREF:
+        case AREF:
+            shapes.References.push_back(RecordHash(*e, buffer));
+            break;
+        default:
+            break;
+        }
+    }
+    for (auto &layer : shapes.Layers)
+        std::sort(layer.second.begin(), layer.second.end());
+    std::sort(shapes.References.begin(), shapes.References.end());
+    return 0;
+}
+
+void CompareShapes(const CellShapes &older, const CellShapes &newer, CellDiff &diff)
+{
+    auto a = older.Layers.begin();
+    auto b = newer.Layers.begin();
+    while (a != older.Layers.end() || b != newer.Layers.end())
+    {
+        if (b == newer.Layers.end() || (a != older.Layers.end() && a->first < b->first))
+        {
+            diff.Layers.push_back(a->first);
+            ++a;
+        }
+        else if (a == older.Layers.end() || b->first < a->first)
+        {
+            diff.Layers.push_back(b->first);
+            ++b;
+        }
+        else
+        {
+            if (a->second != b->second)
+                diff.Layers.push_back(a->first);
+            ++a;
+            ++b;
+        }
+    }
+    diff.References = older.References != newer.References;
+    diff.Change = diff.Layers.empty() && !diff.References ? CELL_EQUIVALENT : CELL_MODIFIED;
+}
+
+int Diff(CellSource &older, CellSource &newer, std::vector<CellDiff> &diffs, std::string &err, unsigned int threads)
+{
+    int rc = older.Scan(err);
+    if (rc == 0)
+        rc = newer.Scan(err);
+    if (rc != 0)
+        return rc;
+
+    // A name stands for the first cell of that name.
+    std::map<std::string, std::pair<int, int>> cells;
+    for (size_t i = 0; i < older.Names.size(); i++)
+        cells.insert(std::make_pair(older.Names[i], std::make_pair(int(i), -1)));
+    for (size_t i = 0; i < newer.Names.size(); i++)
+    {
+        auto iter = cells.insert(std::make_pair(newer.Names[i], std::make_pair(-1, -1))).first;
+        if (iter->second.second < 0)
+            iter->second.second = int(i);
+    }
+
+    std::vector<CellDiff> all(cells.size());
+    std::vector<std::pair<int, int>> pairs(cells.size());
+    std::vector<size_t> compared;
+    std::unordered_map<std::string, size_t> index;
+    size_t k = 0;
+    for (auto &cell : cells)
+    {
+        CellDiff &diff = all[k];
+        diff.Name = cell.first;
+        pairs[k] = cell.second;
+        index.insert(std::make_pair(cell.first, k));
+        if (cell.second.first < 0)
+            diff.Change = CELL_ADDED;
+        else if (cell.second.second < 0)
+            diff.Change = CELL_REMOVED;
+        else if (older.Hashes[cell.second.first] != newer.Hashes[cell.second.second])
+            compared.push_back(k);
+        k++;
+    }
+
+    std::vector<int> codes(threads, 0);
+    std::vector<std::string> errors(threads);
+    ParallelFor(compared.size(), threads, [&](size_t i, unsigned int thread) {
+        if (codes[thread] != 0)
+            return;
+        size_t cell = compared[i];
+        CellShapes a, b;
+        codes[thread] = ReadShapes(older, pairs[cell].first, thread, a, errors[thread]);
+        if (codes[thread] == 0)
+            codes[thread] = ReadShapes(newer, pairs[cell].second, thread, b, errors[thread]);
+        if (codes[thread] == 0)
+            CompareShapes(a, b, all[cell]);
+    });
+    for (size_t i = 0; i < codes.size(); i++)
+    {
+        if (codes[i] != 0)
+        {
+            err = errors[i];
+            return codes[i];
+        }
+    }
+
+    // Whether a cell under each cell of the new version changed, children first.
+    enum { NEW, OPEN, DONE };
+    std::vector<char> state(all.size(), NEW);
+    std::vector<std::pair<size_t, size_t>> stack;
+    for (size_t root = 0; root < all.size(); root++)
+    {
+        if (pairs[root].second < 0 || state[root] != NEW)
+            continue;
+        state[root] = OPEN;
+        stack.push_back(std::make_pair(root, size_t(0)));
+        while (!stack.empty())
+        {
+            size_t cell = stack.back().first;
+            size_t &next = stack.back().second;
+            const std::vector<std::string> &references = newer.References[pairs[cell].second];
+            if (next < references.size())
+            {
+                auto iter = index.find(references[next++]);
+                if (iter == index.end() || pairs[iter->second].second < 0)
+                {
+                    all[cell].Below = true;
+                    continue;
+                }
+                size_t child = iter->second;
+                if (state[child] == NEW)
+                {
+                    state[child] = OPEN;
+                    stack.push_back(std::make_pair(child, size_t(0)));
+                }
+                else if (state[child] == DONE)
+                {
+                    all[cell].Below = all[cell].Below || all[child].Below
+                                      || all[child].Change == CELL_MODIFIED || all[child].Change == CELL_ADDED;
+                }
+                continue;
+            }
+            state[cell] = DONE;
+            stack.pop_back();
+            if (!stack.empty())
+            {
+                size_t parent = stack.back().first;
+                all[parent].Below = all[parent].Below || all[cell].Below
+                                    || all[cell].Change == CELL_MODIFIED || all[cell].Change == CELL_ADDED;
+            }
+        }
+    }
+
+    diffs.clear();
+    for (auto &diff : all)
+    {
+        if (diff.Change != CELL_UNCHANGED || diff.Below)
+            diffs.push_back(diff);
+    }
+    return 0;
+}
+
+}
+
+CellDiff::CellDiff()
+{
+    Change = CELL_UNCHANGED;
+    References = false;
+    Below = false;
+}
+
+int DiffDatabases(std::string oldName, std::string newName, std::vector<CellDiff> &diffs,
+                  std::string &err, unsigned int threads)
+{
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    DatabaseSource older(threads), newer(threads);
+    int rc = older.Open(oldName, err);
+    if (rc == 0)
+        rc = newer.Open(newName, err);
+    if (rc != 0)
+        return rc;
+    return Diff(older, newer, diffs, err, threads);
+}
+
+int DiffGDSII(std::string oldName, std::string newName, std::vector<CellDiff> &diffs,
+              std::string &err, unsigned int threads)
+{
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    FileSource older(threads), newer(threads);
+    int rc = older.Open(oldName, err);
+    if (rc == 0)
+        rc = newer.Open(newName, err);
+    if (rc != 0)
+        return rc;
+    return Diff(older, newer, diffs, err, threads);
+}
+
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of GDSII.
+ *
+ * diff.h -- The header file which declare the comparison of two versions
+ *           of a layout cell by cell.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_DIFF_H
+#define GDS_DIFF_H
+#include <string>
+#include <vector>
+#include "census.h"
+
+namespace GDS {
+
+enum CELL_CHANGE
+{
+    CELL_UNCHANGED  = 0,    //< The records are the same.
+    CELL_EQUIVALENT = 1,    //< The records differ, but not the shapes and the references.
+    CELL_MODIFIED   = 2,
+    CELL_ADDED      = 3,
+    CELL_REMOVED    = 4
+};
+
+/*!
+ * \brief The change of a cell from the old version to the new one.
+ */
+struct CellDiff
+{
+    std::string             Name;
+    CELL_CHANGE             Change;
+    std::vector<LayerKey>   Layers;         //< The layers whose shapes differ, for CELL_MODIFIED.
+    bool                    References;     //< Whether the SREFs and AREFs differ, for CELL_MODIFIED.
+    bool                    Below;          //< Whether a cell under it in the new version is modified, added or missing.
+
+    CellDiff();
+};
+
+/*
+ * A cell is compared by the hash of its records from HashCellRecords,
+ * which a database keeps in cell_hash_table; the data of the cells is
+ * read only for the hashes a database lacks and for the cells whose
+ * hashes differ. Those cells are parsed and their shapes compared layer
+ * by layer, and their references, in any order; the first point of a
+ * BOUNDARY and the direction of its points do not matter. TEXT and NODE
+ * are not compared. The cells are hashed and compared on several threads.
+ *
+ * The changes are sorted by name, and a cell is listed if it is not
+ * CELL_UNCHANGED or a cell under it changed.
+ */
+
+/*!
+ * Compare two layout databases.
+ * @param diffs[out] The changed cells.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ * @return 0 if succeeded, or DB_ERROR, FORMAT_ERROR.
+ */
+int DiffDatabases(std::string oldName, std::string newName, std::vector<CellDiff> &diffs,
+                  std::string &err, unsigned int threads = 0);
+/*!
+ * Compare two GDSII files. The files are mapped and every cell is hashed.
+ * @return 0 if succeeded, or FILE_ERROR, FORMAT_ERROR.
+ */
+int DiffGDSII(std::string oldName, std::string newName, std::vector<CellDiff> &diffs,
+              std::string &err, unsigned int threads = 0);
+
+}
+
+#endif // GDS_DIFF_H
@@ -0,0 +1,1007 @@
+/*
+ * This file is part of GDSII.
+ *
+ * drc.cpp -- The source file which defines the width, spacing and
+ *            enclosure checks of layers.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <tuple>
+#include "drc.h"
+#include "gdsio.h"
+#include "parallel.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "boundary.h"
+#include "box.h"
+#include "path.h"
+#include "sref.h"
+#include "aref.h"
+#include "transform.h"
+#include "outline.h"
+#include "placement.h"
+#include <sqlite3.h>
+
+namespace GDS
+{
+
+namespace
+{
+
+const long long BIN_EDGES = 16;         // Edges per bin on average.
+const long long MAX_BINS = 1 << 22;     // Bins of a grid at most.
+const size_t TILES_PER_THREAD = 8;
+
+const std::string CREATE_DRC_TABLES =
+" \
+DROP TABLE IF EXISTS drc_rule_table; \
+DROP TABLE IF EXISTS drc_violation_table; \
+CREATE TABLE drc_rule_table (ID INTEGER NOT NULL, NAME TEXT NOT NULL, CHECK_TYPE TEXT NOT NULL, \
+LAYER INTEGER NOT NULL, DATATYPE INTEGER NOT NULL, OUTER_LAYER INTEGER NOT NULL, OUTER_DATATYPE INTEGER NOT NULL, \
+VALUE INTEGER NOT NULL);\
+CREATE TABLE drc_violation_table (CELL TEXT NOT NULL, RULE INTEGER NOT NULL, X0 INTEGER NOT NULL, Y0 INTEGER NOT NULL, \
+X1 INTEGER NOT NULL, Y1 INTEGER NOT NULL, X2 INTEGER NOT NULL, Y2 INTEGER NOT NULL, \
+X3 INTEGER NOT NULL, Y3 INTEGER NOT NULL, DISTANCE REAL NOT NULL);\
+";
+
+Rect Around(const Segment &s, long long margin)
+{
+    Rect r;
+    r.Left = std::min(s.Start.X, s.End.X) - margin;
+    r.Right = std::max(s.Start.X, s.End.X) + margin;
+    r.Bottom = std::min(s.Start.Y, s.End.Y) - margin;
+    r.Top = std::max(s.Start.Y, s.End.Y) + margin;
+    return r;
+}
+
+// 1 if p is on the left of s, -1 on the right, or 0 on its line.
+int Side(const Segment &s, const Point &p)
+{
+    long long cross = ((long long)s.End.X - s.Start.X) * ((long long)p.Y - s.Start.Y)
+        - ((long long)s.End.Y - s.Start.Y) * ((long long)p.X - s.Start.X);
+    return (cross > 0) - (cross < 0);
+}
+
+long long Dot(const Segment &a, const Segment &b)
+{
+    return ((long long)a.End.X - a.Start.X) * ((long long)b.End.X - b.Start.X)
+        + ((long long)a.End.Y - a.Start.Y) * ((long long)b.End.Y - b.Start.Y);
+}
+
+bool SameVertex(const Segment &a, const Segment &b)
+{
+    auto same = [](const Point &p, const Point &q) { return p.X == q.X && p.Y == q.Y; };
+    return same(a.Start, b.Start) || same(a.Start, b.End) || same(a.End, b.Start) || same(a.End, b.End);
+}
+
+// Whether the segments cross at a point inside both of them.
+bool Crosses(const Segment &a, const Segment &b)
+{
+    return Side(a, b.Start) * Side(a, b.End) < 0 && Side(b, a.Start) * Side(b, a.End) < 0;
+}
+
+double Distance(const Point &p, const Segment &s)
+{
+    double dx = (double)s.End.X - s.Start.X;
+    double dy = (double)s.End.Y - s.Start.Y;
+    double px = (double)p.X - s.Start.X;
+    double py = (double)p.Y - s.Start.Y;
+    double length = dx * dx + dy * dy;
+    double t = length == 0 ? 0 : (px * dx + py * dy) / length;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    px -= t * dx;
+    py -= t * dy;
+    return std::sqrt(px * px + py * py);
+}
+
+double Distance(const Segment &a, const Segment &b)
+{
+    int sides[] = { Side(a, b.Start), Side(a, b.End), Side(b, a.Start), Side(b, a.End) };
+    if (sides[0] * sides[1] <= 0 && sides[2] * sides[3] <= 0
+        && (sides[0] != 0 || sides[1] != 0 || sides[2] != 0 || sides[3] != 0))
+        return 0;
+    return std::min(std::min(Distance(a.Start, b), Distance(a.End, b)),
+                    std::min(Distance(b.Start, a), Distance(b.End, a)));
+}
+
+// Whether the edges are measured by a check, as drc.h describes.
+bool Faces(DRC_CHECK check, const Segment &a, const Segment &b)
+{
+    switch (check)
+    {
+    case DRC_WIDTH:
+        return Dot(a, b) < 0 && !SameVertex(a, b)
+            && std::max(Side(a, b.Start), Side(a, b.End)) > 0
+            && std::max(Side(b, a.Start), Side(b, a.End)) > 0;
+    case DRC_SPACING:
+        return Dot(a, b) < 0 && !SameVertex(a, b)
+            && std::min(Side(a, b.Start), Side(a, b.End)) < 0
+            && std::min(Side(b, a.Start), Side(b, a.End)) < 0;
+    case DRC_ENCLOSURE:
+        return Crosses(a, b)
+            || (Dot(a, b) > 0
+                && std::min(Side(a, b.Start), Side(a, b.End)) <= 0
+                && std::max(Side(b, a.Start), Side(b, a.End)) >= 0);
+    default:
+        return false;
+    }
+}
+
+/*
+ * The edges in each bin of a grid, stored as one array with the start of
+ * each bin.
+ */
+struct Bins
+{
+    long long Left, Bottom, Size, Columns, Rows;
+    std::vector<size_t> Starts;
+    std::vector<unsigned int> Members;
+
+    long long Column(long long x) const
+    {
+        return std::min((x - Left) / Size, Columns - 1);
+    }
+    long long Row(long long y) const
+    {
+        return std::min((y - Bottom) / Size, Rows - 1);
+    }
+    void Fill(const std::vector<Segment> &edges, long long margin)
+    {
+        Starts.assign((size_t)(Columns * Rows + 1), 0);
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (size_t k = 0; k < edges.size(); k++)
+            {
+                Rect r = Around(edges[k], margin);
+                for (long long j = Row(r.Bottom); j <= Row(r.Top); j++)
+                {
+                    for (long long i = Column(r.Left); i <= Column(r.Right); i++)
+                    {
+                        size_t bin = (size_t)(j * Columns + i);
+                        if (pass == 0)
+                            Starts[bin + 1]++;
+                        else
+                            Members[Starts[bin]++] = (unsigned int)k;
+                    }
+                }
+            }
+            if (pass == 0)
+            {
+                for (size_t bin = 1; bin < Starts.size(); bin++)
+                    Starts[bin] += Starts[bin - 1];
+                Members.resize(Starts.back());
+            }
+            else
+            {
+                // The starts were moved to the ends of the bins.
+                for (size_t bin = Starts.size() - 1; bin > 0; bin--)
+                    Starts[bin] = Starts[bin - 1];
+                Starts[0] = 0;
+            }
+        }
+    }
+};
+
+void CheckRule(const std::vector<Segment> &first, const std::vector<Segment> &second, bool same,
+               const DrcRule &rule, size_t rule_index, std::vector<DrcViolation> &violations,
+               unsigned int threads)
+{
+    if (first.empty() || second.empty() || rule.Value <= 0)
+        return;
+
+    // Two edges closer than the value have a point within half of it of both.
+    long long margin = ((long long)rule.Value + 1) / 2;
+    Rect all = Around(first.front(), margin);
+    size_t count = first.size() + (same ? 0 : second.size());
+    for (int set = 0; set < (same ? 1 : 2); set++)
+    {
+        for (auto &e : set == 0 ? first : second)
+        {
+            Rect r = Around(e, margin);
+            all.Left = std::min(all.Left, r.Left);
+            all.Bottom = std::min(all.Bottom, r.Bottom);
+            all.Right = std::max(all.Right, r.Right);
+            all.Top = std::max(all.Top, r.Top);
+        }
+    }
+    double area = (double)(all.Right - all.Left + 1) * (double)(all.Top - all.Bottom + 1);
+    double size = std::sqrt(area * BIN_EDGES / (double)count);
+    size = std::max(size, std::sqrt(area / MAX_BINS));
+    size = std::max(size, (double)rule.Value);
+
+    Bins bins;
+    bins.Left = all.Left;
+    bins.Bottom = all.Bottom;
+    bins.Size = std::max(1LL, (long long)std::ceil(size));
+    bins.Columns = (all.Right - all.Left) / bins.Size + 1;
+    bins.Rows = (all.Top - all.Bottom) / bins.Size + 1;
+    bins.Fill(first, margin);
+    Bins other;
+    if (!same)
+    {
+        other = bins;
+        other.Fill(second, margin);
+    }
+    const Bins &second_bins = same ? bins : other;
+
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    size_t tiles = std::min((size_t)bins.Rows, (size_t)threads * TILES_PER_THREAD);
+    std::vector<std::vector<DrcViolation> > parts(tiles);
+    ParallelFor(tiles, threads, [&](size_t tile, unsigned int)
+    {
+        long long row_begin = bins.Rows * (long long)tile / (long long)tiles;
+        long long row_end = bins.Rows * (long long)(tile + 1) / (long long)tiles;
+        std::vector<DrcViolation> &out = parts[tile];
+        for (long long j = row_begin; j < row_end; j++)
+        {
+            for (long long i = 0; i < bins.Columns; i++)
+            {
+                size_t bin = (size_t)(j * bins.Columns + i);
+                for (size_t m = bins.Starts[bin]; m < bins.Starts[bin + 1]; m++)
+                {
+                    const Segment &a = first[bins.Members[m]];
+                    Rect ra = Around(a, margin);
+                    size_t n = same ? m + 1 : second_bins.Starts[bin];
+                    for (; n < second_bins.Starts[bin + 1]; n++)
+                    {
+                        const Segment &b = second[second_bins.Members[n]];
+                        Rect rb = Around(b, margin);
+                        long long x = std::max(ra.Left, rb.Left);
+                        long long y = std::max(ra.Bottom, rb.Bottom);
+                        if (x > std::min(ra.Right, rb.Right) || y > std::min(ra.Top, rb.Top)
+                            || bins.Column(x) != i || bins.Row(y) != j)
+                            continue;
+                        if (!Faces(rule.Check, a, b))
+                            continue;
+                        double distance = Distance(a, b);
+                        if (distance >= rule.Value)
+                            continue;
+                        DrcViolation violation;
+                        violation.Rule = rule_index;
+                        violation.First = a;
+                        violation.Second = b;
+                        violation.Distance = distance;
+                        out.push_back(violation);
+                    }
+                }
+            }
+        }
+    });
+
+    for (auto &part : parts)
+        violations.insert(violations.end(), part.begin(), part.end());
+}
+
+const char *CheckName(DRC_CHECK check)
+{
+    switch (check)
+    {
+    case DRC_WIDTH:
+        return "WIDTH";
+    case DRC_SPACING:
+        return "SPACING";
+    case DRC_ENCLOSURE:
+        return "ENCLOSURE";
+    default:
+        return "";
+    }
+}
+
+
+typedef std::map<LayerKey, std::vector<Segment> > LayerEdges;
+
+// Check pairs with one edge from each side, on every rule but width.
+void CheckSides(const LayerEdges &a, const LayerEdges &b, const std::vector<DrcRule> &rules,
+                std::vector<DrcViolation> &violations)
+{
+    for (size_t k = 0; k < rules.size(); k++)
+    {
+        const DrcRule &rule = rules[k];
+        if (rule.Check == DRC_WIDTH)
+            continue;
+        LayerKey second = rule.Check == DRC_ENCLOSURE ? rule.Outer : rule.Layer;
+        for (int side = 0; side < (rule.Check == DRC_ENCLOSURE ? 2 : 1); side++)
+        {
+            auto inner = (side == 0 ? a : b).find(rule.Layer);
+            auto outer = (side == 0 ? b : a).find(second);
+            if (inner != (side == 0 ? a : b).end() && outer != (side == 0 ? b : a).end())
+                CheckRule(inner->second, outer->second, false, rule, k, violations, 1);
+        }
+    }
+}
+
+/*
+ * The range of (col, row) whose lattice point col * c + row * r is in a
+ * box, clipped to the given limits. The corners of the box are mapped
+ * back to the lattice, or a line of points is solved on each axis.
+ */
+void LatticeRange(const Point &c, const Point &r, const Rect &box,
+                  int &col0, int &col1, int &row0, int &row1)
+{
+    double det = (double)c.X * r.Y - (double)r.X * c.Y;
+    if (det != 0)
+    {
+        double cols[4], rows[4];
+        long long xs[] = { box.Left, box.Right, box.Right, box.Left };
+        long long ys[] = { box.Bottom, box.Bottom, box.Top, box.Top };
+        for (int i = 0; i < 4; i++)
+        {
+            cols[i] = ((double)xs[i] * r.Y - (double)r.X * ys[i]) / det;
+            rows[i] = ((double)c.X * ys[i] - (double)xs[i] * c.Y) / det;
+        }
+        col0 = std::max(col0, (int)std::floor(*std::min_element(cols, cols + 4)));
+        col1 = std::min(col1, (int)std::ceil(*std::max_element(cols, cols + 4)));
+        row0 = std::max(row0, (int)std::floor(*std::min_element(rows, rows + 4)));
+        row1 = std::min(row1, (int)std::ceil(*std::max_element(rows, rows + 4)));
+        return;
+    }
+    // A line of points: only one of the ranges has more than one value.
+    auto solve = [&](const Point &pitch, int &lo, int &hi)
+    {
+        long long limits[2][2] = { { box.Left, box.Right }, { box.Bottom, box.Top } };
+        int steps[2] = { pitch.X, pitch.Y };
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (steps[axis] == 0)
+            {
+                if (limits[axis][0] > 0 || limits[axis][1] < 0)
+                    hi = lo - 1;
+                continue;
+            }
+            double a = (double)limits[axis][0] / steps[axis];
+            double b = (double)limits[axis][1] / steps[axis];
+            lo = std::max(lo, (int)std::ceil(std::min(a, b)));
+            hi = std::min(hi, (int)std::floor(std::max(a, b)));
+        }
+    };
+    if (row0 == row1 && row0 == 0)
+        solve(c, col0, col1);
+    else if (col0 == col1 && col0 == 0)
+        solve(r, row0, row1);
+}
+
+// The instances whose bounds overlap a region.
+void ElementRange(const Placement &p, const Rect &region, int &col0, int &col1, int &row0, int &row1)
+{
+    col0 = row0 = 0;
+    col1 = p.Cols - 1;
+    row1 = p.Rows - 1;
+    Rect origins = { region.Left - p.Bounds.Right - p.Origin.X, region.Bottom - p.Bounds.Top - p.Origin.Y,
+                     region.Right - p.Bounds.Left - p.Origin.X, region.Top - p.Bounds.Bottom - p.Origin.Y };
+    LatticeRange(p.ColPitch, p.RowPitch, origins, col0, col1, row0, row1);
+}
+
+struct CellInfo
+{
+    LayerEdges              Local;
+    bool                    HasLocal;
+    Rect                    LocalBounds;
+    std::vector<Placement>  Placements;
+    bool                    HasBounds;
+    Rect                    Bounds;     //< The bounds of the edges under the cell.
+
+    CellInfo()
+        : HasLocal(false), LocalBounds(), HasBounds(false), Bounds()
+    {
+    }
+};
+
+// Two instances: their cells, orientations, and the offset between them.
+struct Context
+{
+    const Structure *A, *B;
+    bool ReflectionA, ReflectionB;
+    double MagA, AngleA, MagB, AngleB;
+    int DX, DY;
+
+    bool operator<(const Context &other) const
+    {
+        return std::tie(A, B, ReflectionA, ReflectionB, MagA, AngleA, MagB, AngleB, DX, DY)
+            < std::tie(other.A, other.B, other.ReflectionA, other.ReflectionB, other.MagA, other.AngleA,
+                       other.MagB, other.AngleB, other.DX, other.DY);
+    }
+};
+
+class HierarchicalCheck
+{
+public:
+    HierarchicalCheck(const std::vector<DrcRule> &rules) : mRules(rules)
+    {
+        mMargin = 0;
+        for (auto &rule : rules)
+        {
+            mLayers.push_back(rule.Layer);
+            if (rule.Check == DRC_ENCLOSURE)
+                mLayers.push_back(rule.Outer);
+            mMargin = std::max(mMargin, (long long)rule.Value);
+        }
+        std::sort(mLayers.begin(), mLayers.end());
+        mLayers.erase(std::unique(mLayers.begin(), mLayers.end()), mLayers.end());
+    }
+
+    void Run(const Structure *root, std::vector<DrcCellViolations> &cells, unsigned int threads)
+    {
+        std::vector<const Structure*> path;
+        Visit(root, path);
+        ParallelFor(mOrder.size(), threads, [&](size_t i, unsigned int)
+        {
+            ReadLocal(mOrder[i], mCells[mOrder[i]]);
+        });
+        for (auto cell : mOrder)
+            SetBounds(mCells[cell]);
+
+        std::vector<std::vector<DrcViolation> > found(mOrder.size());
+        ParallelFor(mOrder.size(), threads, [&](size_t i, unsigned int)
+        {
+            CheckCell(mCells[mOrder[i]], found[i]);
+        });
+        cells.clear();
+        for (size_t i = 0; i < mOrder.size(); i++)
+        {
+            if (found[i].empty())
+                continue;
+            DrcCellViolations result;
+            result.Cell = mOrder[i];
+            result.Violations.swap(found[i]);
+            cells.push_back(std::move(result));
+        }
+    }
+
+private:
+    // Find the cells under the root, each after the cells it refers to.
+    void Visit(const Structure *cell, std::vector<const Structure*> &path)
+    {
+        if (mCells.count(cell) != 0 || std::find(path.begin(), path.end(), cell) != path.end())
+            return;
+        path.push_back(cell);
+        CellInfo info;
+        for (size_t i = 0; i < cell->Size(); i++)
+        {
+            Placement p;
+            if (!ReadPlacement(cell->Get((int)i), cell->Parent(), p)
+                || std::find(path.begin(), path.end(), p.Cell) != path.end())
+                continue;
+            Visit(p.Cell, path);
+            info.Placements.push_back(p);
+        }
+        path.pop_back();
+        mCells[cell] = std::move(info);
+        mOrder.push_back(cell);
+    }
+
+    void ReadLocal(const Structure *cell, CellInfo &info)
+    {
+        info.HasLocal = false;
+        std::map<LayerKey, std::vector<Polygon> > polygons;
+        auto wanted = [&](short layer, short data_type)
+        {
+            return std::binary_search(mLayers.begin(), mLayers.end(), LayerKey(layer, data_type));
+        };
+        Polygon outline;
+        for (size_t i = 0; i < cell->Size(); i++)
+        {
+            const Element *e = cell->Get((int)i);
+            if (e->Tag() == BOUNDARY)
+            {
+                const Boundary *boundary = static_cast<const Boundary*>(e);
+                if (wanted(boundary->Layer(), boundary->DataType()))
+                    polygons[LayerKey(boundary->Layer(), boundary->DataType())].push_back(boundary->XY());
+            }
+            else if (e->Tag() == BOX_BOUNDARY)
+            {
+                const Box *box = static_cast<const Box*>(e);
+                if (wanted(box->Layer(), box->DataType()))
+                    polygons[LayerKey(box->Layer(), box->DataType())].push_back(box->XY());
+            }
+            else if (e->Tag() == PATH)
+            {
+                const Path *path = static_cast<const Path*>(e);
+                if (wanted(path->Layer(), path->DataType()) && OutlinePath(path, outline))
+                    polygons[LayerKey(path->Layer(), path->DataType())].push_back(outline);
+            }
+        }
+        for (auto &layer : polygons)
+        {
+            std::vector<Segment> &edges = info.Local[layer.first];
+            MergeEdges(layer.second, edges, 1);
+            for (auto &e : edges)
+            {
+                if (!info.HasLocal)
+                    info.LocalBounds = Around(e, 0);
+                Extend(info.LocalBounds, Around(e, 0));
+                info.HasLocal = true;
+            }
+        }
+    }
+
+    void SetBounds(CellInfo &info)
+    {
+        info.HasBounds = info.HasLocal;
+        info.Bounds = info.LocalBounds;
+        for (auto &p : info.Placements)
+        {
+            const CellInfo &child = mCells[p.Cell];
+            if (!child.HasBounds)
+            {
+                p.Cols = p.Rows = 0;
+                continue;
+            }
+            SetInstanceBounds(p, MapRect(Place(p, Point(0, 0)), child.Bounds));
+            if (!info.HasBounds)
+                info.Bounds = p.AllBounds;
+            Extend(info.Bounds, p.AllBounds);
+            info.HasBounds = true;
+        }
+    }
+
+    /*
+     * Add the edges under a cell which overlap a region of the cell, mapped
+     * to the coordinates of the caller. A reflected edge is turned around,
+     * so the inside stays on its left.
+     */
+    void Gather(const CellInfo &info, const Transform &transform, bool reflected,
+                const Rect &region, LayerEdges &out) const
+    {
+        if (!info.HasBounds || !Touches(info.Bounds, region))
+            return;
+        for (auto &layer : info.Local)
+        {
+            std::vector<Segment> *edges = nullptr;
+            for (auto &e : layer.second)
+            {
+                if (!Touches(Around(e, 0), region))
+                    continue;
+                if (edges == nullptr)
+                    edges = &out[layer.first];
+                Segment mapped = { transform.Map(e.Start), transform.Map(e.End) };
+                if (reflected)
+                    std::swap(mapped.Start, mapped.End);
+                edges->push_back(mapped);
+            }
+        }
+        for (auto &p : info.Placements)
+        {
+            int col0, col1, row0, row1;
+            ElementRange(p, region, col0, col1, row0, row1);
+            for (int row = row0; row <= row1; row++)
+            {
+                for (int col = col0; col <= col1; col++)
+                {
+                    Point origin = ElementOrigin(p, col, row);
+                    if (!Touches(Offset(p.Bounds, origin), region))
+                        continue;
+                    Transform next = Place(p, origin);
+                    next.Multiply(transform);
+                    Gather(mCells.at(p.Cell), next, reflected != p.Reflection,
+                           MapRect(Inverse(p, origin), region), out);
+                }
+            }
+        }
+    }
+
+    // The violations between two instances, with the first one at (0, 0).
+    const std::vector<DrcViolation> &CheckContext(const Placement &a, const Placement &b, const Point &offset)
+    {
+        Context key = { a.Cell, b.Cell, a.Reflection, b.Reflection, a.Mag, a.Angle, b.Mag, b.Angle,
+                        offset.X, offset.Y };
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto iter = mContexts.find(key);
+            if (iter != mContexts.end())
+                return iter->second;
+        }
+
+        Point zero(0, 0);
+        Rect near_a = Grow(a.Bounds, mMargin);
+        Rect near_b = Grow(Offset(b.Bounds, offset), mMargin);
+        LayerEdges edges_a, edges_b;
+        Gather(mCells.at(a.Cell), Place(a, zero), a.Reflection, MapRect(Inverse(a, zero), near_b), edges_a);
+        Gather(mCells.at(b.Cell), Place(b, offset), b.Reflection, MapRect(Inverse(b, offset), near_a), edges_b);
+        std::vector<DrcViolation> found;
+        CheckSides(edges_a, edges_b, mRules, found);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mContexts.insert(std::make_pair(key, std::move(found))).first->second;
+    }
+
+    void AddMoved(const std::vector<DrcViolation> &found, const Point &origin, std::vector<DrcViolation> &out)
+    {
+        for (auto v : found)
+        {
+            Point *pts[] = { &v.First.Start, &v.First.End, &v.Second.Start, &v.Second.End };
+            for (auto p : pts)
+            {
+                p->X += origin.X;
+                p->Y += origin.Y;
+            }
+            out.push_back(v);
+        }
+    }
+
+    void CheckCell(const CellInfo &info, std::vector<DrcViolation> &out)
+    {
+        CheckDrc(info.Local, mRules, out, 1);
+
+        // The shapes of the cell against the instances near them.
+        if (info.HasLocal)
+        {
+            Rect near_local = Grow(info.LocalBounds, mMargin);
+            for (auto &p : info.Placements)
+            {
+                int col0, col1, row0, row1;
+                ElementRange(p, near_local, col0, col1, row0, row1);
+                for (int row = row0; row <= row1; row++)
+                {
+                    for (int col = col0; col <= col1; col++)
+                    {
+                        Point origin = ElementOrigin(p, col, row);
+                        Rect near_instance = Grow(Offset(p.Bounds, origin), mMargin);
+                        if (!Touches(near_instance, near_local))
+                            continue;
+                        LayerEdges local, instance;
+                        for (auto &layer : info.Local)
+                        {
+                            for (auto &e : layer.second)
+                            {
+                                if (Touches(Around(e, 0), near_instance))
+                                    local[layer.first].push_back(e);
+                            }
+                        }
+                        Gather(mCells.at(p.Cell), Place(p, origin), p.Reflection,
+                               MapRect(Inverse(p, origin), near_local), instance);
+                        CheckSides(local, instance, mRules, out);
+                    }
+                }
+            }
+        }
+
+        // Neighbours in the same array, once for each offset between them.
+        for (auto &p : info.Placements)
+        {
+            if (p.Cols * p.Rows < 2)
+                continue;
+            long long width = p.Bounds.Right - p.Bounds.Left + 2 * mMargin;
+            long long height = p.Bounds.Top - p.Bounds.Bottom + 2 * mMargin;
+            Rect offsets = { -width, -height, width, height };
+            int col0 = 1 - p.Cols, col1 = p.Cols - 1, row0 = 0, row1 = p.Rows - 1;
+            LatticeRange(p.ColPitch, p.RowPitch, offsets, col0, col1, row0, row1);
+            for (int dr = row0; dr <= row1; dr++)
+            {
+                for (int dc = col0; dc <= col1; dc++)
+                {
+                    if (dr == 0 && dc <= 0)
+                        continue;
+                    Point offset = ElementOrigin(p, dc, dr);
+                    offset.X -= p.Origin.X;
+                    offset.Y -= p.Origin.Y;
+                    if (!Touches(Grow(p.Bounds, mMargin), Grow(Offset(p.Bounds, offset), mMargin)))
+                        continue;
+                    const std::vector<DrcViolation> &found = CheckContext(p, p, offset);
+                    if (found.empty())
+                        continue;
+                    for (int row = 0; row + dr < p.Rows; row++)
+                    {
+                        for (int col = std::max(0, -dc); col < p.Cols && col + dc < p.Cols; col++)
+                            AddMoved(found, ElementOrigin(p, col, row), out);
+                    }
+                }
+            }
+        }
+
+        // Instances of different references, found by sweeping their bounds.
+        std::vector<size_t> order;
+        for (size_t i = 0; i < info.Placements.size(); i++)
+        {
+            if (info.Placements[i].Cols * info.Placements[i].Rows > 0)
+                order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return info.Placements[a].AllBounds.Left < info.Placements[b].AllBounds.Left;
+        });
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const Placement &a = info.Placements[order[i]];
+            Rect near_a = Grow(a.AllBounds, mMargin);
+            for (size_t j = i + 1; j < order.size(); j++)
+            {
+                const Placement &b = info.Placements[order[j]];
+                Rect near_b = Grow(b.AllBounds, mMargin);
+                if (near_b.Left > near_a.Right)
+                    break;
+                if (!Touches(near_a, near_b))
+                    continue;
+                CheckPlacements(a, b, Intersect(near_a, near_b), out);
+            }
+        }
+    }
+
+    void CheckPlacements(const Placement &a, const Placement &b, const Rect &region, std::vector<DrcViolation> &out)
+    {
+        int col0, col1, row0, row1;
+        ElementRange(a, region, col0, col1, row0, row1);
+        for (int row = row0; row <= row1; row++)
+        {
+            for (int col = col0; col <= col1; col++)
+            {
+                Point origin = ElementOrigin(a, col, row);
+                Rect near_a = Grow(Offset(a.Bounds, origin), mMargin);
+                int bc0, bc1, br0, br1;
+                ElementRange(b, Grow(near_a, mMargin), bc0, bc1, br0, br1);
+                for (int b_row = br0; b_row <= br1; b_row++)
+                {
+                    for (int b_col = bc0; b_col <= bc1; b_col++)
+                    {
+                        Point b_origin = ElementOrigin(b, b_col, b_row);
+                        if (!Touches(near_a, Grow(Offset(b.Bounds, b_origin), mMargin)))
+                            continue;
+                        Point offset(b_origin.X - origin.X, b_origin.Y - origin.Y);
+                        AddMoved(CheckContext(a, b, offset), origin, out);
+                    }
+                }
+            }
+        }
+    }
+
+    const std::vector<DrcRule>                  &mRules;
+    std::vector<LayerKey>                       mLayers;
+    long long                                   mMargin;    //< The largest value of the rules.
+    std::map<const Structure*, CellInfo>        mCells;
+    std::vector<const Structure*>               mOrder;
+    std::map<Context, std::vector<DrcViolation> > mContexts;
+    std::mutex                                  mMutex;
+};
+
+void FlattenCell(const Structure *cell, const std::map<const Structure*, const std::vector<DrcViolation>*> &found,
+                 std::map<const Structure*, bool> &has, std::vector<const Structure*> &path,
+                 const Transform &transform, bool reflected, double scale, std::vector<DrcViolation> &out);
+
+// Whether there are violations in a cell or under it.
+bool HasViolations(const Structure *cell, const std::map<const Structure*, const std::vector<DrcViolation>*> &found,
+                   std::map<const Structure*, bool> &has)
+{
+    auto iter = has.find(cell);
+    if (iter != has.end())
+        return iter->second;
+    has[cell] = false;      // A cycle finds nothing.
+    bool result = found.count(cell) != 0;
+    for (size_t i = 0; !result && i < cell->Size(); i++)
+    {
+        Placement p;
+        if (ReadPlacement(cell->Get((int)i), cell->Parent(), p))
+            result = HasViolations(p.Cell, found, has);
+    }
+    has[cell] = result;
+    return result;
+}
+
+void FlattenCell(const Structure *cell, const std::map<const Structure*, const std::vector<DrcViolation>*> &found,
+                 std::map<const Structure*, bool> &has, std::vector<const Structure*> &path,
+                 const Transform &transform, bool reflected, double scale, std::vector<DrcViolation> &out)
+{
+    if (!HasViolations(cell, found, has) || std::find(path.begin(), path.end(), cell) != path.end())
+        return;
+    auto iter = found.find(cell);
+    if (iter != found.end())
+    {
+        for (auto v : *iter->second)
+        {
+            Segment *segments[] = { &v.First, &v.Second };
+            for (auto s : segments)
+            {
+                s->Start = transform.Map(s->Start);
+                s->End = transform.Map(s->End);
+                if (reflected)
+                    std::swap(s->Start, s->End);
+            }
+            v.Distance *= scale;
+            out.push_back(v);
+        }
+    }
+    path.push_back(cell);
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        Placement p;
+        if (!ReadPlacement(cell->Get((int)i), cell->Parent(), p) || !HasViolations(p.Cell, found, has))
+            continue;
+        for (int row = 0; row < p.Rows; row++)
+        {
+            for (int col = 0; col < p.Cols; col++)
+            {
+                Transform next = Place(p, ElementOrigin(p, col, row));
+                next.Multiply(transform);
+                FlattenCell(p.Cell, found, has, path, next, reflected != p.Reflection, scale * p.Mag, out);
+            }
+        }
+    }
+    path.pop_back();
+}
+
+// The violations of each cell, with the name of the cell.
+typedef std::pair<std::string, const std::vector<DrcViolation>*> CellGroup;
+
+int WriteGroups(std::string dbName, const std::vector<DrcRule> &rules,
+                const std::vector<CellGroup> &groups, std::string &err)
+{
+    sqlite3 *db;
+    int rc = sqlite3_open(dbName.c_str(), &db);
+    if (rc != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    rc = sqlite3_exec(db, CREATE_DRC_TABLES.c_str(), 0, 0, 0);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        err = "SQL error: failed to create drc_rule_table and drc_violation_table.\n";
+        return DB_ERROR;
+    }
+
+    sqlite3_exec(db, "begin;", 0, 0, 0);
+    sqlite3_stmt *stmt = 0;
+    const char *sql = "INSERT INTO drc_rule_table VALUES(?,?,?,?,?,?,?,?)";
+    rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    for (size_t i = 0; rc == SQLITE_OK && i < rules.size(); i++)
+    {
+        const DrcRule &rule = rules[i];
+        sqlite3_reset(stmt);
+        rc = sqlite3_bind_int64(stmt, 1, (sqlite3_int64)i);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_text(stmt, 2, rule.Name.c_str(), -1, SQLITE_STATIC);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_text(stmt, 3, CheckName(rule.Check), -1, SQLITE_STATIC);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(stmt, 4, rule.Layer.first);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(stmt, 5, rule.Layer.second);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(stmt, 6, rule.Outer.first);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(stmt, 7, rule.Outer.second);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(stmt, 8, rule.Value);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    }
+    sqlite3_finalize(stmt);
+    stmt = 0;
+
+    sql = "INSERT INTO drc_violation_table VALUES(?,?,?,?,?,?,?,?,?,?,?)";
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    for (size_t g = 0; rc == SQLITE_OK && g < groups.size(); g++)
+    {
+        const std::vector<DrcViolation> &violations = *groups[g].second;
+        for (size_t i = 0; rc == SQLITE_OK && i < violations.size(); i++)
+        {
+            const DrcViolation &v = violations[i];
+            const Point *pts[] = { &v.First.Start, &v.First.End, &v.Second.Start, &v.Second.End };
+            sqlite3_reset(stmt);
+            rc = sqlite3_bind_text(stmt, 1, groups[g].first.c_str(), -1, SQLITE_STATIC);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_int64(stmt, 2, (sqlite3_int64)v.Rule);
+            for (int k = 0; rc == SQLITE_OK && k < 4; k++)
+            {
+                rc = sqlite3_bind_int(stmt, 3 + 2 * k, pts[k]->X);
+                if (rc == SQLITE_OK)
+                    rc = sqlite3_bind_int(stmt, 4 + 2 * k, pts[k]->Y);
+            }
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_double(stmt, 11, v.Distance);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_exec(db, "rollback;", 0, 0, 0);
+        sqlite3_close(db);
+        err = "SQL error: failed to add violations into drc_violation_table.\n";
+        return DB_ERROR;
+    }
+    sqlite3_exec(db, "commit;", 0, 0, 0);
+    sqlite3_close(db);
+
+    return 0;
+}
+
+}
+
+void CheckDrc(const std::map<LayerKey, std::vector<Segment> > &layers, const std::vector<DrcRule> &rules,
+              std::vector<DrcViolation> &violations, unsigned int threads)
+{
+    violations.clear();
+    for (size_t k = 0; k < rules.size(); k++)
+    {
+        const DrcRule &rule = rules[k];
+        auto first = layers.find(rule.Layer);
+        if (first == layers.end())
+            continue;
+        if (rule.Check != DRC_ENCLOSURE)
+        {
+            CheckRule(first->second, first->second, true, rule, k, violations, threads);
+            continue;
+        }
+        auto second = layers.find(rule.Outer);
+        if (second != layers.end())
+            CheckRule(first->second, second->second, false, rule, k, violations, threads);
+    }
+}
+
+void CheckDrc(const Structure *cell, const std::vector<DrcRule> &rules,
+              std::vector<DrcViolation> &violations, unsigned int threads)
+{
+    std::map<LayerKey, std::vector<Segment> > layers;
+    for (auto &rule : rules)
+    {
+        for (int k = 0; k < (rule.Check == DRC_ENCLOSURE ? 2 : 1); k++)
+        {
+            LayerKey layer = k == 0 ? rule.Layer : rule.Outer;
+            if (layers.count(layer) != 0)
+                continue;
+            std::vector<Polygon> polygons;
+            CollectPolygons(cell, std::vector<LayerKey>(1, layer), polygons);
+            MergeEdges(polygons, layers[layer], threads);
+        }
+    }
+    CheckDrc(layers, rules, violations, threads);
+}
+
+void CheckDrcHierarchical(const Structure *root, const std::vector<DrcRule> &rules,
+                          std::vector<DrcCellViolations> &cells, unsigned int threads)
+{
+    HierarchicalCheck check(rules);
+    check.Run(root, cells, threads);
+}
+
+void FlattenViolations(const Structure *root, const std::vector<DrcCellViolations> &cells,
+                       std::vector<DrcViolation> &violations)
+{
+    std::map<const Structure*, const std::vector<DrcViolation>*> found;
+    for (auto &cell : cells)
+        found[cell.Cell] = &cell.Violations;
+    std::map<const Structure*, bool> has;
+    std::vector<const Structure*> path;
+    FlattenCell(root, found, has, path, Transform(), false, 1, violations);
+}
+
+int WriteDrcViolations(std::string dbName, const std::vector<DrcRule> &rules,
+                       const std::vector<DrcViolation> &violations, std::string &err)
+{
+    std::vector<CellGroup> groups(1, CellGroup(std::string(), &violations));
+    return WriteGroups(dbName, rules, groups, err);
+}
+
+int WriteDrcViolations(std::string dbName, const std::vector<DrcRule> &rules,
+                       const std::vector<DrcCellViolations> &cells, std::string &err)
+{
+    std::vector<CellGroup> groups;
+    for (auto &cell : cells)
+        groups.push_back(CellGroup(cell.Cell->Name(), &cell.Violations));
+    return WriteGroups(dbName, rules, groups, err);
+}
+
+}
@@ -0,0 +1,160 @@
+/*
+ * This file is part of GDSII.
+ *
+ * drc.h -- The header file which declare the width, spacing and enclosure
+ *          checks of layers.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_DRC_H
+#define GDS_DRC_H
+#include <map>
+#include <string>
+#include <vector>
+#include "census.h"
+#include "boolean.h"
+
+namespace GDS {
+class Structure;
+
+enum DRC_CHECK
+{
+    DRC_WIDTH,
+    DRC_SPACING,
+    DRC_ENCLOSURE,
+};
+
+/*!
+ * \brief A rule: the distance between some edges must not be less than Value.
+ */
+struct DrcRule
+{
+    std::string Name;
+    DRC_CHECK   Check;
+    LayerKey    Layer;      //< The layer checked, or the inner layer of an enclosure.
+    LayerKey    Outer;      //< The outer layer of an enclosure.
+    int         Value;      //< The minimum distance in database units.
+};
+
+/*!
+ * \brief Two edges closer than a rule allows.
+ */
+struct DrcViolation
+{
+    size_t      Rule;       //< The index of the rule.
+    Segment     First;      //< The edge of Layer.
+    Segment     Second;     //< The edge of Layer, or of Outer for an enclosure.
+    double      Distance;
+};
+
+/*
+ * The checks measure the Euclidean distance between the edges of the
+ * merged layers, given by MergeEdges, so shapes which touch or overlap
+ * are one shape. Two edges are measured when they face each other:
+ *  - Width: they go in opposite directions, and each one has a part on
+ *    the inner side of the other.
+ *  - Spacing: they go in opposite directions, and each one has a part on
+ *    the outer side of the other. The shapes may be the same one.
+ *  - Enclosure: the edge of the outer layer goes in the same direction,
+ *    it is outside the inner edge or on its line, and the inner edge is
+ *    inside it or on its line. An inner edge which crosses an outer edge
+ *    is a violation at distance 0.
+ *
+ * The candidate pairs of edges come from a grid of bins, where each edge
+ * is put in the bins within half the rule value of it. Two edges closer
+ * than the value share a bin, and the pair is measured by one bin only,
+ * the one with the lower left corner of the overlap of their areas. The
+ * bins are grouped into tiles, which are checked on several threads; the
+ * violations are in the order of the rules, then of the tiles.
+ */
+
+/*!
+ * Check rules on the edges of layers.
+ * @param layers The edges of each layer, from MergeEdges.
+ * @param rules The rules. Rules on missing layers find nothing.
+ * @param violations[out] The violations.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void CheckDrc(const std::map<LayerKey, std::vector<Segment> > &layers, const std::vector<DrcRule> &rules,
+              std::vector<DrcViolation> &violations, unsigned int threads = 0);
+/*!
+ * Check rules on a cell, with the shapes of the cells under it, which are
+ * collected by CollectPolygons and merged on several threads.
+ */
+void CheckDrc(const Structure *cell, const std::vector<DrcRule> &rules,
+              std::vector<DrcViolation> &violations, unsigned int threads = 0);
+
+/*!
+ * \brief The violations found in a cell, in its coordinates. They repeat
+ * in every placement of the cell.
+ */
+struct DrcCellViolations
+{
+    const Structure            *Cell;
+    std::vector<DrcViolation>   Violations;
+};
+
+/*
+ * The hierarchical check visits each cell under the root once. The shapes
+ * of the cell itself are merged and checked like CheckDrc does, and then
+ * the cell checks where its sources meet: its own shapes against each
+ * instance, and the instances against each other, instance by instance
+ * of an AREF. Each side of such a pair brings the edges of its whole
+ * subtree near the other side, and only pairs with one edge from each
+ * side are measured, so nothing is found twice.
+ *
+ * Two instances are a context: their cells, their orientations, and the
+ * offset between them. The result of a context is kept, so the instances
+ * of an array, which have a few contexts between neighbours, are checked
+ * once for each context instead of once for each instance.
+ *
+ * Shapes of different sources are not merged. Width is measured within
+ * the shapes of a cell; a shape made of pieces in several cells is
+ * measured piece by piece, and pieces which touch or overlap are not a
+ * spacing violation.
+ */
+
+/*!
+ * Check rules on a cell and the cells under it through the hierarchy.
+ * @param cells[out] The cells with violations, each cell before the cells
+ *                   which refer to it.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void CheckDrcHierarchical(const Structure *root, const std::vector<DrcRule> &rules,
+                          std::vector<DrcCellViolations> &cells, unsigned int threads = 0);
+/*!
+ * Repeat the violations of the cells in every placement under the root,
+ * in the coordinates of the root.
+ * @param violations[out] The violations are appended.
+ */
+void FlattenViolations(const Structure *root, const std::vector<DrcCellViolations> &cells,
+                       std::vector<DrcViolation> &violations);
+
+/*!
+ * Write the rules and the violations into drc_rule_table and
+ * drc_violation_table of a database, replacing the ones there. The CELL
+ * of flat violations is empty.
+ * @return 0 if succeeded, or DB_ERROR.
+ */
+int WriteDrcViolations(std::string dbName, const std::vector<DrcRule> &rules,
+                       const std::vector<DrcViolation> &violations, std::string &err);
+int WriteDrcViolations(std::string dbName, const std::vector<DrcRule> &rules,
+                       const std::vector<DrcCellViolations> &cells, std::string &err);
+
+}
+
+#endif // GDS_DRC_H
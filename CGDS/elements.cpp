@@ -20,6 +20,7 @@
  **/
 #include "tags.h"
 #include "elements.h"
+#include "structures.h"
 
 
 namespace GDS
@@ -61,6 +62,12 @@ void Element::SetParent(Structure *parent)
     mParent = parent;
 }
 
+void Element::Changed()
+{
+    if (mParent != nullptr)
+        mParent->SetChanged(true);
+}
+
 Record_type Element::Tag() const
 {
     return mTag;
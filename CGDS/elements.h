@@ -48,6 +48,13 @@ public:
             will return false.
     */
     virtual bool BBox(int &x, int &y, int &w, int &h) const = 0;
+    /*!
+    Append the GDSII records of current element to a buffer.
+    @param out[in,out] The buffer.
+    @return False if the element can not be written as GDSII records,
+            e.g. a BOUNDARY with more points than a XY record holds.
+    */
+    virtual bool Write(std::vector<char> &out) const = 0;
 
     Structure *Parent() const;
 
@@ -57,6 +64,11 @@ protected:
     void SetTag(Record_type tag);
     
     void SetParent(Structure *parent);
+    /*!
+    Mark the parent structure as changed, so it is written from its
+    elements. The setters call it after changing current element.
+    */
+    void Changed();
 
 private:
     Record_type mTag;
@@ -21,29 +21,45 @@
  **/
 
 #include <sstream>
+#include <cstring>
 #include <cmath>
+#include <map>
 #include <vector>
 #include <cassert>
 #include "gdsio.h"
 #include "tags.h"
-#include "sqlite/sqlite3.h"
+#include "stats.h"
+#include <sqlite3.h>
 
 const char *INFO_TABLE = "db_info_table";
 const char *CELL_TABLE = "cell_table";
+const char *CELL_OFFSET_TABLE = "cell_offset_table";
 //const std::string DATA_COL_NAME = "DATA";
 const char *GDS_VERSION_ID = "GDS_VERSION";
 const char *MOD_TIME_ID = "MOD_TIME";
 const char *ACC_TIME_ID = "ACC_TIME";
 const char *LIB_NAME_ID = "LIB_NAME";
 const char *UNITS_ID = "UNITS";
+const char *CELL_FORMAT_ID = "CELL_FORMAT";
 const char *DATA_COL_NAME = "DATA";
 
 const std::string CREATE_DB_BASIC_INFO =
 " \
 DROP TABLE IF EXISTS db_info_table; \
 DROP TABLE IF EXISTS cell_table; \
+DROP TABLE IF EXISTS cell_offset_table; \
+DROP TABLE IF EXISTS cell_summary_table; \
+DROP TABLE IF EXISTS cell_layer_table; \
+DROP TABLE IF EXISTS cell_reference_table; \
+DROP TABLE IF EXISTS cell_hash_table; \
 CREATE TABLE db_info_table ( ID TEXT NOT NULL, DATA BLOB NOT NULL); \
 CREATE TABLE cell_table (ID TEXT NOT NULL, DATA BLOB);\
+CREATE TABLE cell_offset_table (ID TEXT NOT NULL, START INTEGER NOT NULL, END INTEGER NOT NULL);\
+CREATE TABLE cell_summary_table (ID TEXT NOT NULL, BOUNDARIES INTEGER NOT NULL, PATHS INTEGER NOT NULL, \
+SREFS INTEGER NOT NULL, AREFS INTEGER NOT NULL, OTHERS INTEGER NOT NULL);\
+CREATE TABLE cell_layer_table (ID TEXT NOT NULL, LAYER INTEGER NOT NULL, DATATYPE INTEGER NOT NULL, COUNT INTEGER NOT NULL);\
+CREATE TABLE cell_reference_table (ID TEXT NOT NULL, SNAME TEXT NOT NULL, COUNT INTEGER NOT NULL);\
+CREATE TABLE cell_hash_table (ID TEXT NOT NULL, HASH INTEGER NOT NULL);\
 ";
 const char *GET_ROWID_TEMPLATE = "SELECT rowid FROM %s WHERE ID='%s';";
 const char *UPDATE_LIB_NAME_SIZE = "UPDATE db_info_table SET DATA=zeroblob(%d) WHERE ID='LIB_NAME';";
@@ -54,14 +70,14 @@ void GDS::Encode(short in, char* out)
 {
     char high, low;
     high = (in & 0xff00) >> 8;
-    low = low & 0x00ff;
+    low = in & 0x00ff;
     out[0] = high;
     out[1] = low;
 }
 
-void GDS::Decode(char *in, short &out)
+void GDS::Decode(const char *in, short &out)
 {
-    out = in[0] << 8 | in[1];
+    out = (short)(((unsigned char)in[0] << 8) | (unsigned char)in[1]);
 }
 
 void GDS::Encode(int in, char* out)
@@ -72,9 +88,12 @@ void GDS::Encode(int in, char* out)
     out[0] = (in >> 24) & 0xff;
 }
 
-void GDS::Decode(char *in, int &out)
+void GDS::Decode(const char *in, int &out)
 {
-    out = in[3] + (in[2] << 8) + (in[1] << 16) + (in[0] << 24);
+    out = (int)(((unsigned int)(unsigned char)in[0] << 24)
+                | ((unsigned int)(unsigned char)in[1] << 16)
+                | ((unsigned int)(unsigned char)in[2] << 8)
+                | (unsigned int)(unsigned char)in[3]);
 }
 
 void GDS::Encode(double in, char *out)
@@ -103,21 +122,26 @@ void GDS::Encode(double in, char *out)
                 exponent--;
             }
         }
+        // 56-bit mantissa, rounded to the nearest.
+        unsigned long long bits = (unsigned long long)(mantissa * 72057594037927936.0 + 0.5);
+        if (bits >> 56)
+        {
+            bits >>= 4;
+            exponent++;
+        }
         exponent += 64;
-        out[0] = exponent;
+        out[0] = (char)(exponent & 0x7f);
         if (in < 0)
             out[0] = out[0] | 0x80;
-        for (int j = 1; j < 8; j++)
+        for (int j = 7; j >= 1; j--)
         {
-            mantissa *= 256;
-            out[j] = mantissa;
-            mantissa = mantissa - int(mantissa);
-
+            out[j] = (char)(bits & 0xff);
+            bits >>= 8;
         }
     }
 }
 
-void GDS::Decode(char *in, double &out)
+void GDS::Decode(const char *in, double &out)
 {
     short sign_flag = (in[0] & 0x80) ? -1 : 1;
     short exponent = (in[0] & 0x7f) - 64;
@@ -125,7 +149,7 @@ void GDS::Decode(char *in, double &out)
     for (int i = 1; i < 8; i++)
     {
         mantissa = mantissa << 8;
-        mantissa = mantissa | in[i];
+        mantissa = mantissa | (unsigned char)in[i];
     }
 
     out = mantissa / std::pow(2.0, 56);
@@ -154,7 +178,7 @@ bool GDS::readShort(std::ifstream &in, short &data)
     if (in.fail())
         return false;
     
-    data = buffer[0] << 8 | buffer[1];
+    data = (short)(((unsigned char)buffer[0] << 8) | (unsigned char)buffer[1]);
 
     return true;
 }
@@ -177,10 +201,7 @@ bool GDS::readInteger(std::ifstream &in, int &data)
     if (in.fail())
         return false;
 
-    data = buffer[3]
-            + (buffer[2] << 8)
-            + (buffer[1] << 16)
-            + (buffer[0] << 24);
+    Decode(buffer, data);
 
     return true;
  }
@@ -329,6 +350,91 @@ bool GDS::writeByte(std::ofstream &out, char data)
     return !out.fail();
 }
 
+bool GDS::ReadRecordHeader(const char *&cursor, const char *end, int &size, Byte &type, Byte &dt)
+{
+    if (end - cursor < 4)
+        return false;
+    size = ((unsigned char)cursor[0] << 8) | (unsigned char)cursor[1];
+    type = (Byte)cursor[2];
+    dt = (Byte)cursor[3];
+    if (size < 4 || end - cursor < size)
+        return false;
+    cursor += 4;
+    return true;
+}
+
+namespace
+{
+
+// Make room for a record and write its header.
+char *AppendRecord(std::vector<char> &out, GDS::Byte type, GDS::Byte dt, size_t data_size)
+{
+    size_t offset = out.size();
+    out.resize(offset + 4 + data_size);
+    char *p = &out[offset];
+    p[0] = (char)((data_size + 4) >> 8);
+    p[1] = (char)((data_size + 4) & 0xff);
+    p[2] = (char)type;
+    p[3] = (char)dt;
+    return p + 4;
+}
+
+}
+
+void GDS::PutRecord(std::vector<char> &out, Byte type)
+{
+    AppendRecord(out, type, NoData, 0);
+}
+
+void GDS::PutShortRecord(std::vector<char> &out, Byte type, Byte dt, const short *values, int count)
+{
+    char *p = AppendRecord(out, type, dt, 2 * count);
+    for (int i = 0; i < count; i++)
+        Encode(values[i], p + 2 * i);
+}
+
+void GDS::PutShortRecord(std::vector<char> &out, Byte type, Byte dt, short value)
+{
+    PutShortRecord(out, type, dt, &value, 1);
+}
+
+void GDS::PutIntRecord(std::vector<char> &out, Byte type, int value)
+{
+    Encode(value, AppendRecord(out, type, Integer_4, 4));
+}
+
+void GDS::PutDoubleRecord(std::vector<char> &out, Byte type, const double *values, int count)
+{
+    char *p = AppendRecord(out, type, Real_8, 8 * count);
+    for (int i = 0; i < count; i++)
+        Encode(values[i], p + 8 * i);
+}
+
+bool GDS::PutStringRecord(std::vector<char> &out, Byte type, const std::string &str)
+{
+    size_t size = str.size() + str.size() % 2;
+    if (size > 0xfffb)
+        return false;
+    char *p = AppendRecord(out, type, String, size);
+    memcpy(p, str.data(), str.size());
+    if (size != str.size())
+        p[size - 1] = '\0';
+    return true;
+}
+
+bool GDS::PutXYRecord(std::vector<char> &out, const Point *pts, size_t count)
+{
+    if (8 * count > 0xfffb)
+        return false;
+    char *p = AppendRecord(out, XY, Integer_4, 8 * count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Encode(pts[i].X, p + 8 * i);
+        Encode(pts[i].Y, p + 8 * i + 4);
+    }
+    return true;
+}
+
 std::string GDS::byteToString(char data)
 {
     std::stringstream ss;
@@ -336,209 +442,884 @@ std::string GDS::byteToString(char data)
     return ss.str();
 }
 
-int InsertGDSData2DB(sqlite3 *db,
-                     const std::string &table,
-                     const std::string &ID,
-                     char *data, int nSize,
-                     std::string &err)
+namespace
 {
-    int rc;
-    sqlite3_stmt *stmt;
-    char sql[100];
-    sprintf(sql, "INSERT INTO %s VALUES(?,?)", table.c_str());
-    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
-    if (rc != SQLITE_OK)
-    {
-        goto ERROR;
-    }
 
-    sqlite3_reset(stmt);
-    rc = sqlite3_bind_text(stmt, 1, ID.c_str(), -1, SQLITE_STATIC);
-    if (rc != SQLITE_OK)
-    {
-        goto ERROR;
-    }
-    rc = sqlite3_bind_blob(stmt, 2, data, nSize, SQLITE_TRANSIENT);
-    if (rc != SQLITE_OK)
-    {
-        goto ERROR;
-    }
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE)
-    {
-        goto ERROR;
-    }
+const unsigned char COMPACT_RAW = 0x7f;     //< Tag of raw bytes.
+const unsigned char COMPACT_REPEAT = 0x80;  //< Flag of a record repeating the previous one of its type.
+const GDS::Byte NO_DATA_TYPE = 0xff;
 
-    sqlite3_finalize(stmt);
-    return 0;
+// Data type of each record type, NO_DATA_TYPE for the unknown ones.
+const GDS::Byte RECORD_DATA_TYPE[0x3c] = {
+    0x02, 0x02, 0x06, 0x05, 0x00, 0x02, 0x06, 0x00,     // HEADER .. ENDSTR
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x02, 0x03,     // BOUNDARY .. WIDTH
+    0x03, 0x00, 0x06, 0x02, 0x00, 0x00, 0x02, 0x01,     // XY .. PRESENTATION
+    0xff, 0x06, 0x01, 0x05, 0x05, 0xff, 0xff, 0x06,     // SPACING .. REFLIBS
+    0x06, 0x02, 0x02, 0x06, 0x06, 0x02, 0x01, 0x03,     // FONTS .. ELKEY
+    0xff, 0xff, 0x02, 0x02, 0x06, 0x00, 0x02, 0x03,     // LINKTYPE .. PLEX
+    0x03, 0x03, 0x02, 0x02, 0x01, 0x03, 0x02, 0x06,     // BGNEXTN .. MASK
+    0x00, 0x02, 0x06, 0x02,                             // ENDMASKS .. LIBSECUR
+};
 
-ERROR:
-    char buffer[100];
-    sprintf(buffer, "SQL error: failed to insert data of %s into %s.\n", ID.c_str(), table.c_str());
-    err = buffer;
-    sqlite3_finalize(stmt);
-    return 1;
+GDS::Byte RecordDataType(GDS::Byte type)
+{
+    return type < sizeof(RECORD_DATA_TYPE) ? RECORD_DATA_TYPE[type] : NO_DATA_TYPE;
 }
 
-int GDS::ConvertGDSII2DB(std::string gdsName, std::string dbName, std::string &err)
+void PutVarint(std::vector<char> &out, unsigned int value)
 {
-    sqlite3 *db;
-    int rc;
-    char *zErrMsg = 0;
-
-    rc = sqlite3_open(dbName.c_str(), &db);
-    if (rc)
+    while (value >= 0x80)
     {
-        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
-        sqlite3_close(db);
-        return DB_ERROR;
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
     }
+    out.push_back((char)value);
+}
 
-    rc = sqlite3_exec(db, CREATE_DB_BASIC_INFO.c_str(), 0, 0, &zErrMsg);
-    if (rc != SQLITE_OK)
-    {
-        err = "SQL error: " + std::string(zErrMsg) + "\n";
-        sqlite3_free(zErrMsg);
-        sqlite3_close(db);
-        return DB_ERROR;
-    }
+void PutSigned(std::vector<char> &out, int value)
+{
+    PutVarint(out, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
 
-    std::ifstream infile;
-    infile.open(gdsName, std::ios::binary);
-    if (!infile.is_open())
+bool GetVarint(const char *&cursor, const char *end, unsigned int &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
     {
-        err = "GDSII file error: failed to open the GDSII file.\n";
-        sqlite3_close(db);
-        return FILE_ERROR;
+        if (cursor >= end)
+            return false;
+        unsigned char c = (unsigned char)*cursor++;
+        value |= (unsigned int)(c & 0x7f) << shift;
+        if ((c & 0x80) == 0)
+            return true;
     }
+    return false;
+}
 
-    short record_size;
-    char record_type, record_dt;
+bool GetSigned(const char *&cursor, const char *end, int &value)
+{
+    unsigned int raw;
+    if (!GetVarint(cursor, end, raw))
+        return false;
+    value = (int)(raw >> 1) ^ -(int)(raw & 1);
+    return true;
+}
 
-    if (!readShort(infile, record_size) ||
-        !readByte(infile, record_type) ||
-        !readByte(infile, record_dt))
-    {
-        err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
-        sqlite3_close(db);
-        return FILE_ERROR;
-    }
-    if (record_type != HEADER)
-    {
-        err = "GDSII format error: unexpected tag where 'HEADER' is expected.\n";
-        sqlite3_close(db);
-        return FORMAT_ERROR;
-    }
-    if (record_size != 6)
-    {
-        err = "GDSII format error: incorrect record size of 'HEADER'.\n";
-        sqlite3_close(db);
-        return FORMAT_ERROR;
-    }
-   
-    char buffer_2b[2];
-    // VERSION
-    infile.read(buffer_2b, 2);
-    if (InsertGDSData2DB(db, INFO_TABLE, GDS_VERSION_ID, buffer_2b, 2, err))
-    {
-        sqlite3_close(db);
-        return DB_ERROR;
-    }
-    // TIME INFO OF LIB
-    if (!readShort(infile, record_size) ||
-        !readByte(infile, record_type) ||
-        !readByte(infile, record_dt))
-    {
-        err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
-        sqlite3_close(db);
-        return FILE_ERROR;
-    }
-    if (record_type != BGNLIB)
-    {
-        err = "GDSII format error: unexpected tag where 'BGNLIB' is expected.\n";
-        sqlite3_close(db);
-        return FORMAT_ERROR;
-    }
-    if (record_size != 28)
-    {
-        err = "GDSII format error: incorrect record size of 'BGNLIB'.\n";
-        sqlite3_close(db);
-        return FORMAT_ERROR;
-    }
-    char buffer_12b[12];
-    infile.read(buffer_12b, 12);
-    if (InsertGDSData2DB(db, INFO_TABLE, MOD_TIME_ID, buffer_12b, 12, err))
-    {
-        sqlite3_close(db);
-        return DB_ERROR;
-    }
-    infile.read(buffer_12b, 12);
-    if (InsertGDSData2DB(db, INFO_TABLE, ACC_TIME_ID, buffer_12b, 12, err))
-    {
-        sqlite3_close(db);
-        return DB_ERROR;
-    }
+void PutRaw(std::vector<char> &out, const char *data, size_t size)
+{
+    out.push_back((char)COMPACT_RAW);
+    PutVarint(out, (unsigned int)size);
+    out.insert(out.end(), data, data + size);
+}
 
-    std::map<std::string, std::pair<unsigned long long, unsigned long long> > cache_map;
-    while (true)
+}
+
+void GDS::EncodeCompactCell(const char *data, size_t size, std::vector<char> &out)
+{
+    out.clear();
+    out.reserve(size / 2);
+
+    const char *last_data[COMPACT_RAW] = { 0 };
+    int last_size[COMPACT_RAW] = { 0 };
+    int last_x = 0;
+    int last_y = 0;
+
+    const char *cursor = data;
+    const char *end = data + size;
+    while (cursor < end)
     {
-        if (!readShort(infile, record_size) ||
-            !readByte(infile, record_type) ||
-            !readByte(infile, record_dt))
+        const char *record = cursor;
+        int record_size;
+        Byte record_type, record_dt;
+        if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
         {
-            err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
-            sqlite3_close(db);
-            return FILE_ERROR;
+            PutRaw(out, record, end - record);
+            break;
         }
+        cursor = record + record_size;
+        const char *payload = record + 4;
+        int n = record_size - 4;
 
-        bool finished = false;
-        switch (record_type)
+        bool encodable = record_type < COMPACT_RAW && RecordDataType(record_type) == record_dt;
+        if (encodable)
         {
-        case ENDLIB:
-            finished = true;
-            break;
-        case LIBNAME:
+            switch (record_dt)
+            {
+            case NoData:
+                encodable = n == 0;
+                break;
+            case Integer_2:
+                encodable = n % 2 == 0;
+                break;
+            case Integer_4:
+                encodable = n % 4 == 0 && (record_type != XY || n % 8 == 0);
+                break;
+            default:
+                break;
+            }
+        }
+        if (!encodable)
         {
-            if (record_size < 4 || record_size % 2 != 0)
+            PutRaw(out, record, record_size);
+            continue;
+        }
+
+        if (record_type == XY && n >= 8)
+        {
+            // The delta state follows the record even when it is repeated.
+            int x, y;
+            Decode(payload + n - 8, x);
+            Decode(payload + n - 4, y);
+            if (n == last_size[record_type] && memcmp(payload, last_data[record_type], n) == 0)
             {
-                err = "GDSII format error: incorrect record size of 'LIBNAME'.\n";
-                sqlite3_close(db);
-                return FORMAT_ERROR;
+                out.push_back((char)(record_type | COMPACT_REPEAT));
             }
-            char *buffer_str = new char[record_size - 4];
-            infile.read(buffer_str, record_size - 4);
-            if (InsertGDSData2DB(db, INFO_TABLE, LIB_NAME_ID, buffer_str, record_size - 4, err))
+            else
             {
-                sqlite3_close(db);
-                delete[] buffer_str;
-                return DB_ERROR;
+                out.push_back((char)record_type);
+                PutVarint(out, n / 8);
+                int prev_x = last_x;
+                int prev_y = last_y;
+                for (int i = 0; i < n; i += 8)
+                {
+                    int px, py;
+                    Decode(payload + i, px);
+                    Decode(payload + i + 4, py);
+                    PutSigned(out, (int)((unsigned int)px - (unsigned int)prev_x));
+                    PutSigned(out, (int)((unsigned int)py - (unsigned int)prev_y));
+                    prev_x = px;
+                    prev_y = py;
+                }
             }
-            delete[] buffer_str;
-            break;
+            last_x = x;
+            last_y = y;
+            last_data[record_type] = payload;
+            last_size[record_type] = n;
+            continue;
         }
-        case UNITS:
+
+        if (n > 0 && n == last_size[record_type] && memcmp(payload, last_data[record_type], n) == 0)
         {
-            if (record_size != 20)
+            out.push_back((char)(record_type | COMPACT_REPEAT));
+            continue;
+        }
+        last_data[record_type] = payload;
+        last_size[record_type] = n;
+
+        out.push_back((char)record_type);
+        switch (record_dt)
+        {
+        case NoData:
+            break;
+        case Integer_2:
+            PutVarint(out, n / 2);
+            for (int i = 0; i < n; i += 2)
             {
-                err = "GDSII format error: incorrect record size of 'UNITS'.\n";
-                sqlite3_close(db);
-                return FORMAT_ERROR;
+                short value;
+                Decode(payload + i, value);
+                PutSigned(out, value);
             }
-            char buffer[16];
-            infile.read(buffer, 16);
-            if (InsertGDSData2DB(db, INFO_TABLE, UNITS_ID, buffer, 16, err))
+            break;
+        case Integer_4:
+            PutVarint(out, n / 4);
+            for (int i = 0; i < n; i += 4)
             {
-                sqlite3_close(db);
-                return DB_ERROR;
+                int value;
+                Decode(payload + i, value);
+                PutSigned(out, value);
             }
             break;
+        default:
+            PutVarint(out, n);
+            out.insert(out.end(), payload, payload + n);
+            break;
         }
-        case BGNSTR:
+    }
+}
+
+bool GDS::DecodeCompactCell(const char *data, size_t size, std::vector<char> &out)
+{
+    GDS_STATS_TIMER(STAT_TIME_DECODE_COMPACT);
+    out.clear();
+    out.reserve(size * 2);
+
+    size_t last_offset[COMPACT_RAW] = { 0 };
+    int last_size[COMPACT_RAW] = { 0 };
+    int last_x = 0;
+    int last_y = 0;
+
+    const char *cursor = data;
+    const char *end = data + size;
+    while (cursor < end)
+    {
+        unsigned char tag = (unsigned char)*cursor++;
+        if (tag == COMPACT_RAW)
         {
-            infile.seekg(-4, std::ios_base::cur);
-            unsigned long long start_pos = infile.tellg();
-            unsigned long long end_pos = start_pos;
-            std::string name;
+            unsigned int n;
+            if (!GetVarint(cursor, end, n) || (size_t)(end - cursor) < n)
+                return false;
+            out.insert(out.end(), cursor, cursor + n);
+            cursor += n;
+            continue;
+        }
+
+        Byte record_type = tag & ~COMPACT_REPEAT;
+        Byte record_dt = RecordDataType(record_type);
+        if (record_dt == NO_DATA_TYPE)
+            return false;
+
+        size_t header = out.size();
+        out.resize(header + 4);
+        out[header + 2] = (char)record_type;
+        out[header + 3] = (char)record_dt;
+
+        if (tag & COMPACT_REPEAT)
+        {
+            if (last_size[record_type] == 0)
+                return false;
+            // Copy through an index, the insertion may move the buffer.
+            size_t from = last_offset[record_type];
+            int n = last_size[record_type];
+            out.resize(header + 4 + n);
+            memmove(&out[header + 4], &out[from], n);
+        }
+        else
+        {
+            unsigned int count;
+            switch (record_dt)
+            {
+            case NoData:
+                break;
+            case Integer_2:
+                if (!GetVarint(cursor, end, count) || count > 0x7ffd)
+                    return false;
+                for (unsigned int i = 0; i < count; i++)
+                {
+                    int value;
+                    if (!GetSigned(cursor, end, value))
+                        return false;
+                    char buffer[2];
+                    Encode((short)value, buffer);
+                    out.insert(out.end(), buffer, buffer + 2);
+                }
+                break;
+            case Integer_4:
+                if (!GetVarint(cursor, end, count) || count > 0x3ffe)
+                    return false;
+                if (record_type == XY)
+                {
+                    if (count > 0x1fff)
+                        return false;
+                    int x = last_x;
+                    int y = last_y;
+                    for (unsigned int i = 0; i < count; i++)
+                    {
+                        int dx, dy;
+                        if (!GetSigned(cursor, end, dx) || !GetSigned(cursor, end, dy))
+                            return false;
+                        x = (int)((unsigned int)x + (unsigned int)dx);
+                        y = (int)((unsigned int)y + (unsigned int)dy);
+                        char buffer[8];
+                        Encode(x, buffer);
+                        Encode(y, buffer + 4);
+                        out.insert(out.end(), buffer, buffer + 8);
+                    }
+                }
+                else
+                {
+                    for (unsigned int i = 0; i < count; i++)
+                    {
+                        int value;
+                        if (!GetSigned(cursor, end, value))
+                            return false;
+                        char buffer[4];
+                        Encode(value, buffer);
+                        out.insert(out.end(), buffer, buffer + 4);
+                    }
+                }
+                break;
+            default:
+                if (!GetVarint(cursor, end, count) || count > 0xfffb || (size_t)(end - cursor) < count)
+                    return false;
+                out.insert(out.end(), cursor, cursor + count);
+                cursor += count;
+                break;
+            }
+        }
+
+        int n = (int)(out.size() - header - 4);
+        if (n > 0xfffb)
+            return false;
+        out[header] = (char)((n + 4) >> 8);
+        out[header + 1] = (char)((n + 4) & 0xff);
+        if (n > 0)
+        {
+            last_offset[record_type] = header + 4;
+            last_size[record_type] = n;
+        }
+        if (record_type == XY && n >= 8)
+        {
+            Decode(&out[header + 4 + n - 8], last_x);
+            Decode(&out[header + 4 + n - 4], last_y);
+        }
+    }
+    return true;
+}
+
+namespace
+{
+
+// Record types whose data the metadata scan looks at. The data of the
+// other records, the XY points above all, is skipped by its length.
+bool IsScannedRecord(GDS::Byte type)
+{
+    switch (type)
+    {
+    case GDS::STRNAME:
+    case GDS::LAYER:
+    case GDS::DATATYPE:
+    case GDS::TEXTTYPE:
+    case GDS::NODETYPE:
+    case GDS::BOXTYPE:
+    case GDS::SNAME:
+    case GDS::COLROW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Call visit(type, data, size) for each record of a cell. data is the
+ * record data in GDSII encoding for the scanned records, and null for
+ * the others.
+ */
+template <typename Visit>
+bool ScanGDSIIRecords(const char *data, size_t size, Visit &visit)
+{
+    const char *cursor = data;
+    const char *end = data + size;
+    while (cursor < end)
+    {
+        int record_size;
+        GDS::Byte record_type, record_dt;
+        if (!GDS::ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
+            return false;
+        if (IsScannedRecord(record_type))
+            visit(record_type, cursor, record_size - 4);
+        else
+            visit(record_type, (const char *)nullptr, 0);
+        cursor += record_size - 4;
+    }
+    return true;
+}
+
+template <typename Visit>
+bool ScanCompactRecords(const char *data, size_t size, Visit &visit)
+{
+    // The last data of each scanned record type, for the repeated records.
+    std::string last[COMPACT_RAW];
+    std::string record;
+
+    const char *cursor = data;
+    const char *end = data + size;
+    while (cursor < end)
+    {
+        unsigned char tag = (unsigned char)*cursor++;
+        unsigned int count;
+        if (tag == COMPACT_RAW)
+        {
+            // Raw bytes hold whole records.
+            if (!GetVarint(cursor, end, count) || (size_t)(end - cursor) < count)
+                return false;
+            if (!ScanGDSIIRecords(cursor, count, visit))
+                return false;
+            cursor += count;
+            continue;
+        }
+
+        GDS::Byte record_type = tag & ~COMPACT_REPEAT;
+        GDS::Byte record_dt = RecordDataType(record_type);
+        if (record_dt == NO_DATA_TYPE)
+            return false;
+        bool scanned = IsScannedRecord(record_type);
+        if (tag & COMPACT_REPEAT)
+        {
+            if (scanned)
+                visit(record_type, last[record_type].data(), (int)last[record_type].size());
+            else
+                visit(record_type, (const char *)nullptr, 0);
+            continue;
+        }
+
+        record.clear();
+        switch (record_dt)
+        {
+        case GDS::NoData:
+            break;
+        case GDS::Integer_2:
+        case GDS::Integer_4:
+            if (!GetVarint(cursor, end, count))
+                return false;
+            if (record_type == GDS::XY)
+                count *= 2;
+            for (unsigned int i = 0; i < count; i++)
+            {
+                if (!scanned)
+                {
+                    // Skip a varint.
+                    while (cursor < end && (*cursor & 0x80))
+                        cursor++;
+                    if (cursor++ >= end)
+                        return false;
+                    continue;
+                }
+                int value;
+                if (!GetSigned(cursor, end, value))
+                    return false;
+                char buffer[4];
+                if (record_dt == GDS::Integer_2)
+                {
+                    GDS::Encode((short)value, buffer);
+                    record.append(buffer, 2);
+                }
+                else
+                {
+                    GDS::Encode(value, buffer);
+                    record.append(buffer, 4);
+                }
+            }
+            break;
+        default:
+            if (!GetVarint(cursor, end, count) || (size_t)(end - cursor) < count)
+                return false;
+            if (scanned)
+                record.assign(cursor, count);
+            cursor += count;
+            break;
+        }
+
+        if (!scanned)
+        {
+            visit(record_type, (const char *)nullptr, 0);
+            continue;
+        }
+        if (!record.empty())
+            last[record_type] = record;
+        visit(record_type, record.data(), (int)record.size());
+    }
+    return true;
+}
+
+template <typename Visit>
+bool ScanRecords(const char *data, size_t size, short format, Visit &visit)
+{
+    if (format == GDS::CELL_FORMAT_COMPACT)
+        return ScanCompactRecords(data, size, visit);
+    return ScanGDSIIRecords(data, size, visit);
+}
+
+// A GDSII string without the padding nulls, like readString.
+void AssignString(std::string &str, const char *data, int size)
+{
+    str.clear();
+    for (int i = 0; i < size; i++)
+    {
+        if (data[i] != '\0')
+            str.push_back(data[i]);
+    }
+}
+
+}
+
+bool GDS::ScanCellReferences(const char *data, size_t size, short format, std::vector<std::string> &names)
+{
+    names.clear();
+    std::string name;
+    auto visit = [&](Byte type, const char *record, int n)
+    {
+        if (type != SNAME)
+            return;
+        AssignString(name, record, n);
+        if (names.empty() || names.back() != name)
+            names.push_back(name);
+    };
+    return ScanRecords(data, size, format, visit);
+}
+
+GDS::CellSummary::CellSummary()
+{
+    Boundaries = 0;
+    Paths = 0;
+    SRefs = 0;
+    ARefs = 0;
+    Others = 0;
+}
+
+bool GDS::ScanCellSummary(const char *data, size_t size, short format, CellSummary &summary)
+{
+    summary = CellSummary();
+    Byte element = 0;
+    bool has_layer = false;
+    short layer = 0;
+    short data_type = 0;
+    std::string sname;
+    auto visit = [&](Byte type, const char *record, int n)
+    {
+        switch (type)
+        {
+        case BOUNDARY:
+        case PATH:
+        case SREF:
+        case AREF:
+        case TEXT:
+        case NODE:
+        case BOX:
+            element = type;
+            has_layer = false;
+            layer = 0;
+            data_type = 0;
+            break;
+        case STRNAME:
+            AssignString(summary.Name, record, n);
+            break;
+        case LAYER:
+            if (n >= 2)
+            {
+                Decode(record, layer);
+                has_layer = true;
+            }
+            break;
+        case DATATYPE:
+        case TEXTTYPE:
+        case NODETYPE:
+        case BOXTYPE:
+            if (n >= 2)
+                Decode(record, data_type);
+            break;
+        case SNAME:
+            AssignString(sname, record, n);
+            break;
+        case ENDEL:
+            switch (element)
+            {
+            case BOUNDARY:
+                summary.Boundaries++;
+                break;
+            case PATH:
+                summary.Paths++;
+                break;
+            case SREF:
+                summary.SRefs++;
+                summary.References[sname]++;
+                break;
+            case AREF:
+                summary.ARefs++;
+                summary.References[sname]++;
+                break;
+            case 0:
+                return;
+            default:
+                summary.Others++;
+                break;
+            }
+            if (has_layer)
+                summary.Layers[std::make_pair(layer, data_type)]++;
+            element = 0;
+            break;
+        default:
+            break;
+        }
+    };
+    return ScanRecords(data, size, format, visit);
+}
+
+GDS::StorageProfile::StorageProfile()
+{
+    PageSize = 0;
+    JournalMode = nullptr;
+    Synchronous = nullptr;
+    CacheSize = 0;
+    MmapSize = 0;
+    TempStore = nullptr;
+}
+
+GDS::StorageProfile GDS::StorageProfile::Default()
+{
+    return StorageProfile();
+}
+
+GDS::StorageProfile GDS::StorageProfile::BulkLoad()
+{
+    StorageProfile profile;
+    profile.PageSize = 65536;
+    profile.JournalMode = "OFF";
+    profile.Synchronous = "OFF";
+    profile.CacheSize = -262144;
+    profile.TempStore = "MEMORY";
+    return profile;
+}
+
+GDS::StorageProfile GDS::StorageProfile::ReadMostly()
+{
+    StorageProfile profile;
+    profile.JournalMode = "WAL";
+    profile.Synchronous = "NORMAL";
+    profile.CacheSize = -65536;
+    profile.MmapSize = 1LL << 30;
+    profile.TempStore = "MEMORY";
+    return profile;
+}
+
+int GDS::ApplyStorageProfile(sqlite3 *db, const StorageProfile &profile, std::string &err)
+{
+    std::stringstream ss;
+    if (profile.PageSize > 0)
+        ss << "PRAGMA page_size=" << profile.PageSize << ";";
+    if (profile.JournalMode != nullptr)
+        ss << "PRAGMA journal_mode=" << profile.JournalMode << ";";
+    if (profile.Synchronous != nullptr)
+        ss << "PRAGMA synchronous=" << profile.Synchronous << ";";
+    if (profile.CacheSize != 0)
+        ss << "PRAGMA cache_size=" << profile.CacheSize << ";";
+    if (profile.MmapSize > 0)
+        ss << "PRAGMA mmap_size=" << profile.MmapSize << ";";
+    if (profile.TempStore != nullptr)
+        ss << "PRAGMA temp_store=" << profile.TempStore << ";";
+    if (ss.str().empty())
+        return 0;
+
+    char *zErrMsg = 0;
+    int rc = sqlite3_exec(db, ss.str().c_str(), 0, 0, &zErrMsg);
+    if (rc != SQLITE_OK)
+    {
+        err = "SQL error: " + std::string(zErrMsg) + "\n";
+        sqlite3_free(zErrMsg);
+        return DB_ERROR;
+    }
+    return 0;
+}
+
+int InsertGDSData2DB(sqlite3 *db,
+                     const std::string &table,
+                     const std::string &ID,
+                     char *data, int nSize,
+                     std::string &err)
+{
+    int rc;
+    sqlite3_stmt *stmt;
+    char sql[100];
+    sprintf(sql, "INSERT INTO %s VALUES(?,?)", table.c_str());
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    if (rc != SQLITE_OK)
+    {
+        goto ERROR;
+    }
+
+    sqlite3_reset(stmt);
+    rc = sqlite3_bind_text(stmt, 1, ID.c_str(), -1, SQLITE_STATIC);
+    if (rc != SQLITE_OK)
+    {
+        goto ERROR;
+    }
+    rc = sqlite3_bind_blob(stmt, 2, data, nSize, SQLITE_TRANSIENT);
+    if (rc != SQLITE_OK)
+    {
+        goto ERROR;
+    }
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE)
+    {
+        goto ERROR;
+    }
+
+    sqlite3_finalize(stmt);
+    return 0;
+
+ERROR:
+    char buffer[100];
+    sprintf(buffer, "SQL error: failed to insert data of %s into %s.\n", ID.c_str(), table.c_str());
+    err = buffer;
+    sqlite3_finalize(stmt);
+    return 1;
+}
+
+int GDS::ConvertGDSII2DB(std::string gdsName, std::string dbName, std::string &err,
+                         CELL_FORMAT format, const StorageProfile &profile)
+{
+    GDS_STATS_TIMER(STAT_TIME_CONVERT);
+    sqlite3 *db;
+    int rc;
+    char *zErrMsg = 0;
+
+    rc = sqlite3_open(dbName.c_str(), &db);
+    if (rc)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    // The page size only takes effect before the tables are created.
+    if (ApplyStorageProfile(db, profile, err))
+    {
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    rc = sqlite3_exec(db, CREATE_DB_BASIC_INFO.c_str(), 0, 0, &zErrMsg);
+    if (rc != SQLITE_OK)
+    {
+        err = "SQL error: " + std::string(zErrMsg) + "\n";
+        sqlite3_free(zErrMsg);
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    std::ifstream infile;
+    infile.open(gdsName, std::ios::binary);
+    if (!infile.is_open())
+    {
+        err = "GDSII file error: failed to open the GDSII file.\n";
+        sqlite3_close(db);
+        return FILE_ERROR;
+    }
+
+    short record_size;
+    char record_type, record_dt;
+
+    if (!readShort(infile, record_size) ||
+        !readByte(infile, record_type) ||
+        !readByte(infile, record_dt))
+    {
+        err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
+        sqlite3_close(db);
+        return FILE_ERROR;
+    }
+    if (record_type != HEADER)
+    {
+        err = "GDSII format error: unexpected tag where 'HEADER' is expected.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+    if (record_size != 6)
+    {
+        err = "GDSII format error: incorrect record size of 'HEADER'.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+   
+    char buffer_2b[2];
+    // VERSION
+    infile.read(buffer_2b, 2);
+    if (InsertGDSData2DB(db, INFO_TABLE, GDS_VERSION_ID, buffer_2b, 2, err))
+    {
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    // TIME INFO OF LIB
+    if (!readShort(infile, record_size) ||
+        !readByte(infile, record_type) ||
+        !readByte(infile, record_dt))
+    {
+        err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
+        sqlite3_close(db);
+        return FILE_ERROR;
+    }
+    if (record_type != BGNLIB)
+    {
+        err = "GDSII format error: unexpected tag where 'BGNLIB' is expected.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+    if (record_size != 28)
+    {
+        err = "GDSII format error: incorrect record size of 'BGNLIB'.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+    char buffer_12b[12];
+    infile.read(buffer_12b, 12);
+    if (InsertGDSData2DB(db, INFO_TABLE, MOD_TIME_ID, buffer_12b, 12, err))
+    {
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    infile.read(buffer_12b, 12);
+    if (InsertGDSData2DB(db, INFO_TABLE, ACC_TIME_ID, buffer_12b, 12, err))
+    {
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    char buffer_format[2];
+    Encode((short)format, buffer_format);
+    if (InsertGDSData2DB(db, INFO_TABLE, CELL_FORMAT_ID, buffer_format, 2, err))
+    {
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    std::map<std::string, std::pair<unsigned long long, unsigned long long> > cache_map;
+    while (true)
+    {
+        if (!readShort(infile, record_size) ||
+            !readByte(infile, record_type) ||
+            !readByte(infile, record_dt))
+        {
+            err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
+            sqlite3_close(db);
+            return FILE_ERROR;
+        }
+
+        bool finished = false;
+        switch (record_type)
+        {
+        case ENDLIB:
+            finished = true;
+            break;
+        case LIBNAME:
+        {
+            if (record_size < 4 || record_size % 2 != 0)
+            {
+                err = "GDSII format error: incorrect record size of 'LIBNAME'.\n";
+                sqlite3_close(db);
+                return FORMAT_ERROR;
+            }
+            char *buffer_str = new char[record_size - 4];
+            infile.read(buffer_str, record_size - 4);
+            if (InsertGDSData2DB(db, INFO_TABLE, LIB_NAME_ID, buffer_str, record_size - 4, err))
+            {
+                sqlite3_close(db);
+                delete[] buffer_str;
+                return DB_ERROR;
+            }
+            delete[] buffer_str;
+            break;
+        }
+        case UNITS:
+        {
+            if (record_size != 20)
+            {
+                err = "GDSII format error: incorrect record size of 'UNITS'.\n";
+                sqlite3_close(db);
+                return FORMAT_ERROR;
+            }
+            char buffer[16];
+            infile.read(buffer, 16);
+            if (InsertGDSData2DB(db, INFO_TABLE, UNITS_ID, buffer, 16, err))
+            {
+                sqlite3_close(db);
+                return DB_ERROR;
+            }
+            break;
+        }
+        case BGNSTR:
+        {
+            infile.seekg(-4, std::ios_base::cur);
+            unsigned long long start_pos = infile.tellg();
+            unsigned long long end_pos = start_pos;
+            std::string name;
             while (1)
             {
                 if (!readShort(infile, record_size) ||
@@ -552,86 +1333,665 @@ int GDS::ConvertGDSII2DB(std::string gdsName, std::string dbName, std::string &e
                 if (record_type == STRNAME)
                 {
 
-                    if (!readString(infile, record_size - 4, name))
-                    {
-                        err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
-                        sqlite3_close(db);
-                        return FILE_ERROR;
-                    }
-                }
-                else if (record_type == ENDSTR)
-                {
-                    end_pos = infile.tellg();
-                    break;
-                }
-                else
+                    if (!readString(infile, record_size - 4, name))
+                    {
+                        err = "GDSII file error: failed to read excepted data from the GDSII file.\n";
+                        sqlite3_close(db);
+                        return FILE_ERROR;
+                    }
+                }
+                else if (record_type == ENDSTR)
+                {
+                    end_pos = infile.tellg();
+                    break;
+                }
+                else
+                {
+                    infile.seekg((unsigned short)record_size - 4, std::ios_base::cur);
+                }
+            }
+            assert(start_pos != end_pos);
+            cache_map[name] = std::make_pair(start_pos, end_pos);
+
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (finished)
+            break;
+    }
+
+    // Write cell data into database;
+    sqlite3_exec(db, "begin;", 0, 0, 0);
+    sqlite3_stmt *stmt;
+    const char *sql = "INSERT INTO cell_table VALUES(?,?)";
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        err = "SQL error: failed to add cell data into cell_table.\n";
+        return DB_ERROR;
+    }
+    std::vector<char> compact;
+    std::vector<CellSummary> summaries;
+    summaries.reserve(cache_map.size());
+    std::vector<unsigned long long> hashes;
+    hashes.reserve(cache_map.size());
+    for (auto &e : cache_map)
+    {
+        sqlite3_reset(stmt);
+        rc = sqlite3_bind_text(stmt, 1, e.first.c_str(), -1, SQLITE_STATIC);
+        if (rc != SQLITE_OK)
+        {
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            err = "SQL error: failed to add cell data into cell_table.\n";
+            return DB_ERROR;
+        }
+        infile.seekg(e.second.first, std::ios_base::beg);
+        char *buffer = new char[e.second.second - e.second.first];
+        infile.read(buffer, e.second.second - e.second.first);
+        summaries.push_back(CellSummary());
+        ScanCellSummary(buffer, e.second.second - e.second.first, CELL_FORMAT_GDSII, summaries.back());
+        summaries.back().Name = e.first;
+        hashes.push_back(HashCellRecords(buffer, e.second.second - e.second.first));
+        if (format == CELL_FORMAT_COMPACT)
+        {
+            EncodeCompactCell(buffer, e.second.second - e.second.first, compact);
+            rc = sqlite3_bind_blob64(stmt, 2, compact.data(), compact.size(), SQLITE_TRANSIENT);
+            GDS_STATS_ADD(STAT_BLOB_BYTES_WRITTEN, compact.size());
+        }
+        else
+        {
+            rc = sqlite3_bind_blob64(stmt, 2, buffer, e.second.second - e.second.first, SQLITE_TRANSIENT);
+            GDS_STATS_ADD(STAT_BLOB_BYTES_WRITTEN, e.second.second - e.second.first);
+        }
+        if (rc != SQLITE_OK)
+        {
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            err = "SQL error: failed to add cell data into cell_table.\n";
+            return DB_ERROR;
+        }
+        {
+            GDS_STATS_TIMER(STAT_TIME_DB_INSERT);
+            rc = sqlite3_step(stmt);
+        }
+        if (rc != SQLITE_DONE)
+        {
+            sqlite3_finalize(stmt);
+            delete[] buffer;
+            sqlite3_close(db);
+            err = "SQL error: failed to add cell data into cell_table.\n";
+            return DB_ERROR;
+        }
+        GDS_STATS_ADD(STAT_DB_ROWS_INSERTED, 1);
+        delete[]buffer;
+    }
+    sqlite3_finalize(stmt);
+
+    // Keep the offsets, so the GDSII file can be loaded without indexing it again.
+    sql = "INSERT INTO cell_offset_table VALUES(?,?,?)";
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    for (auto iter = cache_map.begin(); rc == SQLITE_OK && iter != cache_map.end(); ++iter)
+    {
+        sqlite3_reset(stmt);
+        rc = sqlite3_bind_text(stmt, 1, iter->first.c_str(), -1, SQLITE_STATIC);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 2, (sqlite3_int64)iter->second.first);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 3, (sqlite3_int64)iter->second.second);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        err = "SQL error: failed to add cell offsets into cell_offset_table.\n";
+        return DB_ERROR;
+    }
+    // Keep the summaries, so the metadata can be queried without the cell data.
+    sqlite3_stmt *layer_stmt = 0;
+    sqlite3_stmt *reference_stmt = 0;
+    sql = "INSERT INTO cell_summary_table VALUES(?,?,?,?,?,?)";
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+    {
+        sql = "INSERT INTO cell_layer_table VALUES(?,?,?,?)";
+        rc = sqlite3_prepare_v2(db, sql, strlen(sql), &layer_stmt, 0);
+    }
+    if (rc == SQLITE_OK)
+    {
+        sql = "INSERT INTO cell_reference_table VALUES(?,?,?)";
+        rc = sqlite3_prepare_v2(db, sql, strlen(sql), &reference_stmt, 0);
+    }
+    for (size_t i = 0; rc == SQLITE_OK && i < summaries.size(); i++)
+    {
+        const CellSummary &summary = summaries[i];
+        sqlite3_reset(stmt);
+        rc = sqlite3_bind_text(stmt, 1, summary.Name.c_str(), -1, SQLITE_STATIC);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 2, summary.Boundaries);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 3, summary.Paths);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 4, summary.SRefs);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 5, summary.ARefs);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 6, summary.Others);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+        for (auto iter = summary.Layers.begin(); rc == SQLITE_OK && iter != summary.Layers.end(); ++iter)
+        {
+            sqlite3_reset(layer_stmt);
+            rc = sqlite3_bind_text(layer_stmt, 1, summary.Name.c_str(), -1, SQLITE_STATIC);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_int(layer_stmt, 2, iter->first.first);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_int(layer_stmt, 3, iter->first.second);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_int64(layer_stmt, 4, iter->second);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_step(layer_stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+        }
+        for (auto iter = summary.References.begin(); rc == SQLITE_OK && iter != summary.References.end(); ++iter)
+        {
+            sqlite3_reset(reference_stmt);
+            rc = sqlite3_bind_text(reference_stmt, 1, summary.Name.c_str(), -1, SQLITE_STATIC);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_text(reference_stmt, 2, iter->first.c_str(), -1, SQLITE_STATIC);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_bind_int64(reference_stmt, 3, iter->second);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_step(reference_stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(layer_stmt);
+    sqlite3_finalize(reference_stmt);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        err = "SQL error: failed to add cell summaries into cell_summary_table.\n";
+        return DB_ERROR;
+    }
+    // Keep the hashes, so two databases can be compared cell by cell without the cell data.
+    sql = "INSERT INTO cell_hash_table VALUES(?,?)";
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    for (size_t i = 0; rc == SQLITE_OK && i < summaries.size(); i++)
+    {
+        sqlite3_reset(stmt);
+        rc = sqlite3_bind_text(stmt, 1, summaries[i].Name.c_str(), -1, SQLITE_STATIC);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int64(stmt, 2, (sqlite3_int64)hashes[i]);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        err = "SQL error: failed to add cell hashes into cell_hash_table.\n";
+        return DB_ERROR;
+    }
+    // Cells are looked up by name when a subtree is opened.
+    rc = sqlite3_exec(db, "CREATE INDEX cell_name_index ON cell_table (ID);", 0, 0, 0);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        err = "SQL error: failed to index cell_table.\n";
+        return DB_ERROR;
+    }
+    sqlite3_exec(db, "commit;", 0, 0, 0);
+
+    sqlite3_close(db);
+
+    return 0;
+}
+
+unsigned long long GDS::HashCellRecords(const char *data, size_t size)
+{
+    const char *cursor = data;
+    int record_size;
+    Byte record_type, record_dt;
+    if (ReadRecordHeader(cursor, data + size, record_size, record_type, record_dt) && record_type == BGNSTR)
+    {
+        data += record_size;
+        size -= record_size;
+    }
+
+    // Words of 8 bytes are mixed in one by one; the tail is padded.
+    auto mix = [](unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    };
+    unsigned long long h = mix(size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, data + i, 8);
+        h = mix(h ^ (word + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+    unsigned long long tail = 0;
+    for (; i < size; i++)
+        tail = (tail << 8) | (unsigned char)data[i];
+    return mix(h ^ (tail + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+}
+
+int GDS::IndexGDSII(const char *data, size_t size, std::vector<CellOffset> &index, std::string &err)
+{
+    const char *cursor = data;
+    const char *end = data + size;
+    int record_size;
+    Byte record_type, record_dt;
+    CellOffset cell;
+    bool in_cell = false;
+
+    index.clear();
+    while (true)
+    {
+        const char *record = cursor;
+        if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
+        {
+            err = "GDSII format error: unexpected end of the GDSII data.\n";
+            return FORMAT_ERROR;
+        }
+        switch (record_type)
+        {
+        case BGNSTR:
+            if (in_cell)
+            {
+                err = "GDSII format error: unexpected tag where 'ENDSTR' is expected.\n";
+                return FORMAT_ERROR;
+            }
+            in_cell = true;
+            cell.Name.clear();
+            cell.Start = record - data;
+            break;
+        case STRNAME:
+            if (in_cell)
+            {
+                // Nulls are dropped like readString does.
+                for (int i = 0; i < record_size - 4; i++)
                 {
-                    infile.seekg(record_size - 4, std::ios_base::cur);
+                    if (cursor[i] != '\0')
+                        cell.Name.push_back(cursor[i]);
                 }
             }
-            assert(start_pos != end_pos);
-            cache_map[name] = std::make_pair(start_pos, end_pos);
-
             break;
-        }
+        case ENDSTR:
+            if (!in_cell)
+            {
+                err = "GDSII format error: unexpected tag 'ENDSTR'.\n";
+                return FORMAT_ERROR;
+            }
+            in_cell = false;
+            cell.End = cursor - data;
+            index.push_back(cell);
+            break;
+        case ENDLIB:
+            return 0;
         default:
             break;
         }
+        cursor = record + record_size;
+    }
+}
 
-        if (finished)
-            break;
+int GDS::ReadCellOffsets(std::string dbName, std::vector<CellOffset> &index, std::string &err)
+{
+    sqlite3 *db;
+    if (sqlite3_open_v2(dbName.c_str(), &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
     }
 
-    // Write cell data into database;
-    sqlite3_exec(db, "begin;", 0, 0, 0);
+    index.clear();
     sqlite3_stmt *stmt;
-    const char *sql = "INSERT INTO cell_table VALUES(?,?)";
-    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
-    if (rc != SQLITE_OK)
+    const char *sql = "SELECT ID, START, END FROM cell_offset_table ORDER BY START;";
+    int rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt);
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
     {
-        sqlite3_finalize(stmt);
+        CellOffset cell;
+        cell.Name.assign((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0));
+        cell.Start = (unsigned long long)sqlite3_column_int64(stmt, 1);
+        cell.End = (unsigned long long)sqlite3_column_int64(stmt, 2);
+        index.push_back(cell);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    if (rc != SQLITE_DONE)
+    {
+        err = "SQL error: failed to read cell offsets from cell_offset_table.\n";
+        return DB_ERROR;
+    }
+
+    return 0;
+}
+
+int GDS::ReadCellSummaries(std::string dbName, std::vector<CellSummary> &summaries, std::string &err)
+{
+    sqlite3 *db;
+    if (sqlite3_open_v2(dbName.c_str(), &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
         sqlite3_close(db);
-        err = "SQL error: failed to add cell data into cell_table.\n";
         return DB_ERROR;
     }
-    for (auto &e : cache_map)
+
+    summaries.clear();
+    std::map<std::string, size_t> position;
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT ID, BOUNDARIES, PATHS, SREFS, AREFS, OTHERS FROM cell_summary_table;";
+    int rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
     {
-        sqlite3_reset(stmt);
-        rc = sqlite3_bind_text(stmt, 1, e.first.c_str(), -1, SQLITE_STATIC);
-        if (rc != SQLITE_OK)
+        rc = sqlite3_step(stmt);
+        for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+        {
+            CellSummary summary;
+            summary.Name.assign((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0));
+            summary.Boundaries = (unsigned int)sqlite3_column_int64(stmt, 1);
+            summary.Paths = (unsigned int)sqlite3_column_int64(stmt, 2);
+            summary.SRefs = (unsigned int)sqlite3_column_int64(stmt, 3);
+            summary.ARefs = (unsigned int)sqlite3_column_int64(stmt, 4);
+            summary.Others = (unsigned int)sqlite3_column_int64(stmt, 5);
+            position[summary.Name] = summaries.size();
+            summaries.push_back(summary);
+        }
+        sqlite3_finalize(stmt);
+
+        sql = "SELECT ID, LAYER, DATATYPE, COUNT FROM cell_layer_table;";
+        if (rc == SQLITE_DONE)
+            rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+        if (rc == SQLITE_OK)
         {
+            rc = sqlite3_step(stmt);
+            for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+            {
+                std::string name((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0));
+                auto iter = position.find(name);
+                if (iter == position.end())
+                    continue;
+                std::pair<short, short> layer((short)sqlite3_column_int(stmt, 1), (short)sqlite3_column_int(stmt, 2));
+                summaries[iter->second].Layers[layer] = (unsigned int)sqlite3_column_int64(stmt, 3);
+            }
             sqlite3_finalize(stmt);
-            sqlite3_close(db);
-            err = "SQL error: failed to add cell data into cell_table.\n";
-            return DB_ERROR;
         }
-        infile.seekg(e.second.first, std::ios_base::beg);
-        char *buffer = new char[e.second.second - e.second.first];
-        infile.read(buffer, e.second.second - e.second.first);
-        rc = sqlite3_bind_blob64(stmt, 2, buffer, e.second.second - e.second.first, SQLITE_TRANSIENT);
-        if (rc != SQLITE_OK)
+
+        sql = "SELECT ID, SNAME, COUNT FROM cell_reference_table;";
+        if (rc == SQLITE_DONE)
+            rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+        if (rc == SQLITE_OK)
         {
+            rc = sqlite3_step(stmt);
+            for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+            {
+                std::string name((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0));
+                auto iter = position.find(name);
+                if (iter == position.end())
+                    continue;
+                std::string sname((const char *)sqlite3_column_text(stmt, 1), sqlite3_column_bytes(stmt, 1));
+                summaries[iter->second].References[sname] = (unsigned int)sqlite3_column_int64(stmt, 2);
+            }
             sqlite3_finalize(stmt);
-            sqlite3_close(db);
-            err = "SQL error: failed to add cell data into cell_table.\n";
+        }
+        sqlite3_close(db);
+        if (rc != SQLITE_DONE)
+        {
+            err = "SQL error: failed to read cell summaries from cell_summary_table.\n";
             return DB_ERROR;
         }
+        return 0;
+    }
+    sqlite3_finalize(stmt);
+
+    // Databases of older versions have no summary tables: scan the cells.
+    short format = CELL_FORMAT_GDSII;
+    sql = "SELECT DATA FROM db_info_table WHERE ID=? LIMIT 1;";
+    rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_bind_text(stmt, 1, CELL_FORMAT_ID, -1, SQLITE_STATIC);
+    if (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_bytes(stmt, 0) >= 2)
+        Decode((const char *)sqlite3_column_blob(stmt, 0), format);
+    sqlite3_finalize(stmt);
+
+    sql = "SELECT ID, DATA FROM cell_table;";
+    rc = sqlite3_prepare_v2(db, sql, (int)strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
         rc = sqlite3_step(stmt);
-        if (rc != SQLITE_DONE)
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        CellSummary summary;
+        const char *data = (const char *)sqlite3_column_blob(stmt, 1);
+        size_t size = sqlite3_column_bytes(stmt, 1);
+        if (!ScanCellSummary(data, size, format, summary))
         {
             sqlite3_finalize(stmt);
-            delete[] buffer;
             sqlite3_close(db);
-            err = "SQL error: failed to add cell data into cell_table.\n";
+            err = "Database format error: the data of a cell is corrupted.\n";
+            return FORMAT_ERROR;
+        }
+        summary.Name.assign((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0));
+        summaries.push_back(summary);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    if (rc != SQLITE_DONE)
+    {
+        err = "SQL error: failed to read cell data from cell_table.\n";
+        return DB_ERROR;
+    }
+
+    return 0;
+}
+
+int GDS::StreamCellData(sqlite3 *db, long long rowid, short format, std::ofstream &out,
+                        std::vector<char> &buffer, std::string &err)
+{
+    const int CHUNK_SIZE = 1 << 20;
+
+    sqlite3_blob *blob;
+    int rc = sqlite3_blob_open(db, "main", CELL_TABLE, DATA_COL_NAME, rowid, 0, &blob);
+    if (rc != SQLITE_OK)
+    {
+        err = "SQL error: failed to open the data of a cell.\n";
+        sqlite3_blob_close(blob);
+        return DB_ERROR;
+    }
+    int nBytes = sqlite3_blob_bytes(blob);
+    GDS_STATS_ADD(STAT_DB_ROWS_READ, 1);
+    GDS_STATS_ADD(STAT_BLOB_BYTES_READ, nBytes);
+
+    if (format == CELL_FORMAT_COMPACT)
+    {
+        buffer.resize(nBytes);
+        rc = sqlite3_blob_read(blob, buffer.data(), nBytes, 0);
+        sqlite3_blob_close(blob);
+        if (rc != SQLITE_OK)
+        {
+            err = "SQL error: failed to read the data of a cell.\n";
             return DB_ERROR;
         }
-        delete[]buffer;
+        std::vector<char> decoded;
+        if (!DecodeCompactCell(buffer.data(), buffer.size(), decoded))
+        {
+            err = "Format error: failed to decode the data of a cell.\n";
+            return FORMAT_ERROR;
+        }
+        out.write(decoded.data(), decoded.size());
+    }
+    else
+    {
+        if (buffer.size() < (size_t)CHUNK_SIZE)
+            buffer.resize(CHUNK_SIZE);
+        for (int offset = 0; offset < nBytes; offset += CHUNK_SIZE)
+        {
+            int n = nBytes - offset < CHUNK_SIZE ? nBytes - offset : CHUNK_SIZE;
+            rc = sqlite3_blob_read(blob, buffer.data(), n, offset);
+            if (rc != SQLITE_OK)
+            {
+                err = "SQL error: failed to read the data of a cell.\n";
+                sqlite3_blob_close(blob);
+                return DB_ERROR;
+            }
+            out.write(buffer.data(), n);
+        }
+        sqlite3_blob_close(blob);
+    }
+
+    if (out.fail())
+    {
+        err = "GDSII file error: failed to write the GDSII file.\n";
+        return FILE_ERROR;
+    }
+    return 0;
+}
+
+int GDS::ConvertDB2GDSII(std::string dbName, std::string gdsName, std::string &err)
+{
+    sqlite3 *db;
+    int rc;
+
+    rc = sqlite3_open_v2(dbName.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
+    if (rc)
+    {
+        err = "Can't open database: " + std::string(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    // Only the read settings, a read-only connection can not change the journal.
+    StorageProfile profile = StorageProfile::ReadMostly();
+    profile.JournalMode = nullptr;
+    profile.Synchronous = nullptr;
+    if (ApplyStorageProfile(db, profile, err))
+    {
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+
+    // The library information, kept as the data of the records.
+    std::map<std::string, std::string> info;
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT ID, DATA FROM db_info_table;";
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt);
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        std::string id((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_bytes(stmt, 0));
+        const char *data = (const char *)sqlite3_column_blob(stmt, 1);
+        info[id] = std::string(data, data + sqlite3_column_bytes(stmt, 1));
     }
     sqlite3_finalize(stmt);
-    sqlite3_exec(db, "commit;", 0, 0, 0);
+    if (rc != SQLITE_DONE)
+    {
+        err = "SQL error: failed to read the library information.\n";
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
+    if (info[GDS_VERSION_ID].size() != 2
+        || info[MOD_TIME_ID].size() != 12
+        || info[ACC_TIME_ID].size() != 12
+        || info[UNITS_ID].size() != 16
+        || info.count(LIB_NAME_ID) == 0)
+    {
+        err = "Format error: incomplete library information in database.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+    short format = CELL_FORMAT_GDSII;
+    if (info.count(CELL_FORMAT_ID) != 0)
+    {
+        if (info[CELL_FORMAT_ID].size() != 2)
+        {
+            err = "Format error: incorrect cell format in database.\n";
+            sqlite3_close(db);
+            return FORMAT_ERROR;
+        }
+        Decode(info[CELL_FORMAT_ID].data(), format);
+    }
+    if (format != CELL_FORMAT_GDSII && format != CELL_FORMAT_COMPACT)
+    {
+        err = "Format error: unsupported cell format in database.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+
+    std::ofstream outfile(gdsName, std::ios::binary);
+    if (!outfile.is_open())
+    {
+        err = "GDSII file error: failed to open the GDSII file.\n";
+        sqlite3_close(db);
+        return FILE_ERROR;
+    }
 
+    std::vector<char> buffer;
+    const std::string &version = info[GDS_VERSION_ID];
+    memcpy(AppendRecord(buffer, HEADER, Integer_2, 2), version.data(), 2);
+    char *p = AppendRecord(buffer, BGNLIB, Integer_2, 24);
+    memcpy(p, info[MOD_TIME_ID].data(), 12);
+    memcpy(p + 12, info[ACC_TIME_ID].data(), 12);
+    const std::string &lib_name = info[LIB_NAME_ID];
+    if (lib_name.size() > 0xfffa)
+    {
+        err = "Format error: incorrect lib name in database.\n";
+        sqlite3_close(db);
+        return FORMAT_ERROR;
+    }
+    p = AppendRecord(buffer, LIBNAME, String, lib_name.size() + lib_name.size() % 2);
+    memcpy(p, lib_name.data(), lib_name.size());
+    if (lib_name.size() % 2 != 0)
+        p[lib_name.size()] = '\0';
+    memcpy(AppendRecord(buffer, UNITS, Real_8, 16), info[UNITS_ID].data(), 16);
+    outfile.write(buffer.data(), buffer.size());
+
+    sql = "SELECT rowid FROM cell_table ORDER BY rowid;";
+    rc = sqlite3_prepare_v2(db, sql, strlen(sql), &stmt, 0);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_step(stmt);
+    for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        int ret = StreamCellData(db, sqlite3_column_int64(stmt, 0), format, outfile, buffer, err);
+        if (ret)
+        {
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            return ret;
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE)
+    {
+        err = "SQL error: failed to read cell data from database.\n";
+        sqlite3_close(db);
+        return DB_ERROR;
+    }
     sqlite3_close(db);
 
+    buffer.clear();
+    PutRecord(buffer, ENDLIB);
+    outfile.write(buffer.data(), buffer.size());
+    outfile.close();
+    if (outfile.fail())
+    {
+        err = "GDSII file error: failed to write the GDSII file.\n";
+        return FILE_ERROR;
+    }
+
     return 0;
 }
-
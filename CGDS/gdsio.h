@@ -23,8 +23,12 @@
 #ifndef GDSIO_H
 #define GDSIO_H
 #include <fstream>
+#include <map>
 #include <string>
-//#include "tags.h"
+#include <vector>
+#include "tags.h"
+
+struct sqlite3;
 
 namespace GDS {
 
@@ -32,6 +36,54 @@ const int DB_ERROR = 1;
 const int FILE_ERROR = 2;
 const int FORMAT_ERROR = 3;
 
+/*!
+ * Encoding of the cell data in cell_table, recorded as CELL_FORMAT in
+ * db_info_table. Databases without the record use CELL_FORMAT_GDSII.
+ */
+enum CELL_FORMAT
+{
+    CELL_FORMAT_GDSII   = 0,    //< Raw GDSII records from BGNSTR to ENDSTR.
+    CELL_FORMAT_COMPACT = 1,    //< Records encoded by EncodeCompactCell.
+};
+
+/*!
+ * SQLite settings applied when a layout database is opened or created.
+ * A zero or null field keeps the default of SQLite.
+ */
+struct StorageProfile
+{
+    int         PageSize;       //< page_size in bytes. Only effective on a new database.
+    const char *JournalMode;    //< journal_mode, such as "WAL", "DELETE" or "OFF".
+    const char *Synchronous;    //< synchronous, such as "OFF", "NORMAL" or "FULL".
+    int         CacheSize;      //< cache_size. A negative value is in KiB.
+    long long   MmapSize;       //< mmap_size in bytes.
+    const char *TempStore;      //< temp_store, such as "MEMORY" or "FILE".
+
+    StorageProfile();
+
+    /*!
+     * Defaults of SQLite.
+     */
+    static StorageProfile Default();
+    /*!
+     * Settings for writing a new database in one pass: large pages for
+     * the cell blobs, no rollback journal and no syncs. A crash during
+     * the conversion leaves a database which has to be converted again.
+     */
+    static StorageProfile BulkLoad();
+    /*!
+     * Settings for reading cells: WAL so readers do not block a writer,
+     * a large page cache and memory-mapped reads.
+     */
+    static StorageProfile ReadMostly();
+};
+
+/*!
+ * Apply the settings of a profile to an open database.
+ * @return 0 if succeeded, or DB_ERROR.
+ */
+int ApplyStorageProfile(sqlite3 *db, const StorageProfile &profile, std::string &err);
+
 /*
  * 2-Byte Signed Integer    ---- short
  * 4-Byte Signed Integer    ---- int
@@ -82,21 +134,177 @@ void Encode(double in, char *output);
  * @param in 2-byte binary code.
  * @param out The number.
  */
-void Decode(char *in, short &out);
+void Decode(const char *in, short &out);
 /*!
  * Decode a 4-byte binary into a int number.
  * @param in 4-byte binary code.
  * @param out The number.
  */
-void Decode(char *in, int &out);
+void Decode(const char *in, int &out);
 /*!
  * Decode a 8-byte binary into a double number.
  * @param in 8-byte binary code.
  * @param out The number.
  */
-void Decode(char *in, double &out);
+void Decode(const char *in, double &out);
+
+/*!
+ * Read the header of a record from a memory buffer.
+ * @param cursor[in,out] The position of the record. On success it is moved
+ *                       to the data of the record.
+ * @param end The end of the buffer.
+ * @param size[out] The size of the record, including the 4-byte header.
+ * @param type[out], dt[out] The record type and the data type.
+ * @return False if the buffer is too short for the record.
+ */
+bool ReadRecordHeader(const char *&cursor, const char *end, int &size, Byte &type, Byte &dt);
+
+/*
+ * Append GDSII records to a memory buffer. The data is encoded in place,
+ * so a record costs one resize of the buffer instead of a write per field.
+ * Functions returning bool fail if the data does not fit in a record.
+ */
+void PutRecord(std::vector<char> &out, Byte type);
+void PutShortRecord(std::vector<char> &out, Byte type, Byte dt, const short *values, int count);
+void PutShortRecord(std::vector<char> &out, Byte type, Byte dt, short value);
+void PutIntRecord(std::vector<char> &out, Byte type, int value);
+void PutDoubleRecord(std::vector<char> &out, Byte type, const double *values, int count);
+bool PutStringRecord(std::vector<char> &out, Byte type, const std::string &str);
+bool PutXYRecord(std::vector<char> &out, const Point *pts, size_t count);
+
+/*!
+ * Encode the GDSII records of a cell into the compact form.
+ *
+ * Each record is written as a one-byte tag followed by its data. The data
+ * type is implied by the record type, integers are zig-zag varints, and
+ * the points of XY are deltas from the previous point. A record with the
+ * same data as the previous record of its type (LAYER, DATATYPE, WIDTH,
+ * SNAME, ...) is written as the tag only. The encoding is lossless, and
+ * records which do not fit it are kept as raw bytes.
+ * @param data The GDSII records.
+ * @param size The size of the records in bytes.
+ * @param out[out] The encoded data.
+ */
+void EncodeCompactCell(const char *data, size_t size, std::vector<char> &out);
+/*!
+ * Decode the data of EncodeCompactCell back into GDSII records.
+ * @return False if the data is corrupted.
+ */
+bool DecodeCompactCell(const char *data, size_t size, std::vector<char> &out);
+
+/*!
+ * Collect the names of the cells referred to by SREF and AREF in the data
+ * of a cell, skipping the geometry without parsing it.
+ * @param data The data of the cell in cell_table.
+ * @param size The size of the data in bytes.
+ * @param format The CELL_FORMAT of the data.
+ * @param names[out] The names. A name may appear more than once.
+ * @return False if the data is corrupted.
+ */
+bool ScanCellReferences(const char *data, size_t size, short format, std::vector<std::string> &names);
+
+/*!
+ * \brief The metadata of a cell: the element counts, the layers in use
+ * and the cells referred to.
+ */
+struct CellSummary
+{
+    std::string         Name;
+    unsigned int        Boundaries;
+    unsigned int        Paths;
+    unsigned int        SRefs;
+    unsigned int        ARefs;
+    unsigned int        Others;     //< TEXT, NODE and BOX.
+    std::map<std::pair<short, short>, unsigned int> Layers;     //< (layer, datatype) -> elements
+    std::map<std::string, unsigned int>             References; //< cell name -> SREF and AREF
+
+    CellSummary();
+};
+
+/*!
+ * Summarize the data of a cell. Like ScanCellReferences, only the record
+ * headers and the small records (STRNAME, LAYER, the *TYPE records,
+ * SNAME) are read; XY and the other records are skipped by their length.
+ * @param data The data of the cell, from BGNSTR to ENDSTR.
+ * @param size The size of the data in bytes.
+ * @param format The CELL_FORMAT of the data.
+ * @param summary[out] The summary.
+ * @return False if the data is corrupted.
+ */
+bool ScanCellSummary(const char *data, size_t size, short format, CellSummary &summary);
+/*!
+ * Read the summaries of the cells in a layout database, which
+ * ConvertGDSII2DB keeps in cell_summary_table, cell_layer_table and
+ * cell_reference_table. The cells of databases without these tables are
+ * scanned by ScanCellSummary.
+ * @return 0 if succeeded, or DB_ERROR, FORMAT_ERROR.
+ */
+int ReadCellSummaries(std::string dbName, std::vector<CellSummary> &summaries, std::string &err);
+/*!
+ * Hash the GDSII records of a cell without BGNSTR, which holds the time
+ * stamps, so a cell written again unchanged keeps its hash.
+ * ConvertGDSII2DB keeps the hashes in cell_hash_table.
+ * @param data The data of the cell, from BGNSTR to ENDSTR.
+ * @param size The size of the data in bytes.
+ */
+unsigned long long HashCellRecords(const char *data, size_t size);
+
+/*!
+ * \brief The records of a cell in a GDSII file, from BGNSTR to ENDSTR.
+ */
+struct CellOffset
+{
+    std::string         Name;
+    unsigned long long  Start;      //< Offset of BGNSTR in the file.
+    unsigned long long  End;        //< Offset after ENDSTR.
+};
+
+/*!
+ * Locate the cells in the data of a GDSII file. Only the record headers
+ * and STRNAME are read; the elements are skipped.
+ * @param data The data of the file, starting with HEADER.
+ * @param size The size of the data in bytes.
+ * @param index[out] The cells in the order of the file.
+ * @return 0 if succeeded, or FORMAT_ERROR.
+ */
+int IndexGDSII(const char *data, size_t size, std::vector<CellOffset> &index, std::string &err);
+/*!
+ * Read the offsets of the cells in the source GDSII file, which
+ * ConvertGDSII2DB keeps in cell_offset_table.
+ * @return 0 if succeeded, or DB_ERROR. Databases of older versions
+ *         have no cell_offset_table.
+ */
+int ReadCellOffsets(std::string dbName, std::vector<CellOffset> &index, std::string &err);
 
-int ConvertGDSII2DB(std::string gdsName, std::string dbName, std::string &err);
+/*!
+ * Convert a GDSII file into a layout database. Besides the data of the
+ * cells, the offsets of the cells in the file are kept in
+ * cell_offset_table for Library::LoadGDS.
+ * @param profile The SQLite settings. StorageProfile::BulkLoad() is
+ *                faster, but a crash leaves a broken database.
+ */
+int ConvertGDSII2DB(std::string gdsName, std::string dbName, std::string &err,
+                    CELL_FORMAT format = CELL_FORMAT_GDSII,
+                    const StorageProfile &profile = StorageProfile::Default());
+/*!
+ * Write a layout database back to a GDSII file, the inverse of
+ * ConvertGDSII2DB. The cells are not parsed; the data of each cell is
+ * copied from the database to the file.
+ * @return 0 if succeeded, or DB_ERROR, FILE_ERROR, FORMAT_ERROR.
+ */
+int ConvertDB2GDSII(std::string dbName, std::string gdsName, std::string &err);
+/*!
+ * Copy the data of a cell in cell_table to a GDSII stream. Raw GDSII data
+ * goes through a fixed-size buffer; compact data is decoded first.
+ * @param db The database.
+ * @param rowid The rowid of the cell in cell_table.
+ * @param format The CELL_FORMAT of the database.
+ * @param out The GDSII stream.
+ * @param buffer A buffer which is reused between calls.
+ * @return 0 if succeeded, or DB_ERROR, FILE_ERROR, FORMAT_ERROR.
+ */
+int StreamCellData(sqlite3 *db, long long rowid, short format, std::ofstream &out,
+                   std::vector<char> &buffer, std::string &err);
 
 
 
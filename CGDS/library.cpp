@@ -20,7 +20,9 @@
  **/
 
 #include <assert.h>
+#include <algorithm>
 #include <fstream>
+#include <cstring>
 #include "library.h"
 #include "tags.h"
 #include "gdsio.h"
@@ -33,7 +35,11 @@
 #include "boundary.h"
 #include "path.h"
 #include "structures.h"
-#include "sqlite/sqlite3.h"
+#include "box.h"
+#include "parallel.h"
+#include "mapfile.h"
+#include "transform.h"
+#include <sqlite3.h>
 //#include "text.h"
 
 
@@ -44,6 +50,7 @@ namespace GDS
     Library::Library()
     {
         mDBConnection = nullptr;
+        mStorageProfile = StorageProfile::Default();
         Init();
     }
 
@@ -74,10 +81,37 @@ namespace GDS
         mVersion = 0;
         mDBUnitInMeter = 1e-9;
         mDBUnitInUserUnit = 1e-3;
+        mCellFormat = CELL_FORMAT_GDSII;
 
         Clear();
     }
 
+    const std::string &Library::LibName() const
+    {
+        return mLibName;
+    }
+
+    void Library::SetLibName(const std::string &name)
+    {
+        mLibName = name;
+    }
+
+    double Library::DBUnitInUserUnit() const
+    {
+        return mDBUnitInUserUnit;
+    }
+
+    double Library::DBUnitInMeter() const
+    {
+        return mDBUnitInMeter;
+    }
+
+    void Library::SetUnits(double user_unit, double meter)
+    {
+        mDBUnitInUserUnit = user_unit;
+        mDBUnitInMeter = meter;
+    }
+
     size_t Library::Size() const
     {
         return mCells.size();
@@ -100,6 +134,7 @@ namespace GDS
             }
         }
         mCells.clear();
+        mCellIndex.clear();
         for (auto &e : mDeletedCells)
         {
             if (e != nullptr)
@@ -118,42 +153,60 @@ namespace GDS
         return mCells[index];
     }
 
-    Structure *Library::Add(std::string name)
+    Structure *Library::Add(const std::string &name)
     {
         Structure *ret(nullptr);
 
         Structure *new_item = new Structure(name, this);
+        // A new cell has no data in the database, even under an old name.
+        new_item->SetChanged(true);
         mCells.push_back(new_item);
+        mCellIndex.insert(std::make_pair(new_item->NameId(), new_item));
         ret = new_item;
 
         return ret;
     }
 
-    Structure *Library::Get(std::string name)
+    Structure *Library::Get(const std::string &name)
     {
-        for (auto& e : mCells)
-        {
-            if (!e)
-                continue;
-            if (e->Name() == name)
-            {
-                return e;
-            }
-        }
-        return nullptr;
+        StringTable::Id id;
+        if (!StringTable::Instance().Find(name, id))
+            return nullptr;
+        return GetById(id);
     }
 
-    void Library::Del(std::string name)
+    Structure *Library::GetById(StringTable::Id name)
     {
+        auto iter = mCellIndex.find(name);
+        if (iter == mCellIndex.end())
+            return nullptr;
+        return iter->second;
+    }
+
+    void Library::Del(const std::string &name)
+    {
+        StringTable::Id id;
+        if (!StringTable::Instance().Find(name, id))
+            return;
         for (size_t i = 0; i < Size(); i++)
         {
             auto node = mCells[i];
             if (node == nullptr)
                 continue;
-            if (node->Name() == name)
+            if (node->NameId() == id)
             {
                 mCells.erase(mCells.begin() + i);
                 mDeletedCells.push_back(node);
+                mCellIndex.erase(id);
+                // Another cell with the same name takes over the index.
+                for (auto e : mCells)
+                {
+                    if (e != nullptr && e->NameId() == id)
+                    {
+                        mCellIndex[id] = e;
+                        break;
+                    }
+                }
                 break;
             }
         }
@@ -173,7 +226,7 @@ namespace GDS
             return -1;
         }
         rc = sqlite3_step(ppStmt);
-        if (rc != SQLITE_DONE)
+        if (rc != SQLITE_ROW)
         {
             err = "SQL error: failed to get row id of " + ID + " in " + table + ".\n";
             sqlite3_finalize(ppStmt);
@@ -184,8 +237,29 @@ namespace GDS
         return ret;
     }
 
+    void Library::SetStorageProfile(const StorageProfile &profile)
+    {
+        mStorageProfile = profile;
+    }
+
+    void Library::SetLayerFilter(const LayerFilter &filter)
+    {
+        mLayerFilter = filter;
+    }
+
     bool Library::OpenDB(const std::string &file_name, std::string &err)
     {
+        return OpenDatabase(file_name, nullptr, err);
+    }
+
+    bool Library::OpenDB(const std::string &file_name, const std::string &root, std::string &err)
+    {
+        return OpenDatabase(file_name, &root, err);
+    }
+
+    bool Library::OpenDatabase(const std::string &file_name, const std::string *root, std::string &err)
+    {
+        GDS_STATS_TIMER(STAT_TIME_OPEN_DB);
         Init();
 
         int rc;
@@ -198,6 +272,12 @@ namespace GDS
             mDBConnection = nullptr;
             return false;
         }
+        if (ApplyStorageProfile(mDBConnection, mStorageProfile, err))
+        {
+            sqlite3_close(mDBConnection);
+            mDBConnection = nullptr;
+            return false;
+        }
 
         sqlite3_int64 rowId;
         sqlite3_blob *ppBlob;
@@ -504,8 +584,48 @@ namespace GDS
         }
         sqlite3_blob_close(ppBlob);
 
+        // CELL FORMAT, which is absent in the databases of older versions.
+        rowId = GetRowID(mDBConnection, INFO_TABLE, CELL_FORMAT_ID, err);
+        if (rowId != -1)
+        {
+            rc = sqlite3_blob_open(mDBConnection,
+                                   "main",
+                                   INFO_TABLE,
+                                   DATA_COL_NAME,
+                                   rowId,
+                                   0,
+                                   &ppBlob);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_blob_read(ppBlob, buffer_2b, 2, 0);
+            sqlite3_blob_close(ppBlob);
+            if (rc != SQLITE_OK)
+            {
+                err = "Failed to get cell format information from database.\n";
+                sqlite3_close(mDBConnection);
+                mDBConnection = nullptr;
+                return false;
+            }
+            Decode(buffer_2b, mCellFormat);
+        }
+        if (mCellFormat != CELL_FORMAT_GDSII && mCellFormat != CELL_FORMAT_COMPACT)
+        {
+            err = "Unsupported cell format in database.\n";
+            sqlite3_close(mDBConnection);
+            mDBConnection = nullptr;
+            return false;
+        }
+        err.clear();
+
+        if (root != nullptr)
+        {
+            if (LoadSubtree(*root, err))
+                return true;
+            Clear();
+            return false;
+        }
+
         char cmd[100];
-        sprintf(cmd, "SELECT ID FROM %s;", CELL_TABLE);
+        sprintf(cmd, "SELECT ID, DATA FROM %s;", CELL_TABLE);
         sqlite3_stmt *stmt;
         rc = sqlite3_prepare_v2(mDBConnection, cmd, (int)strlen(cmd), &stmt, 0);
         if (rc != SQLITE_OK)
@@ -516,14 +636,44 @@ namespace GDS
             mDBConnection = nullptr;
             return false;
         }
+        std::vector<char> decoded;
         while (true)
         {
-            rc = sqlite3_step(stmt);
+            {
+                GDS_STATS_TIMER(STAT_TIME_DB_READ);
+                rc = sqlite3_step(stmt);
+            }
             if (rc == SQLITE_ROW)
             {
-                char cell_name[100];
-                sprintf(cell_name, "%s", sqlite3_column_text(stmt, 0));
-                Add(std::string(cell_name));
+                std::string cell_name((const char *)sqlite3_column_text(stmt, 0),
+                                      sqlite3_column_bytes(stmt, 0));
+                Structure *cell = Add(cell_name);
+                const char *data = (const char *)sqlite3_column_blob(stmt, 1);
+                int nBytes = sqlite3_column_bytes(stmt, 1);
+                GDS_STATS_ADD(STAT_DB_ROWS_READ, 1);
+                GDS_STATS_ADD(STAT_BLOB_BYTES_READ, nBytes);
+                std::string msg;
+                if (mCellFormat == CELL_FORMAT_COMPACT)
+                {
+                    if (!DecodeCompactCell(data, nBytes, decoded))
+                    {
+                        err = "Failed to decode the data of cell " + cell_name + ".\n";
+                        sqlite3_finalize(stmt);
+                        sqlite3_close(mDBConnection);
+                        mDBConnection = nullptr;
+                        return false;
+                    }
+                    data = decoded.data();
+                    nBytes = (int)decoded.size();
+                }
+                if (cell->Read(data, nBytes, msg, &mLayerFilter) != 0)
+                {
+                    err = "Failed to read the data of cell " + cell_name + ": " + msg;
+                    sqlite3_finalize(stmt);
+                    sqlite3_close(mDBConnection);
+                    mDBConnection = nullptr;
+                    return false;
+                }
             }
             else if (rc == SQLITE_DONE)
             {
@@ -542,6 +692,88 @@ namespace GDS
         return true;
     }
 
+    bool Library::LoadSubtree(const std::string &root, std::string &err)
+    {
+        // Find the cells of the subtree breadth first. Only the blobs of
+        // those cells are read, through the index on the cell names.
+        sqlite3_stmt *stmt;
+        const char *sql = "SELECT DATA FROM cell_table WHERE ID=? LIMIT 1;";
+        int rc = sqlite3_prepare_v2(mDBConnection, sql, (int)strlen(sql), &stmt, 0);
+        if (rc != SQLITE_OK)
+        {
+            err = "Failed during fetching cell info from database.\n";
+            sqlite3_finalize(stmt);
+            return false;
+        }
+
+        std::vector<std::string> queue(1, root);
+        std::unordered_map<std::string, bool> visited;
+        visited[root] = true;
+        std::vector<std::string> names;
+        std::vector<char> data;
+        std::vector<char> decoded;
+        std::vector<CellOffset> index;
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            sqlite3_reset(stmt);
+            sqlite3_bind_text(stmt, 1, queue[i].c_str(), (int)queue[i].size(), SQLITE_STATIC);
+            {
+                GDS_STATS_TIMER(STAT_TIME_DB_READ);
+                rc = sqlite3_step(stmt);
+            }
+            if (rc != SQLITE_ROW)
+            {
+                // Missing references are ignored, like in SortCells.
+                if (rc == SQLITE_DONE && i > 0)
+                    continue;
+                err = rc == SQLITE_DONE ? "Cell " + root + " is not in the database.\n"
+                                        : "Failed during fetching cell info from database.\n";
+                sqlite3_finalize(stmt);
+                return false;
+            }
+            const char *blob = (const char *)sqlite3_column_blob(stmt, 0);
+            int nBytes = sqlite3_column_bytes(stmt, 0);
+            GDS_STATS_ADD(STAT_DB_ROWS_READ, 1);
+            GDS_STATS_ADD(STAT_BLOB_BYTES_READ, nBytes);
+            if (!ScanCellReferences(blob, nBytes, mCellFormat, names))
+            {
+                err = "Failed to scan the data of cell " + queue[i] + ".\n";
+                sqlite3_finalize(stmt);
+                return false;
+            }
+            for (auto &name : names)
+            {
+                if (!visited[name])
+                {
+                    visited[name] = true;
+                    queue.push_back(name);
+                }
+            }
+
+            // The GDSII records of the cells are gathered for LoadCells.
+            if (mCellFormat == CELL_FORMAT_COMPACT)
+            {
+                if (!DecodeCompactCell(blob, nBytes, decoded))
+                {
+                    err = "Failed to decode the data of cell " + queue[i] + ".\n";
+                    sqlite3_finalize(stmt);
+                    return false;
+                }
+                blob = decoded.data();
+                nBytes = (int)decoded.size();
+            }
+            CellOffset offset;
+            offset.Name = queue[i];
+            offset.Start = data.size();
+            data.insert(data.end(), blob, blob + nBytes);
+            offset.End = data.size();
+            index.push_back(offset);
+        }
+        sqlite3_finalize(stmt);
+
+        return LoadCells(data.data(), data.size(), index, err, 0);
+    }
+
     void Library::CloseDB()
     {
         if (mDBConnection != nullptr)
@@ -550,6 +782,494 @@ namespace GDS
         Init();
     }
 
+    bool Library::ReadHeader(const char *data, size_t size, std::string &err)
+    {
+        const char *cursor = data;
+        const char *end = data + size;
+        int record_size;
+        Byte record_type, record_dt;
+
+        if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt)
+            || record_type != HEADER || record_size != 6)
+        {
+            err = "GDSII format error: unexpected tag where 'HEADER' is expected.\n";
+            return false;
+        }
+        Decode(cursor, mVersion);
+        cursor += 2;
+
+        while (true)
+        {
+            const char *record = cursor;
+            if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
+            {
+                err = "GDSII format error: unexpected end of the GDSII data.\n";
+                return false;
+            }
+            switch (record_type)
+            {
+            case BGNLIB:
+                if (record_size != 28)
+                {
+                    err = "GDSII format error: incorrect record size of 'BGNLIB'.\n";
+                    return false;
+                }
+                Decode(cursor, mModYear);
+                Decode(cursor + 2, mModMonth);
+                Decode(cursor + 4, mModDay);
+                Decode(cursor + 6, mModHour);
+                Decode(cursor + 8, mModMinute);
+                Decode(cursor + 10, mModSecond);
+                Decode(cursor + 12, mAccYear);
+                Decode(cursor + 14, mAccMonth);
+                Decode(cursor + 16, mAccDay);
+                Decode(cursor + 18, mAccHour);
+                Decode(cursor + 20, mAccMinute);
+                Decode(cursor + 22, mAccSecond);
+                break;
+            case LIBNAME:
+                mLibName.clear();
+                for (int i = 0; i < record_size - 4; i++)
+                {
+                    if (cursor[i] != '\0')
+                        mLibName.push_back(cursor[i]);
+                }
+                break;
+            case UNITS:
+                if (record_size != 20)
+                {
+                    err = "GDSII format error: incorrect record size of 'UNITS'.\n";
+                    return false;
+                }
+                Decode(cursor, mDBUnitInUserUnit);
+                Decode(cursor + 8, mDBUnitInMeter);
+                break;
+            case BGNSTR:
+            case ENDLIB:
+                return true;
+            default:
+                break;
+            }
+            cursor = record + record_size;
+        }
+    }
+
+    bool Library::LoadCells(const char *data, size_t size, const std::vector<CellOffset> &index,
+                            std::string &err, unsigned int threads)
+    {
+        for (auto &offset : index)
+        {
+            if (offset.Start + 32 > offset.End || offset.End > size
+                || (Byte)data[offset.Start + 2] != BGNSTR || (Byte)data[offset.End - 2] != ENDSTR)
+            {
+                err = "The offsets of cell " + offset.Name + " do not match the GDSII file.\n";
+                return false;
+            }
+        }
+
+        // The largest cells are handed out first, so the threads finish together.
+        std::vector<size_t> order(index.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return index[a].End - index[a].Start > index[b].End - index[b].Start;
+        });
+
+        // Every cell is parsed into a structure of its own; the threads
+        // share nothing but the string table. The structures are created
+        // up front, since the constructor is not thread safe (localtime).
+        std::vector<Structure*> cells(index.size());
+        for (size_t i = 0; i < cells.size(); i++)
+            cells[i] = new Structure(index[i].Name, this);
+        std::vector<std::string> msgs(index.size());
+        std::vector<char> failed(index.size());
+        ParallelFor(order.size(), threads, [&](size_t i, unsigned int)
+        {
+            size_t k = order[i];
+            failed[k] = cells[k]->Read(data + index[k].Start,
+                                       (size_t)(index[k].End - index[k].Start), msgs[k], &mLayerFilter) != 0;
+        });
+
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            if (failed[i])
+            {
+                err = "Failed to read the data of cell " + index[i].Name + ": " + msgs[i];
+                for (auto cell : cells)
+                    delete cell;
+                return false;
+            }
+        }
+
+        // Link the cells into the library in the order of the file.
+        mCells.reserve(mCells.size() + cells.size());
+        for (auto cell : cells)
+        {
+            mCells.push_back(cell);
+            mCellIndex.insert(std::make_pair(cell->NameId(), cell));
+        }
+
+        return true;
+    }
+
+    bool Library::LoadGDS(const std::string &file_name, std::string &err, unsigned int threads)
+    {
+        GDS_STATS_TIMER(STAT_TIME_LOAD_GDS);
+        Init();
+
+        MappedFile file;
+        if (!file.Open(file_name))
+        {
+            err = "Can not open " + file_name + '\n';
+            return false;
+        }
+        if (!ReadHeader(file.Data(), file.Size(), err))
+            return false;
+        std::vector<CellOffset> index;
+        if (IndexGDSII(file.Data(), file.Size(), index, err))
+            return false;
+
+        return LoadCells(file.Data(), file.Size(), index, err, threads);
+    }
+
+    bool Library::LoadGDS(const std::string &file_name, const std::vector<CellOffset> &index,
+                          std::string &err, unsigned int threads)
+    {
+        GDS_STATS_TIMER(STAT_TIME_LOAD_GDS);
+        Init();
+
+        MappedFile file;
+        if (!file.Open(file_name))
+        {
+            err = "Can not open " + file_name + '\n';
+            return false;
+        }
+        if (!ReadHeader(file.Data(), file.Size(), err))
+            return false;
+
+        return LoadCells(file.Data(), file.Size(), index, err, threads);
+    }
+
+    void Library::SortCells(std::vector<Structure*> &sorted) const
+    {
+        // Iterative depth-first search, a cell is emitted after all the
+        // cells it refers to. Cycles and missing references are ignored.
+        std::unordered_map<const Structure*, char> state;  // 1: visiting, 2: done
+        std::vector<std::pair<Structure*, size_t> > stack;
+        sorted.clear();
+        sorted.reserve(mCells.size());
+        for (auto root : mCells)
+        {
+            if (root == nullptr || state[root] != 0)
+                continue;
+            state[root] = 1;
+            stack.push_back(std::make_pair(root, (size_t)0));
+            while (!stack.empty())
+            {
+                Structure *cell = stack.back().first;
+                size_t &i = stack.back().second;
+                Structure *child = nullptr;
+                while (i < cell->Size() && child == nullptr)
+                {
+                    Element *e = cell->Get((int)i++);
+                    StringTable::Id name;
+                    if (e->Tag() == SREF)
+                        name = static_cast<SRef*>(e)->SNameId();
+                    else if (e->Tag() == AREF)
+                        name = static_cast<ARef*>(e)->SNameId();
+                    else
+                        continue;
+                    auto iter = mCellIndex.find(name);
+                    if (iter != mCellIndex.end() && state[iter->second] == 0)
+                        child = iter->second;
+                }
+                if (child != nullptr)
+                {
+                    state[child] = 1;
+                    stack.push_back(std::make_pair(child, (size_t)0));
+                }
+                else
+                {
+                    state[cell] = 2;
+                    sorted.push_back(cell);
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+
+    bool Library::Census(LayerCensus &census, std::string &err, unsigned int threads)
+    {
+        std::unordered_map<StringTable::Id, bool> referred;
+        for (auto cell : mCells)
+        {
+            for (size_t i = 0; i < cell->Size(); i++)
+            {
+                Element *e = cell->Get((int)i);
+                if (e->Tag() == SREF)
+                    referred[static_cast<SRef*>(e)->SNameId()] = true;
+                else if (e->Tag() == AREF)
+                    referred[static_cast<ARef*>(e)->SNameId()] = true;
+            }
+        }
+        std::vector<Structure*> roots;
+        for (auto cell : mCells)
+        {
+            if (referred.count(cell->NameId()) == 0)
+                roots.push_back(cell);
+        }
+
+        err.clear();
+        BuildCensus(roots, census, threads);
+        return true;
+    }
+
+    bool Library::Census(const std::string &root, LayerCensus &census, std::string &err, unsigned int threads)
+    {
+        Structure *cell = Get(root);
+        if (cell == nullptr)
+        {
+            census.clear();
+            err = "Cell " + root + " is not in the library.\n";
+            return false;
+        }
+
+        err.clear();
+        BuildCensus(std::vector<Structure*>(1, cell), census, threads);
+        return true;
+    }
+
+    StatsReport Library::Stats()
+    {
+        StatsReport report;
+        ReadStats(report);
+        return report;
+    }
+
+    void Library::BuildCensus(const std::vector<Structure*> &roots, LayerCensus &census, unsigned int threads)
+    {
+        // Find the cells under the roots.
+        std::unordered_map<const Structure*, LayerCensus> tree;
+        std::vector<Structure*> stack(roots.begin(), roots.end());
+        for (auto root : roots)
+            tree[root];
+        while (!stack.empty())
+        {
+            Structure *cell = stack.back();
+            stack.pop_back();
+            for (size_t i = 0; i < cell->Size(); i++)
+            {
+                Element *e = cell->Get((int)i);
+                StringTable::Id name;
+                if (e->Tag() == SREF)
+                    name = static_cast<SRef*>(e)->SNameId();
+                else if (e->Tag() == AREF)
+                    name = static_cast<ARef*>(e)->SNameId();
+                else
+                    continue;
+                auto iter = mCellIndex.find(name);
+                if (iter != mCellIndex.end() && tree.count(iter->second) == 0)
+                {
+                    tree[iter->second];
+                    stack.push_back(iter->second);
+                }
+            }
+        }
+
+        std::vector<Structure*> sorted;
+        SortCells(sorted);
+        std::vector<Structure*> cells;
+        cells.reserve(tree.size());
+        for (auto cell : sorted)
+        {
+            if (tree.count(cell) != 0)
+                cells.push_back(cell);
+        }
+
+        // The census of each cell itself, then the instances from the bottom up.
+        ParallelFor(cells.size(), threads, [&](size_t i, unsigned int)
+        {
+            cells[i]->Census();
+        });
+        std::unordered_map<const Structure*, bool> done;
+        for (auto cell : cells)
+        {
+            LayerCensus &result = tree[cell];
+            result = cell->Census();
+            for (size_t i = 0; i < cell->Size(); i++)
+            {
+                Element *e = cell->Get((int)i);
+                if (e->Tag() == SREF)
+                {
+                    SRef *ref = static_cast<SRef*>(e);
+                    auto iter = mCellIndex.find(ref->SNameId());
+                    if (iter == mCellIndex.end() || done.count(iter->second) == 0)
+                        continue;
+
+                    Transform transform;
+                    if (ref->StransFlag(REFLECTION))
+                        transform.Scale(1, -1);
+                    transform.Scale(ref->Mag(), ref->Mag());
+                    transform.Rotate(ref->Angle());
+                    transform.Translate(ref->XY().X, ref->XY().Y);
+                    AddToCensus(result, tree[iter->second], transform, 1);
+                }
+                else if (e->Tag() == AREF)
+                {
+                    ARef *ref = static_cast<ARef*>(e);
+                    auto iter = mCellIndex.find(ref->SNameId());
+                    if (iter == mCellIndex.end() || done.count(iter->second) == 0)
+                        continue;
+                    Point col_pitch, row_pitch;
+                    if (!ref->Pitch(col_pitch, row_pitch))
+                        continue;
+
+                    // The extents of the array are the ones of its corner instances.
+                    const Point &origin = ref->XY()[0];
+                    int rows = ref->Row() - 1;
+                    int cols = ref->Col() - 1;
+                    Point corners[] = {
+                        Point(origin.X, origin.Y),
+                        Point(origin.X + col_pitch.X * cols, origin.Y + col_pitch.Y * cols),
+                        Point(origin.X + row_pitch.X * rows, origin.Y + row_pitch.Y * rows),
+                        Point(origin.X + row_pitch.X * rows + col_pitch.X * cols,
+                              origin.Y + row_pitch.Y * rows + col_pitch.Y * cols)
+                    };
+                    unsigned long long copies = (unsigned long long)ref->Row() * ref->Col();
+                    for (int k = 0; k < 4; k++)
+                    {
+                        Transform transform;
+                        if (ref->StransFlag(REFLECTION))
+                            transform.Scale(1, -1);
+                        transform.Scale(ref->Mag(), ref->Mag());
+                        transform.Rotate(ref->Angle());
+                        transform.Translate(corners[k].X, corners[k].Y);
+                        AddToCensus(result, tree[iter->second], transform, k == 0 ? copies : 0);
+                    }
+                }
+            }
+            done[cell] = true;
+        }
+
+        census.clear();
+        for (auto root : roots)
+            AddToCensus(census, tree[root], Transform(), 1);
+    }
+
+    bool Library::WriteGDS(const std::string &file_name, std::string &err, unsigned int threads)
+    {
+        GDS_STATS_TIMER(STAT_TIME_WRITE_GDS);
+        std::vector<Structure*> cells;
+        SortCells(cells);
+
+        // Rowids of the cells in the database, for copying unchanged cells.
+        std::unordered_map<StringTable::Id, sqlite3_int64> rowids;
+        if (mDBConnection != nullptr)
+        {
+            sqlite3_stmt *stmt;
+            const char *sql = "SELECT rowid, ID FROM cell_table;";
+            int rc = sqlite3_prepare_v2(mDBConnection, sql, (int)strlen(sql), &stmt, 0);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_step(stmt);
+            for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+            {
+                std::string name((const char *)sqlite3_column_text(stmt, 1),
+                                 sqlite3_column_bytes(stmt, 1));
+                StringTable::Id id;
+                if (StringTable::Instance().Find(name, id))
+                    rowids[id] = sqlite3_column_int64(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+            if (rc != SQLITE_DONE)
+            {
+                err = "Failed during fetching cell info from database.\n";
+                return false;
+            }
+        }
+        std::vector<sqlite3_int64> cell_rowids(cells.size(), -1);
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            auto iter = rowids.find(cells[i]->NameId());
+            if (!cells[i]->IsChanged() && iter != rowids.end())
+                cell_rowids[i] = iter->second;
+            else if (cells[i]->IsFiltered())
+            {
+                err = "Cell " + cells[i]->Name() + " was read with a layer filter and can not be written.\n";
+                return false;
+            }
+        }
+
+        std::ofstream out(file_name, std::ios::binary);
+        if (!out.is_open())
+        {
+            err = "Can not open " + file_name + '\n';
+            return false;
+        }
+
+        std::vector<char> buffer;
+        PutShortRecord(buffer, HEADER, Integer_2, mVersion == 0 ? (short)600 : mVersion);
+        short dates[] = {
+            mModYear, mModMonth, mModDay, mModHour, mModMinute, mModSecond,
+            mAccYear, mAccMonth, mAccDay, mAccHour, mAccMinute, mAccSecond
+        };
+        PutShortRecord(buffer, BGNLIB, Integer_2, dates, 12);
+        PutStringRecord(buffer, LIBNAME, mLibName);
+        double units[] = { mDBUnitInUserUnit, mDBUnitInMeter };
+        PutDoubleRecord(buffer, UNITS, units, 2);
+        out.write(buffer.data(), buffer.size());
+
+        // Cells are serialized in batches, so the memory in use is bounded
+        // by the batch instead of the library. The buffers are reused.
+        if (threads == 0)
+            threads = DefaultThreadCount();
+        const size_t batch_size = 16 * threads;
+        std::vector<std::vector<char> > buffers(batch_size);
+        std::vector<char> failed(batch_size);
+        for (size_t start = 0; start < cells.size(); start += batch_size)
+        {
+            size_t count = std::min(batch_size, cells.size() - start);
+            ParallelFor(count, threads, [&](size_t i, unsigned int)
+            {
+                buffers[i].clear();
+                if (cell_rowids[start + i] == -1)
+                    failed[i] = !cells[start + i]->Write(buffers[i]);
+            });
+            for (size_t i = 0; i < count; i++)
+            {
+                if (cell_rowids[start + i] != -1)
+                {
+                    if (StreamCellData(mDBConnection, cell_rowids[start + i], mCellFormat, out, buffer, err))
+                        return false;
+                    continue;
+                }
+                if (failed[i])
+                {
+                    err = "Failed to write cell " + cells[start + i]->Name() + ".\n";
+                    return false;
+                }
+                out.write(buffers[i].data(), buffers[i].size());
+            }
+            if (out.fail())
+            {
+                err = "Failed to write " + file_name + ".\n";
+                return false;
+            }
+        }
+
+        buffer.clear();
+        PutRecord(buffer, ENDLIB);
+        out.write(buffer.data(), buffer.size());
+        out.close();
+        if (out.fail())
+        {
+            err = "Failed to write " + file_name + ".\n";
+            return false;
+        }
+
+        return true;
+    }
+
     //void Library::BuildCellLinks(bool del_dirty_links)
     //{
     //    for (auto cell : mCells)
@@ -25,7 +25,12 @@
 #include <string>
 #include <vector>
 #include <map>
-#include "sqlite/sqlite3.h"
+#include <unordered_map>
+#include "strtable.h"
+#include "gdsio.h"
+#include "census.h"
+#include "stats.h"
+#include <sqlite3.h>
 
 namespace GDS 
 {
@@ -44,20 +49,111 @@ public:
 
     void Init();
 
+    const std::string &LibName() const;
+    void SetLibName(const std::string &name);
+    /*!
+    Get the size of a database unit in user units and in meters.
+    */
+    double DBUnitInUserUnit() const;
+    double DBUnitInMeter() const;
+    void SetUnits(double user_unit, double meter);
+
     size_t Size() const;
     Structure *Get(int index);
-    Structure *Get(std::string name);
-    Structure *Add(std::string name);
-    void Del(std::string name);
+    Structure *Get(const std::string &name);
+    /*!
+    Get a cell by the id of its name in StringTable.
+    */
+    Structure *GetById(StringTable::Id name);
+    Structure *Add(const std::string &name);
+    void Del(const std::string &name);
     //void BuildCellLinks(bool del_dirty_links = false);
     //void CollectLayers(Techfile &tech_file);
+    /*!
+    Set the SQLite settings used by the following OpenDB.
+    The default is StorageProfile::Default(). StorageProfile::ReadMostly()
+    turns on WAL, which stays on in the database and keeps -wal and -shm
+    files next to it while it is open.
+    */
+    void SetStorageProfile(const StorageProfile &profile);
+    /*!
+    Set the layers kept by the following OpenDB and LoadGDS. The elements
+    other than SREF and AREF on the other layers are skipped when the cells
+    are parsed, so the memory and the time follow the kept layers. Cells
+    which lost elements are marked by Structure::IsFiltered(); they are
+    copied from the database by WriteGDS while unchanged, and can not be
+    written otherwise.
+    The default filter keeps every layer.
+    */
+    void SetLayerFilter(const LayerFilter &filter);
     bool OpenDB(const std::string &file_name, std::string &err);
+    /*!
+    Open a database with only a cell and the cells it refers to, directly
+    or not. The references are found by ScanCellReferences before any cell
+    is parsed, so the cost follows the size of the subtree.
+    @param root The name of the top cell of the subtree.
+    */
+    bool OpenDB(const std::string &file_name, const std::string &root, std::string &err);
     void CloseDB();
+    /*!
+    Load a GDSII file into memory without a database. The file is mapped,
+    the cells are located by IndexGDSII, and then parsed on several threads.
+    @param file_name The path of the GDSII file.
+    @param err[out] The error message.
+    @param threads The number of threads, 0 for DefaultThreadCount().
+    */
+    bool LoadGDS(const std::string &file_name, std::string &err, unsigned int threads = 0);
+    /*!
+    Load a GDSII file with known offsets of its cells, such as the ones
+    returned by ReadCellOffsets, instead of locating the cells first.
+    */
+    bool LoadGDS(const std::string &file_name, const std::vector<CellOffset> &index,
+                 std::string &err, unsigned int threads = 0);
+    /*!
+    Write the library to a GDSII file. Cells are serialized in parallel
+    and written with referenced cells before the cells which refer to them.
+    When the library is opened from a database, the cells which are not
+    changed are copied from the database without being serialized.
+    @param file_name The path of the GDSII file.
+    @param err[out] The error message.
+    @param threads The number of threads, 0 for DefaultThreadCount().
+    */
+    bool WriteGDS(const std::string &file_name, std::string &err, unsigned int threads = 0);
+    /*!
+    Count the shapes and vertices of each (layer, datatype) pair under the
+    top cells, the cells which are not referred to by other cells. A cell
+    is counted once for every instance of it, and the extents are mapped
+    to the coordinates of the top cells. The census of each cell itself is
+    kept by Structure::Census(); the cells are counted on several threads.
+    @param census[out] The census.
+    @param err[out] The error message.
+    @param threads The number of threads, 0 for DefaultThreadCount().
+    */
+    bool Census(LayerCensus &census, std::string &err, unsigned int threads = 0);
+    /*!
+    Count the shapes under a cell instead of the top cells.
+    @param root The name of the cell.
+    */
+    bool Census(const std::string &root, LayerCensus &census, std::string &err, unsigned int threads = 0);
+    /*!
+    Get the counters and timers of the library, which are shared by every
+    Library in the process. They are zeros unless the library is built
+    with GDS_ENABLE_STATS; see stats.h.
+    */
+    static StatsReport Stats();
     void Clear();
 
     /*int read(std::ifstream &in, std::string &msg);
     int write(std::ofstream &out, std::string &msg);*/
 private:
+    void SortCells(std::vector<Structure*> &sorted) const;
+    void BuildCensus(const std::vector<Structure*> &roots, LayerCensus &census, unsigned int threads);
+    bool OpenDatabase(const std::string &file_name, const std::string *root, std::string &err);
+    bool LoadSubtree(const std::string &root, std::string &err);
+    bool ReadHeader(const char *data, size_t size, std::string &err);
+    bool LoadCells(const char *data, size_t size, const std::vector<CellOffset> &index,
+                   std::string &err, unsigned int threads);
+
     short           mVersion;
     short           mModYear;
     short           mModMonth;
@@ -74,23 +170,28 @@ private:
     std::string     mLibName;
     double          mDBUnitInMeter;
     double          mDBUnitInUserUnit;
+    short           mCellFormat;    //< CELL_FORMAT of the cell data in the database.
 
     std::vector<Structure*> mCells;
     std::vector<Structure*> mDeletedCells;
-    std::map<std::string, int> _CellMaps;   //< 
+    std::unordered_map<StringTable::Id, Structure*> mCellIndex;   //< Cells indexed by the ids of their names.
 
     sqlite3 *mDBConnection;
+    StorageProfile mStorageProfile;
+    LayerFilter mLayerFilter;
 
 };
 }
 
 extern const char *INFO_TABLE;
 extern const char *CELL_TABLE;
+extern const char *CELL_OFFSET_TABLE;
 extern const char *GDS_VERSION_ID;
 extern const char *MOD_TIME_ID;
 extern const char *ACC_TIME_ID;
 extern const char *LIB_NAME_ID;
 extern const char *UNITS_ID;
+extern const char *CELL_FORMAT_ID;
 extern const char *DATA_COL_NAME;
 
 #endif // LIBRARY_H
@@ -0,0 +1,156 @@
+/*
+ * This file is part of GDSII.
+ *
+ * mapfile.cpp -- The source file which defines the read-only file mapping.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "mapfile.h"
+
+namespace GDS
+{
+
+MappedFile::MappedFile()
+{
+    mData = nullptr;
+    mSize = 0;
+#ifdef _WIN32
+    mFile = INVALID_HANDLE_VALUE;
+    mMapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+const char *MappedFile::Data() const
+{
+    return mData;
+}
+
+size_t MappedFile::Size() const
+{
+    return mSize;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &file_name)
+{
+    Close();
+
+    mFile = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size))
+    {
+        Close();
+        return false;
+    }
+    mSize = (size_t)size.QuadPart;
+    if (mSize == 0)
+        return true;
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+    mData = (const char *)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (mData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        UnmapViewOfFile(mData);
+    if (mMapping != nullptr)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+    mData = nullptr;
+    mSize = 0;
+    mMapping = nullptr;
+    mFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string &file_name)
+{
+    Close();
+
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced.
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    mData = (const char *)data;
+    mSize = (size_t)st.st_size;
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        munmap(const_cast<char *>(mData), mSize);
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of GDSII.
+ *
+ * mapfile.h -- The header file which declare the read-only file mapping.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_MAPFILE_H
+#define GDS_MAPFILE_H
+#include <cstddef>
+#include <string>
+
+namespace GDS {
+
+/*!
+    * \brief Read-only memory mapping of a whole file.
+    *
+    * The pages are loaded by the system when they are touched, so threads
+    * can parse different parts of a large file without reading it into a
+    * buffer first.
+    */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /*!
+    Map a file, unmapping the previous one.
+    @return False if the file can not be opened or mapped.
+    */
+    bool Open(const std::string &file_name);
+    void Close();
+    const char *Data() const;
+    size_t Size() const;
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const char          *mData;
+    size_t              mSize;
+#ifdef _WIN32
+    void                *mFile;
+    void                *mMapping;
+#endif
+};
+
+}
+
+#endif // GDS_MAPFILE_H
@@ -0,0 +1,884 @@
+/*
+ * This file is part of GDSII.
+ *
+ * nets.cpp -- The source file which defines the extraction of the nets of
+ *             connected shapes.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include "nets.h"
+#include "parallel.h"
+#include "structures.h"
+#include "library.h"
+#include "elements.h"
+#include "boundary.h"
+#include "box.h"
+#include "path.h"
+#include "sref.h"
+#include "aref.h"
+#include "transform.h"
+#include "placement.h"
+
+namespace GDS
+{
+
+namespace
+{
+
+const double TILE_SHAPES = 32;          // Shapes per tile on average.
+const long long MAX_TILES = 1 << 20;    // Tiles of a cell at most.
+
+long long Cross(const Point &o, const Point &a, const Point &b)
+{
+    return ((long long)a.X - o.X) * ((long long)b.Y - o.Y) - ((long long)a.Y - o.Y) * ((long long)b.X - o.X);
+}
+
+// Whether p, on the line of a and b, is between them.
+bool Between(const Point &a, const Point &b, const Point &p)
+{
+    return std::min(a.X, b.X) <= p.X && p.X <= std::max(a.X, b.X)
+        && std::min(a.Y, b.Y) <= p.Y && p.Y <= std::max(a.Y, b.Y);
+}
+
+// Whether two closed segments share a point.
+bool SegmentsTouch(const Point &a, const Point &b, const Point &c, const Point &d)
+{
+    long long d1 = Cross(c, d, a);
+    long long d2 = Cross(c, d, b);
+    long long d3 = Cross(a, b, c);
+    long long d4 = Cross(a, b, d);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        return true;
+    return (d1 == 0 && Between(c, d, a)) || (d2 == 0 && Between(c, d, b))
+        || (d3 == 0 && Between(a, b, c)) || (d4 == 0 && Between(a, b, d));
+}
+
+// Whether p is inside a polygon, for a point which is not on its edges.
+bool Inside(const Polygon &polygon, const Point &p)
+{
+    bool inside = false;
+    size_t n = polygon.size();
+    for (size_t i = 0, j = n - 1; i < n; j = i++)
+    {
+        const Point &a = polygon[i];
+        const Point &b = polygon[j];
+        if ((a.Y > p.Y) != (b.Y > p.Y)
+            && (double)p.X < (double)(b.X - a.X) * ((double)p.Y - a.Y) / ((double)b.Y - a.Y) + a.X)
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Whether two shapes share a point. Their bounds touch.
+bool ShapesTouch(const Polygon &a, bool a_rect, const Polygon &b, bool b_rect)
+{
+    if (a_rect && b_rect)
+        return true;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        const Point &p = a[i];
+        const Point &q = a[(i + 1) % a.size()];
+        for (size_t j = 0; j < b.size(); j++)
+        {
+            if (SegmentsTouch(p, q, b[j], b[(j + 1) % b.size()]))
+                return true;
+        }
+    }
+    return Inside(a, b[0]) || Inside(b, a[0]);
+}
+
+bool ShapePolygon(const Element *e, Polygon &polygon)
+{
+    switch (e->Tag())
+    {
+    case BOUNDARY:
+        polygon = static_cast<const Boundary*>(e)->XY();
+        return polygon.size() >= 3;
+    case BOX_BOUNDARY:
+        polygon = static_cast<const Box*>(e)->XY();
+        return polygon.size() >= 3;
+    case PATH:
+        return OutlinePath(static_cast<const Path*>(e), polygon);
+    default:
+        return false;
+    }
+}
+
+bool ShapeLayer(const Element *e, LayerKey &layer)
+{
+    switch (e->Tag())
+    {
+    case BOUNDARY:
+        layer = LayerKey(static_cast<const Boundary*>(e)->Layer(), static_cast<const Boundary*>(e)->DataType());
+        return true;
+    case BOX_BOUNDARY:
+        layer = LayerKey(static_cast<const Box*>(e)->Layer(), static_cast<const Box*>(e)->DataType());
+        return true;
+    case PATH:
+        layer = LayerKey(static_cast<const Path*>(e)->Layer(), static_cast<const Path*>(e)->DataType());
+        return true;
+    default:
+        return false;
+    }
+}
+
+// The placement of an element of a cell, by its index.
+struct Instance : Placement
+{
+    size_t              Element;
+};
+
+// The bounds of a rectangle mapped by a transform, widened by a unit for
+// the rounding of the corners.
+Rect MapRectRounded(const Transform &transform, const Rect &r)
+{
+    return Grow(MapRect(transform, r), 1);
+}
+
+// The range of i in [0, count) with origin + i * pitch in [lo, hi].
+void IndexRange(long long origin, long long pitch, int count, long long lo, long long hi, int &first, int &last)
+{
+    long long a = 0, b = count - 1;
+    if (pitch == 0)
+    {
+        if (origin < lo || origin > hi)
+            b = -1;
+    }
+    else if (pitch > 0)
+    {
+        a = std::max(a, -FloorDiv(origin - lo, pitch));
+        b = std::min(b, FloorDiv(hi - origin, pitch));
+    }
+    else
+    {
+        a = std::max(a, -FloorDiv(hi - origin, pitch));
+        b = std::min(b, FloorDiv(lo - origin, pitch));
+    }
+    first = (int)a;
+    last = (int)b;
+}
+
+/*
+ * Call visit(col, row) for the instances of an array whose bounds touch a
+ * box. Arrays along the axes are solved on each axis; others are scanned.
+ */
+template <typename Visit>
+void ForInstances(const Instance &inst, const Rect &box, Visit visit)
+{
+    if (!Touches(inst.AllBounds, box))
+        return;
+    int col0 = 0, col1 = inst.Cols - 1, row0 = 0, row1 = inst.Rows - 1;
+    const Point &c = inst.ColPitch;
+    const Point &r = inst.RowPitch;
+    const Rect &b = inst.Bounds;
+    if ((c.Y == 0 || inst.Cols == 1) && (r.X == 0 || inst.Rows == 1))
+    {
+        IndexRange(inst.Origin.X, c.X, inst.Cols, box.Left - b.Right, box.Right - b.Left, col0, col1);
+        IndexRange(inst.Origin.Y, r.Y, inst.Rows, box.Bottom - b.Top, box.Top - b.Bottom, row0, row1);
+    }
+    else if ((c.X == 0 || inst.Cols == 1) && (r.Y == 0 || inst.Rows == 1))
+    {
+        IndexRange(inst.Origin.Y, c.Y, inst.Cols, box.Bottom - b.Top, box.Top - b.Bottom, col0, col1);
+        IndexRange(inst.Origin.X, r.X, inst.Rows, box.Left - b.Right, box.Right - b.Left, row0, row1);
+    }
+    for (int row = row0; row <= row1; row++)
+    {
+        for (int col = col0; col <= col1; col++)
+        {
+            if (Touches(Offset(b, ElementOrigin(inst, col, row)), box))
+                visit(col, row);
+        }
+    }
+}
+
+class UnionFind
+{
+public:
+    unsigned int Add()
+    {
+        mParent.push_back((unsigned int)mParent.size());
+        return mParent.back();
+    }
+
+    void Resize(size_t count)
+    {
+        while (mParent.size() < count)
+            Add();
+    }
+
+    size_t Size() const
+    {
+        return mParent.size();
+    }
+
+    unsigned int Find(unsigned int x)
+    {
+        while (mParent[x] != x)
+        {
+            mParent[x] = mParent[mParent[x]];
+            x = mParent[x];
+        }
+        return x;
+    }
+
+    // False if they were joined already.
+    bool Union(unsigned int a, unsigned int b)
+    {
+        a = Find(a);
+        b = Find(b);
+        if (a == b)
+            return false;
+        if (a < b)
+            std::swap(a, b);
+        mParent[a] = b;
+        return true;
+    }
+
+private:
+    std::vector<unsigned int>   mParent;
+};
+
+/*
+ * A shape of a cell. Rectangle tells that it is a rectangle on the axes, which
+ * touches what its bounds touch.
+ */
+struct Shape
+{
+    Rect            Box;
+    unsigned int    Element;
+    int             Layer;      //< The index of the layer among the connected ones.
+    bool            Rectangle;
+};
+
+// A shape of an instance, in the coordinates of the cell which looks at it.
+struct Placed
+{
+    Polygon         Points;
+    Rect            Box;
+    int             Layer;
+    bool            Rectangle;
+    unsigned int    Net;        //< The net in the cell of the instance.
+};
+
+struct NodeKey
+{
+    size_t          Element;
+    int             Col, Row;
+    unsigned int    Net;
+
+    bool operator==(const NodeKey &other) const
+    {
+        return Element == other.Element && Col == other.Col && Row == other.Row && Net == other.Net;
+    }
+};
+
+struct NodeHash
+{
+    size_t operator()(const NodeKey &k) const
+    {
+        size_t h = k.Element * 0x9E3779B97F4A7C15ULL;
+        h ^= ((size_t)(unsigned int)k.Col * 0x85EBCA6BU + (size_t)(unsigned int)k.Row) * 0xC2B2AE35U;
+        return h ^ (h >> 29) ^ ((size_t)k.Net * 0x27D4EB2FU);
+    }
+};
+
+class NetExtractor
+{
+public:
+    NetExtractor(const std::vector<LayerConnection> &connections, std::vector<CellNets> &cells, unsigned int threads)
+        : mCells(cells), mThreads(threads == 0 ? DefaultThreadCount() : threads)
+    {
+        for (auto &c : connections)
+        {
+            mLayers.push_back(c.first);
+            mLayers.push_back(c.second);
+        }
+        std::sort(mLayers.begin(), mLayers.end());
+        mLayers.erase(std::unique(mLayers.begin(), mLayers.end()), mLayers.end());
+        size_t n = mLayers.size();
+        mConnect.assign(n * n, false);
+        for (size_t i = 0; i < n; i++)
+            mConnect[i * n + i] = true;
+        for (auto &c : connections)
+        {
+            size_t a = LayerIndex(c.first);
+            size_t b = LayerIndex(c.second);
+            mConnect[a * n + b] = mConnect[b * n + a] = true;
+        }
+    }
+
+    void Visit(const Structure *cell)
+    {
+        CellInfo &info = mInfo[cell];
+        if (info.State != NEW)
+            return;
+        info.State = VISITING;
+        Library *lib = cell->Parent();
+        bool empty = true;
+        for (size_t i = 0; i < cell->Size(); i++)
+        {
+            const Element *e = cell->Get((int)i);
+            LayerKey key;
+            if (ShapeLayer(e, key))
+            {
+                auto found = std::lower_bound(mLayers.begin(), mLayers.end(), key);
+                Polygon polygon;
+                if (found == mLayers.end() || *found != key || !ShapePolygon(e, polygon))
+                    continue;
+                Shape shape;
+                shape.Box = Bounds(polygon);
+                shape.Element = (unsigned int)i;
+                shape.Layer = (int)(found - mLayers.begin());
+                shape.Rectangle = Box::IsRectangle(polygon);
+                info.Shapes.push_back(shape);
+                continue;
+            }
+            Instance inst;
+            if (!ReadPlacement(e, lib, inst))
+                continue;
+            Visit(inst.Cell);
+            const CellInfo &child = mInfo[inst.Cell];
+            if (child.State != DONE || !child.HasBounds)
+                continue;
+            inst.Element = i;
+            SetInstanceBounds(inst, MapRectRounded(Place(inst, Point(0, 0)), child.Bounds));
+            Extend(info.Bounds, inst.AllBounds, empty);
+            info.Instances.push_back(inst);
+        }
+        for (auto &shape : info.Shapes)
+            Extend(info.Bounds, shape.Box, empty);
+        info.HasBounds = !empty;
+        BuildTiles(info);
+
+        info.Index = mCells.size();
+        mCells.push_back(CellNets());
+        mCells.back().Cell = cell;
+        mCells.back().NetCount = 0;
+        Connect(cell, info);
+        info.State = DONE;
+    }
+
+    void Finish()
+    {
+        for (auto &nets : mCells)
+        {
+            std::sort(nets.Joins.begin(), nets.Joins.end(), [](const NetJoin &a, const NetJoin &b)
+            {
+                return std::tie(a.Element, a.Col, a.Row, a.ChildNet) < std::tie(b.Element, b.Col, b.Row, b.ChildNet);
+            });
+        }
+    }
+
+private:
+    enum STATE
+    {
+        NEW,
+        VISITING,
+        DONE,
+    };
+
+    typedef std::tuple<size_t, int, int, unsigned int> JoinKey;
+    typedef std::vector<std::pair<unsigned int, unsigned int> > NetPairs;
+
+    struct CellInfo
+    {
+        STATE                       State;
+        size_t                      Index;      //< The index of the nets in the result.
+        std::vector<Shape>          Shapes;
+        std::vector<Instance>       Instances;  //< The instances with shapes.
+        bool                        HasBounds;
+        Rect                        Bounds;
+        // The shapes by the tiles they touch.
+        long long                   TileLeft, TileBottom, TileSize;
+        long long                   Cols, Rows;
+        std::vector<unsigned int>   TileStart, TileShapes;
+        std::vector<unsigned int>   Stamps;
+        unsigned int                Stamp;
+        std::map<JoinKey, unsigned int> Joins;
+
+        CellInfo()
+            : State(NEW), Index(0), HasBounds(false), TileLeft(0), TileBottom(0), TileSize(1),
+              Cols(0), Rows(0), Stamp(0)
+        {
+        }
+    };
+
+    struct Context
+    {
+        const Structure    *CellA;
+        bool                ReflectionA;
+        double              MagA, AngleA;
+        const Structure    *CellB;
+        bool                ReflectionB;
+        double              MagB, AngleB;
+        long long           X, Y;
+
+        bool operator<(const Context &o) const
+        {
+            return std::tie(CellA, ReflectionA, MagA, AngleA, CellB, ReflectionB, MagB, AngleB, X, Y)
+                < std::tie(o.CellA, o.ReflectionA, o.MagA, o.AngleA, o.CellB, o.ReflectionB, o.MagB, o.AngleB, o.X, o.Y);
+        }
+    };
+
+    size_t LayerIndex(const LayerKey &key) const
+    {
+        return std::lower_bound(mLayers.begin(), mLayers.end(), key) - mLayers.begin();
+    }
+
+    bool Connects(int a, int b) const
+    {
+        return mConnect[(size_t)a * mLayers.size() + b];
+    }
+
+    void BuildTiles(CellInfo &info)
+    {
+        size_t n = info.Shapes.size();
+        if (n == 0)
+            return;
+        bool empty = true;
+        Rect bounds = { 0, 0, 0, 0 };
+        for (auto &shape : info.Shapes)
+            Extend(bounds, shape.Box, empty);
+        double width = (double)(bounds.Right - bounds.Left) + 1;
+        double height = (double)(bounds.Top - bounds.Bottom) + 1;
+        long long tile = std::max(1LL, (long long)std::ceil(std::sqrt(width * height * TILE_SHAPES / n)));
+        while ((long long)(width / tile + 1) * (long long)(height / tile + 1) > MAX_TILES)
+            tile *= 2;
+        info.TileLeft = bounds.Left;
+        info.TileBottom = bounds.Bottom;
+        info.TileSize = tile;
+        info.Cols = (bounds.Right - bounds.Left) / tile + 1;
+        info.Rows = (bounds.Top - bounds.Bottom) / tile + 1;
+
+        info.TileStart.assign((size_t)(info.Cols * info.Rows + 1), 0);
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                long long c0, c1, r0, r1;
+                TileRange(info, info.Shapes[i].Box, c0, c1, r0, r1);
+                for (long long r = r0; r <= r1; r++)
+                {
+                    for (long long c = c0; c <= c1; c++)
+                    {
+                        size_t t = (size_t)(r * info.Cols + c);
+                        if (pass == 0)
+                            info.TileStart[t + 1]++;
+                        else
+                            info.TileShapes[info.TileStart[t]++] = (unsigned int)i;
+                    }
+                }
+            }
+            if (pass == 0)
+            {
+                for (size_t t = 1; t < info.TileStart.size(); t++)
+                    info.TileStart[t] += info.TileStart[t - 1];
+                info.TileShapes.resize(info.TileStart.back());
+            }
+            else
+            {
+                // Each start was moved to the next one.
+                for (size_t t = info.TileStart.size() - 1; t > 0; t--)
+                    info.TileStart[t] = info.TileStart[t - 1];
+                info.TileStart[0] = 0;
+            }
+        }
+        info.Stamps.assign(n, 0);
+    }
+
+    void TileRange(const CellInfo &info, const Rect &box, long long &c0, long long &c1, long long &r0, long long &r1) const
+    {
+        c0 = std::max(0LL, FloorDiv(box.Left - info.TileLeft, info.TileSize));
+        c1 = std::min(info.Cols - 1, FloorDiv(box.Right - info.TileLeft, info.TileSize));
+        r0 = std::max(0LL, FloorDiv(box.Bottom - info.TileBottom, info.TileSize));
+        r1 = std::min(info.Rows - 1, FloorDiv(box.Top - info.TileBottom, info.TileSize));
+    }
+
+    // Call visit(index) once for each shape of a cell whose bounds touch a box.
+    template <typename VisitShape>
+    void ForShapes(CellInfo &info, const Rect &box, VisitShape visit)
+    {
+        if (info.Shapes.empty())
+            return;
+        if (++info.Stamp == 0)
+        {
+            std::fill(info.Stamps.begin(), info.Stamps.end(), 0);
+            info.Stamp = 1;
+        }
+        long long c0, c1, r0, r1;
+        TileRange(info, box, c0, c1, r0, r1);
+        for (long long r = r0; r <= r1; r++)
+        {
+            for (long long c = c0; c <= c1; c++)
+            {
+                size_t t = (size_t)(r * info.Cols + c);
+                for (unsigned int k = info.TileStart[t]; k < info.TileStart[t + 1]; k++)
+                {
+                    unsigned int i = info.TileShapes[k];
+                    if (info.Stamps[i] == info.Stamp || !Touches(info.Shapes[i].Box, box))
+                        continue;
+                    info.Stamps[i] = info.Stamp;
+                    visit(i);
+                }
+            }
+        }
+    }
+
+    /*
+    Connect the shapes of a cell tile by tile. A pair is checked in the
+    tile of the lower left corner of the overlap of their bounds; each tile
+    keeps the unions which joined two of its groups.
+    */
+    void ConnectShapes(const Structure *cell, CellInfo &info, UnionFind &nodes)
+    {
+        if (info.Shapes.size() < 2)
+            return;
+        std::vector<NetPairs> unions(mThreads);
+        ParallelFor((size_t)(info.Cols * info.Rows), mThreads, [&](size_t t, unsigned int thread)
+        {
+            unsigned int begin = info.TileStart[t];
+            unsigned int end = info.TileStart[t + 1];
+            if (end - begin < 2)
+                return;
+            std::vector<unsigned int> order(info.TileShapes.begin() + begin, info.TileShapes.begin() + end);
+            std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+            {
+                return info.Shapes[a].Box.Left < info.Shapes[b].Box.Left;
+            });
+            UnionFind groups;
+            groups.Resize(order.size());
+            Polygon pa, pb;
+            long long col = (long long)t % info.Cols;
+            long long row = (long long)t / info.Cols;
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                const Shape &a = info.Shapes[order[i]];
+                bool has_a = false;
+                for (size_t j = i + 1; j < order.size() && info.Shapes[order[j]].Box.Left <= a.Box.Right; j++)
+                {
+                    const Shape &b = info.Shapes[order[j]];
+                    if (!Touches(a.Box, b.Box) || !Connects(a.Layer, b.Layer)
+                        || FloorDiv(std::max(a.Box.Left, b.Box.Left) - info.TileLeft, info.TileSize) != col
+                        || FloorDiv(std::max(a.Box.Bottom, b.Box.Bottom) - info.TileBottom, info.TileSize) != row
+                        || groups.Find((unsigned int)i) == groups.Find((unsigned int)j))
+                        continue;
+                    if (!(a.Rectangle && b.Rectangle))
+                    {
+                        if (!has_a)
+                            ShapePolygon(cell->Get(a.Element), pa);
+                        has_a = true;
+                        ShapePolygon(cell->Get(b.Element), pb);
+                        if (!ShapesTouch(pa, a.Rectangle, pb, b.Rectangle))
+                            continue;
+                    }
+                    groups.Union((unsigned int)i, (unsigned int)j);
+                    unions[thread].push_back(std::make_pair(order[i], order[j]));
+                }
+            }
+        });
+        for (auto &list : unions)
+        {
+            for (auto &u : list)
+                nodes.Union(u.first, u.second);
+        }
+    }
+
+    /*
+    Get the shapes of a cell and of the cells under it which touch a box,
+    with their nets in the cell.
+    @param to_target Maps the cell to the coordinates of the result.
+    @param box The box in the coordinates of the cell.
+    */
+    void Gather(const Structure *cell, const Transform &to_target, const Rect &box, std::vector<Placed> &out)
+    {
+        CellInfo &info = mInfo[cell];
+        const CellNets &nets = mCells[info.Index];
+        ForShapes(info, box, [&](unsigned int i)
+        {
+            const Shape &shape = info.Shapes[i];
+            Placed placed;
+            ShapePolygon(cell->Get(shape.Element), placed.Points);
+            for (auto &p : placed.Points)
+                p = to_target.Map(p);
+            placed.Box = Bounds(placed.Points);
+            placed.Layer = shape.Layer;
+            placed.Rectangle = Box::IsRectangle(placed.Points);
+            placed.Net = (unsigned int)nets.ShapeNets[shape.Element];
+            out.push_back(std::move(placed));
+        });
+        for (size_t k = 0; k < info.Instances.size(); k++)
+        {
+            const Instance &inst = info.Instances[k];
+            ForInstances(inst, box, [&](int col, int row)
+            {
+                Point origin = ElementOrigin(inst, col, row);
+                Transform placement = Place(inst, origin);
+                placement.Multiply(to_target);
+                size_t first = out.size();
+                Gather(inst.Cell, placement, MapRectRounded(Inverse(inst, origin), box), out);
+                for (size_t i = first; i < out.size(); i++)
+                    out[i].Net = NetOf(info, inst.Element, col, row, out[i].Net);
+            });
+        }
+    }
+
+    /*
+    The net of a cell which a net of an instance is part of. A net which
+    connects to nothing in the cell becomes a net of the cell here.
+    */
+    unsigned int NetOf(CellInfo &info, size_t element, int col, int row, unsigned int child_net)
+    {
+        JoinKey key(element, col, row, child_net);
+        auto found = info.Joins.find(key);
+        if (found != info.Joins.end())
+            return found->second;
+        CellNets &nets = mCells[info.Index];
+        NetJoin join = { element, col, row, child_net, nets.NetCount++ };
+        nets.Joins.push_back(join);
+        info.Joins[key] = join.Net;
+        return join.Net;
+    }
+
+    // The pairs of nets which connect between two instances.
+    const NetPairs &Connections(const Instance &a, const Point &oa, const Instance &b, const Point &ob)
+    {
+        Context key = { a.Cell, a.Reflection, a.Mag, a.Angle, b.Cell, b.Reflection, b.Mag, b.Angle,
+                        (long long)ob.X - oa.X, (long long)ob.Y - oa.Y };
+        auto found = mContexts.find(key);
+        if (found != mContexts.end())
+            return found->second;
+
+        NetPairs &pairs = mContexts[key];
+        Rect region = Intersect(Offset(a.Bounds, oa), Offset(b.Bounds, ob));
+        std::vector<Placed> sa, sb;
+        Gather(a.Cell, Place(a, oa), MapRectRounded(Inverse(a, oa), region), sa);
+        if (sa.empty())
+            return pairs;
+        Gather(b.Cell, Place(b, ob), MapRectRounded(Inverse(b, ob), region), sb);
+        for (auto &pa : sa)
+        {
+            for (auto &pb : sb)
+            {
+                if (Connects(pa.Layer, pb.Layer) && Touches(pa.Box, pb.Box)
+                    && ShapesTouch(pa.Points, pa.Rectangle, pb.Points, pb.Rectangle))
+                    pairs.push_back(std::make_pair(pa.Net, pb.Net));
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        return pairs;
+    }
+
+    unsigned int Node(UnionFind &nodes, size_t element, int col, int row, unsigned int net)
+    {
+        NodeKey key = { element, col, row, net };
+        auto found = mNodes.find(key);
+        if (found != mNodes.end())
+            return found->second;
+        unsigned int node = nodes.Add();
+        mNodes[key] = node;
+        mNodeKeys.push_back(key);
+        return node;
+    }
+
+    void Connect(const Structure *cell, CellInfo &info)
+    {
+        UnionFind nodes;
+        nodes.Resize(info.Shapes.size());
+        mNodes.clear();
+        mNodeKeys.clear();
+        ConnectShapes(cell, info, nodes);
+
+        // The shapes of the cell against the instances they touch.
+        std::vector<Placed> placed;
+        Polygon polygon;
+        for (auto &inst : info.Instances)
+        {
+            ForShapes(info, inst.AllBounds, [&](unsigned int i)
+            {
+                const Shape &shape = info.Shapes[i];
+                bool has_polygon = false;
+                ForInstances(inst, shape.Box, [&](int col, int row)
+                {
+                    Point origin = ElementOrigin(inst, col, row);
+                    placed.clear();
+                    Gather(inst.Cell, Place(inst, origin), MapRectRounded(Inverse(inst, origin), shape.Box), placed);
+                    for (auto &p : placed)
+                    {
+                        if (!Connects(shape.Layer, p.Layer) || !Touches(shape.Box, p.Box))
+                            continue;
+                        unsigned int node = Node(nodes, inst.Element, col, row, p.Net);
+                        if (nodes.Find(node) == nodes.Find(i))
+                            continue;
+                        if (!has_polygon)
+                            ShapePolygon(cell->Get(shape.Element), polygon);
+                        has_polygon = true;
+                        if (ShapesTouch(polygon, shape.Rectangle, p.Points, p.Rectangle))
+                            nodes.Union(node, i);
+                    }
+                });
+            });
+        }
+
+        // The instances against each other: the neighbours in each array,
+        // once for each offset, then the instances of different elements.
+        for (size_t k = 0; k < info.Instances.size(); k++)
+        {
+            const Instance &inst = info.Instances[k];
+            for (int dr = 0; dr < inst.Rows; dr++)
+            {
+                for (int dc = dr == 0 ? 1 : 1 - inst.Cols; dc < inst.Cols; dc++)
+                {
+                    Point offset(inst.ColPitch.X * dc + inst.RowPitch.X * dr, inst.ColPitch.Y * dc + inst.RowPitch.Y * dr);
+                    if (!Touches(inst.Bounds, Offset(inst.Bounds, offset)))
+                        continue;
+                    int col0 = std::max(0, -dc);
+                    int col1 = std::min(inst.Cols, inst.Cols - dc);
+                    const NetPairs &pairs = Connections(inst, ElementOrigin(inst, col0, 0), inst, ElementOrigin(inst, col0 + dc, dr));
+                    for (int row = 0; pairs.size() > 0 && row + dr < inst.Rows; row++)
+                    {
+                        for (int col = col0; col < col1; col++)
+                        {
+                            for (auto &pair : pairs)
+                                nodes.Union(Node(nodes, inst.Element, col, row, pair.first),
+                                            Node(nodes, inst.Element, col + dc, row + dr, pair.second));
+                        }
+                    }
+                }
+            }
+            for (size_t j = k + 1; j < info.Instances.size(); j++)
+            {
+                const Instance &other = info.Instances[j];
+                ForInstances(inst, other.AllBounds, [&](int col, int row)
+                {
+                    Point oa = ElementOrigin(inst, col, row);
+                    ForInstances(other, Offset(inst.Bounds, oa), [&](int other_col, int other_row)
+                    {
+                        Point ob = ElementOrigin(other, other_col, other_row);
+                        for (auto &pair : Connections(inst, oa, other, ob))
+                            nodes.Union(Node(nodes, inst.Element, col, row, pair.first),
+                                        Node(nodes, other.Element, other_col, other_row, pair.second));
+                    });
+                });
+            }
+        }
+
+        // A group is a net of the cell when it has a shape of the cell or
+        // joins nets of two instances.
+        CellNets &nets = mCells[info.Index];
+        std::vector<unsigned int> members(nodes.Size(), 0);
+        std::vector<int> ids(nodes.Size(), -1);
+        for (size_t i = 0; i < info.Shapes.size(); i++)
+            members[nodes.Find((unsigned int)i)] += 2;
+        for (size_t i = info.Shapes.size(); i < nodes.Size(); i++)
+            members[nodes.Find((unsigned int)i)]++;
+        nets.ShapeNets.assign(cell->Size(), -1);
+        for (size_t i = 0; i < nodes.Size(); i++)
+        {
+            unsigned int root = nodes.Find((unsigned int)i);
+            if (members[root] < 2)
+                continue;
+            if (ids[root] < 0)
+                ids[root] = (int)nets.NetCount++;
+            if (i < info.Shapes.size())
+            {
+                nets.ShapeNets[info.Shapes[i].Element] = ids[root];
+                continue;
+            }
+            const NodeKey &key = mNodeKeys[i - info.Shapes.size()];
+            NetJoin join = { key.Element, key.Col, key.Row, key.Net, (unsigned int)ids[root] };
+            nets.Joins.push_back(join);
+            info.Joins[JoinKey(join.Element, join.Col, join.Row, join.ChildNet)] = join.Net;
+        }
+    }
+
+    std::vector<LayerKey>                   mLayers;    //< The connected layers, sorted.
+    std::vector<bool>                       mConnect;   //< Whether two layers connect, by their indices.
+    std::vector<CellNets>                  &mCells;
+    unsigned int                            mThreads;
+    std::map<const Structure*, CellInfo>    mInfo;
+    std::map<Context, NetPairs>             mContexts;
+    std::unordered_map<NodeKey, unsigned int, NodeHash> mNodes;     //< The nodes of the instances in the current cell.
+    std::vector<NodeKey>                    mNodeKeys;
+};
+
+void CollectCellNet(const Structure *cell, const std::map<const Structure*, const CellNets*> &found,
+                    unsigned int net, const Transform *transform, std::vector<Polygon> &polygons,
+                    std::vector<LayerKey> *layers)
+{
+    auto it = found.find(cell);
+    if (it == found.end())
+        return;
+    const CellNets &nets = *it->second;
+    for (size_t i = 0; i < nets.ShapeNets.size() && i < cell->Size(); i++)
+    {
+        if (nets.ShapeNets[i] != (int)net)
+            continue;
+        const Element *e = cell->Get((int)i);
+        polygons.push_back(Polygon());
+        ShapePolygon(e, polygons.back());
+        if (transform != nullptr)
+        {
+            for (auto &p : polygons.back())
+                p = transform->Map(p);
+        }
+        if (layers != nullptr)
+        {
+            LayerKey key;
+            ShapeLayer(e, key);
+            layers->push_back(key);
+        }
+    }
+    for (auto &join : nets.Joins)
+    {
+        Instance inst;
+        if (join.Net != net || join.Element >= cell->Size()
+            || !ReadPlacement(cell->Get((int)join.Element), cell->Parent(), inst))
+            continue;
+        Transform placement = Place(inst, ElementOrigin(inst, join.Col, join.Row));
+        if (transform != nullptr)
+            placement.Multiply(*transform);
+        CollectCellNet(inst.Cell, found, join.ChildNet, &placement, polygons, layers);
+    }
+}
+
+}
+
+void ExtractNets(const Structure *root, const std::vector<LayerConnection> &connections,
+                 std::vector<CellNets> &cells, unsigned int threads)
+{
+    cells.clear();
+    NetExtractor extractor(connections, cells, threads);
+    extractor.Visit(root);
+    extractor.Finish();
+}
+
+void CollectNet(const Structure *cell, const std::vector<CellNets> &cells, unsigned int net,
+                std::vector<Polygon> &polygons, std::vector<LayerKey> *layers)
+{
+    std::map<const Structure*, const CellNets*> found;
+    for (auto &nets : cells)
+        found[nets.Cell] = &nets;
+    CollectCellNet(cell, found, net, nullptr, polygons, layers);
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+ * This file is part of GDSII.
+ *
+ * nets.h -- The header file which declare the extraction of the nets of
+ *           connected shapes.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_NETS_H
+#define GDS_NETS_H
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "census.h"
+#include "outline.h"
+
+namespace GDS {
+class Structure;
+
+/*!
+ * Two layers whose shapes connect where they touch, like a metal and a via.
+ */
+typedef std::pair<LayerKey, LayerKey> LayerConnection;
+
+/*!
+ * \brief A net of an instance which is part of a net of the cell.
+ */
+struct NetJoin
+{
+    size_t          Element;    //< The index of the SREF or AREF in the cell.
+    int             Col, Row;   //< The instance of an AREF; 0 for an SREF.
+    unsigned int    ChildNet;   //< The net in the cell of the instance.
+    unsigned int    Net;        //< The net in the cell.
+};
+
+/*!
+ * \brief The nets of a cell.
+ *
+ * A net is made of shapes of the cell and of nets of its instances. A net
+ * of an instance which connects to nothing in the cell is not listed; it
+ * is a net on its own, named by the instance and its net there.
+ */
+struct CellNets
+{
+    const Structure        *Cell;
+    unsigned int            NetCount;
+    std::vector<int>        ShapeNets;  //< The net of each element, or -1 if it is not a shape on the layers.
+    std::vector<NetJoin>    Joins;      //< Sorted by element, col, row and child net.
+};
+
+/*
+ * Shapes connect where they touch or overlap, a shared corner included:
+ * two shapes of one layer, or of two layers in a connection. A Boundary
+ * or Box is taken as it is and a Path as its outline from OutlinePath.
+ *
+ * Each cell is visited once, children first. The shapes of the cell are
+ * put into tiles, and the pairs of shapes in each tile which may connect,
+ * by their extents, are checked on several threads. Each tile keeps the
+ * unions which joined two groups and the unions of the tiles are merged
+ * into the nets of the cell. Then the shapes of the cell are connected to
+ * the instances they touch and the instances to each other, by the
+ * shapes of the instances near the place where they meet, which carry the
+ * nets of their cells. Two instances are checked once for each pair of
+ * cells, orientations and offset between them, so the neighbours of an
+ * array are checked once for each neighbour offset. The nets of a cell
+ * are the same in each of its instances, so shapes of an instance turned
+ * off the axes which only touch after their corners are rounded are not
+ * connected.
+ *
+ * The shapes of each cell are kept once, not the flat shapes, so the
+ * memory grows with the shapes of the cells and the nets which cross
+ * instances rather than with the flat design.
+ */
+
+/*!
+ * Extract the nets of a cell and of the cells under it.
+ * @param connections The connected layers. A layer in no connection is ignored.
+ * @param cells[out] The nets of the cells, each cell before the cells
+ *                   which refer to it.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ */
+void ExtractNets(const Structure *root, const std::vector<LayerConnection> &connections,
+                 std::vector<CellNets> &cells, unsigned int threads = 0);
+
+/*!
+ * Get the shapes of a net of a cell, through its instances, in the
+ * coordinates of the cell.
+ * @param polygons[out] The shapes are appended.
+ * @param layers[out] The (layer, datatype) of each shape is appended, if
+ *                    it is not null.
+ */
+void CollectNet(const Structure *cell, const std::vector<CellNets> &cells, unsigned int net,
+                std::vector<Polygon> &polygons, std::vector<LayerKey> *layers = nullptr);
+
+}
+
+#endif // GDS_NETS_H
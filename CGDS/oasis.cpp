@@ -0,0 +1,1946 @@
+/*
+ * This file is part of GDSII.
+ *
+ * oasis.cpp -- The source file which defines the reader and writer of OASIS.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#ifdef GDS_USE_ZLIB
+#include <zlib.h>
+#endif
+#include "oasis.h"
+#include "gdsio.h"
+#include "library.h"
+#include "structures.h"
+#include "boundary.h"
+#include "box.h"
+#include "path.h"
+#include "sref.h"
+#include "aref.h"
+#include "outline.h"
+#include "parallel.h"
+
+namespace
+{
+
+using namespace GDS;
+
+const char OASIS_MAGIC[] = "%SEMI-OASIS\r\n";
+const size_t OASIS_MAGIC_SIZE = 13;
+const size_t END_RECORD_SIZE = 256;
+const char *S_CELL_OFFSET = "S_CELL_OFFSET";
+const int CIRCLE_VERTICES = 64;
+
+enum OASIS_RECORD
+{
+    OAS_PAD                 = 0,
+    OAS_START               = 1,
+    OAS_END                 = 2,
+    OAS_CELLNAME            = 3,
+    OAS_CELLNAME_REF        = 4,
+    OAS_TEXTSTRING          = 5,
+    OAS_TEXTSTRING_REF      = 6,
+    OAS_PROPNAME            = 7,
+    OAS_PROPNAME_REF        = 8,
+    OAS_PROPSTRING          = 9,
+    OAS_PROPSTRING_REF      = 10,
+    OAS_LAYERNAME           = 11,
+    OAS_LAYERNAME_TEXT      = 12,
+    OAS_CELL_REF            = 13,
+    OAS_CELL                = 14,
+    OAS_XYABSOLUTE          = 15,
+    OAS_XYRELATIVE          = 16,
+    OAS_PLACEMENT           = 17,
+    OAS_PLACEMENT_TRANSFORM = 18,
+    OAS_TEXT                = 19,
+    OAS_RECTANGLE           = 20,
+    OAS_POLYGON             = 21,
+    OAS_PATH                = 22,
+    OAS_TRAPEZOID           = 23,
+    OAS_TRAPEZOID_A         = 24,
+    OAS_TRAPEZOID_B         = 25,
+    OAS_CTRAPEZOID          = 26,
+    OAS_CIRCLE              = 27,
+    OAS_PROPERTY            = 28,
+    OAS_PROPERTY_REPEAT     = 29,
+    OAS_XNAME               = 30,
+    OAS_XNAME_REF           = 31,
+    OAS_XELEMENT            = 32,
+    OAS_XGEOMETRY           = 33,
+    OAS_CBLOCK              = 34,
+};
+
+// Directions of the octangular deltas: E, N, W, S, NE, NW, SW, SE.
+const int OCT_DX[] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+const int OCT_DY[] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+// Vertices of the CTRAPEZOID types: x = xw * w + xh * h, y = yw * w + yh * h.
+struct CTrapezoidVertex
+{
+    signed char xw, xh, yw, yh;
+};
+const CTrapezoidVertex CTRAPEZOIDS[26][4] = {
+    { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 1, -1, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 1, -1, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 1, 0, 1 }, { 1, 0, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 1, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 1, 0, 1 }, { 1, -1, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 1, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 1, -1, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 1, 0, 1 }, { 1, 0, 0, 1 }, { 1, -1, 0, 0 } },
+    { { 0, 1, 0, 0 }, { 0, 0, 0, 1 }, { 1, -1, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, -1, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, -1, 1 }, { 1, 0, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 1, 0, 1, 0 } },
+    { { 0, 0, 1, 0 }, { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, -1, 1 }, { 1, 0, 1, 0 } },
+    { { 0, 0, 1, 0 }, { 0, 0, -1, 1 }, { 1, 0, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, -1, 1 }, { 1, 0, 0, 1 }, { 1, 0, 1, 0 } },
+    { { 0, 0, 1, 0 }, { 0, 0, 0, 1 }, { 1, 0, -1, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 1, 0 }, { 1, 0, 0, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 1, 0 }, { 1, 0, 1, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 1, 0, 1, 0 }, { 1, 0, 0, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 1, 0 }, { 1, 0, 1, 0 }, { 1, 0, 0, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 1, 0, 1 }, { 0, 2, 0, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 0, 1 }, { 0, 2, 0, 1 }, { 0, 1, 0, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 2, 0 }, { 1, 0, 1, 0 }, { 0, 0, 0, 0 } },
+    { { 1, 0, 0, 0 }, { 0, 0, 1, 0 }, { 1, 0, 2, 0 }, { 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 1, 0, 0, 0 } },
+    { { 0, 0, 0, 0 }, { 0, 0, 1, 0 }, { 1, 0, 1, 0 }, { 1, 0, 0, 0 } },
+};
+
+// Reading of the basic OASIS data types from a memory buffer.
+struct Cursor
+{
+    const unsigned char *p;
+    const unsigned char *end;
+
+    Cursor(const unsigned char *begin, const unsigned char *e) : p(begin), end(e) {}
+
+    bool Byte(unsigned char &v)
+    {
+        if (p >= end)
+            return false;
+        v = *p++;
+        return true;
+    }
+
+    bool UInt(unsigned long long &v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (p >= end)
+                return false;
+            unsigned char b = *p++;
+            v |= (unsigned long long)(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool SInt(long long &v)
+    {
+        unsigned long long u;
+        if (!UInt(u))
+            return false;
+        v = (u & 1) ? -(long long)(u >> 1) : (long long)(u >> 1);
+        return true;
+    }
+
+    bool RealOfType(unsigned long long type, double &v)
+    {
+        unsigned long long a, b;
+        switch (type)
+        {
+        case 0:
+        case 1:
+            if (!UInt(a))
+                return false;
+            v = (double)a;
+            break;
+        case 2:
+        case 3:
+            if (!UInt(a) || a == 0)
+                return false;
+            v = 1.0 / a;
+            break;
+        case 4:
+        case 5:
+            if (!UInt(a) || !UInt(b) || b == 0)
+                return false;
+            v = (double)a / b;
+            break;
+        case 6:
+        {
+            if (end - p < 4)
+                return false;
+            unsigned int bits = 0;
+            for (int i = 3; i >= 0; i--)
+                bits = (bits << 8) | p[i];
+            float f;
+            memcpy(&f, &bits, 4);
+            v = f;
+            p += 4;
+            return true;
+        }
+        case 7:
+        {
+            if (end - p < 8)
+                return false;
+            unsigned long long bits = 0;
+            for (int i = 7; i >= 0; i--)
+                bits = (bits << 8) | p[i];
+            memcpy(&v, &bits, 8);
+            p += 8;
+            return true;
+        }
+        default:
+            return false;
+        }
+        if (type == 1 || type == 3 || type == 5)
+            v = -v;
+        return true;
+    }
+
+    bool Real(double &v)
+    {
+        unsigned long long type;
+        return UInt(type) && RealOfType(type, v);
+    }
+
+    bool String(std::string &s)
+    {
+        unsigned long long size;
+        if (!UInt(size) || size > (unsigned long long)(end - p))
+            return false;
+        s.assign((const char *)p, (size_t)size);
+        p += size;
+        return true;
+    }
+
+    bool SkipString()
+    {
+        unsigned long long size;
+        if (!UInt(size) || size > (unsigned long long)(end - p))
+            return false;
+        p += size;
+        return true;
+    }
+};
+
+bool ReadGDelta(Cursor &c, long long &x, long long &y)
+{
+    unsigned long long v;
+    if (!c.UInt(v))
+        return false;
+    if ((v & 1) == 0)
+    {
+        long long m = (long long)(v >> 4);
+        x = OCT_DX[(v >> 1) & 7] * m;
+        y = OCT_DY[(v >> 1) & 7] * m;
+        return true;
+    }
+    x = (v & 2) ? -(long long)(v >> 2) : (long long)(v >> 2);
+    return c.SInt(y);
+}
+
+// Read a point-list. The points are relative to the first one, which is (0, 0).
+bool ReadPointList(Cursor &c, bool polygon, std::vector<Point> &pts)
+{
+    unsigned long long type, n;
+    if (!c.UInt(type) || !c.UInt(n) || n > (unsigned long long)(c.end - c.p))
+        return false;
+
+    pts.clear();
+    pts.reserve((size_t)n + 2);
+    pts.push_back(Point(0, 0));
+    long long x = 0, y = 0, dx = 0, dy = 0;
+    for (unsigned long long i = 0; i < n; i++)
+    {
+        long long gx, gy;
+        unsigned long long v;
+        switch (type)
+        {
+        case 0:
+        case 1:
+        {
+            long long d;
+            if (!c.SInt(d))
+                return false;
+            if ((i % 2 == 0) == (type == 0))
+                x += d;
+            else
+                y += d;
+            break;
+        }
+        case 2:
+            if (!c.UInt(v))
+                return false;
+            x += OCT_DX[v & 3] * (long long)(v >> 2);
+            y += OCT_DY[v & 3] * (long long)(v >> 2);
+            break;
+        case 3:
+            if (!c.UInt(v))
+                return false;
+            x += OCT_DX[v & 7] * (long long)(v >> 3);
+            y += OCT_DY[v & 7] * (long long)(v >> 3);
+            break;
+        case 4:
+            if (!ReadGDelta(c, gx, gy))
+                return false;
+            x += gx;
+            y += gy;
+            break;
+        case 5:
+            if (!ReadGDelta(c, gx, gy))
+                return false;
+            dx += gx;
+            dy += gy;
+            x += dx;
+            y += dy;
+            break;
+        default:
+            return false;
+        }
+        pts.push_back(Point((int)x, (int)y));
+    }
+    if (polygon && (type == 0 || type == 1))
+    {
+        // The implicit vertex which closes a Manhattan polygon.
+        if ((n % 2 == 0) == (type == 0))
+            pts.push_back(Point(0, (int)y));
+        else
+            pts.push_back(Point((int)x, 0));
+    }
+    return true;
+}
+
+struct Repetition
+{
+    bool Lattice;                   //< Cols x Rows copies at multiples of the two steps.
+    long long Cols, Rows;
+    long long ColX, ColY, RowX, RowY;
+    std::vector<Point> Offsets;     //< Offsets of the copies otherwise, starting with (0, 0).
+
+    Repetition() : Lattice(true), Cols(1), Rows(1), ColX(0), ColY(0), RowX(0), RowY(0) {}
+};
+
+bool ReadRepetition(Cursor &c, Repetition &rep)
+{
+    unsigned long long type;
+    if (!c.UInt(type))
+        return false;
+    // Type 0 reuses the previous repetition.
+    if (type == 0)
+        return true;
+
+    rep = Repetition();
+    unsigned long long n, m, a, b, grid = 1;
+    long long x, y;
+    switch (type)
+    {
+    case 1:
+        if (!c.UInt(n) || !c.UInt(m) || !c.UInt(a) || !c.UInt(b))
+            return false;
+        rep.Cols = n + 2;
+        rep.Rows = m + 2;
+        rep.ColX = a;
+        rep.RowY = b;
+        return true;
+    case 2:
+        if (!c.UInt(n) || !c.UInt(a))
+            return false;
+        rep.Cols = n + 2;
+        rep.ColX = a;
+        return true;
+    case 3:
+        if (!c.UInt(n) || !c.UInt(b))
+            return false;
+        rep.Rows = n + 2;
+        rep.RowY = b;
+        return true;
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+    {
+        if (!c.UInt(n) || (type % 2 == 1 && !c.UInt(grid)))
+            return false;
+        if (n > (unsigned long long)(c.end - c.p))
+            return false;
+        rep.Lattice = false;
+        rep.Offsets.push_back(Point(0, 0));
+        long long pos = 0;
+        for (unsigned long long i = 0; i <= n; i++)
+        {
+            if (!c.UInt(a))
+                return false;
+            pos += a * grid;
+            rep.Offsets.push_back(type < 6 ? Point((int)pos, 0) : Point(0, (int)pos));
+        }
+        return true;
+    }
+    case 8:
+        if (!c.UInt(n) || !c.UInt(m) || !ReadGDelta(c, rep.ColX, rep.ColY)
+            || !ReadGDelta(c, rep.RowX, rep.RowY))
+            return false;
+        rep.Cols = n + 2;
+        rep.Rows = m + 2;
+        return true;
+    case 9:
+        if (!c.UInt(n) || !ReadGDelta(c, rep.ColX, rep.ColY))
+            return false;
+        rep.Cols = n + 2;
+        return true;
+    case 10:
+    case 11:
+    {
+        if (!c.UInt(n) || (type == 11 && !c.UInt(grid)))
+            return false;
+        if (n > (unsigned long long)(c.end - c.p))
+            return false;
+        rep.Lattice = false;
+        rep.Offsets.push_back(Point(0, 0));
+        long long px = 0, py = 0;
+        for (unsigned long long i = 0; i <= n; i++)
+        {
+            if (!ReadGDelta(c, x, y))
+                return false;
+            px += x * (long long)grid;
+            py += y * (long long)grid;
+            rep.Offsets.push_back(Point((int)px, (int)py));
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// The modal variables, which are reset at each CELL.
+struct Modal
+{
+    bool                XYRelative;
+    long long           GeometryX, GeometryY;
+    long long           PlacementX, PlacementY;
+    long long           TextX, TextY;
+    unsigned long long  Layer, DataType;
+    unsigned long long  GeometryW, GeometryH;
+    std::vector<Point>  PolygonPts, PathPts;
+    unsigned long long  HalfWidth;
+    long long           StartExtension, EndExtension;
+    unsigned long long  CTrapezoidType;
+    unsigned long long  CircleRadius;
+    StringTable::Id     PlacementCell;
+    Repetition          Rep;
+    std::string         PropName;
+
+    void Reset()
+    {
+        XYRelative = false;
+        GeometryX = GeometryY = 0;
+        PlacementX = PlacementY = 0;
+        TextX = TextY = 0;
+        Layer = DataType = 0;
+        GeometryW = GeometryH = 0;
+        PolygonPts.clear();
+        PathPts.clear();
+        HalfWidth = 0;
+        StartExtension = EndExtension = 0;
+        CTrapezoidType = 0;
+        CircleRadius = 0;
+        PlacementCell = StringTable::EMPTY;
+        Rep = Repetition();
+        PropName.clear();
+    }
+};
+
+class OasisReader
+{
+public:
+    OasisReader(Library &lib) : mLib(lib) {}
+
+    int Read(const std::string &file_name, const std::vector<std::string> *cells, std::string &err);
+
+private:
+    bool ParseRecords(Cursor &c);
+    bool ParseCell(Cursor &c, unsigned long long id);
+    bool ParsePlacement(Cursor &c, unsigned long long id);
+    bool ParseText(Cursor &c);
+    bool ParseRectangle(Cursor &c);
+    bool ParsePolygon(Cursor &c);
+    bool ParsePath(Cursor &c);
+    bool ParseTrapezoid(Cursor &c, unsigned long long id);
+    bool ParseCTrapezoid(Cursor &c);
+    bool ParseCircle(Cursor &c);
+    bool ParseProperty(Cursor &c);
+    bool ParseXGeometry(Cursor &c);
+    bool ParseCBlock(Cursor &c);
+
+    bool ReadLayer(Cursor &c, unsigned char info);
+    bool ReadXY(Cursor &c, bool has_x, bool has_y, long long &x, long long &y);
+    bool ReadRep(Cursor &c, bool has_rep, const Repetition *&rep);
+    void AddPolygon(const std::vector<Point> &pts, long long x, long long y, const Repetition *rep);
+    void ParseTable(unsigned long long offset);
+
+    bool Truncated()
+    {
+        mErr = "OASIS format error: unexpected end of the data.\n";
+        return false;
+    }
+    bool Fail(const std::string &msg)
+    {
+        mErr = "OASIS format error: " + msg + "\n";
+        return false;
+    }
+
+    enum Pass
+    {
+        PASS_NAMES,     //< Collect the names only.
+        PASS_CELLS,     //< Create the cells.
+    };
+
+    Library                                             &mLib;
+    std::string                                         mErr;
+    std::vector<unsigned char>                          mData;
+    Pass                                                mPass;
+    Modal                                               mModal;
+    bool                                                mStop;
+    bool                                                mTableOnly;     //< Stop at the first record which is not in a name table.
+    std::unordered_map<unsigned long long, std::string> mCellNames;
+    unsigned long long                                  mNextCellName;
+    std::unordered_map<unsigned long long, std::string> mPropNames;
+    unsigned long long                                  mNextPropName;
+    std::unordered_map<std::string, unsigned long long> mCellOffsets;
+    std::string                                         mLastCellName;
+    bool                                                mAfterCellName; //< Properties are attached to mLastCellName.
+    const std::unordered_set<std::string>               *mWanted;
+    std::string                                         mTarget;        //< Only this cell is read, when not empty.
+    bool                                                mInTarget;
+    Structure                                           *mCell;         //< The cell which elements are added to.
+    std::vector<Point>                                  mPts;
+};
+
+int OasisReader::Read(const std::string &file_name, const std::vector<std::string> *cells, std::string &err)
+{
+    std::ifstream in(file_name, std::ios::binary);
+    if (!in.is_open())
+    {
+        err = "OASIS file error: failed to open the OASIS file.\n";
+        return FILE_ERROR;
+    }
+    in.seekg(0, std::ios::end);
+    mData.resize((size_t)in.tellg());
+    in.seekg(0, std::ios::beg);
+    in.read((char *)mData.data(), mData.size());
+    if (in.fail())
+    {
+        err = "OASIS file error: failed to read the OASIS file.\n";
+        return FILE_ERROR;
+    }
+    if (mData.size() < OASIS_MAGIC_SIZE + END_RECORD_SIZE
+        || memcmp(mData.data(), OASIS_MAGIC, OASIS_MAGIC_SIZE) != 0)
+    {
+        err = "OASIS format error: not an OASIS file.\n";
+        return FORMAT_ERROR;
+    }
+
+    const unsigned char *end = mData.data() + mData.size();
+    Cursor c(mData.data() + OASIS_MAGIC_SIZE, end - END_RECORD_SIZE);
+    unsigned long long id, offset_flag;
+    std::string version;
+    double unit;
+    if (!c.UInt(id) || id != OAS_START || !c.String(version) || !c.Real(unit)
+        || !c.UInt(offset_flag) || unit <= 0)
+    {
+        err = "OASIS format error: incorrect START record.\n";
+        return FORMAT_ERROR;
+    }
+    // The flag and the offset of the name tables, in the order of
+    // CELLNAME, TEXTSTRING, PROPNAME, PROPSTRING, LAYERNAME and XNAME.
+    unsigned long long tables[12];
+    Cursor table_cursor(end - END_RECORD_SIZE, end);
+    if (offset_flag == 1 && (!table_cursor.UInt(id) || id != OAS_END))
+    {
+        err = "OASIS format error: incorrect END record.\n";
+        return FORMAT_ERROR;
+    }
+    for (int i = 0; i < 12; i++)
+    {
+        if (!(offset_flag == 0 ? c.UInt(tables[i]) : table_cursor.UInt(tables[i])))
+        {
+            err = "OASIS format error: incorrect table offsets.\n";
+            return FORMAT_ERROR;
+        }
+    }
+    const unsigned char *body = c.p;
+
+    mLib.Init();
+    mLib.SetUnits(1.0 / unit, 1e-6 / unit);
+
+    mStop = false;
+    mTableOnly = false;
+    mNextCellName = 0;
+    mNextPropName = 0;
+    mAfterCellName = false;
+    mWanted = nullptr;
+    mInTarget = false;
+    mCell = nullptr;
+    mModal.Reset();
+
+    // Names which are referred to before they are defined are common, so
+    // the names are collected before any cell is created: from the strict
+    // name tables if there are, or by a pass over the whole file.
+    bool names_known = tables[0] == 1 && tables[1] != 0;
+    mPass = PASS_NAMES;
+    if (names_known)
+    {
+        if (tables[5] != 0)
+            ParseTable(tables[5]);
+        ParseTable(tables[1]);
+    }
+    else
+    {
+        Cursor all(body, end - END_RECORD_SIZE);
+        ParseRecords(all);
+    }
+    if (!mErr.empty())
+    {
+        err = mErr;
+        return FORMAT_ERROR;
+    }
+
+    mPass = PASS_CELLS;
+    std::unordered_set<std::string> wanted;
+    bool use_offsets = false;
+    if (cells != nullptr)
+    {
+        wanted.insert(cells->begin(), cells->end());
+        mWanted = &wanted;
+        use_offsets = names_known;
+        for (auto &name : wanted)
+        {
+            if (mCellOffsets.count(name) == 0 || mCellOffsets[name] >= mData.size() - END_RECORD_SIZE)
+                use_offsets = false;
+        }
+    }
+
+    if (use_offsets)
+    {
+        for (auto &name : wanted)
+        {
+            Cursor cell(mData.data() + mCellOffsets[name], end - END_RECORD_SIZE);
+            mTarget = name;
+            mInTarget = false;
+            mStop = false;
+            mCell = nullptr;
+            mModal.Reset();
+            if (!ParseRecords(cell))
+            {
+                err = mErr;
+                return FORMAT_ERROR;
+            }
+            if (!mInTarget)
+            {
+                err = "OASIS format error: cell " + name + " is not at its S_CELL_OFFSET.\n";
+                return FORMAT_ERROR;
+            }
+        }
+    }
+    else
+    {
+        Cursor all(body, end - END_RECORD_SIZE);
+        mStop = false;
+        mNextCellName = 0;
+        mNextPropName = 0;
+        if (!ParseRecords(all))
+        {
+            err = mErr;
+            return FORMAT_ERROR;
+        }
+    }
+
+    return 0;
+}
+
+void OasisReader::ParseTable(unsigned long long offset)
+{
+    if (offset >= mData.size())
+    {
+        mErr = "OASIS format error: incorrect table offset.\n";
+        return;
+    }
+    Cursor c(mData.data() + offset, mData.data() + mData.size());
+    mTableOnly = true;
+    mStop = false;
+    ParseRecords(c);
+    mTableOnly = false;
+    mStop = false;
+}
+
+bool OasisReader::ParseRecords(Cursor &c)
+{
+    while (!mStop && c.p < c.end)
+    {
+        const unsigned char *record = c.p;
+        unsigned long long id;
+        if (!c.UInt(id))
+            return Truncated();
+        if (mTableOnly && id != OAS_PAD && id != OAS_CBLOCK
+            && (id < OAS_CELLNAME || id > OAS_LAYERNAME_TEXT)
+            && id != OAS_PROPERTY && id != OAS_PROPERTY_REPEAT
+            && id != OAS_XNAME && id != OAS_XNAME_REF)
+        {
+            mStop = true;
+            break;
+        }
+
+        bool after_cell_name = false;
+        bool ok = true;
+        std::string name;
+        unsigned long long v;
+        switch (id)
+        {
+        case OAS_PAD:
+            break;
+        case OAS_END:
+            mStop = true;
+            break;
+        case OAS_CELLNAME:
+        case OAS_CELLNAME_REF:
+        {
+            unsigned long long ref = mNextCellName++;
+            if (!c.String(name) || (id == OAS_CELLNAME_REF && !c.UInt(ref)))
+                return Truncated();
+            mCellNames[ref] = name;
+            mLastCellName = name;
+            after_cell_name = true;
+            break;
+        }
+        case OAS_PROPNAME:
+        case OAS_PROPNAME_REF:
+        {
+            unsigned long long ref = mNextPropName++;
+            if (!c.String(name) || (id == OAS_PROPNAME_REF && !c.UInt(ref)))
+                return Truncated();
+            mPropNames[ref] = name;
+            break;
+        }
+        case OAS_TEXTSTRING:
+        case OAS_PROPSTRING:
+            ok = c.SkipString();
+            break;
+        case OAS_TEXTSTRING_REF:
+        case OAS_PROPSTRING_REF:
+            ok = c.SkipString() && c.UInt(v);
+            break;
+        case OAS_LAYERNAME:
+        case OAS_LAYERNAME_TEXT:
+        {
+            ok = c.SkipString();
+            for (int i = 0; i < 2 && ok; i++)
+            {
+                unsigned long long type, bound;
+                ok = c.UInt(type) && type <= 4;
+                if (ok && type != 0)
+                    ok = c.UInt(bound);
+                if (ok && type == 4)
+                    ok = c.UInt(bound);
+            }
+            break;
+        }
+        case OAS_CELL_REF:
+        case OAS_CELL:
+            if (!ParseCell(c, id))
+                return false;
+            break;
+        case OAS_XYABSOLUTE:
+            mModal.XYRelative = false;
+            break;
+        case OAS_XYRELATIVE:
+            mModal.XYRelative = true;
+            break;
+        case OAS_PLACEMENT:
+        case OAS_PLACEMENT_TRANSFORM:
+            ok = ParsePlacement(c, id);
+            break;
+        case OAS_TEXT:
+            ok = ParseText(c);
+            break;
+        case OAS_RECTANGLE:
+            ok = ParseRectangle(c);
+            break;
+        case OAS_POLYGON:
+            ok = ParsePolygon(c);
+            break;
+        case OAS_PATH:
+            ok = ParsePath(c);
+            break;
+        case OAS_TRAPEZOID:
+        case OAS_TRAPEZOID_A:
+        case OAS_TRAPEZOID_B:
+            ok = ParseTrapezoid(c, id);
+            break;
+        case OAS_CTRAPEZOID:
+            ok = ParseCTrapezoid(c);
+            break;
+        case OAS_CIRCLE:
+            ok = ParseCircle(c);
+            break;
+        case OAS_PROPERTY:
+            ok = ParseProperty(c);
+            after_cell_name = mAfterCellName;
+            break;
+        case OAS_PROPERTY_REPEAT:
+            after_cell_name = mAfterCellName;
+            break;
+        case OAS_XNAME:
+        case OAS_XNAME_REF:
+            ok = c.UInt(v) && c.SkipString() && (id == OAS_XNAME || c.UInt(v));
+            break;
+        case OAS_XELEMENT:
+            ok = c.UInt(v) && c.SkipString();
+            break;
+        case OAS_XGEOMETRY:
+            ok = ParseXGeometry(c);
+            break;
+        case OAS_CBLOCK:
+            if (!ParseCBlock(c))
+                return false;
+            break;
+        default:
+            return Fail("unknown record at offset " + std::to_string((long long)(record - mData.data())) + ".");
+        }
+        if (!ok)
+            return mErr.empty() ? Truncated() : false;
+        mAfterCellName = after_cell_name;
+    }
+    return true;
+}
+
+bool OasisReader::ParseCell(Cursor &c, unsigned long long id)
+{
+    std::string name;
+    if (id == OAS_CELL_REF)
+    {
+        unsigned long long ref;
+        if (!c.UInt(ref))
+            return Truncated();
+        auto iter = mCellNames.find(ref);
+        if (iter == mCellNames.end())
+        {
+            if (mPass == PASS_CELLS)
+                return Fail("undefined cell name reference.");
+        }
+        else
+        {
+            name = iter->second;
+        }
+    }
+    else if (!c.String(name))
+    {
+        return Truncated();
+    }
+
+    mModal.Reset();
+    mCell = nullptr;
+    if (mPass != PASS_CELLS)
+        return true;
+    if (!mTarget.empty())
+    {
+        if (mInTarget)
+        {
+            mStop = true;
+            return true;
+        }
+        if (name != mTarget)
+            return true;
+        mInTarget = true;
+    }
+    else if (mWanted != nullptr && mWanted->count(name) == 0)
+    {
+        return true;
+    }
+    mCell = mLib.Add(name);
+    return true;
+}
+
+bool OasisReader::ReadLayer(Cursor &c, unsigned char info)
+{
+    if ((info & 0x01) && !c.UInt(mModal.Layer))
+        return false;
+    if ((info & 0x02) && !c.UInt(mModal.DataType))
+        return false;
+    return true;
+}
+
+bool OasisReader::ReadXY(Cursor &c, bool has_x, bool has_y, long long &x, long long &y)
+{
+    long long v;
+    if (has_x)
+    {
+        if (!c.SInt(v))
+            return false;
+        x = mModal.XYRelative ? x + v : v;
+    }
+    if (has_y)
+    {
+        if (!c.SInt(v))
+            return false;
+        y = mModal.XYRelative ? y + v : v;
+    }
+    return true;
+}
+
+bool OasisReader::ReadRep(Cursor &c, bool has_rep, const Repetition *&rep)
+{
+    rep = nullptr;
+    if (!has_rep)
+        return true;
+    if (!ReadRepetition(c, mModal.Rep))
+        return Fail("incorrect repetition.");
+    rep = &mModal.Rep;
+    return true;
+}
+
+// Call func(dx, dy) for the offset of every copy of a repetition.
+template <typename Func>
+void ForEachCopy(const Repetition *rep, Func func)
+{
+    if (rep == nullptr)
+    {
+        func(0LL, 0LL);
+    }
+    else if (rep->Lattice)
+    {
+        for (long long r = 0; r < rep->Rows; r++)
+        {
+            for (long long col = 0; col < rep->Cols; col++)
+                func(col * rep->ColX + r * rep->RowX, col * rep->ColY + r * rep->RowY);
+        }
+    }
+    else
+    {
+        for (auto &pt : rep->Offsets)
+            func((long long)pt.X, (long long)pt.Y);
+    }
+}
+
+void OasisReader::AddPolygon(const std::vector<Point> &pts, long long x, long long y, const Repetition *rep)
+{
+    if (mCell == nullptr || pts.empty())
+        return;
+    ForEachCopy(rep, [&](long long dx, long long dy)
+    {
+        std::vector<Point> copy;
+        copy.reserve(pts.size() + 1);
+        for (auto &pt : pts)
+            copy.push_back(Point((int)(pt.X + x + dx), (int)(pt.Y + y + dy)));
+        copy.push_back(copy[0]);
+        if (Box::IsRectangle(copy))
+        {
+            Box *box = new Box;
+            box->SetLayer((short)mModal.Layer);
+            box->SetDataType((short)mModal.DataType);
+            box->SetXY(copy);
+            mCell->Add(box);
+        }
+        else
+        {
+            Boundary *boundary = new Boundary;
+            boundary->SetLayer((short)mModal.Layer);
+            boundary->SetDataType((short)mModal.DataType);
+            boundary->SetXY(std::move(copy));
+            mCell->Add(boundary);
+        }
+    });
+}
+
+bool OasisReader::ParsePlacement(Cursor &c, unsigned long long id)
+{
+    unsigned char info;
+    if (!c.Byte(info))
+        return false;
+    if (info & 0x80)
+    {
+        std::string name;
+        if (info & 0x40)
+        {
+            unsigned long long ref;
+            if (!c.UInt(ref))
+                return false;
+            auto iter = mCellNames.find(ref);
+            if (iter == mCellNames.end())
+            {
+                if (mPass == PASS_CELLS)
+                    return Fail("undefined cell name reference.");
+            }
+            else
+            {
+                name = iter->second;
+            }
+        }
+        else if (!c.String(name))
+        {
+            return false;
+        }
+        if (mPass == PASS_CELLS)
+            mModal.PlacementCell = StringTable::Instance().Intern(name);
+    }
+    double mag = 1, angle = 0;
+    if (id == OAS_PLACEMENT_TRANSFORM)
+    {
+        if ((info & 0x04) && !c.Real(mag))
+            return false;
+        if ((info & 0x02) && !c.Real(angle))
+            return false;
+    }
+    else
+    {
+        angle = ((info >> 1) & 0x3) * 90.0;
+    }
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x20) != 0, (info & 0x10) != 0, mModal.PlacementX, mModal.PlacementY)
+        || !ReadRep(c, (info & 0x08) != 0, rep))
+        return false;
+    if (mCell == nullptr)
+        return true;
+
+    long long x = mModal.PlacementX;
+    long long y = mModal.PlacementY;
+    short strans = (info & 0x01) ? (short)REFLECTION : 0;
+    if (rep != nullptr && rep->Lattice && rep->Cols <= 32767 && rep->Rows <= 32767
+        && rep->Cols * rep->Rows > 1)
+    {
+        ARef *aref = new ARef;
+        aref->SetSNameId(mModal.PlacementCell);
+        aref->SetStrans(strans);
+        aref->SetMag(mag);
+        aref->SetAngle(angle);
+        aref->SetRowCol((int)rep->Rows, (int)rep->Cols);
+        std::vector<Point> pts;
+        pts.push_back(Point((int)x, (int)y));
+        pts.push_back(Point((int)(x + rep->Cols * rep->ColX), (int)(y + rep->Cols * rep->ColY)));
+        pts.push_back(Point((int)(x + rep->Rows * rep->RowX), (int)(y + rep->Rows * rep->RowY)));
+        aref->SetXY(std::move(pts));
+        mCell->Add(aref);
+        return true;
+    }
+    ForEachCopy(rep, [&](long long dx, long long dy)
+    {
+        SRef *sref = new SRef;
+        sref->SetSNameId(mModal.PlacementCell);
+        sref->SetStrans(strans);
+        sref->SetMag(mag);
+        sref->SetAnagle(angle);
+        sref->SetXY(Point((int)(x + dx), (int)(y + dy)));
+        mCell->Add(sref);
+    });
+    return true;
+}
+
+bool OasisReader::ParseText(Cursor &c)
+{
+    unsigned char info;
+    unsigned long long v;
+    if (!c.Byte(info))
+        return false;
+    if (info & 0x40)
+    {
+        if ((info & 0x20) ? !c.UInt(v) : !c.SkipString())
+            return false;
+    }
+    if ((info & 0x01) && !c.UInt(v))
+        return false;
+    if ((info & 0x02) && !c.UInt(v))
+        return false;
+    const Repetition *rep;
+    return ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.TextX, mModal.TextY)
+        && ReadRep(c, (info & 0x04) != 0, rep);
+}
+
+bool OasisReader::ParseRectangle(Cursor &c)
+{
+    unsigned char info;
+    if (!c.Byte(info) || !ReadLayer(c, info))
+        return false;
+    if ((info & 0x40) && !c.UInt(mModal.GeometryW))
+        return false;
+    if (info & 0x80)
+        mModal.GeometryH = mModal.GeometryW;
+    else if ((info & 0x20) && !c.UInt(mModal.GeometryH))
+        return false;
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        || !ReadRep(c, (info & 0x04) != 0, rep))
+        return false;
+    if (mCell == nullptr)
+        return true;
+
+    ForEachCopy(rep, [&](long long dx, long long dy)
+    {
+        Box *box = new Box;
+        box->SetLayer((short)mModal.Layer);
+        box->SetDataType((short)mModal.DataType);
+        box->SetRect((int)(mModal.GeometryX + dx), (int)(mModal.GeometryY + dy),
+                     (int)mModal.GeometryW, (int)mModal.GeometryH);
+        mCell->Add(box);
+    });
+    return true;
+}
+
+bool OasisReader::ParsePolygon(Cursor &c)
+{
+    unsigned char info;
+    if (!c.Byte(info) || !ReadLayer(c, info))
+        return false;
+    if ((info & 0x20) && !ReadPointList(c, true, mModal.PolygonPts))
+        return false;
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        || !ReadRep(c, (info & 0x04) != 0, rep))
+        return false;
+    AddPolygon(mModal.PolygonPts, mModal.GeometryX, mModal.GeometryY, rep);
+    return true;
+}
+
+bool OasisReader::ParsePath(Cursor &c)
+{
+    unsigned char info;
+    if (!c.Byte(info) || !ReadLayer(c, info))
+        return false;
+    if ((info & 0x40) && !c.UInt(mModal.HalfWidth))
+        return false;
+    if (info & 0x80)
+    {
+        // Extension scheme SSEE: 1 flush, 2 half width, 3 explicit.
+        unsigned long long scheme;
+        if (!c.UInt(scheme))
+            return false;
+        long long *ext[] = { &mModal.StartExtension, &mModal.EndExtension };
+        for (int i = 0; i < 2; i++)
+        {
+            switch ((scheme >> (2 - 2 * i)) & 0x3)
+            {
+            case 1:
+                *ext[i] = 0;
+                break;
+            case 2:
+                *ext[i] = (long long)mModal.HalfWidth;
+                break;
+            case 3:
+                if (!c.SInt(*ext[i]))
+                    return false;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    if ((info & 0x20) && !ReadPointList(c, false, mModal.PathPts))
+        return false;
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        || !ReadRep(c, (info & 0x04) != 0, rep))
+        return false;
+    if (mCell == nullptr || mModal.PathPts.empty())
+        return true;
+
+    // Other extensions than flush and half width become path type 4.
+    const std::vector<Point> &pts = mModal.PathPts;
+    short path_type = 4;
+    long long half = (long long)mModal.HalfWidth;
+    if (mModal.StartExtension == 0 && mModal.EndExtension == 0)
+        path_type = 0;
+    else if (mModal.StartExtension == half && mModal.EndExtension == half)
+        path_type = 2;
+    ForEachCopy(rep, [&](long long dx, long long dy)
+    {
+        std::vector<Point> copy;
+        copy.reserve(pts.size());
+        for (auto &pt : pts)
+            copy.push_back(Point((int)(pt.X + mModal.GeometryX + dx), (int)(pt.Y + mModal.GeometryY + dy)));
+        Path *path = new Path;
+        path->SetLayer((short)mModal.Layer);
+        path->SetDataType((short)mModal.DataType);
+        path->SetWidth((int)(2 * half));
+        path->SetPathType(path_type);
+        if (path_type == 4)
+        {
+            path->SetBgnExtn((int)mModal.StartExtension);
+            path->SetEndExtn((int)mModal.EndExtension);
+        }
+        path->SetXY(std::move(copy));
+        mCell->Add(path);
+    });
+    return true;
+}
+
+bool OasisReader::ParseTrapezoid(Cursor &c, unsigned long long id)
+{
+    unsigned char info;
+    if (!c.Byte(info) || !ReadLayer(c, info))
+        return false;
+    if ((info & 0x40) && !c.UInt(mModal.GeometryW))
+        return false;
+    if ((info & 0x20) && !c.UInt(mModal.GeometryH))
+        return false;
+    long long da = 0, db = 0;
+    if (id != OAS_TRAPEZOID_B && !c.SInt(da))
+        return false;
+    if (id != OAS_TRAPEZOID_A && !c.SInt(db))
+        return false;
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        || !ReadRep(c, (info & 0x04) != 0, rep))
+        return false;
+
+    long long w = (long long)mModal.GeometryW;
+    long long h = (long long)mModal.GeometryH;
+    mPts.clear();
+    if (info & 0x80)
+    {
+        mPts.push_back(Point(0, (int)std::max(da, 0LL)));
+        mPts.push_back(Point(0, (int)(h + std::min(db, 0LL))));
+        mPts.push_back(Point((int)w, (int)(h - std::max(db, 0LL))));
+        mPts.push_back(Point((int)w, (int)(-std::min(da, 0LL))));
+    }
+    else
+    {
+        mPts.push_back(Point((int)std::max(da, 0LL), (int)h));
+        mPts.push_back(Point((int)(w + std::min(db, 0LL)), (int)h));
+        mPts.push_back(Point((int)(w - std::max(db, 0LL)), 0));
+        mPts.push_back(Point((int)(-std::min(da, 0LL)), 0));
+    }
+    AddPolygon(mPts, mModal.GeometryX, mModal.GeometryY, rep);
+    return true;
+}
+
+bool OasisReader::ParseCTrapezoid(Cursor &c)
+{
+    unsigned char info;
+    if (!c.Byte(info) || !ReadLayer(c, info))
+        return false;
+    if ((info & 0x80) && !c.UInt(mModal.CTrapezoidType))
+        return false;
+    if ((info & 0x40) && !c.UInt(mModal.GeometryW))
+        return false;
+    if ((info & 0x20) && !c.UInt(mModal.GeometryH))
+        return false;
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        || !ReadRep(c, (info & 0x04) != 0, rep))
+        return false;
+    if (mModal.CTrapezoidType > 25)
+        return Fail("incorrect CTRAPEZOID type.");
+
+    long long w = (long long)mModal.GeometryW;
+    long long h = (long long)mModal.GeometryH;
+    const CTrapezoidVertex *vertices = CTRAPEZOIDS[mModal.CTrapezoidType];
+    int count = (mModal.CTrapezoidType >= 16 && mModal.CTrapezoidType <= 23) ? 3 : 4;
+    mPts.clear();
+    for (int i = 0; i < count; i++)
+    {
+        const CTrapezoidVertex &v = vertices[i];
+        mPts.push_back(Point((int)(v.xw * w + v.xh * h), (int)(v.yw * w + v.yh * h)));
+    }
+    AddPolygon(mPts, mModal.GeometryX, mModal.GeometryY, rep);
+    return true;
+}
+
+bool OasisReader::ParseCircle(Cursor &c)
+{
+    unsigned char info;
+    if (!c.Byte(info) || !ReadLayer(c, info))
+        return false;
+    if ((info & 0x20) && !c.UInt(mModal.CircleRadius))
+        return false;
+    const Repetition *rep;
+    if (!ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        || !ReadRep(c, (info & 0x04) != 0, rep))
+        return false;
+
+    const double PI = 3.14159265358979323846;
+    double r = (double)mModal.CircleRadius;
+    mPts.clear();
+    for (int i = 0; i < CIRCLE_VERTICES; i++)
+    {
+        double a = 2 * PI * i / CIRCLE_VERTICES;
+        mPts.push_back(Point((int)floor(r * cos(a) + 0.5), (int)floor(r * sin(a) + 0.5)));
+    }
+    AddPolygon(mPts, mModal.GeometryX, mModal.GeometryY, rep);
+    return true;
+}
+
+bool OasisReader::ParseProperty(Cursor &c)
+{
+    unsigned char info;
+    if (!c.Byte(info))
+        return false;
+    if (info & 0x04)
+    {
+        if (info & 0x02)
+        {
+            unsigned long long ref;
+            if (!c.UInt(ref))
+                return false;
+            auto iter = mPropNames.find(ref);
+            mModal.PropName = iter == mPropNames.end() ? std::string() : iter->second;
+        }
+        else if (!c.String(mModal.PropName))
+        {
+            return false;
+        }
+    }
+    if (info & 0x08)
+        return true;
+
+    unsigned long long count = info >> 4;
+    if (count == 15 && !c.UInt(count))
+        return false;
+    bool has_offset = false;
+    unsigned long long offset = 0;
+    for (unsigned long long i = 0; i < count; i++)
+    {
+        unsigned long long type, u;
+        long long s;
+        double d;
+        if (!c.UInt(type))
+            return false;
+        bool ok;
+        if (type <= 7)
+            ok = c.RealOfType(type, d);
+        else if (type == 8)
+            ok = c.UInt(u);
+        else if (type == 9)
+            ok = c.SInt(s);
+        else if (type <= 12)
+            ok = c.SkipString();
+        else if (type <= 15)
+            ok = c.UInt(u);
+        else
+            return Fail("incorrect property value.");
+        if (!ok)
+            return false;
+        if (i == 0 && type == 8)
+        {
+            has_offset = true;
+            offset = u;
+        }
+    }
+    if (mAfterCellName && has_offset && mModal.PropName == S_CELL_OFFSET)
+        mCellOffsets[mLastCellName] = offset;
+    return true;
+}
+
+bool OasisReader::ParseXGeometry(Cursor &c)
+{
+    unsigned char info;
+    unsigned long long attribute;
+    if (!c.Byte(info) || !c.UInt(attribute) || !ReadLayer(c, info) || !c.SkipString())
+        return false;
+    const Repetition *rep;
+    return ReadXY(c, (info & 0x10) != 0, (info & 0x08) != 0, mModal.GeometryX, mModal.GeometryY)
+        && ReadRep(c, (info & 0x04) != 0, rep);
+}
+
+bool OasisReader::ParseCBlock(Cursor &c)
+{
+    unsigned long long type, raw_size, size;
+    if (!c.UInt(type) || !c.UInt(raw_size) || !c.UInt(size)
+        || size > (unsigned long long)(c.end - c.p))
+        return Truncated();
+    if (type != 0)
+        return Fail("unsupported CBLOCK compression.");
+    // Deflate does not expand data by more than about 1032 times.
+    if (raw_size > size * 1032 + 64)
+        return Fail("incorrect CBLOCK size.");
+
+#ifdef GDS_USE_ZLIB
+    std::vector<unsigned char> buffer((size_t)raw_size);
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -15) != Z_OK)
+        return Fail("failed to decompress CBLOCK.");
+    stream.next_in = const_cast<unsigned char *>(c.p);
+    stream.avail_in = (uInt)size;
+    stream.next_out = buffer.data();
+    stream.avail_out = (uInt)raw_size;
+    int rc = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (rc != Z_STREAM_END || stream.total_out != raw_size)
+        return Fail("failed to decompress CBLOCK.");
+    c.p += size;
+
+    Cursor block(buffer.data(), buffer.data() + buffer.size());
+    return ParseRecords(block);
+#else
+    return Fail("CBLOCK is not supported without zlib.");
+#endif
+}
+
+// Writing of the basic OASIS data types.
+void PutUInt(std::vector<char> &out, unsigned long long v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((char)((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)v);
+}
+
+void PutSInt(std::vector<char> &out, long long v)
+{
+    PutUInt(out, v < 0 ? ((unsigned long long)(-v) << 1) | 1 : (unsigned long long)v << 1);
+}
+
+void PutString(std::vector<char> &out, const std::string &s)
+{
+    PutUInt(out, s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+void PutReal(std::vector<char> &out, double v)
+{
+    double whole = floor(fabs(v));
+    if (whole == fabs(v) && whole < 9007199254740992.0)
+    {
+        PutUInt(out, v < 0 ? 1 : 0);
+        PutUInt(out, (unsigned long long)whole);
+        return;
+    }
+    PutUInt(out, 7);
+    unsigned long long bits;
+    memcpy(&bits, &v, 8);
+    for (int i = 0; i < 8; i++)
+        out.push_back((char)((bits >> (8 * i)) & 0xff));
+}
+
+void PutGDelta(std::vector<char> &out, long long x, long long y)
+{
+    long long ax = x < 0 ? -x : x;
+    long long ay = y < 0 ? -y : y;
+    if (x == 0 || y == 0 || ax == ay)
+    {
+        int dir;
+        if (y == 0)
+            dir = x >= 0 ? 0 : 2;
+        else if (x == 0)
+            dir = y > 0 ? 1 : 3;
+        else if (y > 0)
+            dir = x > 0 ? 4 : 5;
+        else
+            dir = x < 0 ? 6 : 7;
+        PutUInt(out, ((unsigned long long)std::max(ax, ay) << 4) | (dir << 1));
+        return;
+    }
+    PutUInt(out, ((unsigned long long)ax << 2) | (x < 0 ? 2 : 0) | 1);
+    PutSInt(out, y);
+}
+
+// Write the points after the first one, relative to the first one.
+void PutPointList(std::vector<char> &out, const Point *pts, size_t count, bool polygon)
+{
+    // A Manhattan list whose edges alternate in direction is written as
+    // 1-deltas. A polygon needs an even count and has two implicit edges.
+    size_t edges = polygon ? count : count - 1;
+    int type = -1;
+    for (int first = 0; first < 2 && type == -1 && count > 1; first++)
+    {
+        if (polygon && (count % 2 != 0 || count < 4))
+            break;
+        bool ok = true;
+        for (size_t i = 0; i < edges && ok; i++)
+        {
+            const Point &a = pts[i];
+            const Point &b = pts[(i + 1) % count];
+            ok = (i % 2 == (size_t)first) ? a.Y == b.Y : a.X == b.X;
+        }
+        if (ok)
+            type = first;
+    }
+
+    if (type != -1)
+    {
+        size_t n = polygon ? count - 2 : count - 1;
+        PutUInt(out, type);
+        PutUInt(out, n);
+        for (size_t i = 0; i < n; i++)
+        {
+            bool horizontal = (i % 2 == 0) == (type == 0);
+            PutSInt(out, horizontal ? (long long)pts[i + 1].X - pts[i].X : (long long)pts[i + 1].Y - pts[i].Y);
+        }
+        return;
+    }
+
+    PutUInt(out, 4);
+    PutUInt(out, count - 1);
+    for (size_t i = 1; i < count; i++)
+        PutGDelta(out, (long long)pts[i].X - pts[i - 1].X, (long long)pts[i].Y - pts[i - 1].Y);
+}
+
+// Serialize the elements of a cell, with the modal variables of a new cell.
+class CellWriter
+{
+public:
+    CellWriter(const std::unordered_map<StringTable::Id, unsigned long long> &refnums)
+        : mRefnums(refnums), mHasLayer(false), mLayer(0), mDataType(0),
+          mGeometryX(0), mGeometryY(0), mPlacementX(0), mPlacementY(0),
+          mHasCell(false), mCell(StringTable::EMPTY)
+    {
+    }
+
+    void Write(const Structure *cell, std::vector<char> &out);
+
+private:
+    void PutLayer(std::vector<char> &out, unsigned char &info, short layer, short data_type);
+    void PutXY(unsigned char &info, unsigned char x_bit, unsigned char y_bit,
+               long long x, long long y, long long &mx, long long &my);
+    void PutPlacement(std::vector<char> &out, StringTable::Id name, short strans,
+                      double mag, double angle, Point pt, const ARef *aref);
+
+    const std::unordered_map<StringTable::Id, unsigned long long> &mRefnums;
+    bool                mHasLayer;
+    unsigned long long  mLayer, mDataType;
+    long long           mGeometryX, mGeometryY, mPlacementX, mPlacementY;
+    bool                mHasCell;
+    StringTable::Id     mCell;
+    std::vector<char>   mFields;    //< The fields after the info byte.
+    std::vector<Point>  mPts;
+};
+
+void CellWriter::PutLayer(std::vector<char> &out, unsigned char &info, short layer, short data_type)
+{
+    unsigned long long l = (unsigned short)layer;
+    unsigned long long d = (unsigned short)data_type;
+    if (!mHasLayer || l != mLayer)
+    {
+        info |= 0x01;
+        PutUInt(out, l);
+    }
+    if (!mHasLayer || d != mDataType)
+    {
+        info |= 0x02;
+        PutUInt(out, d);
+    }
+    mHasLayer = true;
+    mLayer = l;
+    mDataType = d;
+}
+
+void CellWriter::PutXY(unsigned char &info, unsigned char x_bit, unsigned char y_bit,
+                       long long x, long long y, long long &mx, long long &my)
+{
+    if (x != mx)
+    {
+        info |= x_bit;
+        PutSInt(mFields, x);
+        mx = x;
+    }
+    if (y != my)
+    {
+        info |= y_bit;
+        PutSInt(mFields, y);
+        my = y;
+    }
+}
+
+void CellWriter::PutPlacement(std::vector<char> &out, StringTable::Id name, short strans,
+                              double mag, double angle, Point pt, const ARef *aref)
+{
+    mFields.clear();
+    unsigned char info = (strans & REFLECTION) ? 0x01 : 0;
+    if (!mHasCell || name != mCell)
+    {
+        info |= 0x80;
+        auto iter = mRefnums.find(name);
+        if (iter != mRefnums.end())
+        {
+            info |= 0x40;
+            PutUInt(mFields, iter->second);
+        }
+        else
+        {
+            PutString(mFields, StringTable::Instance().Str(name));
+        }
+        mHasCell = true;
+        mCell = name;
+    }
+
+    double quarter = angle / 90;
+    bool simple = mag == 1 && quarter == floor(quarter);
+    Byte record = simple ? OAS_PLACEMENT : OAS_PLACEMENT_TRANSFORM;
+    if (simple)
+    {
+        info |= (unsigned char)((((long long)quarter % 4 + 4) % 4) << 1);
+    }
+    else
+    {
+        if (mag != 1)
+        {
+            info |= 0x04;
+            PutReal(mFields, mag);
+        }
+        if (angle != 0)
+        {
+            info |= 0x02;
+            PutReal(mFields, angle);
+        }
+    }
+    PutXY(info, 0x20, 0x10, pt.X, pt.Y, mPlacementX, mPlacementY);
+
+    Point col_pitch, row_pitch;
+    if (aref != nullptr && aref->Row() * aref->Col() > 1 && aref->Pitch(col_pitch, row_pitch))
+    {
+        info |= 0x08;
+        long long cols = aref->Col(), rows = aref->Row();
+        long long cx = col_pitch.X, cy = col_pitch.Y;
+        long long rx = row_pitch.X, ry = row_pitch.Y;
+        if (cols > 1 && rows > 1 && cy == 0 && rx == 0 && cx >= 0 && ry >= 0)
+        {
+            PutUInt(mFields, 1);
+            PutUInt(mFields, cols - 2);
+            PutUInt(mFields, rows - 2);
+            PutUInt(mFields, cx);
+            PutUInt(mFields, ry);
+        }
+        else if (rows == 1 && cy == 0 && cx >= 0)
+        {
+            PutUInt(mFields, 2);
+            PutUInt(mFields, cols - 2);
+            PutUInt(mFields, cx);
+        }
+        else if (cols == 1 && rx == 0 && ry >= 0)
+        {
+            PutUInt(mFields, 3);
+            PutUInt(mFields, rows - 2);
+            PutUInt(mFields, ry);
+        }
+        else if (cols > 1 && rows > 1)
+        {
+            PutUInt(mFields, 8);
+            PutUInt(mFields, cols - 2);
+            PutUInt(mFields, rows - 2);
+            PutGDelta(mFields, cx, cy);
+            PutGDelta(mFields, rx, ry);
+        }
+        else
+        {
+            PutUInt(mFields, 9);
+            PutUInt(mFields, cols > 1 ? cols - 2 : rows - 2);
+            if (cols > 1)
+                PutGDelta(mFields, cx, cy);
+            else
+                PutGDelta(mFields, rx, ry);
+        }
+    }
+
+    out.push_back((char)record);
+    out.push_back((char)info);
+    out.insert(out.end(), mFields.begin(), mFields.end());
+}
+
+void CellWriter::Write(const Structure *cell, std::vector<char> &out)
+{
+    mHasLayer = false;
+    mLayer = mDataType = 0;
+    mGeometryX = mGeometryY = mPlacementX = mPlacementY = 0;
+    mHasCell = false;
+    mCell = StringTable::EMPTY;
+
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        const Element *e = cell->Get((int)i);
+        mFields.clear();
+        unsigned char info = 0;
+        switch (e->Tag())
+        {
+        case BOX_BOUNDARY:
+        {
+            const Box *box = static_cast<const Box*>(e);
+            PutLayer(mFields, info, box->Layer(), box->DataType());
+            long long w = (long long)box->Right() - box->Left();
+            long long h = (long long)box->Top() - box->Bottom();
+            info |= 0x40;
+            PutUInt(mFields, w);
+            if (w == h)
+            {
+                info |= 0x80;
+            }
+            else
+            {
+                info |= 0x20;
+                PutUInt(mFields, h);
+            }
+            PutXY(info, 0x10, 0x08, box->Left(), box->Bottom(), mGeometryX, mGeometryY);
+            out.push_back((char)OAS_RECTANGLE);
+            break;
+        }
+        case BOUNDARY:
+        {
+            const Boundary *boundary = static_cast<const Boundary*>(e);
+            const std::vector<Point> &pts = boundary->XY();
+            size_t count = pts.size();
+            if (count > 1 && pts[0].X == pts[count - 1].X && pts[0].Y == pts[count - 1].Y)
+                count--;
+            if (count == 0)
+                continue;
+            PutLayer(mFields, info, boundary->Layer(), boundary->DataType());
+            info |= 0x20;
+            PutPointList(mFields, pts.data(), count, true);
+            PutXY(info, 0x10, 0x08, pts[0].X, pts[0].Y, mGeometryX, mGeometryY);
+            out.push_back((char)OAS_POLYGON);
+            break;
+        }
+        case PATH:
+        {
+            const Path *path = static_cast<const Path*>(e);
+            const std::vector<Point> &pts = path->XY();
+            if (pts.empty())
+                continue;
+            // An OASIS path has a whole half width and no round ends, so
+            // other paths are written as their outlines.
+            int width = path->Width() < 0 ? -path->Width() : path->Width();
+            if (width % 2 != 0 || path->PathType() == 1)
+            {
+                if (!OutlinePath(path, mPts))
+                    continue;
+                PutLayer(mFields, info, path->Layer(), path->DataType());
+                info |= 0x20;
+                PutPointList(mFields, mPts.data(), mPts.size() - 1, true);
+                PutXY(info, 0x10, 0x08, mPts[0].X, mPts[0].Y, mGeometryX, mGeometryY);
+                out.push_back((char)OAS_POLYGON);
+                break;
+            }
+            PutLayer(mFields, info, path->Layer(), path->DataType());
+            info |= 0xe0;
+            PutUInt(mFields, width / 2);
+            if (path->PathType() == 4)
+            {
+                PutUInt(mFields, 0xf);
+                PutSInt(mFields, path->BgnExtn());
+                PutSInt(mFields, path->EndExtn());
+            }
+            else
+            {
+                PutUInt(mFields, path->PathType() == 2 ? 0xa : 0x5);
+            }
+            PutPointList(mFields, pts.data(), pts.size(), false);
+            PutXY(info, 0x10, 0x08, pts[0].X, pts[0].Y, mGeometryX, mGeometryY);
+            out.push_back((char)OAS_PATH);
+            break;
+        }
+        case SREF:
+        {
+            const SRef *sref = static_cast<const SRef*>(e);
+            PutPlacement(out, sref->SNameId(), sref->Strans(), sref->Mag(), sref->Angle(),
+                         sref->XY(), nullptr);
+            continue;
+        }
+        case AREF:
+        {
+            const ARef *aref = static_cast<const ARef*>(e);
+            if (aref->XY().size() != 3 || aref->Row() <= 0 || aref->Col() <= 0)
+                continue;
+            PutPlacement(out, aref->SNameId(), aref->Strans(), aref->Mag(), aref->Angle(),
+                         aref->XY()[0], aref);
+            continue;
+        }
+        default:
+            continue;
+        }
+        out.push_back((char)info);
+        out.insert(out.end(), mFields.begin(), mFields.end());
+    }
+}
+
+}
+
+int GDS::ReadOASIS(const std::string &file_name, Library &lib, std::string &err)
+{
+    OasisReader reader(lib);
+    return reader.Read(file_name, nullptr, err);
+}
+
+int GDS::ReadOASIS(const std::string &file_name, const std::vector<std::string> &cells,
+                   Library &lib, std::string &err)
+{
+    OasisReader reader(lib);
+    return reader.Read(file_name, &cells, err);
+}
+
+int GDS::WriteOASIS(const std::string &file_name, Library &lib, std::string &err,
+                    bool compress, unsigned int threads)
+{
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        const Structure *cell = lib.Get((int)i);
+        if (cell->IsFiltered())
+        {
+            err = "Cell " + cell->Name() + " was read with a layer filter and can not be written.\n";
+            return FORMAT_ERROR;
+        }
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            Record_type tag = cell->Get((int)k)->Tag();
+            if (tag == TEXT || tag == NODE || tag == BOX)
+            {
+                err = "Cell " + cell->Name() + " has TEXT, NODE or BOX elements, which can not be written to OASIS.\n";
+                return FORMAT_ERROR;
+            }
+        }
+    }
+
+    std::ofstream out(file_name, std::ios::binary);
+    if (!out.is_open())
+    {
+        err = "OASIS file error: failed to open the OASIS file.\n";
+        return FILE_ERROR;
+    }
+#ifndef GDS_USE_ZLIB
+    (void)compress;
+#endif
+
+    // Grid steps per micron. Whole numbers are written exactly.
+    double unit = 1e-6 / lib.DBUnitInMeter();
+    if (fabs(unit - floor(unit + 0.5)) < unit * 1e-9)
+        unit = floor(unit + 0.5);
+
+    std::vector<char> buffer(OASIS_MAGIC, OASIS_MAGIC + OASIS_MAGIC_SIZE);
+    PutUInt(buffer, OAS_START);
+    PutString(buffer, "1.0");
+    PutReal(buffer, unit);
+    PutUInt(buffer, 1);     // The table offsets are in the END record.
+    unsigned long long propname_table = buffer.size();
+    PutUInt(buffer, OAS_PROPNAME);
+    PutString(buffer, S_CELL_OFFSET);
+    out.write(buffer.data(), buffer.size());
+    unsigned long long pos = buffer.size();
+
+    size_t count = lib.Size();
+    std::unordered_map<StringTable::Id, unsigned long long> refnums;
+    for (size_t i = 0; i < count; i++)
+        refnums.insert(std::make_pair(lib.Get((int)i)->NameId(), (unsigned long long)i));
+
+    // Cells are serialized in parallel batches like Library::WriteGDS.
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    const size_t batch_size = 16 * threads;
+    std::vector<std::vector<char> > buffers(batch_size);
+    std::vector<CellWriter> writers(threads, CellWriter(refnums));
+    std::vector<std::vector<char> > bodies(threads);
+    std::vector<unsigned long long> offsets(count);
+    for (size_t start = 0; start < count; start += batch_size)
+    {
+        size_t n = std::min(batch_size, count - start);
+        ParallelFor(n, threads, [&](size_t i, unsigned int thread)
+        {
+            std::vector<char> &cell = buffers[i];
+            std::vector<char> &body = bodies[thread];
+            cell.clear();
+            body.clear();
+            PutUInt(cell, OAS_CELL_REF);
+            PutUInt(cell, start + i);
+            writers[thread].Write(lib.Get((int)(start + i)), body);
+#ifdef GDS_USE_ZLIB
+            if (compress && body.size() > 64)
+            {
+                uLongf size = compressBound((uLong)body.size());
+                std::vector<char> packed(size);
+                z_stream stream;
+                memset(&stream, 0, sizeof(stream));
+                if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+                {
+                    stream.next_in = (Bytef *)body.data();
+                    stream.avail_in = (uInt)body.size();
+                    stream.next_out = (Bytef *)packed.data();
+                    stream.avail_out = (uInt)packed.size();
+                    int rc = deflate(&stream, Z_FINISH);
+                    size = stream.total_out;
+                    deflateEnd(&stream);
+                    if (rc == Z_STREAM_END && size < body.size())
+                    {
+                        PutUInt(cell, OAS_CBLOCK);
+                        PutUInt(cell, 0);
+                        PutUInt(cell, body.size());
+                        PutUInt(cell, size);
+                        cell.insert(cell.end(), packed.begin(), packed.begin() + size);
+                        return;
+                    }
+                }
+            }
+#endif
+            cell.insert(cell.end(), body.begin(), body.end());
+        });
+        for (size_t i = 0; i < n; i++)
+        {
+            offsets[start + i] = pos;
+            out.write(buffers[i].data(), buffers[i].size());
+            pos += buffers[i].size();
+        }
+        if (out.fail())
+        {
+            err = "OASIS file error: failed to write the OASIS file.\n";
+            return FILE_ERROR;
+        }
+    }
+
+    // The strict cell name table, with the offset of each cell.
+    unsigned long long cellname_table = pos;
+    buffer.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        PutUInt(buffer, OAS_CELLNAME);
+        PutString(buffer, lib.Get((int)i)->Name());
+        PutUInt(buffer, OAS_PROPERTY);
+        buffer.push_back(0x17);     // One value, name by reference, standard property.
+        PutUInt(buffer, 0);
+        PutUInt(buffer, 8);
+        PutUInt(buffer, offsets[i]);
+    }
+    if (count == 0)
+        cellname_table = 0;
+
+    // END is padded to 256 bytes.
+    size_t end_start = buffer.size();
+    PutUInt(buffer, OAS_END);
+    unsigned long long tables[] = { 1, cellname_table, 1, 0, 1, propname_table, 1, 0, 1, 0, 1, 0 };
+    for (int i = 0; i < 12; i++)
+        PutUInt(buffer, tables[i]);
+    size_t rest = END_RECORD_SIZE - (buffer.size() - end_start) - 1;
+    size_t padding = rest - 1 < 128 ? rest - 1 : rest - 2;
+    PutUInt(buffer, padding);
+    buffer.resize(buffer.size() + padding, 0);
+    PutUInt(buffer, 0);     // No validation.
+    out.write(buffer.data(), buffer.size());
+    out.close();
+    if (out.fail())
+    {
+        err = "OASIS file error: failed to write the OASIS file.\n";
+        return FILE_ERROR;
+    }
+
+    return 0;
+}
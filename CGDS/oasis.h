@@ -0,0 +1,78 @@
+/*
+ * This file is part of GDSII.
+ *
+ * oasis.h -- The header file which declare the reader and writer of OASIS.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_OASIS_H
+#define GDS_OASIS_H
+#include <string>
+#include <vector>
+
+namespace GDS {
+class Library;
+
+/*
+ * OASIS (SEMI P39) files are mapped onto the GDSII model:
+ *  RECTANGLE                       ---- Box
+ *  POLYGON, TRAPEZOID, CTRAPEZOID  ---- Boundary, or Box if rectangular
+ *  CIRCLE                          ---- Boundary with 64 vertices
+ *  PATH                            ---- Path. Extensions other than flush
+ *                                       at both ends or half width at both
+ *                                       ends give a path of type 4 with the
+ *                                       BGNEXTN and ENDEXTN of the ends.
+ *  PLACEMENT                       ---- SRef, or ARef for a lattice repetition
+ * Other repetitions of an element are expanded into copies. TEXT,
+ * PROPERTY and the X-records are skipped. CBLOCK needs GDS_USE_ZLIB.
+ * A PATH has a whole half width and no round ends, so a Path of an odd
+ * width or of path type 1 is written as a POLYGON of its outline from
+ * OutlinePath. The TEXT, NODE and BOX elements of GDSII are not written;
+ * WriteOASIS refuses a library which has them rather than drop them.
+ */
+
+/*!
+ * Read an OASIS file into a library.
+ * @param file_name The path of the OASIS file.
+ * @param lib[out] The library, which is cleared first.
+ * @param err[out] The error message.
+ * @return 0 if succeeded, or FILE_ERROR, FORMAT_ERROR.
+ */
+int ReadOASIS(const std::string &file_name, Library &lib, std::string &err);
+/*!
+ * Read some cells of an OASIS file into a library. When the cell name
+ * table is strict and has S_CELL_OFFSET properties, only the records of
+ * the wanted cells are parsed; otherwise the file is scanned.
+ * @param cells The names of the cells to read.
+ */
+int ReadOASIS(const std::string &file_name, const std::vector<std::string> &cells,
+              Library &lib, std::string &err);
+/*!
+ * Write a library as an OASIS file. The cell name table is strict and
+ * written with S_CELL_OFFSET properties, so cells can be read selectively.
+ * @param compress Put the content of each cell in a CBLOCK. Ignored when
+ *                 the library is built without GDS_USE_ZLIB.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ * @return 0 if succeeded, or FILE_ERROR, FORMAT_ERROR. FORMAT_ERROR is
+ *         also returned for cells read with a layer filter.
+ */
+int WriteOASIS(const std::string &file_name, Library &lib, std::string &err,
+               bool compress = true, unsigned int threads = 0);
+
+}
+
+#endif // GDS_OASIS_H
@@ -0,0 +1,292 @@
+/*
+ * This file is part of GDSII.
+ *
+ * outline.cpp -- The source file which defines the outlines of paths.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cmath>
+#include "outline.h"
+#include "structures.h"
+#include "elements.h"
+#include "path.h"
+
+namespace GDS
+{
+
+namespace
+{
+
+const double MITER_LIMIT = 100;                 // Half widths a miter may reach.
+const double MITER_MIN = 2 / (MITER_LIMIT * MITER_LIMIT);  // 1 + cos of the sharpest mitered bend.
+const int MAX_ARC_EDGES = 64;                   // Edges of a half circle at most.
+const double ARC_ERROR = 0.5;                   // Distance of the arc edges from the circle.
+const double PI = 3.14159265358979323846;
+const double SQRT_HALF = 0.70710678118654752440;
+
+template <typename T>
+struct Vec
+{
+    T X, Y;
+    Vec(T x, T y)
+    {
+        X = x;
+        Y = y;
+    }
+};
+
+// The unit direction from a to b. The integer one is for the Manhattan paths.
+Vec<long long> Direction(const Point &a, const Point &b, long long)
+{
+    return Vec<long long>((b.X > a.X) - (b.X < a.X), (b.Y > a.Y) - (b.Y < a.Y));
+}
+
+Vec<double> Direction(const Point &a, const Point &b, double)
+{
+    double dx = (double)b.X - a.X;
+    double dy = (double)b.Y - a.Y;
+    if (dx == 0 || dy == 0)
+        return Vec<double>((dx > 0) - (dx < 0), (dy > 0) - (dy < 0));
+    if (dx == dy || dx == -dy)
+        return Vec<double>(dx > 0 ? SQRT_HALF : -SQRT_HALF, dy > 0 ? SQRT_HALF : -SQRT_HALF);
+    double length = std::sqrt(dx * dx + dy * dy);
+    return Vec<double>(dx / length, dy / length);
+}
+
+int ToGrid(long long value)
+{
+    return (int)value;
+}
+
+int ToGrid(double value)
+{
+    return (int)std::floor(value + 0.5);
+}
+
+/*
+ * The outline is built into a sink: a polygon, or the extents of its
+ * points when only those are wanted.
+ */
+struct PolygonSink
+{
+    std::vector<Point> &Points;
+
+    explicit PolygonSink(std::vector<Point> &points)
+        : Points(points)
+    {
+    }
+    void Add(int x, int y)
+    {
+        Points.push_back(Point(x, y));
+    }
+};
+
+struct BoundsSink
+{
+    int Left, Bottom, Right, Top;
+
+    BoundsSink()
+        : Left(GDS_MAX_INT), Bottom(GDS_MAX_INT), Right(GDS_MIN_INT), Top(GDS_MIN_INT)
+    {
+    }
+    void Add(int x, int y)
+    {
+        Left = x < Left ? x : Left;
+        Bottom = y < Bottom ? y : Bottom;
+        Right = x > Right ? x : Right;
+        Top = y > Top ? y : Top;
+    }
+};
+
+template <typename T, typename Sink>
+void Emit(Sink &out, T x, T y)
+{
+    out.Add(ToGrid(x), ToGrid(y));
+}
+
+// The half circle from the right of d to its left around p, without its ends.
+template <typename Sink>
+void AddArc(Sink &out, const Point &p, const Vec<double> &d, double half, int edges)
+{
+    double c = std::cos(PI / edges);
+    double s = std::sin(PI / edges);
+    double x = d.Y * half;
+    double y = -d.X * half;
+    for (int i = 1; i < edges; i++)
+    {
+        double next_x = x * c - y * s;
+        y = x * s + y * c;
+        x = next_x;
+        Emit(out, p.X + x, p.Y + y);
+    }
+}
+
+int ArcEdges(double half)
+{
+    if (half <= 2 * ARC_ERROR)
+        return 4;
+    int edges = (int)std::ceil(PI / std::acos(1 - ARC_ERROR / half));
+    edges += edges % 2;
+    return edges < 4 ? 4 : edges > MAX_ARC_EDGES ? MAX_ARC_EDGES : edges;
+}
+
+// The next point from index along step which is not at pts[index], or -1.
+ptrdiff_t NextPoint(const Point *pts, ptrdiff_t count, ptrdiff_t index, ptrdiff_t step)
+{
+    const Point &p = pts[index];
+    for (index += step; index >= 0 && index < count; index += step)
+    {
+        if (pts[index].X != p.X || pts[index].Y != p.Y)
+            return index;
+    }
+    return -1;
+}
+
+/*
+ * Add the right side of the path walked from first along step. The right
+ * of a direction d is (d.Y, -d.X), and a miter is the sum of the two
+ * normals over one plus their dot product.
+ * @return The direction of the last segment, at whose end the side stops.
+ */
+template <typename T, typename Sink>
+Vec<T> AddSide(const Point *pts, ptrdiff_t count, ptrdiff_t first, ptrdiff_t step, T half,
+               T start_extn, T end_extn, T miter_min, Sink &out)
+{
+    ptrdiff_t i = NextPoint(pts, count, first, step);
+    Vec<T> d = Direction(pts[first], pts[i], T());
+    Emit(out, pts[first].X - d.X * start_extn + d.Y * half, pts[first].Y - d.Y * start_extn - d.X * half);
+    for (ptrdiff_t j = NextPoint(pts, count, i, step); j >= 0; j = NextPoint(pts, count, i, step))
+    {
+        const Point &p = pts[i];
+        Vec<T> e = Direction(p, pts[j], T());
+        T dot = d.X * e.X + d.Y * e.Y;
+        T cross = d.X * e.Y - d.Y * e.X;
+        if (cross != 0 || dot < 0)
+        {
+            if (1 + dot < miter_min)
+            {
+                Emit(out, p.X + (d.X + d.Y) * half, p.Y + (d.Y - d.X) * half);
+                Emit(out, p.X + (e.Y - e.X) * half, p.Y - (e.X + e.Y) * half);
+            }
+            else
+            {
+                Emit(out, p.X + (d.Y + e.Y) * half / (1 + dot), p.Y - (d.X + e.X) * half / (1 + dot));
+            }
+        }
+        d = e;
+        i = j;
+    }
+    const Point &p = pts[i];
+    Emit(out, p.X + d.X * end_extn + d.Y * half, p.Y + d.Y * end_extn - d.X * half);
+    return d;
+}
+
+// Add the outline of a path to a sink, without closing it.
+template <typename Sink>
+bool AddOutline(const Point *pts, size_t count, int width, short path_type,
+                int bgn_extn, int end_extn, Sink &out)
+{
+    long long w = width < 0 ? -(long long)width : width;
+    ptrdiff_t n = (ptrdiff_t)count;
+    if (w == 0 || n < 2 || NextPoint(pts, n, 0, 1) < 0)
+        return false;
+
+    bool manhattan = path_type != 1 && w % 2 == 0;
+    for (ptrdiff_t i = 0; manhattan && i + 1 < n; i++)
+        manhattan = pts[i].X == pts[i + 1].X || pts[i].Y == pts[i + 1].Y;
+    if (manhattan)
+    {
+        long long half = w / 2;
+        long long start = path_type == 2 ? half : path_type == 4 ? bgn_extn : 0;
+        long long end = path_type == 2 ? half : path_type == 4 ? end_extn : 0;
+        AddSide<long long>(pts, n, 0, 1, half, start, end, 1LL, out);
+        AddSide<long long>(pts, n, n - 1, -1, half, end, start, 1LL, out);
+    }
+    else
+    {
+        double half = w / 2.0;
+        double start = path_type == 2 ? half : path_type == 4 ? bgn_extn : 0;
+        double end = path_type == 2 ? half : path_type == 4 ? end_extn : 0;
+        int arc_edges = path_type == 1 ? ArcEdges(half) : 0;
+        Vec<double> d = AddSide<double>(pts, n, 0, 1, half, start, end, MITER_MIN, out);
+        if (arc_edges > 0)
+            AddArc(out, pts[n - 1], d, half, arc_edges);
+        d = AddSide<double>(pts, n, n - 1, -1, half, end, start, MITER_MIN, out);
+        if (arc_edges > 0)
+            AddArc(out, pts[0], d, half, arc_edges);
+    }
+    return true;
+}
+
+}
+
+bool OutlinePath(const Point *pts, size_t count, int width, short path_type,
+                 int bgn_extn, int end_extn, std::vector<Point> &polygon)
+{
+    polygon.clear();
+    polygon.reserve(2 * count + 3 + (path_type == 1 ? 2 * MAX_ARC_EDGES : 0));
+    PolygonSink sink(polygon);
+    if (!AddOutline(pts, count, width, path_type, bgn_extn, end_extn, sink))
+        return false;
+    polygon.push_back(polygon.front());
+    return true;
+}
+
+bool OutlinePath(const Path *path, std::vector<Point> &polygon)
+{
+    const std::vector<Point> &pts = path->XY();
+    return OutlinePath(pts.data(), pts.size(), path->Width(), path->PathType(),
+                       path->BgnExtn(), path->EndExtn(), polygon);
+}
+
+bool OutlineBounds(const Path *path, int &left, int &bottom, int &right, int &top)
+{
+    const std::vector<Point> &pts = path->XY();
+    BoundsSink sink;
+    if (!AddOutline(pts.data(), pts.size(), path->Width(), path->PathType(),
+                    path->BgnExtn(), path->EndExtn(), sink))
+        return false;
+    left = sink.Left;
+    bottom = sink.Bottom;
+    right = sink.Right;
+    top = sink.Top;
+    return true;
+}
+
+size_t OutlinePaths(const Structure *cell, std::vector<Polygon> &polygons, std::vector<LayerKey> *layers)
+{
+    size_t added = 0;
+    for (size_t i = 0; i < cell->Size(); i++)
+    {
+        const Element *e = cell->Get((int)i);
+        if (e->Tag() != PATH)
+            continue;
+        const Path *path = static_cast<const Path*>(e);
+        polygons.push_back(Polygon());
+        if (!OutlinePath(path, polygons.back()))
+        {
+            polygons.pop_back();
+            continue;
+        }
+        if (layers != nullptr)
+            layers->push_back(LayerKey(path->Layer(), path->DataType()));
+        added++;
+    }
+    return added;
+}
+
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of GDSII.
+ *
+ * outline.h -- The header file which declare the outlines of paths.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_OUTLINE_H
+#define GDS_OUTLINE_H
+#include <cstddef>
+#include <vector>
+#include "tags.h"
+#include "census.h"
+
+namespace GDS {
+class Structure;
+class Path;
+
+/*!
+ * A polygon as the points of a BOUNDARY. The last point may repeat the
+ * first one; the polygons returned by the library always do.
+ */
+typedef std::vector<Point> Polygon;
+
+/*
+ * The outline of a path is its center line moved by half the width to
+ * each side, with mitered bends. A bend so sharp that its miter would
+ * reach further than 100 half widths is squared off at half the width
+ * instead. The ends are extended along the path by 0 for path type 0,
+ * half the width for type 2 and BGNEXTN/ENDEXTN for type 4. Type 1 ends
+ * in half circles, which are polygons with at most 64 edges whose
+ * vertices are on the circle.
+ *
+ * A path whose segments are all horizontal or vertical and whose width
+ * is even has integer corners, which are computed with integers. Other
+ * paths are computed with doubles and rounded to the grid; segments at
+ * 45 degrees take their directions from a table.
+ */
+
+/*!
+ * Get the outline of a path.
+ * @param pts, count The points of the path. Repeated points are skipped.
+ * @param width The width. A negative width is taken as its absolute value.
+ * @param path_type The PATHTYPE, 0, 1, 2 or 4.
+ * @param bgn_extn, end_extn The extensions of path type 4.
+ * @param polygon[out] The outline, counterclockwise and closed. The vector
+ *                     is cleared first, so a reused one keeps its memory.
+ * @return False if the path has no area: width 0 or less than two
+ *         different points.
+ */
+bool OutlinePath(const Point *pts, size_t count, int width, short path_type,
+                 int bgn_extn, int end_extn, std::vector<Point> &polygon);
+bool OutlinePath(const Path *path, std::vector<Point> &polygon);
+/*!
+ * Get the extents of the outline of a path, without building the outline.
+ * @return False if the path has no area.
+ */
+bool OutlineBounds(const Path *path, int &left, int &bottom, int &right, int &top);
+
+/*!
+ * Get the outlines of the paths of a cell. The cells under it are not
+ * visited.
+ * @param polygons[out] The outlines are appended.
+ * @param layers[out] The (layer, datatype) of each outline is appended,
+ *                    if it is not null.
+ * @return The number of outlines appended.
+ */
+size_t OutlinePaths(const Structure *cell, std::vector<Polygon> &polygons,
+                    std::vector<LayerKey> *layers = nullptr);
+
+}
+
+#endif // GDS_OUTLINE_H
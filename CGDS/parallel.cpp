@@ -0,0 +1,71 @@
+/*
+ * This file is part of GDSII.
+ *
+ * parallel.cpp -- The source file which defines the helpers to run loops on
+ *                 several threads.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "parallel.h"
+
+namespace GDS
+{
+
+unsigned int DefaultThreadCount()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void ParallelFor(size_t count, unsigned int threads,
+                 const std::function<void(size_t index, unsigned int thread)> &body)
+{
+    if (threads == 0)
+        threads = DefaultThreadCount();
+    if (threads > count)
+        threads = (unsigned int)count;
+    if (threads <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            body(i, 0);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&](unsigned int thread)
+    {
+        while (true)
+        {
+            size_t i = next.fetch_add(1);
+            if (i >= count)
+                break;
+            body(i, thread);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; t++)
+        pool.push_back(std::thread(worker, t));
+    worker(0);
+    for (auto &t : pool)
+        t.join();
+}
+
+}
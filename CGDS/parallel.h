@@ -0,0 +1,48 @@
+/*
+ * This file is part of GDSII.
+ *
+ * parallel.h -- The header file which declare the helpers to run loops on
+ *               several threads.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_PARALLEL_H
+#define GDS_PARALLEL_H
+#include <cstddef>
+#include <functional>
+
+namespace GDS {
+
+/*!
+ * Get the number of threads to use when 0 is requested.
+ */
+unsigned int DefaultThreadCount();
+
+/*!
+ * Run body(index, thread) for every index in [0, count).
+ * The indices are handed out one by one to the threads, so the work of
+ * each index may vary. body must be safe to run concurrently.
+ * @param count The number of indices.
+ * @param threads The number of threads, 0 for DefaultThreadCount().
+ * @param body The work for one index. thread is in [0, threads).
+ */
+void ParallelFor(size_t count, unsigned int threads,
+                 const std::function<void(size_t index, unsigned int thread)> &body);
+
+}
+
+#endif // GDS_PARALLEL_H
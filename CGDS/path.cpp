@@ -19,11 +19,11 @@
  * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
  **/
 
-#include <assert.h>
 #include "path.h"
 #include <sstream>
 #include <algorithm>
 #include "gdsio.h"
+#include "outline.h"
 
 namespace GDS
 {
@@ -35,6 +35,8 @@ Path::Path(Structure *parent) :Element(PATH, parent)
     mDataType = -1;
     mWidth = 0;
     mPathType = 0;
+    mBgnExtn = 0;
+    mEndExtn = 0;
 }
 
 Path::~Path()
@@ -42,6 +44,11 @@ Path::~Path()
 
 }
 
+short Path::Eflags() const
+{
+    return mEflags;
+}
+
 short Path::Layer() const
 {
     return mLayer;
@@ -62,105 +69,135 @@ short Path::PathType() const
     return mPathType;
 }
 
-std::vector<Point> Path::XY() const
+int Path::BgnExtn() const
+{
+    return mBgnExtn;
+}
+
+int Path::EndExtn() const
+{
+    return mEndExtn;
+}
+
+const std::vector<Point> &Path::XY() const
 {
     return mPts;
 }
 
+void Path::SetEflags(short eflags)
+{
+    mEflags = eflags;
+    Changed();
+}
+
 void Path::SetLayer(short layer)
 {
     mLayer = layer;
+    Changed();
 }
 
 void Path::SetDataType(short data_type)
 {
     mDataType = data_type;
+    Changed();
 }
 
 void Path::SetWidth(int width)
 {
     mWidth = width;
+    Changed();
 }
 
 void Path::SetPathType(short type)
 {
     mPathType = type;
+    Changed();
+}
+
+void Path::SetBgnExtn(int extension)
+{
+    mBgnExtn = extension;
+    Changed();
+}
+
+void Path::SetEndExtn(int extension)
+{
+    mEndExtn = extension;
+    Changed();
 }
 
 void Path::SetXY(const std::vector<Point> &pts)
 {
-    mPts.clear();
     mPts = pts;
+    Changed();
+}
+
+void Path::SetXY(std::vector<Point> &&pts)
+{
+    mPts = std::move(pts);
+    Changed();
+}
+
+bool Path::SetPoint(int index, Point pt)
+{
+    if (index < 0 || index >= (int)mPts.size())
+        return false;
+    mPts[index] = pt;
+    Changed();
+    return true;
+}
+
+bool Path::InsertPoint(int index, Point pt)
+{
+    if (index < 0 || index > (int)mPts.size())
+        return false;
+    mPts.insert(mPts.begin() + index, pt);
+    Changed();
+    return true;
+}
+
+bool Path::RemovePoint(int index)
+{
+    if (index < 0 || index >= (int)mPts.size())
+        return false;
+    mPts.erase(mPts.begin() + index);
+    Changed();
+    return true;
 }
 
 bool Path::BBox(int &x, int &y, int &w, int &h) const
 {
-    assert(mWidth > 0 && mPts.size() >= 2);
-    if (mWidth == 0 || mPts.size() < 2)
+    int left, bottom, right, top;
+    if (!OutlineBounds(this, left, bottom, right, top))
         return false;
 
-    int llx = GDS_MAX_INT;
-    int lly = GDS_MAX_INT;
-    int urx = GDS_MIN_INT;
-    int ury = GDS_MIN_INT;
-    for (auto pt : mPts)
-    {
-        llx = pt.X < llx ? pt.X : llx;
-        lly = pt.Y < lly ? pt.Y : lly;
-        urx = pt.X > urx ? pt.X : urx;
-        ury = pt.Y > ury ? pt.Y : ury;
-    }
-    // extend the path
-    for (size_t i = 1; i < mPts.size(); i++)
-    {
-        if (mPts[i - 1].X == mPts[i].X)
-        {
-            llx = (mPts[i].X - mWidth / 2) < llx ? (mPts[i].X - mWidth / 2) : llx;
-            urx = (mPts[i].X + mWidth / 2) > urx ? (mPts[i].X + mWidth / 2) : urx;
-        }
-        else
-        {
-            lly = (mPts[i].Y - mWidth / 2) < lly ? (mPts[i].Y - mWidth / 2) : lly;
-            ury = (mPts[i].Y + mWidth / 2) > ury ? (mPts[i].Y + mWidth / 2) : ury;
-        }
-    }
-    // extend the end point
-    if (mPathType > 0)
+    x = left;
+    y = bottom;
+    w = right - left;
+    h = top - bottom;
+
+    return true;
+}
+
+bool Path::Write(std::vector<char> &out) const
+{
+    PutRecord(out, PATH);
+    if (mEflags != 0)
+        PutShortRecord(out, EFLAGS, BitArray, mEflags);
+    PutShortRecord(out, LAYER, Integer_2, mLayer);
+    PutShortRecord(out, DATATYPE, Integer_2, mDataType);
+    if (mPathType != 0)
+        PutShortRecord(out, PATHTYPE, Integer_2, mPathType);
+    if (mWidth != 0)
+        PutIntRecord(out, WIDTH, mWidth);
+    if (mPathType == 4)
     {
-        if (mPts[0].X == mPts[1].X)
-        {
-            if (mPts[0].Y < mPts[1].Y)
-                lly = (mPts[0].Y - mWidth / 2) < lly ? (mPts[0].Y - mWidth / 2) : lly;
-            else
-                ury = (mPts[0].Y + mWidth / 2) > ury ? (mPts[0].Y + mWidth / 2) : ury;
-        }
-        else
-        {
-            if (mPts[0].X < mPts[1].X)
-                llx = (mPts[0].X - mWidth / 2) < llx ? (mPts[0].X - mWidth / 2) : llx;
-            else
-                urx = (mPts[0].X + mWidth / 2) > urx ? (mPts[0].X + mWidth / 2) : urx;
-        }
-        size_t n = mPts.size();
-        if (mPts[n - 2].X == mPts[n - 1].X)
-        {
-            if (mPts[n - 1].Y < mPts[n - 2].Y)
-                lly = (mPts[n - 1].Y - mWidth / 2) < lly ? (mPts[n - 1].Y - mWidth / 2) : lly;
-            else
-                ury = (mPts[n - 1].Y + mWidth / 2) > ury ? (mPts[n - 1].Y + mWidth / 2) : ury;
-        }
-        else 
-        {
-            if (mPts[n - 1].X < mPts[n - 2].X)
-                llx = (mPts[n - 1].X - mWidth / 2) < llx ? (mPts[n - 1].X - mWidth / 2) : llx;
-            else
-                urx = (mPts[n - 1].X + mWidth / 2) > urx ? (mPts[n - 1].X + mWidth / 2) : urx;
-        }
+        PutIntRecord(out, BGNEXTN, mBgnExtn);
+        PutIntRecord(out, ENDEXTN, mEndExtn);
     }
-    x = llx;
-    y = lly;
-    w = urx - llx;
-    h = ury - lly;
+    if (!PutXYRecord(out, mPts.data(), mPts.size()))
+        return false;
+    PutRecord(out, ENDEL);
 
     return true;
 }
@@ -47,28 +47,55 @@ public:
     Path(Structure* parent = nullptr);
     virtual ~Path();
 
+    /*!
+    The EFLAGS bits of the element, kept as they were read.
+    */
+    short Eflags() const;
     short Layer() const;
     short DataType() const;
     int Width() const;
     short PathType() const;
-    std::vector<Point> XY() const;
+    /*!
+    The extensions of the ends along the path, used by path type 4.
+    They may be negative.
+    */
+    int BgnExtn() const;
+    int EndExtn() const;
+    const std::vector<Point> &XY() const;
+    /*!
+    The extents of the outline given by OutlinePath.
+    */
     virtual bool BBox(int &x, int &y, int &w, int &h) const;
+    virtual bool Write(std::vector<char> &out) const;
 
+    void SetEflags(short eflags);
     void SetLayer(short layer);
     void SetDataType(short data_type);
     void SetWidth(int width);
     void SetPathType(short type);
+    void SetBgnExtn(int extension);
+    void SetEndExtn(int extension);
     void SetXY(const std::vector<Point> &pts);
+    void SetXY(std::vector<Point> &&pts);
+    /*!
+    Edit a vertex in place.
+    @return False if the index is out of range.
+    */
+    bool SetPoint(int index, Point pt);
+    bool InsertPoint(int index, Point pt);
+    bool RemovePoint(int index);
 
     /*virtual int read(std::ifstream &in, std::string &msg);
     virtual int write(std::ofstream &out, std::string &msg);*/
 
 private:
-    short               mEflags;         //< 2 bytes of bit flags. Not support yet.
+    short               mEflags;         //< 2 bytes of bit flags.
     short               mLayer;
     short               mDataType;
     int                 mWidth;
     short               mPathType;
+    int                 mBgnExtn;
+    int                 mEndExtn;
     std::vector<Point>  mPts;
 };
 
@@ -0,0 +1,184 @@
+/*
+ * This file is part of GDSII.
+ *
+ * placement.cpp -- The source file which defines the placements of SREF
+ *                  and AREF, and the rectangles the layer tools bound them
+ *                  with.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include "placement.h"
+#include "library.h"
+#include "sref.h"
+#include "aref.h"
+
+namespace GDS
+{
+
+void Extend(Rect &r, const Rect &other)
+{
+    r.Left = std::min(r.Left, other.Left);
+    r.Bottom = std::min(r.Bottom, other.Bottom);
+    r.Right = std::max(r.Right, other.Right);
+    r.Top = std::max(r.Top, other.Top);
+}
+
+void Extend(Rect &r, const Rect &other, bool &empty)
+{
+    if (empty)
+    {
+        r = other;
+        empty = false;
+        return;
+    }
+    Extend(r, other);
+}
+
+bool Touches(const Rect &a, const Rect &b)
+{
+    return a.Left <= b.Right && b.Left <= a.Right && a.Bottom <= b.Top && b.Bottom <= a.Top;
+}
+
+bool Overlaps(const Rect &a, const Rect &b)
+{
+    return a.Left < b.Right && b.Left < a.Right && a.Bottom < b.Top && b.Bottom < a.Top;
+}
+
+Rect Intersect(const Rect &a, const Rect &b)
+{
+    Rect r = { std::max(a.Left, b.Left), std::max(a.Bottom, b.Bottom),
+               std::min(a.Right, b.Right), std::min(a.Top, b.Top) };
+    return r;
+}
+
+Rect Offset(const Rect &r, const Point &o)
+{
+    Rect moved = { r.Left + o.X, r.Bottom + o.Y, r.Right + o.X, r.Top + o.Y };
+    return moved;
+}
+
+Rect Grow(const Rect &r, long long margin)
+{
+    Rect grown = { r.Left - margin, r.Bottom - margin, r.Right + margin, r.Top + margin };
+    return grown;
+}
+
+Rect Bounds(const std::vector<Point> &pts)
+{
+    Rect r = { pts[0].X, pts[0].Y, pts[0].X, pts[0].Y };
+    for (auto &p : pts)
+    {
+        r.Left = std::min<long long>(r.Left, p.X);
+        r.Bottom = std::min<long long>(r.Bottom, p.Y);
+        r.Right = std::max<long long>(r.Right, p.X);
+        r.Top = std::max<long long>(r.Top, p.Y);
+    }
+    return r;
+}
+
+Rect MapRect(const Transform &transform, const Rect &r)
+{
+    long long xs[] = { r.Left, r.Right, r.Left, r.Right };
+    long long ys[] = { r.Bottom, r.Bottom, r.Top, r.Top };
+    Rect mapped = { 0, 0, 0, 0 };
+    bool empty = true;
+    for (int i = 0; i < 4; i++)
+    {
+        Point p = transform.Map(Point((int)xs[i], (int)ys[i]));
+        Rect corner = { p.X, p.Y, p.X, p.Y };
+        Extend(mapped, corner, empty);
+    }
+    return mapped;
+}
+
+long long FloorDiv(long long a, long long b)
+{
+    long long q = a / b;
+    return q * b > a ? q - 1 : q;
+}
+
+bool ReadPlacement(const Element *e, Library *lib, Placement &p)
+{
+    if (lib == nullptr || (e->Tag() != SREF && e->Tag() != AREF))
+        return false;
+    p.Cols = p.Rows = 1;
+    p.ColPitch = p.RowPitch = Point(0, 0);
+    if (e->Tag() == SREF)
+    {
+        const SRef *ref = static_cast<const SRef*>(e);
+        p.Cell = lib->GetById(ref->SNameId());
+        p.Reflection = ref->StransFlag(REFLECTION);
+        p.Mag = ref->Mag();
+        p.Angle = ref->Angle();
+        p.Origin = ref->XY();
+    }
+    else
+    {
+        const ARef *ref = static_cast<const ARef*>(e);
+        if (!ref->Pitch(p.ColPitch, p.RowPitch))
+            return false;
+        p.Cell = lib->GetById(ref->SNameId());
+        p.Reflection = ref->StransFlag(REFLECTION);
+        p.Mag = ref->Mag();
+        p.Angle = ref->Angle();
+        p.Origin = ref->XY()[0];
+        p.Cols = ref->Col();
+        p.Rows = ref->Row();
+    }
+    return p.Cell != nullptr;
+}
+
+Point ElementOrigin(const Placement &p, int col, int row)
+{
+    return Point(p.Origin.X + p.ColPitch.X * col + p.RowPitch.X * row,
+                 p.Origin.Y + p.ColPitch.Y * col + p.RowPitch.Y * row);
+}
+
+Transform Place(const Placement &p, const Point &origin)
+{
+    Transform transform;
+    if (p.Reflection)
+        transform.Scale(1, -1);
+    transform.Scale(p.Mag, p.Mag);
+    transform.Rotate(p.Angle);
+    transform.Translate(origin.X, origin.Y);
+    return transform;
+}
+
+Transform Inverse(const Placement &p, const Point &origin)
+{
+    Transform transform;
+    transform.Translate(-origin.X, -origin.Y);
+    transform.Rotate(-p.Angle);
+    transform.Scale(1 / p.Mag, 1 / p.Mag);
+    if (p.Reflection)
+        transform.Scale(1, -1);
+    return transform;
+}
+
+void SetInstanceBounds(Placement &p, const Rect &bounds)
+{
+    // The corner instances bound the lattice.
+    p.Bounds = bounds;
+    bool empty = true;
+    int corners[][2] = { { 0, 0 }, { p.Cols - 1, 0 }, { 0, p.Rows - 1 }, { p.Cols - 1, p.Rows - 1 } };
+    for (auto &corner : corners)
+        Extend(p.AllBounds, Offset(bounds, ElementOrigin(p, corner[0], corner[1])), empty);
+}
+
+}
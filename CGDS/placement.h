@@ -0,0 +1,112 @@
+/*
+ * This file is part of GDSII.
+ *
+ * placement.h -- The header file which declare the placements of SREF and
+ *                AREF, and the rectangles the layer tools bound them with.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_PLACEMENT_H
+#define GDS_PLACEMENT_H
+#include <vector>
+#include "tags.h"
+#include "transform.h"
+
+namespace GDS {
+class Element;
+class Library;
+class Structure;
+
+/*!
+ * \brief A rectangle of closed bounds, wide enough for sums of coordinates.
+ */
+struct Rect
+{
+    long long Left, Bottom, Right, Top;
+};
+
+/*!
+ * Extend a rectangle to cover another one.
+ * @param empty[in,out] True if r covers nothing yet; r is set to other.
+ */
+void Extend(Rect &r, const Rect &other);
+void Extend(Rect &r, const Rect &other, bool &empty);
+/*!
+ * Whether two rectangles share a point, their edges included.
+ */
+bool Touches(const Rect &a, const Rect &b);
+/*!
+ * Whether two rectangles share an area.
+ */
+bool Overlaps(const Rect &a, const Rect &b);
+Rect Intersect(const Rect &a, const Rect &b);
+Rect Offset(const Rect &r, const Point &o);
+Rect Grow(const Rect &r, long long margin);
+/*!
+ * The bounds of a non-empty point list.
+ */
+Rect Bounds(const std::vector<Point> &pts);
+/*!
+ * The bounds of the corners of a rectangle mapped by a transform.
+ */
+Rect MapRect(const Transform &transform, const Rect &r);
+/*!
+ * Divide rounding toward negative infinity, for b > 0.
+ */
+long long FloorDiv(long long a, long long b);
+
+/*!
+ * \brief The instances of an SREF or an AREF; an SREF has one.
+ *
+ * Instance (col, row) is placed at ElementOrigin. Bounds are the ones of
+ * the instance at (0, 0) and AllBounds the ones of all the instances,
+ * both set by SetInstanceBounds.
+ */
+struct Placement
+{
+    const Structure    *Cell;
+    bool                Reflection;
+    double              Mag, Angle;
+    Point               Origin;
+    int                 Cols, Rows;
+    Point               ColPitch, RowPitch;
+    Rect                Bounds;
+    Rect                AllBounds;
+};
+
+/*!
+ * Read the placement of an SREF or an AREF.
+ * @param lib The library of the referred cell.
+ * @return False for other elements, malformed arrays and missing cells.
+ */
+bool ReadPlacement(const Element *e, Library *lib, Placement &p);
+Point ElementOrigin(const Placement &p, int col, int row);
+/*!
+ * The transform of the referred cell into an instance at origin, and its
+ * inverse.
+ */
+Transform Place(const Placement &p, const Point &origin);
+Transform Inverse(const Placement &p, const Point &origin);
+/*!
+ * Set the bounds of the instances from the bounds of the instance at
+ * (0, 0), found from the bounds of the cell by the caller.
+ */
+void SetInstanceBounds(Placement &p, const Rect &bounds);
+
+}
+
+#endif // GDS_PLACEMENT_H
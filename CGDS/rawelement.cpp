@@ -0,0 +1,64 @@
+/*
+ * This file is part of GDSII.
+ *
+ * rawelement.cpp -- The source file which defines the elements kept as records.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "rawelement.h"
+#include "gdsio.h"
+
+namespace GDS
+{
+
+RawElement::RawElement(Record_type tag, Structure *parent) :Element(tag, parent)
+{
+
+}
+
+RawElement::~RawElement()
+{
+
+}
+
+const std::vector<char> &RawElement::Records() const
+{
+    return mRecords;
+}
+
+bool RawElement::BBox(int &x, int &y, int &w, int &h) const
+{
+    x = y = w = h = 0;
+    return false;
+}
+
+bool RawElement::Write(std::vector<char> &out) const
+{
+    PutRecord(out, Tag());
+    out.insert(out.end(), mRecords.begin(), mRecords.end());
+    PutRecord(out, ENDEL);
+
+    return true;
+}
+
+void RawElement::SetRecords(const char *data, size_t size)
+{
+    mRecords.assign(data, data + size);
+    Changed();
+}
+
+}
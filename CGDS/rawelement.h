@@ -0,0 +1,57 @@
+/*
+ * This file is part of GDSII.
+ *
+ * rawelement.h -- The header file which declare the elements kept as records.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_RAWELEMENT_H
+#define GDS_RAWELEMENT_H
+#include "elements.h"
+
+namespace GDS {
+
+/*!
+    * \brief An element which is not modeled, kept as its GDSII records.
+    *
+    * TEXT, NODE and BOX elements are not parsed into an element of their
+    * own. Their records between the element tag and ENDEL are kept as they
+    * were read, so a cell which is written from its elements still holds
+    * them. They have no geometry for the bounding box or the layer tools.
+    */
+class RawElement : public Element
+{
+public:
+    RawElement(Record_type tag, Structure *parent = nullptr);
+    virtual ~RawElement();
+
+    /*!
+    The records after the element tag, without ENDEL.
+    */
+    const std::vector<char> &Records() const;
+    virtual bool BBox(int &x, int &y, int &w, int &h) const;
+    virtual bool Write(std::vector<char> &out) const;
+
+    void SetRecords(const char *data, size_t size);
+
+private:
+    std::vector<char>   mRecords;
+};
+
+}
+
+#endif // GDS_RAWELEMENT_H
@@ -33,7 +33,7 @@ namespace GDS
 SRef::SRef(Structure *parent) :Element(SREF, parent)
 {
     mEflags = 0;
-    mSName = "";
+    mSName = StringTable::EMPTY;
     mStrans = 0;
     mAngle = 0;
     mMag = 1;
@@ -44,7 +44,12 @@ SRef::~SRef()
 {
 }
 
-std::string SRef::SName() const
+const std::string &SRef::SName() const
+{
+    return StringTable::Instance().Str(mSName);
+}
+
+StringTable::Id SRef::SNameId() const
 {
     return mSName;
 }
@@ -64,6 +69,11 @@ double SRef::Mag() const
     return mMag;
 }
 
+short SRef::Eflags() const
+{
+    return mEflags;
+}
+
 short SRef::Strans() const
 {
     return mStrans;
@@ -74,34 +84,52 @@ bool SRef::StransFlag(STRANS_FLAG flag) const
     return (mStrans & flag) != 0;
 }
 
-void SRef::SetSName(std::string name)
+void SRef::SetSName(const std::string &name)
+{
+    mSName = StringTable::Instance().Intern(name);
+    Changed();
+}
+
+void SRef::SetSNameId(StringTable::Id name)
 {
     mSName = name;
+    Changed();
 }
 
 void SRef::SetXY(Point pt)
 {
     mPt = pt;
+    Changed();
 }
 
 void SRef::SetAnagle(double angle)
 {
     mAngle = angle;
+    Changed();
 }
 
 void SRef::SetMag(double mag)
 {
     mMag = mag;
+    Changed();
+}
+
+void SRef::SetEflags(short eflags)
+{
+    mEflags = eflags;
+    Changed();
 }
 
 void SRef::SetStrans(short strans)
 {
     mStrans = strans;
+    Changed();
 }
 
 void SRef::SetStrans(STRANS_FLAG flag, bool enable)
 {
     mStrans = enable ? (mStrans | flag) : (mStrans & (~flag));
+    Changed();
 }
 
 
@@ -113,7 +141,7 @@ bool SRef::BBox(int &x, int &y, int &w, int &h) const
     gds = Parent()->Parent();
     if (gds == nullptr)
         return false;
-    Structure *reference = gds->Get(SName());
+    Structure *reference = gds->GetById(mSName);
     if (reference == nullptr)
         return false;
 
@@ -155,6 +183,27 @@ bool SRef::BBox(int &x, int &y, int &w, int &h) const
     return true;
 }
 
+bool SRef::Write(std::vector<char> &out) const
+{
+    PutRecord(out, SREF);
+    if (mEflags != 0)
+        PutShortRecord(out, EFLAGS, BitArray, mEflags);
+    if (!PutStringRecord(out, SNAME, SName()))
+        return false;
+    if (mStrans != 0 || mMag != 1 || mAngle != 0)
+    {
+        PutShortRecord(out, STRANS, BitArray, mStrans);
+        if (mMag != 1)
+            PutDoubleRecord(out, MAG, &mMag, 1);
+        if (mAngle != 0)
+            PutDoubleRecord(out, ANGLE, &mAngle, 1);
+    }
+    PutXYRecord(out, &mPt, 1);
+    PutRecord(out, ENDEL);
+
+    return true;
+}
+
 //int SRef::read(std::ifstream &in, std::string &msg)
 //{
 //    msg = "";
@@ -22,6 +22,7 @@
 #ifndef GDS_SREF_H
 #define GDS_SREF_H
 #include "elements.h"
+#include "strtable.h"
 
 namespace GDS {
 class Structure;
@@ -43,15 +44,23 @@ public:
     SRef(Structure *parent = nullptr);
     virtual ~SRef();
 
-    std::string SName() const;
+    /*!
+    The EFLAGS bits of the element, kept as they were read.
+    */
+    short Eflags() const;
+    const std::string &SName() const;
+    StringTable::Id SNameId() const;
     Point XY() const;
     double Angle() const;
     double Mag() const;
     short Strans() const;
     bool StransFlag(STRANS_FLAG flag) const;
     virtual bool BBox(int &x, int &y, int &w, int &h) const;
+    virtual bool Write(std::vector<char> &out) const;
 
-    void SetSName(std::string name);
+    void SetEflags(short eflags);
+    void SetSName(const std::string &name);
+    void SetSNameId(StringTable::Id name);
     void SetXY(Point pt);
     void SetAnagle(double angle);
     void SetMag(double mag);
@@ -63,7 +72,7 @@ public:
 
 private:
     short               mEflags;
-    std::string         mSName;
+    StringTable::Id     mSName;
     short               mStrans;
     Point               mPt;
     double              mAngle;
@@ -0,0 +1,295 @@
+/*
+ * This file is part of GDSII.
+ *
+ * stats.cpp -- The counters and timers of the library.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "stats.h"
+#include "gdsio.h"
+
+#if defined(_MSC_VER)
+#define GDS_THREAD_LOCAL __declspec(thread)
+#else
+#define GDS_THREAD_LOCAL __thread
+#endif
+
+namespace GDS
+{
+
+namespace {
+
+const char *COUNTER_NAMES[STAT_COUNTER_COUNT] = {
+    "cells_parsed",
+    "elements_parsed",
+    "bytes_parsed",
+    "db_rows_inserted",
+    "db_rows_read",
+    "blob_bytes_written",
+    "blob_bytes_read",
+    "bbox_calls",
+    "bbox_max_depth",
+    "census_hits",
+    "census_misses",
+    "density_map_hits",
+    "density_map_misses"
+};
+
+const char *TIMER_NAMES[STAT_TIMER_COUNT] = {
+    "ConvertGDSII2DB",
+    "InsertCell",
+    "OpenDB",
+    "ReadCell",
+    "DecodeCompactCell",
+    "Structure::Read",
+    "LoadGDS",
+    "WriteGDS"
+};
+
+#ifdef GDS_ENABLE_STATS
+
+const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+struct TraceEvent
+{
+    STAT_TIMER          Timer;
+    std::thread::id     Thread;
+    long long           Start;      //< Nanoseconds since StartTrace.
+    long long           Duration;
+};
+
+std::atomic<unsigned long long> gTimerCalls[STAT_TIMER_COUNT];
+std::atomic<unsigned long long> gTimerNanoseconds[STAT_TIMER_COUNT];
+std::atomic<bool> gTracing(false);
+std::mutex gTraceMutex;
+std::chrono::steady_clock::time_point gTraceStart;
+std::vector<TraceEvent> gTraceEvents;
+unsigned long long gDroppedEvents = 0;
+
+GDS_THREAD_LOCAL unsigned int tDepth[STAT_COUNTER_COUNT];
+
+#endif
+
+}
+
+#ifdef GDS_ENABLE_STATS
+
+std::atomic<unsigned long long> gStatCounters[STAT_COUNTER_COUNT];
+
+void MaxStat(STAT_COUNTER counter, unsigned long long value)
+{
+    unsigned long long current = gStatCounters[counter].load(std::memory_order_relaxed);
+    while (current < value
+           && !gStatCounters[counter].compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+ScopedTimer::ScopedTimer(STAT_TIMER timer)
+    : mTimer(timer), mStart(std::chrono::steady_clock::now())
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    auto end = std::chrono::steady_clock::now();
+    long long duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - mStart).count();
+    gTimerCalls[mTimer].fetch_add(1, std::memory_order_relaxed);
+    gTimerNanoseconds[mTimer].fetch_add((unsigned long long)duration, std::memory_order_relaxed);
+    if (!gTracing.load(std::memory_order_relaxed))
+        return;
+
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    // The trace may have been restarted since the timer started.
+    if (!gTracing || mStart < gTraceStart)
+        return;
+    if (gTraceEvents.size() >= MAX_TRACE_EVENTS)
+    {
+        gDroppedEvents++;
+        return;
+    }
+    TraceEvent event;
+    event.Timer = mTimer;
+    event.Thread = std::this_thread::get_id();
+    event.Start = std::chrono::duration_cast<std::chrono::nanoseconds>(mStart - gTraceStart).count();
+    event.Duration = duration;
+    gTraceEvents.push_back(event);
+}
+
+ScopedDepth::ScopedDepth(STAT_COUNTER counter)
+    : mCounter(counter)
+{
+    MaxStat(counter, ++tDepth[counter]);
+}
+
+ScopedDepth::~ScopedDepth()
+{
+    --tDepth[mCounter];
+}
+
+#endif // GDS_ENABLE_STATS
+
+StatsReport::StatsReport()
+{
+#ifdef GDS_ENABLE_STATS
+    Enabled = true;
+#else
+    Enabled = false;
+#endif
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        Counters[i] = 0;
+    for (int i = 0; i < STAT_TIMER_COUNT; i++)
+    {
+        TimerCalls[i] = 0;
+        TimerNanoseconds[i] = 0;
+    }
+}
+
+std::string StatsReport::ToString() const
+{
+    if (!Enabled)
+        return "The library is built without GDS_ENABLE_STATS.\n";
+
+    std::string report;
+    char line[128];
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+    {
+        if (Counters[i] == 0)
+            continue;
+        sprintf(line, "%-24s %20llu\n", COUNTER_NAMES[i], Counters[i]);
+        report += line;
+    }
+    bool header = false;
+    for (int i = 0; i < STAT_TIMER_COUNT; i++)
+    {
+        if (TimerCalls[i] == 0)
+            continue;
+        if (!header)
+        {
+            sprintf(line, "%-24s %12s %14s %14s\n", "timer", "calls", "total ms", "mean us");
+            report += line;
+            header = true;
+        }
+        sprintf(line, "%-24s %12llu %14.3f %14.3f\n", TIMER_NAMES[i], TimerCalls[i],
+                TimerNanoseconds[i] / 1e6, TimerNanoseconds[i] / 1e3 / TimerCalls[i]);
+        report += line;
+    }
+    return report;
+}
+
+const char *StatCounterName(STAT_COUNTER counter)
+{
+    return COUNTER_NAMES[counter];
+}
+
+const char *StatTimerName(STAT_TIMER timer)
+{
+    return TIMER_NAMES[timer];
+}
+
+void ReadStats(StatsReport &report)
+{
+    report = StatsReport();
+#ifdef GDS_ENABLE_STATS
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        report.Counters[i] = gStatCounters[i];
+    for (int i = 0; i < STAT_TIMER_COUNT; i++)
+    {
+        report.TimerCalls[i] = gTimerCalls[i];
+        report.TimerNanoseconds[i] = gTimerNanoseconds[i];
+    }
+#endif
+}
+
+void ResetStats()
+{
+#ifdef GDS_ENABLE_STATS
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        gStatCounters[i] = 0;
+    for (int i = 0; i < STAT_TIMER_COUNT; i++)
+    {
+        gTimerCalls[i] = 0;
+        gTimerNanoseconds[i] = 0;
+    }
+#endif
+}
+
+void StartTrace()
+{
+#ifdef GDS_ENABLE_STATS
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    gTraceEvents.clear();
+    gDroppedEvents = 0;
+    gTraceStart = std::chrono::steady_clock::now();
+    gTracing = true;
+#endif
+}
+
+void StopTrace()
+{
+#ifdef GDS_ENABLE_STATS
+    gTracing = false;
+#endif
+}
+
+int WriteTrace(const std::string &file_name, std::string &err)
+{
+    std::ofstream out(file_name.c_str());
+    if (!out.is_open())
+    {
+        err = "Can not open " + file_name + '\n';
+        return FILE_ERROR;
+    }
+
+    out << "{\"traceEvents\":[";
+    unsigned long long dropped = 0;
+#ifdef GDS_ENABLE_STATS
+    {
+        std::lock_guard<std::mutex> lock(gTraceMutex);
+        // The threads are numbered in the order of their first events.
+        std::map<std::thread::id, int> threads;
+        char event[256];
+        for (size_t i = 0; i < gTraceEvents.size(); i++)
+        {
+            const TraceEvent &e = gTraceEvents[i];
+            auto found = threads.find(e.Thread);
+            if (found == threads.end())
+                found = threads.insert(std::make_pair(e.Thread, (int)threads.size() + 1)).first;
+            sprintf(event, "%s\n{\"name\":\"%s\",\"cat\":\"CGDS\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":1,\"tid\":%d}", i == 0 ? "" : ",", TIMER_NAMES[e.Timer],
+                    e.Start / 1e3, e.Duration / 1e3, found->second);
+            out << event;
+        }
+        dropped = gDroppedEvents;
+    }
+#endif
+    out << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+    if (out.fail())
+    {
+        err = "Failed to write " + file_name + ".\n";
+        return FILE_ERROR;
+    }
+    return 0;
+}
+
+}
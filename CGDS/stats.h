@@ -0,0 +1,172 @@
+/*
+ * This file is part of GDSII.
+ *
+ * stats.h -- The header file which declare the counters and timers of
+ *            the library.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_STATS_H
+#define GDS_STATS_H
+#include <string>
+#ifdef GDS_ENABLE_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace GDS {
+
+/*
+ * The library counts and times its hot paths when it is built with
+ * GDS_ENABLE_STATS. Otherwise the GDS_STATS_* macros expand to nothing,
+ * and the functions below report zeros and write empty traces.
+ *
+ * The counters and timers are shared by the whole process and updated
+ * atomically, so they add up the work of every Library and thread. A
+ * timer which runs while tracing also records an event, which
+ * WriteTrace writes in the Chrome trace format.
+ */
+
+enum STAT_COUNTER
+{
+    STAT_CELLS_PARSED,          //< Cells built by Structure::Read.
+    STAT_ELEMENTS_PARSED,       //< Elements built by Structure::Read.
+    STAT_BYTES_PARSED,          //< GDSII bytes read by Structure::Read.
+    STAT_DB_ROWS_INSERTED,      //< Cells inserted into cell_table.
+    STAT_DB_ROWS_READ,          //< Cells read from cell_table.
+    STAT_BLOB_BYTES_WRITTEN,    //< Bytes of the cell blobs inserted.
+    STAT_BLOB_BYTES_READ,       //< Bytes of the cell blobs read.
+    STAT_BBOX_CALLS,            //< Calls of Structure::BBox.
+    STAT_BBOX_MAX_DEPTH,        //< The deepest nesting of Structure::BBox.
+    STAT_CENSUS_HITS,           //< Structure::Census served from the cell.
+    STAT_CENSUS_MISSES,
+    STAT_DENSITY_MAP_HITS,      //< Density maps of cells reused.
+    STAT_DENSITY_MAP_MISSES,
+    STAT_COUNTER_COUNT
+};
+
+enum STAT_TIMER
+{
+    STAT_TIME_CONVERT,          //< ConvertGDSII2DB.
+    STAT_TIME_DB_INSERT,        //< Inserting a cell into cell_table.
+    STAT_TIME_OPEN_DB,          //< Library::OpenDB.
+    STAT_TIME_DB_READ,          //< Reading a cell from cell_table.
+    STAT_TIME_DECODE_COMPACT,   //< DecodeCompactCell.
+    STAT_TIME_PARSE_CELL,       //< Structure::Read.
+    STAT_TIME_LOAD_GDS,         //< Library::LoadGDS.
+    STAT_TIME_WRITE_GDS,        //< Library::WriteGDS.
+    STAT_TIMER_COUNT
+};
+
+/*!
+ * \brief A snapshot of the counters and timers.
+ */
+struct StatsReport
+{
+    bool                Enabled;    //< Whether the library was built with GDS_ENABLE_STATS.
+    unsigned long long  Counters[STAT_COUNTER_COUNT];
+    unsigned long long  TimerCalls[STAT_TIMER_COUNT];
+    unsigned long long  TimerNanoseconds[STAT_TIMER_COUNT];
+
+    StatsReport();
+    /*!
+    A table of the counters and timers which are not zero.
+    */
+    std::string ToString() const;
+};
+
+const char *StatCounterName(STAT_COUNTER counter);
+const char *StatTimerName(STAT_TIMER timer);
+
+void ReadStats(StatsReport &report);
+void ResetStats();
+
+/*!
+ * Record the timers as trace events from now on, dropping the events
+ * recorded before. At most 1 << 20 events are kept.
+ */
+void StartTrace();
+void StopTrace();
+/*!
+ * Write the events recorded since StartTrace as a Chrome trace, which can
+ * be opened by chrome://tracing or Perfetto.
+ * @return 0 if succeeded, or FILE_ERROR.
+ */
+int WriteTrace(const std::string &file_name, std::string &err);
+
+#ifdef GDS_ENABLE_STATS
+
+extern std::atomic<unsigned long long> gStatCounters[STAT_COUNTER_COUNT];
+
+inline void AddStat(STAT_COUNTER counter, unsigned long long value)
+{
+    gStatCounters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void MaxStat(STAT_COUNTER counter, unsigned long long value);
+
+/*!
+ * \brief Add the time of a scope to a timer.
+ */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(STAT_TIMER timer);
+    ~ScopedTimer();
+
+private:
+    ScopedTimer(const ScopedTimer &);
+    ScopedTimer &operator=(const ScopedTimer &);
+
+    STAT_TIMER                              mTimer;
+    std::chrono::steady_clock::time_point   mStart;
+};
+
+/*!
+ * \brief Count the nesting of a scope in the current thread, keeping the
+ * deepest nesting in a counter.
+ */
+class ScopedDepth
+{
+public:
+    explicit ScopedDepth(STAT_COUNTER counter);
+    ~ScopedDepth();
+
+private:
+    ScopedDepth(const ScopedDepth &);
+    ScopedDepth &operator=(const ScopedDepth &);
+
+    STAT_COUNTER    mCounter;
+};
+
+#define GDS_STATS_CONCAT2(a, b) a##b
+#define GDS_STATS_CONCAT(a, b) GDS_STATS_CONCAT2(a, b)
+#define GDS_STATS_ADD(counter, value) GDS::AddStat(GDS::counter, (unsigned long long)(value))
+#define GDS_STATS_TIMER(timer) GDS::ScopedTimer GDS_STATS_CONCAT(gds_timer_, __LINE__)(GDS::timer)
+#define GDS_STATS_DEPTH(counter) GDS::ScopedDepth GDS_STATS_CONCAT(gds_depth_, __LINE__)(GDS::counter)
+
+#else
+
+#define GDS_STATS_ADD(counter, value) ((void)0)
+#define GDS_STATS_TIMER(timer) ((void)0)
+#define GDS_STATS_DEPTH(counter) ((void)0)
+
+#endif // GDS_ENABLE_STATS
+
+}
+
+#endif // GDS_STATS_H
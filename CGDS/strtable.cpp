@@ -0,0 +1,210 @@
+/*
+ * This file is part of GDSII.
+ *
+ * strtable.cpp -- The source file which defines the table of interned strings.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <assert.h>
+#include <string.h>
+#include "strtable.h"
+
+namespace GDS
+{
+
+namespace {
+
+/*
+ * Find the chunk of an id and its place in the chunk.
+ */
+inline int ChunkOf(StringTable::Id id, int first_bits, StringTable::Id &offset)
+{
+    // Chunk i starts at id FIRST_CHUNK * (2^i - 1).
+    unsigned long long n = ((unsigned long long)id >> first_bits) + 1;
+    int chunk = 0;
+    while (n >> (chunk + 1))
+        chunk++;
+    offset = id - (StringTable::Id)((((unsigned long long)1 << chunk) - 1) << first_bits);
+    return chunk;
+}
+
+}
+
+StringTable &StringTable::Instance()
+{
+    static StringTable table;
+    return table;
+}
+
+StringTable::StringTable()
+{
+    for (int i = 0; i < CHUNK_COUNT; i++)
+        mChunks[i].store(nullptr);
+    mSize.store(0);
+    mIndex.store(nullptr);
+    Reset();
+}
+
+StringTable::~StringTable()
+{
+    Release();
+}
+
+size_t StringTable::Hash(const char *str, size_t size)
+{
+    // FNV-1a.
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+StringTable::Index *StringTable::NewIndex(size_t capacity, Index *previous)
+{
+    Index *index = new Index;
+    index->Mask = capacity - 1;
+    index->Slots = new std::atomic<Id>[capacity];
+    for (size_t i = 0; i < capacity; i++)
+        index->Slots[i].store(0, std::memory_order_relaxed);
+    index->Previous = previous;
+    return index;
+}
+
+void StringTable::Insert(Index *index, Id id, size_t hash)
+{
+    size_t i = hash & index->Mask;
+    while (index->Slots[i].load(std::memory_order_relaxed) != 0)
+        i = (i + 1) & index->Mask;
+    index->Slots[i].store(id + 1, std::memory_order_release);
+}
+
+bool StringTable::Lookup(const char *str, size_t size, Id &id) const
+{
+    const Index *index = mIndex.load(std::memory_order_acquire);
+    for (size_t i = Hash(str, size) & index->Mask;; i = (i + 1) & index->Mask)
+    {
+        Id slot = index->Slots[i].load(std::memory_order_acquire);
+        if (slot == 0)
+            return false;
+        const std::string &found = Str(slot - 1);
+        if (found.size() == size && memcmp(found.data(), str, size) == 0)
+        {
+            id = slot - 1;
+            return true;
+        }
+    }
+}
+
+StringTable::Id StringTable::Intern(const std::string &str)
+{
+    return Intern(str.data(), str.size());
+}
+
+StringTable::Id StringTable::Intern(const char *str, size_t size)
+{
+    Id id;
+    if (Lookup(str, size, id))
+        return id;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Another thread may have added it meanwhile.
+    if (Lookup(str, size, id))
+        return id;
+
+    id = mSize.load(std::memory_order_relaxed);
+    Id offset;
+    int chunk = ChunkOf(id, FIRST_CHUNK_BITS, offset);
+    assert(chunk < CHUNK_COUNT);
+    std::string *strings = mChunks[chunk].load(std::memory_order_relaxed);
+    if (strings == nullptr)
+    {
+        strings = new std::string[(size_t)1 << (FIRST_CHUNK_BITS + chunk)];
+        mChunks[chunk].store(strings, std::memory_order_release);
+    }
+    strings[offset].assign(str, size);
+
+    // Keep the index at most half full.
+    Index *index = mIndex.load(std::memory_order_relaxed);
+    if ((size_t)(id + 1) * 2 > index->Mask + 1)
+    {
+        Index *larger = NewIndex((index->Mask + 1) * 2, index);
+        for (Id i = 0; i < id; i++)
+        {
+            const std::string &old = Str(i);
+            Insert(larger, i, Hash(old.data(), old.size()));
+        }
+        mIndex.store(larger, std::memory_order_release);
+        index = larger;
+    }
+    Insert(index, id, Hash(str, size));
+    mSize.store(id + 1, std::memory_order_release);
+
+    return id;
+}
+
+bool StringTable::Find(const std::string &str, Id &id) const
+{
+    return Lookup(str.data(), str.size(), id);
+}
+
+const std::string &StringTable::Str(Id id) const
+{
+    Id offset;
+    int chunk = ChunkOf(id, FIRST_CHUNK_BITS, offset);
+    const std::string *strings = mChunks[chunk].load(std::memory_order_acquire);
+    assert(strings != nullptr);
+    return strings[offset];
+}
+
+size_t StringTable::Size() const
+{
+    return mSize.load(std::memory_order_acquire);
+}
+
+void StringTable::Release()
+{
+    for (int i = 0; i < CHUNK_COUNT; i++)
+    {
+        delete[] mChunks[i].load();
+        mChunks[i].store(nullptr);
+    }
+    Index *index = mIndex.load();
+    while (index != nullptr)
+    {
+        Index *previous = index->Previous;
+        delete[] index->Slots;
+        delete index;
+        index = previous;
+    }
+    mIndex.store(nullptr);
+    mSize.store(0);
+}
+
+void StringTable::Reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Release();
+        mIndex.store(NewIndex((size_t)1 << FIRST_CHUNK_BITS, nullptr));
+    }
+    Intern(std::string());
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of GDSII.
+ *
+ * strtable.h -- The header file which declare the table of interned strings.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_STRTABLE_H
+#define GDS_STRTABLE_H
+#include <atomic>
+#include <string>
+#include <mutex>
+
+namespace GDS {
+
+/*!
+    * \brief Table of interned strings, used for the names of cells.
+    *
+    * Every distinct string is stored once and is identified by a 32-bit id,
+    * so names are compared by id and read without copying. The table is
+    * shared by all libraries, which lets elements that are not in a library
+    * yet carry ids, and keeps ids of different libraries comparable.
+    *
+    * Interning takes a lock only for a string which is new; looking up a
+    * string and reading the string of an id do not lock. Ids live until
+    * Reset() or the end of the program, so the table grows with every name
+    * it is given. A program which opens many unrelated layouts one after
+    * another can Reset() the table between them.
+    */
+class StringTable
+{
+public:
+    typedef unsigned int Id;
+
+    static const Id EMPTY = 0;  //< Id of the empty string.
+
+    static StringTable &Instance();
+
+    /*!
+    Get the id of a string, adding it to the table if it is new.
+    */
+    Id Intern(const std::string &str);
+    Id Intern(const char *str, size_t size);
+    /*!
+    Get the id of a string without adding it.
+    @return False if the string is not in the table.
+    */
+    bool Find(const std::string &str, Id &id) const;
+    /*!
+    Get the string of an id. The reference stays valid until Reset().
+    */
+    const std::string &Str(Id id) const;
+    size_t Size() const;
+    /*!
+    Release every string but the empty one. Only call it when no library,
+    structure or element exists and no other thread uses the table: the ids
+    they hold would name other strings afterwards.
+    */
+    void Reset();
+
+private:
+    StringTable();
+    ~StringTable();
+    StringTable(const StringTable &);
+    StringTable &operator=(const StringTable &);
+
+    /*!
+    Open addressing hash table of ids + 1, 0 marking a free slot. A full
+    index is replaced by a larger one and kept until Reset(), since a reader
+    may still be looking through it.
+    */
+    struct Index
+    {
+        size_t Mask;
+        std::atomic<Id> *Slots;
+        Index *Previous;
+    };
+
+    static size_t Hash(const char *str, size_t size);
+    bool Lookup(const char *str, size_t size, Id &id) const;
+    Index *NewIndex(size_t capacity, Index *previous);
+    void Insert(Index *index, Id id, size_t hash);
+    void Release();
+
+    // Chunk i holds FIRST_CHUNK << i strings, so a few chunks cover all ids
+    // and strings are never moved.
+    static const int FIRST_CHUNK_BITS = 10;
+    static const int CHUNK_COUNT = 23;
+
+    std::atomic<std::string*> mChunks[CHUNK_COUNT];
+    std::atomic<Id> mSize;
+    std::atomic<Index*> mIndex;
+    std::mutex mMutex;          //< Held while adding a string.
+};
+
+}
+
+#endif // GDS_STRTABLE_H
@@ -29,7 +29,10 @@
 #include "path.h"
 #include "sref.h"
 #include "aref.h"
+#include "box.h"
+#include "rawelement.h"
 #include "gdsio.h"
+#include "stats.h"
 //#include "text.h"
 #include <ctime>
 
@@ -38,7 +41,7 @@ namespace GDS
 
 Structure::Structure(Library *parent)
 {
-    mStructName = "";
+    mStructName = StringTable::EMPTY;
     mParent = parent;
 
     time_t now = time(0);
@@ -58,11 +61,13 @@ Structure::Structure(Library *parent)
 
     mIsCached = true;
     mIsChanged = false;
+    mIsFiltered = false;
+    mHasCensus = false;
 }
 
-Structure::Structure(std::string name, Library *parent)
+Structure::Structure(const std::string &name, Library *parent)
 {
-    mStructName = name;
+    mStructName = StringTable::Instance().Intern(name);
     mParent = parent;
 
     time_t now = time(0);
@@ -82,10 +87,14 @@ Structure::Structure(std::string name, Library *parent)
     
     mIsCached = true;
     mIsChanged = false;
+    mIsFiltered = false;
+    mHasCensus = false;
 }
 
 Structure::~Structure()
 {
+    for (auto e : mElements)
+        delete e;
     mElements.clear();
 }
 
@@ -94,7 +103,12 @@ Library* Structure::Parent() const
     return mParent;
 }
 
-std::string Structure::Name() const
+const std::string &Structure::Name() const
+{
+    return StringTable::Instance().Str(mStructName);
+}
+
+StringTable::Id Structure::NameId() const
 {
     return mStructName;
 }
@@ -118,6 +132,55 @@ void Structure::Add(Element *new_element)
         return;
     mElements.push_back(new_element);
     new_element->SetParent(this);
+    mIsChanged = true;
+    mHasCensus = false;
+}
+
+size_t Structure::Remove(const std::vector<bool> &flags)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < mElements.size(); i++)
+    {
+        if (i < flags.size() && flags[i])
+            delete mElements[i];
+        else
+            mElements[kept++] = mElements[i];
+    }
+    size_t removed = mElements.size() - kept;
+    mElements.resize(kept);
+    if (removed > 0)
+    {
+        mIsChanged = true;
+        mHasCensus = false;
+    }
+    return removed;
+}
+
+bool Structure::IsCached() const
+{
+    return mIsCached;
+}
+
+void Structure::SetCached(bool flag)
+{
+    mIsCached = flag;
+}
+
+bool Structure::IsChanged() const
+{
+    return mIsChanged;
+}
+
+void Structure::SetChanged(bool flag)
+{
+    mIsChanged = flag;
+    if (flag)
+        mHasCensus = false;
+}
+
+bool Structure::IsFiltered() const
+{
+    return mIsFiltered;
 }
 
 void Structure::SetParent(Library* parent)
@@ -127,6 +190,8 @@ void Structure::SetParent(Library* parent)
 
 bool Structure::BBox(int &x, int &y, int &w, int &h) const
 {
+    GDS_STATS_ADD(STAT_BBOX_CALLS, 1);
+    GDS_STATS_DEPTH(STAT_BBOX_MAX_DEPTH);
     int llx = GDS_MAX_INT;
     int lly = GDS_MAX_INT;
     int urx = GDS_MIN_INT;
@@ -134,6 +199,16 @@ bool Structure::BBox(int &x, int &y, int &w, int &h) const
     bool ret = false;
     for (auto node : mElements)
     {
+        if (node->Tag() == BOX_BOUNDARY)
+        {
+            const Box *box = static_cast<const Box*>(node);
+            ret = true;
+            llx = box->Left() < llx ? box->Left() : llx;
+            lly = box->Bottom() < lly ? box->Bottom() : lly;
+            urx = box->Right() > urx ? box->Right() : urx;
+            ury = box->Top() > ury ? box->Top() : ury;
+            continue;
+        }
         int _x, _y, _w, _h;
         if (node->BBox(_x, _y, _w, _h))
         {
@@ -152,6 +227,21 @@ bool Structure::BBox(int &x, int &y, int &w, int &h) const
     return ret;
 }
 
+const LayerCensus &Structure::Census() const
+{
+    if (!mHasCensus)
+    {
+        GDS_STATS_ADD(STAT_CENSUS_MISSES, 1);
+        mCensus.clear();
+        for (auto node : mElements)
+            AddToCensus(mCensus, node);
+        mHasCensus = true;
+        return mCensus;
+    }
+    GDS_STATS_ADD(STAT_CENSUS_HITS, 1);
+    return mCensus;
+}
+
 //void Structure::AddReferBy(std::shared_ptr<Structure> cell)
 //{
 //    bool existed = false;
@@ -387,6 +477,415 @@ bool Structure::BBox(int &x, int &y, int &w, int &h) const
 //}
 
 
+bool Structure::Write(std::vector<char> &out) const
+{
+    short dates[] = {
+        mModYear, mModMonth, mModDay, mModHour, mModMinute, mModSecond,
+        mAccYear, mAccMonth, mAccDay, mAccHour, mAccMinute, mAccSecond
+    };
+    if (mIsFiltered)
+        return false;
+    PutShortRecord(out, BGNSTR, Integer_2, dates, 12);
+    if (!PutStringRecord(out, STRNAME, Name()))
+        return false;
+    for (auto node : mElements)
+    {
+        if (!node->Write(out))
+            return false;
+    }
+    PutRecord(out, ENDSTR);
+
+    return true;
+}
+
+namespace
+{
+
+// The records of an element collected before the element is created.
+struct ElementRecords
+{
+    short eflags;
+    short layer;
+    short data_type;
+    short path_type;
+    int width;
+    int bgn_extn, end_extn;
+    StringTable::Id sname;
+    short strans;
+    double angle;
+    double mag;
+    short col, row;
+};
+
+std::string RecordSizeError(Byte record_type, int record_size)
+{
+    std::stringstream ss;
+    ss << "GDSII format error: wrong record size of ";
+    std::map<int, std::string>::const_iterator iter = Record_name.find(record_type);
+    ss << (iter == Record_name.end() ? "RECORD_UNKNOWN" : iter->second);
+    ss << " (" << record_size << ").\n";
+    return ss.str();
+}
+
+/*
+ * Look for the LAYER of an element without parsing it. If the layer is
+ * rejected by the filter, move the cursor after the ENDEL of the element.
+ * Malformed elements are kept, so ReadElement reports them.
+ * @return True if the element is skipped.
+ */
+bool SkipFilteredElement(const LayerFilter &filter, const char *&cursor, const char *end)
+{
+    const char *next = cursor;
+    bool rejected = false;
+    while (true)
+    {
+        int record_size;
+        Byte record_type, record_dt;
+        if (!ReadRecordHeader(next, end, record_size, record_type, record_dt))
+            return false;
+        if (record_type == LAYER && !rejected)
+        {
+            short layer;
+            if (record_size != 6)
+                return false;
+            Decode(next, layer);
+            if (filter.Accept(layer))
+                return false;
+            rejected = true;
+        }
+        next += record_size - 4;
+        if (record_type == ENDEL)
+            break;
+    }
+    if (!rejected)
+        return false;
+    cursor = next;
+    return true;
+}
+
+/*
+ * Keep the records of an element which is not modeled, until ENDEL.
+ * The cursor points to the record after the element tag.
+ */
+Element *ReadRawElement(Byte tag, const char *&cursor, const char *end, std::string &msg)
+{
+    const char *data = cursor;
+    while (true)
+    {
+        int record_size;
+        Byte record_type, record_dt;
+        const char *record = cursor;
+        if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
+        {
+            msg = "GDSII format error: unexpected end of element data.\n";
+            return nullptr;
+        }
+        cursor += record_size - 4;
+        if (record_type == ENDEL)
+        {
+            RawElement *element = new RawElement(Record_type(tag));
+            element->SetRecords(data, record - data);
+            return element;
+        }
+    }
+}
+
+/*
+ * Read the records of an element until ENDEL.
+ * The cursor points to the record after the element tag.
+ */
+Element *ReadElement(Byte tag,
+                     const char *&cursor,
+                     const char *end,
+                     std::vector<Point> &pts,
+                     std::string &msg)
+{
+    ElementRecords records;
+    records.eflags = 0;
+    records.layer = -1;
+    records.data_type = -1;
+    records.path_type = 0;
+    records.width = 0;
+    records.bgn_extn = 0;
+    records.end_extn = 0;
+    records.sname = StringTable::EMPTY;
+    records.strans = 0;
+    records.angle = 0;
+    records.mag = 1;
+    records.col = 0;
+    records.row = 0;
+    pts.clear();
+
+    while (true)
+    {
+        int record_size;
+        Byte record_type, record_dt;
+        if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
+        {
+            msg = "GDSII format error: unexpected end of element data.\n";
+            return nullptr;
+        }
+        const char *data = cursor;
+        cursor += record_size - 4;
+
+        bool finished = false;
+        switch (record_type)
+        {
+        case ENDEL:
+            finished = true;
+            break;
+        case EFLAGS:
+        case LAYER:
+        case DATATYPE:
+        case PATHTYPE:
+        case STRANS:
+        {
+            if (record_size != 6)
+            {
+                msg = RecordSizeError(record_type, record_size);
+                return nullptr;
+            }
+            short value;
+            Decode(data, value);
+            if (record_type == EFLAGS)
+                records.eflags = value;
+            else if (record_type == LAYER)
+                records.layer = value;
+            else if (record_type == DATATYPE)
+                records.data_type = value;
+            else if (record_type == PATHTYPE)
+                records.path_type = value;
+            else
+                records.strans = value;
+            break;
+        }
+        case WIDTH:
+        case BGNEXTN:
+        case ENDEXTN:
+            if (record_size != 8)
+            {
+                msg = RecordSizeError(record_type, record_size);
+                return nullptr;
+            }
+            if (record_type == WIDTH)
+                Decode(data, records.width);
+            else
+                Decode(data, record_type == BGNEXTN ? records.bgn_extn : records.end_extn);
+            break;
+        case MAG:
+        case ANGLE:
+            if (record_size != 12)
+            {
+                msg = RecordSizeError(record_type, record_size);
+                return nullptr;
+            }
+            Decode(data, record_type == MAG ? records.mag : records.angle);
+            break;
+        case COLROW:
+            if (record_size != 8)
+            {
+                msg = RecordSizeError(record_type, record_size);
+                return nullptr;
+            }
+            Decode(data, records.col);
+            Decode(data + 2, records.row);
+            break;
+        case SNAME:
+        {
+            int length = 0;
+            while (length < record_size - 4 && data[length] != '\0')
+                length++;
+            records.sname = StringTable::Instance().Intern(data, length);
+            break;
+        }
+        case XY:
+        {
+            if ((record_size - 4) % 8 != 0)
+            {
+                msg = RecordSizeError(record_type, record_size);
+                return nullptr;
+            }
+            int num = (record_size - 4) / 8;
+            pts.resize(num);
+            for (int i = 0; i < num; i++)
+            {
+                Decode(data + 8 * i, pts[i].X);
+                Decode(data + 8 * i + 4, pts[i].Y);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        if (finished)
+            break;
+    }
+
+    switch (tag)
+    {
+    case BOUNDARY:
+    {
+        if (pts.size() < 4)
+        {
+            msg = "GDSII format error: wrong number of points of BOUNDARY.\n";
+            return nullptr;
+        }
+        if (records.eflags == 0 && Box::IsRectangle(pts))
+        {
+            Box *box = new Box;
+            box->SetLayer(records.layer);
+            box->SetDataType(records.data_type);
+            box->SetXY(pts);
+            return box;
+        }
+        // A Box has no EFLAGS, so flagged rectangles stay boundaries.
+        Boundary *boundary = new Boundary;
+        boundary->SetEflags(records.eflags);
+        boundary->SetLayer(records.layer);
+        boundary->SetDataType(records.data_type);
+        boundary->SetXY(std::move(pts));
+        return boundary;
+    }
+    case PATH:
+    {
+        if (pts.size() < 2)
+        {
+            msg = "GDSII format error: wrong number of points of PATH.\n";
+            return nullptr;
+        }
+        Path *path = new Path;
+        path->SetEflags(records.eflags);
+        path->SetLayer(records.layer);
+        path->SetDataType(records.data_type);
+        path->SetPathType(records.path_type);
+        path->SetWidth(records.width);
+        path->SetBgnExtn(records.bgn_extn);
+        path->SetEndExtn(records.end_extn);
+        path->SetXY(std::move(pts));
+        return path;
+    }
+    case SREF:
+    {
+        if (pts.size() != 1)
+        {
+            msg = "GDSII format error: wrong number of points of SREF.\n";
+            return nullptr;
+        }
+        SRef *sref = new SRef;
+        sref->SetEflags(records.eflags);
+        sref->SetSNameId(records.sname);
+        sref->SetStrans(records.strans);
+        sref->SetAnagle(records.angle);
+        sref->SetMag(records.mag);
+        sref->SetXY(pts[0]);
+        return sref;
+    }
+    case AREF:
+    {
+        if (pts.size() != 3)
+        {
+            msg = "GDSII format error: wrong number of points of AREF.\n";
+            return nullptr;
+        }
+        ARef *aref = new ARef;
+        aref->SetEflags(records.eflags);
+        aref->SetSNameId(records.sname);
+        aref->SetStrans(records.strans);
+        aref->SetAngle(records.angle);
+        aref->SetMag(records.mag);
+        aref->SetRowCol(records.row, records.col);
+        aref->SetXY(std::move(pts));
+        return aref;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+}
+
+int Structure::Read(const char *data, size_t size, std::string &msg, const LayerFilter *filter)
+{
+    GDS_STATS_TIMER(STAT_TIME_PARSE_CELL);
+    const char *cursor = data;
+    const char *end = data + size;
+    int record_size;
+    Byte record_type, record_dt;
+
+    if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt)
+        || record_type != BGNSTR)
+    {
+        msg = "GDSII format error: unexpected tag where 'BGNSTR' is expected.\n";
+        return FORMAT_ERROR;
+    }
+    if (record_size != 28)
+    {
+        msg = "GDSII format error: incorrect record size of 'BGNSTR'.\n";
+        return FORMAT_ERROR;
+    }
+    Decode(cursor, mModYear);
+    Decode(cursor + 2, mModMonth);
+    Decode(cursor + 4, mModDay);
+    Decode(cursor + 6, mModHour);
+    Decode(cursor + 8, mModMinute);
+    Decode(cursor + 10, mModSecond);
+    Decode(cursor + 12, mAccYear);
+    Decode(cursor + 14, mAccMonth);
+    Decode(cursor + 16, mAccDay);
+    Decode(cursor + 18, mAccHour);
+    Decode(cursor + 20, mAccMinute);
+    Decode(cursor + 22, mAccSecond);
+    cursor += 24;
+
+    if (filter != nullptr && filter->IsEmpty())
+        filter = nullptr;
+    mIsFiltered = false;
+    std::vector<Point> pts;
+    while (true)
+    {
+        if (!ReadRecordHeader(cursor, end, record_size, record_type, record_dt))
+        {
+            msg = "GDSII format error: unexpected end of the data of cell " + Name() + ".\n";
+            return FORMAT_ERROR;
+        }
+        switch (record_type)
+        {
+        case ENDSTR:
+            // The elements match the data which was read.
+            mIsChanged = false;
+            GDS_STATS_ADD(STAT_CELLS_PARSED, 1);
+            GDS_STATS_ADD(STAT_ELEMENTS_PARSED, mElements.size());
+            GDS_STATS_ADD(STAT_BYTES_PARSED, size);
+            return 0;
+        case BOUNDARY:
+        case PATH:
+        case SREF:
+        case AREF:
+        case TEXT:
+        case NODE:
+        case BOX:
+        {
+            if (filter != nullptr && record_type != SREF && record_type != AREF
+                && SkipFilteredElement(*filter, cursor, end))
+            {
+                mIsFiltered = true;
+                break;
+            }
+            Element *element = record_type == TEXT || record_type == NODE || record_type == BOX
+                ? ReadRawElement(record_type, cursor, end, msg)
+                : ReadElement(record_type, cursor, end, pts, msg);
+            if (element == nullptr)
+                return FORMAT_ERROR;
+            Add(element);
+            break;
+        }
+        default:
+            cursor += record_size - 4;
+            break;
+        }
+    }
+}
+
 }
 
 
@@ -24,6 +24,8 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include "strtable.h"
+#include "census.h"
 
 namespace GDS {
 class Library;
@@ -33,10 +35,14 @@ class Structure
 { 
 public:
     Structure(Library *parent = nullptr);
-    Structure(std::string name, Library *parent = nullptr);
+    Structure(const std::string &name, Library *parent = nullptr);
+    /*!
+    The elements are owned by the structure and deleted with it.
+    */
     ~Structure();
 
-    std::string Name() const;
+    const std::string &Name() const;
+    StringTable::Id NameId() const;
     size_t Size() const;
     Element* Get(int index) const;
     /*!
@@ -49,18 +55,61 @@ public:
     will return false.
     */
     bool BBox(int &x, int &y, int &w, int &h) const;
+    /*!
+    Get the shapes of current structure itself by (layer, datatype),
+    without the referred cells. The census is computed on the first call
+    and kept until Add(), Read() or SetChanged(true). The extents of a
+    Path are those of its outline from OutlinePath.
+    */
+    const LayerCensus &Census() const;
     void Add(Element *new_element);
+    /*!
+    Delete the elements whose flags are set, and keep the others in order.
+    @param flags One flag for each element; missing flags are not set.
+    @return The number of elements deleted.
+    */
+    size_t Remove(const std::vector<bool> &flags);
+    /*!
+    Read the elements of current structure from the GDSII records of a cell.
+    Rectangular boundaries are kept as Box elements, and TEXT, NODE and BOX
+    as RawElement.
+    @param data The records from BGNSTR to ENDSTR.
+    @param size The size of the data in bytes.
+    @param msg[out] The error message.
+    @param filter The layers to keep, or null for every layer. The elements
+                  on the other layers, but SREF and AREF, are skipped without
+                  being parsed.
+    @return 0 if succeeded, or FORMAT_ERROR.
+    */
+    int Read(const char *data, size_t size, std::string &msg, const LayerFilter *filter = nullptr);
+    /*!
+    Append the GDSII records of current structure, from BGNSTR to ENDSTR,
+    to a buffer.
+    @return False if an element can not be written as GDSII records, or
+    elements were skipped by a layer filter when the structure was read.
+    */
+    bool Write(std::vector<char> &out) const;
     bool IsCached() const;
     void SetCached(bool flag);
+    /*!
+    Whether current structure differs from its data in the database.
+    Add() and the setters of its elements set the flag, so the structure
+    is written from its elements instead of copied from the database.
+    */
     bool IsChanged() const;
     void SetChanged(bool flag);
+    /*!
+    Whether elements were skipped by a layer filter when current structure
+    was read. Such a structure can not be written without losing them.
+    */
+    bool IsFiltered() const;
     Library *Parent() const;
 
 private:
     
     void SetParent(Library *parent);
 
-    std::string     mStructName;
+    StringTable::Id mStructName;
     short           mModYear;
     short           mModMonth;
     short           mModDay;
@@ -79,6 +128,9 @@ private:
 
     bool mIsCached;     //< Indicate the content of current cell has been cached or not.
     bool mIsChanged;
+    bool mIsFiltered;
+    mutable bool        mHasCensus;
+    mutable LayerCensus mCensus;
     
 };
 
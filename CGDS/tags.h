@@ -97,11 +97,15 @@ enum Record_type : Byte
     EFLAGS       = 0x26,
     NODETYPE	 = 0x2a,
 
+    BOX          = 0x2d,
+    BOXTYPE      = 0x2e,
+
     PLEX         = 0x2f,
     BGNEXTN      = 0x30,
     ENDEXTN      = 0x31,
 
     RECORD_UNKNOWN     = 0x79,
+    BOX_BOUNDARY       = 0x7a,  //< Not a GDSII record: rectangular BOUNDARY kept as Box.
 };
 
 const std::map<int, std::string> Record_name = {
@@ -140,9 +144,14 @@ const std::map<int, std::string> Record_name = {
     { 0x26, "EFLAGS" },
     { 0x2a, "NODETYPE" },
 
+    { 0x2d, "BOX" },
+    { 0x2e, "BOXTYPE" },
+
     { 0x2f, "PLEX" },
     { 0x30, "BGNEXTN" },
     { 0x31, "ENDEXTN" },
+
+    { 0x7a, "BOX_BOUNDARY" },
 };
 
 enum Data_type : Byte
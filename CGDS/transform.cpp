@@ -61,13 +61,13 @@ GDS::Transform & GDS::Transform::Rotate(double degrees)
     double tmp[][3] = { { 0,0,0 },{ 0,0,0 },{ 0,0,0 } };
 
     tmp[0][0] = mMatrix[0][0] * std::cos(angle) - mMatrix[0][1] * std::sin(angle);
-    tmp[0][1] = mMatrix[0][0] * std::cos(angle) + mMatrix[0][1] * std::sin(angle);
+    tmp[0][1] = mMatrix[0][0] * std::sin(angle) + mMatrix[0][1] * std::cos(angle);
     tmp[0][2] = mMatrix[0][2];
     tmp[1][0] = mMatrix[1][0] * std::cos(angle) - mMatrix[1][1] * std::sin(angle);
-    tmp[1][1] = mMatrix[1][0] * std::cos(angle) + mMatrix[1][1] * std::sin(angle);
+    tmp[1][1] = mMatrix[1][0] * std::sin(angle) + mMatrix[1][1] * std::cos(angle);
     tmp[1][2] = mMatrix[1][2];
     tmp[2][0] = mMatrix[2][0] * std::cos(angle) - mMatrix[2][1] * std::sin(angle);
-    tmp[2][1] = mMatrix[2][0] * std::cos(angle) + mMatrix[2][1] * std::sin(angle);
+    tmp[2][1] = mMatrix[2][0] * std::sin(angle) + mMatrix[2][1] * std::cos(angle);
     tmp[2][2] = mMatrix[2][2];
 
     for (int i = 0; i < 3; i++)
@@ -81,11 +81,34 @@ GDS::Transform & GDS::Transform::Rotate(double degrees)
     return *this;
 }
 
-GDS::Point GDS::Transform::Map(GDS::Point p)
+GDS::Transform & GDS::Transform::Multiply(const Transform &other)
+{
+    double tmp[][3] = { { 0,0,0 },{ 0,0,0 },{ 0,0,0 } };
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            for (int k = 0; k < 3; k++)
+                tmp[i][j] += mMatrix[i][k] * other.mMatrix[k][j];
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            mMatrix[i][j] = tmp[i][j];
+        }
+    }
+
+    return *this;
+}
+
+GDS::Point GDS::Transform::Map(GDS::Point p) const
 {
     Point ret;
-    ret.X = p.X * mMatrix[0][0] + p.Y * mMatrix[1][0];
-    ret.Y = p.X * mMatrix[1][0] + p.Y * mMatrix[1][1];
+    ret.X = (int)std::floor(p.X * mMatrix[0][0] + p.Y * mMatrix[1][0] + mMatrix[2][0] + 0.5);
+    ret.Y = (int)std::floor(p.X * mMatrix[0][1] + p.Y * mMatrix[1][1] + mMatrix[2][1] + 0.5);
     return ret;
 }
 
@@ -14,8 +14,16 @@ namespace GDS
         Transform& Scale(double xScale, double yScale);
         Transform& Translate(double x, double y);
         Transform& Rotate(double degrees);
+        /*!
+        Append the operations of another transform after the current ones.
+        */
+        Transform& Multiply(const Transform &other);
 
-        Point Map(Point p);
+        /*!
+        Map a point as a row vector, [x y 1] * matrix, rounded to the
+        nearest integer. The operations above apply in call order.
+        */
+        Point Map(Point p) const;
     private:
         double mMatrix[3][3];
     };
@@ -0,0 +1,124 @@
+/*
+ * This file is part of GDSII.
+ *
+ * check.cpp -- A small harness for the tests of the library.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "check.h"
+#include "CGDS/structures.h"
+#include "CGDS/box.h"
+#include "CGDS/sref.h"
+#include "CGDS/aref.h"
+
+namespace {
+
+struct Registered
+{
+    const char          *Name;
+    GDS::TestFunction   Body;
+};
+
+std::vector<Registered> &Tests()
+{
+    static std::vector<Registered> tests;
+    return tests;
+}
+
+const char *gCurrent = "";
+int gFailures = 0;
+
+}
+
+namespace GDS {
+
+TestRegistrar::TestRegistrar(const char *name, TestFunction body)
+{
+    Registered test = { name, body };
+    Tests().push_back(test);
+}
+
+void ReportFailure(const char *file, int line, const std::string &message)
+{
+    printf("%s:%d: %s: %s\n", file, line, gCurrent, message.c_str());
+    fflush(stdout);
+    gFailures++;
+}
+
+std::string TestFile(const std::string &suffix)
+{
+    return std::string(gCurrent) + suffix;
+}
+
+void AddBox(Structure *cell, LayerKey layer, int x, int y, int w, int h)
+{
+    Box *box = new Box;
+    box->SetLayer(layer.first);
+    box->SetDataType(layer.second);
+    box->SetRect(x, y, w, h);
+    cell->Add(box);
+}
+
+SRef *AddSRef(Structure *cell, const std::string &name, int x, int y)
+{
+    SRef *sref = new SRef;
+    sref->SetSName(name);
+    sref->SetXY(Point(x, y));
+    cell->Add(sref);
+    return sref;
+}
+
+ARef *AddARef(Structure *cell, const std::string &name, int x, int y, int cols, int rows,
+              int col_pitch, int row_pitch)
+{
+    std::vector<Point> pts;
+    pts.push_back(Point(x, y));
+    pts.push_back(Point(x + cols * col_pitch, y));
+    pts.push_back(Point(x, y + rows * row_pitch));
+    ARef *aref = new ARef;
+    aref->SetSName(name);
+    aref->SetRowCol(rows, cols);
+    aref->SetXY(std::move(pts));
+    cell->Add(aref);
+    return aref;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int failed = 0, run = 0;
+    for (auto &test : Tests())
+    {
+        if (argc > 1 && strstr(test.Name, argv[1]) == nullptr)
+            continue;
+        gCurrent = test.Name;
+        int before = gFailures;
+        test.Body();
+        run++;
+        if (gFailures != before)
+            failed++;
+        printf("%-40s %s\n", test.Name, gFailures == before ? "ok" : "FAILED");
+        fflush(stdout);
+    }
+    printf("%d of %d tests failed\n", failed, run);
+    return failed;
+}
@@ -0,0 +1,121 @@
+/*
+ * This file is part of GDSII.
+ *
+ * check.h -- The header file which declare a small harness for the tests
+ *            of the library.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef GDS_TESTS_CHECK_H
+#define GDS_TESTS_CHECK_H
+#include <sstream>
+#include <string>
+#include "CGDS/census.h"
+
+/*
+ * Each test executable links check.cpp, whose main runs the tests
+ * registered by GDS_TEST in the order of registration, or the tests whose
+ * names contain the first argument. A failed check is reported with its
+ * file and line and the test goes on; the exit code is the number of
+ * failed tests.
+ */
+
+namespace GDS {
+
+typedef void (*TestFunction)();
+
+struct TestRegistrar
+{
+    TestRegistrar(const char *name, TestFunction body);
+};
+
+void ReportFailure(const char *file, int line, const std::string &message);
+
+/*!
+ * A file name in the working directory of the test, unique to the test.
+ */
+std::string TestFile(const std::string &suffix);
+
+class Structure;
+class SRef;
+class ARef;
+
+/*!
+ * Add a box of w x h with the lower left corner at (x, y) to cell.
+ */
+void AddBox(Structure *cell, LayerKey layer, int x, int y, int w, int h);
+/*!
+ * Add an SREF of the cell name at (x, y) to cell.
+ */
+SRef *AddSRef(Structure *cell, const std::string &name, int x, int y);
+/*!
+ * Add an AREF of the cell name to cell, with cols x rows instances at a
+ * pitch of col_pitch and row_pitch from (x, y).
+ */
+ARef *AddARef(Structure *cell, const std::string &name, int x, int y, int cols, int rows,
+              int col_pitch, int row_pitch);
+
+}
+
+#define GDS_TEST(name) \
+    static void name(); \
+    static GDS::TestRegistrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+            GDS::ReportFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+    } while (0)
+
+#define CHECK_EQ(expected, actual) \
+    do { \
+        auto gds_expected = (expected); \
+        auto gds_actual = (actual); \
+        if (!(gds_expected == gds_actual)) \
+        { \
+            std::ostringstream gds_message; \
+            gds_message << "CHECK_EQ(" #expected ", " #actual "): " << gds_expected << " != " << gds_actual; \
+            GDS::ReportFailure(__FILE__, __LINE__, gds_message.str()); \
+        } \
+    } while (0)
+
+/*!
+ * Check that a call returning bool succeeds, or a call returning an error
+ * code returns 0, and report err otherwise.
+ */
+#define CHECK_OK(call, err) \
+    do { \
+        if (!GDS::Succeeded(call)) \
+            GDS::ReportFailure(__FILE__, __LINE__, "CHECK_OK(" #call "): " + (err)); \
+    } while (0)
+
+namespace GDS {
+
+inline bool Succeeded(bool ok)
+{
+    return ok;
+}
+
+inline bool Succeeded(int rc)
+{
+    return rc == 0;
+}
+
+}
+
+#endif // GDS_TESTS_CHECK_H
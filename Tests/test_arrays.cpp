@@ -0,0 +1,160 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_arrays.cpp -- The tests of the recognition and expansion of arrays.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <vector>
+#include "check.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/sref.h"
+#include "CGDS/arrays.h"
+#include "CGDS/boolean.h"
+
+using namespace GDS;
+
+namespace {
+
+const LayerKey METAL(1, 0);
+
+/*
+ * A 4 x 3 grid of SREFs at a pitch of 300 x 500, a mirrored SREF on the
+ * grid, and two SREFs off it.
+ */
+Structure *MakeLayout(Library &lib)
+{
+    AddBox(lib.Add("LEAF"), METAL, 0, 0, 200, 100);
+
+    Structure *top = lib.Add("TOP");
+    AddSRef(top, "LEAF", -700, 40);
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            AddSRef(top, "LEAF", 1000 + 300 * col, 2000 + 500 * row);
+    AddSRef(top, "LEAF", 1300, 3500)->SetStrans(REFLECTION);
+    AddSRef(top, "LEAF", 5000, -60);
+    return top;
+}
+
+bool PointLess(const Point &a, const Point &b)
+{
+    return a.X != b.X ? a.X < b.X : a.Y < b.Y;
+}
+
+bool PointEqual(const Point &a, const Point &b)
+{
+    return a.X == b.X && a.Y == b.Y;
+}
+
+bool PolygonLess(const Polygon &a, const Polygon &b)
+{
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), PointLess);
+}
+
+/*
+ * The flat shapes of a cell, each from its lowest point, in order.
+ */
+std::vector<Polygon> FlatShapes(const Structure *cell)
+{
+    std::vector<Polygon> polygons;
+    CollectPolygons(cell, std::vector<LayerKey>(1, METAL), polygons);
+    for (auto &polygon : polygons)
+        std::rotate(polygon.begin(), std::min_element(polygon.begin(), polygon.end(), PointLess), polygon.end());
+    std::sort(polygons.begin(), polygons.end(), PolygonLess);
+    return polygons;
+}
+
+size_t CountTag(const Structure *cell, Record_type tag)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < cell->Size(); i++)
+        count += cell->Get((int)i)->Tag() == tag;
+    return count;
+}
+
+bool SameShapes(const std::vector<Polygon> &a, const std::vector<Polygon> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].size() != b[i].size() || !std::equal(a[i].begin(), a[i].end(), b[i].begin(), PointEqual))
+            return false;
+    return true;
+}
+
+struct Bounds
+{
+    int X, Y, W, H;
+};
+
+bool operator==(const Bounds &a, const Bounds &b)
+{
+    return a.X == b.X && a.Y == b.Y && a.W == b.W && a.H == b.H;
+}
+
+std::ostream &operator<<(std::ostream &out, const Bounds &b)
+{
+    return out << '(' << b.X << ", " << b.Y << ", " << b.W << ", " << b.H << ')';
+}
+
+Bounds BBox(const Structure *cell)
+{
+    Bounds b;
+    CHECK(cell->BBox(b.X, b.Y, b.W, b.H));
+    return b;
+}
+
+}
+
+GDS_TEST(RecognizeAndExpandKeepTheShapes)
+{
+    Library lib;
+    Structure *top = MakeLayout(lib);
+    Bounds before = BBox(top);
+    std::vector<Polygon> shapes = FlatShapes(top);
+    CHECK_EQ(15u, shapes.size());
+
+    ArrayReport report;
+    RecognizeArrays(top, report);
+    CHECK_EQ(15u, report.ElementsBefore);
+    CHECK_EQ(4u, report.ElementsAfter);
+    CHECK_EQ(12u, report.SRefsReplaced);
+    CHECK_EQ(1u, report.ArraysAdded);
+    CHECK(report.BytesSaved > 0);
+    CHECK_EQ(1u, CountTag(top, AREF));
+    CHECK(top->IsChanged());
+    CHECK_EQ(before, BBox(top));
+    CHECK(SameShapes(shapes, FlatShapes(top)));
+
+    CHECK_EQ(12u, ExpandArrays(top));
+    CHECK_EQ(0u, CountTag(top, AREF));
+    CHECK_EQ(15u, CountTag(top, SREF));
+    CHECK_EQ(before, BBox(top));
+    CHECK(SameShapes(shapes, FlatShapes(top)));
+}
+
+GDS_TEST(ShortRunsAreKept)
+{
+    Library lib;
+    Structure *top = MakeLayout(lib);
+    ArrayReport report;
+    RecognizeArrays(top, report, 13);
+    CHECK_EQ(0u, report.ArraysAdded);
+    CHECK_EQ(15u, CountTag(top, SREF));
+}
@@ -0,0 +1,145 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_boolean.cpp -- The tests of the Boolean operations on polygons.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "CGDS/boolean.h"
+
+using namespace GDS;
+
+namespace {
+
+Polygon Rectangle(int left, int bottom, int right, int top)
+{
+    Polygon polygon;
+    polygon.push_back(Point(left, bottom));
+    polygon.push_back(Point(right, bottom));
+    polygon.push_back(Point(right, top));
+    polygon.push_back(Point(left, top));
+    return polygon;
+}
+
+Polygon Triangle(Point a, Point b, Point c)
+{
+    Polygon polygon;
+    polygon.push_back(a);
+    polygon.push_back(b);
+    polygon.push_back(c);
+    return polygon;
+}
+
+/*
+ * The area of polygons which do not overlap, whatever their orientation.
+ */
+long long Area(const std::vector<Polygon> &polygons)
+{
+    long long total = 0;
+    for (auto &polygon : polygons)
+    {
+        long long twice = 0;
+        for (size_t i = 0; i < polygon.size(); i++)
+        {
+            const Point &p = polygon[i];
+            const Point &q = polygon[(i + 1) % polygon.size()];
+            twice += (long long)p.X * q.Y - (long long)q.X * p.Y;
+        }
+        total += (twice < 0 ? -twice : twice) / 2;
+    }
+    return total;
+}
+
+long long BooleanArea(const std::vector<Polygon> &a, const std::vector<Polygon> &b, BOOLEAN_OP op,
+                      unsigned int threads = 1)
+{
+    std::vector<Polygon> result;
+    Boolean(a, b, op, result, threads);
+    return Area(result);
+}
+
+}
+
+GDS_TEST(OverlappingSquares)
+{
+    // Two 100 x 100 squares which share a 50 x 50 corner.
+    std::vector<Polygon> a(1, Rectangle(0, 0, 100, 100));
+    std::vector<Polygon> b(1, Rectangle(50, 50, 150, 150));
+    CHECK_EQ(2500, BooleanArea(a, b, BOOLEAN_AND));
+    CHECK_EQ(17500, BooleanArea(a, b, BOOLEAN_OR));
+    CHECK_EQ(15000, BooleanArea(a, b, BOOLEAN_XOR));
+    CHECK_EQ(7500, BooleanArea(a, b, BOOLEAN_NOT));
+    CHECK_EQ(7500, BooleanArea(b, a, BOOLEAN_NOT));
+}
+
+GDS_TEST(TriangleAndSquare)
+{
+    // The hypotenuse cuts the corner (150, 150) off the square, a triangle
+    // of 5000 between (150, 50) and (50, 150).
+    std::vector<Polygon> a(1, Triangle(Point(0, 0), Point(200, 0), Point(0, 200)));
+    std::vector<Polygon> b(1, Rectangle(50, 50, 150, 150));
+    CHECK_EQ(5000, BooleanArea(a, b, BOOLEAN_AND));
+    CHECK_EQ(25000, BooleanArea(a, b, BOOLEAN_OR));
+    CHECK_EQ(20000, BooleanArea(a, b, BOOLEAN_XOR));
+    CHECK_EQ(15000, BooleanArea(a, b, BOOLEAN_NOT));
+    CHECK_EQ(5000, BooleanArea(b, a, BOOLEAN_NOT));
+}
+
+GDS_TEST(OrientationAndOverlapWithinASet)
+{
+    // A clockwise square counts like a counterclockwise one, and a set
+    // which overlaps itself is its union.
+    Polygon clockwise = Rectangle(0, 0, 100, 100);
+    std::swap(clockwise[1], clockwise[3]);
+    std::vector<Polygon> a;
+    a.push_back(clockwise);
+    a.push_back(Rectangle(50, 0, 150, 100));
+    CHECK_EQ(15000, BooleanArea(a, std::vector<Polygon>(), BOOLEAN_OR));
+
+    std::vector<Polygon> merged;
+    Merge(a, merged, 1);
+    CHECK_EQ(15000, Area(merged));
+}
+
+GDS_TEST(ResultDoesNotDependOnThreads)
+{
+    // Enough edges to split the sweep into tiles.
+    std::mt19937 random(7);
+    std::vector<Polygon> sets[2];
+    for (int set = 0; set < 2; set++)
+    {
+        for (int i = 0; i < 6000; i++)
+        {
+            int x = (int)(random() % 100000), y = (int)(random() % 100000);
+            int w = 1 + (int)(random() % 2000), h = 1 + (int)(random() % 2000);
+            sets[set].push_back(Rectangle(x, y, x + w, y + h));
+        }
+    }
+
+    const BOOLEAN_OP ops[] = { BOOLEAN_OR, BOOLEAN_AND, BOOLEAN_NOT, BOOLEAN_XOR };
+    for (auto op : ops)
+    {
+        long long single = BooleanArea(sets[0], sets[1], op, 1);
+        CHECK(single > 0);
+        CHECK_EQ(single, BooleanArea(sets[0], sets[1], op, 2));
+        CHECK_EQ(single, BooleanArea(sets[0], sets[1], op, 4));
+    }
+}
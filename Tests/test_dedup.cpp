@@ -0,0 +1,133 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_dedup.cpp -- The tests of the merging of identical cells.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "check.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/box.h"
+#include "CGDS/sref.h"
+#include "CGDS/aref.h"
+#include "CGDS/gdsio.h"
+#include "CGDS/dedup.h"
+
+using namespace GDS;
+
+namespace {
+
+/*
+ * LEAF_B is a copy of LEAF_A, and MID_B refers to LEAF_B the way MID_A
+ * refers to LEAF_A. LEAF_C differs by its box.
+ */
+void MakeLayout(Library &lib)
+{
+    lib.SetLibName("DEDUP");
+    lib.SetUnits(0.001, 1e-9);
+    AddBox(lib.Add("LEAF_A"), LayerKey(1, 0), 0, 0, 100, 100);
+    AddBox(lib.Add("LEAF_B"), LayerKey(1, 0), 0, 0, 100, 100);
+    AddBox(lib.Add("LEAF_C"), LayerKey(1, 0), 0, 0, 100, 200);
+    AddSRef(lib.Add("MID_A"), "LEAF_A", 10, 20);
+    AddSRef(lib.Add("MID_B"), "LEAF_B", 10, 20);
+
+    Structure *top = lib.Add("TOP");
+    AddSRef(top, "MID_A", 0, 0);
+    AddSRef(top, "MID_B", 500, 0);
+    AddSRef(top, "LEAF_C", 1000, 0);
+    AddARef(top, "LEAF_B", 0, 1000, 2, 2, 200, 200);
+}
+
+std::vector<std::vector<std::string> > Sorted(std::vector<std::vector<std::string> > groups)
+{
+    for (auto &group : groups)
+        std::sort(group.begin(), group.end());
+    std::sort(groups.begin(), groups.end());
+    return groups;
+}
+
+std::vector<std::vector<std::string> > ExpectedGroups()
+{
+    std::vector<std::vector<std::string> > groups(2);
+    groups[0].push_back("LEAF_A");
+    groups[0].push_back("LEAF_B");
+    groups[1].push_back("MID_A");
+    groups[1].push_back("MID_B");
+    return groups;
+}
+
+}
+
+GDS_TEST(FindsIdenticalCellsThroughReferences)
+{
+    Library lib;
+    MakeLayout(lib);
+    for (unsigned int threads = 1; threads <= 4; threads *= 2)
+    {
+        std::vector<std::vector<std::string> > groups;
+        FindDuplicateCells(lib, groups, threads);
+        CHECK(Sorted(groups) == ExpectedGroups());
+    }
+}
+
+GDS_TEST(MergeRenamesReferences)
+{
+    Library lib;
+    MakeLayout(lib);
+    DedupReport report;
+    DeduplicateCells(lib, report, 1);
+    CHECK_EQ(6u, report.CellsBefore);
+    CHECK_EQ(2u, report.CellsMerged);
+    CHECK_EQ(2u, report.ElementsFreed);
+    CHECK_EQ(4u, lib.Size());
+    CHECK(lib.Get("LEAF_B") == nullptr);
+    CHECK(lib.Get("MID_B") == nullptr);
+
+    Structure *top = lib.Get("TOP");
+    CHECK(top != nullptr && top->Size() == 4);
+    CHECK(top->IsChanged());
+    CHECK_EQ(std::string("MID_A"), static_cast<SRef*>(top->Get(0))->SName());
+    CHECK_EQ(std::string("MID_A"), static_cast<SRef*>(top->Get(1))->SName());
+    CHECK_EQ(std::string("LEAF_C"), static_cast<SRef*>(top->Get(2))->SName());
+    CHECK_EQ(std::string("LEAF_A"), static_cast<ARef*>(top->Get(3))->SName());
+    CHECK_EQ(2u, report.ReferencesChanged);
+}
+
+GDS_TEST(FindsIdenticalCellsInADatabase)
+{
+    std::string gds_name = TestFile(".gds");
+    std::string db_name = TestFile(".db");
+    std::string err;
+    {
+        Library lib;
+        MakeLayout(lib);
+        CHECK_OK(lib.WriteGDS(gds_name, err), err);
+    }
+    remove(db_name.c_str());
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err), err);
+
+    std::vector<std::vector<std::string> > groups;
+    CHECK_OK(FindDuplicateCells(db_name, groups, err), err);
+    CHECK(Sorted(groups) == ExpectedGroups());
+
+    remove(gds_name.c_str());
+    remove(db_name.c_str());
+}
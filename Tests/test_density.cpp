@@ -0,0 +1,118 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_density.cpp -- The tests of the density maps.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cmath>
+#include <vector>
+#include "check.h"
+#include "Bench/generator.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/boolean.h"
+#include "CGDS/density.h"
+
+using namespace GDS;
+
+namespace {
+
+double TotalArea(const DensityMap &map)
+{
+    double total = 0;
+    for (auto area : map.Area)
+        total += area;
+    return total;
+}
+
+double MergedArea(const Structure *cell, const std::vector<LayerKey> &layers)
+{
+    std::vector<Polygon> polygons, merged;
+    CollectPolygons(cell, layers, polygons);
+    Merge(polygons, merged, 1);
+    double total = 0;
+    for (auto &polygon : merged)
+    {
+        double twice = 0;
+        for (size_t i = 0; i < polygon.size(); i++)
+        {
+            const Point &p = polygon[i];
+            const Point &q = polygon[(i + 1) % polygon.size()];
+            twice += (double)p.X * q.Y - (double)q.X * p.Y;
+        }
+        total += std::fabs(twice) / 2;
+    }
+    return total;
+}
+
+}
+
+GDS_TEST(OverlapsAreCountedOnce)
+{
+    Library lib;
+    Structure *leaf = lib.Add("LEAF");
+    AddBox(leaf, LayerKey(1, 0), 0, 0, 100, 100);
+    AddBox(leaf, LayerKey(1, 0), 50, 0, 100, 100);    // Overlaps the first box by 50 x 100.
+    AddBox(leaf, LayerKey(2, 0), 0, 0, 1000, 1000);   // Another layer.
+
+    Structure *top = lib.Add("TOP");
+    AddSRef(top, "LEAF", 1030, 70);        // Off the grid of the tiles.
+    AddARef(top, "LEAF", 0, 500, 3, 2, 400, 300);
+
+    std::vector<LayerKey> layers(1, LayerKey(1, 0));
+    DensityMap map;
+    ComputeDensity(top, layers, 100, map, 1);
+    CHECK_EQ(100, map.TileSize);
+    CHECK_EQ(7 * 15000.0, TotalArea(map));
+    CHECK_EQ(MergedArea(top, layers), TotalArea(map));
+    for (size_t i = 0; i < map.Area.size(); i++)
+        CHECK(map.Area[i] >= 0 && map.Area[i] <= 100 * 100);
+
+    // The tile at (1000, 0) has 70 x 30 of the SREF.
+    int col = (1000 - map.Left) / 100, row = (0 - map.Bottom) / 100;
+    CHECK_EQ(70 * 30.0, map.Area[(size_t)(row * map.Cols + col)]);
+}
+
+GDS_TEST(TotalAreaIsMergedArea)
+{
+    GeneratorOptions options;
+    options.Cells = 12;
+    options.Depth = 3;
+    options.Shapes = 30;
+    options.ArrayRows = 2;
+    options.ArrayCols = 3;
+    Library lib;
+    GenerateLibrary(options, lib);
+    Structure *top = lib.Get("TOP");
+    CHECK(top != nullptr);
+
+    std::vector<LayerKey> layers;
+    layers.push_back(LayerKey(1, 0));
+    layers.push_back(LayerKey(2, 0));
+    double merged = MergedArea(top, layers);
+    CHECK(merged > 0);
+
+    // Polygons and round paths have slanted edges, whose crossings are
+    // rounded to the grid when the shapes are merged.
+    for (unsigned int threads = 1; threads <= 4; threads *= 2)
+    {
+        DensityMap map;
+        ComputeDensity(top, layers, 1000, map, threads);
+        CHECK(std::fabs(TotalArea(map) - merged) <= merged * 1e-4);
+    }
+}
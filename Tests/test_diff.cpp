@@ -0,0 +1,129 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_diff.cpp -- The tests of the comparison of two layouts.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cstdio>
+#include <vector>
+#include "check.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/boundary.h"
+#include "CGDS/gdsio.h"
+#include "CGDS/diff.h"
+
+using namespace GDS;
+
+namespace {
+
+void AddTriangle(Structure *cell, int first)
+{
+    Point corners[3] = { Point(0, 0), Point(300, 0), Point(0, 300) };
+    std::vector<Point> pts;
+    for (int i = 0; i < 4; i++)
+        pts.push_back(corners[(first + i) % 3]);
+    Boundary *boundary = new Boundary;
+    boundary->SetLayer(2);
+    boundary->SetDataType(0);
+    boundary->SetXY(std::move(pts));
+    cell->Add(boundary);
+}
+
+/*
+ * The new version changes the box of LEAF, which MID and TOP are above,
+ * starts the triangle of TRI at another corner, drops GONE and adds NEW.
+ * SAME does not change.
+ */
+void WriteLayout(const std::string &file_name, bool changed)
+{
+    Library lib;
+    lib.SetLibName("DIFF");
+    lib.SetUnits(0.001, 1e-9);
+    AddBox(lib.Add("LEAF"), LayerKey(1, 0), 0, 0, 100, changed ? 120 : 100);
+    AddSRef(lib.Add("MID"), "LEAF", 0, 0);
+    AddSRef(lib.Add("TOP"), "MID", 0, 0);
+    AddBox(lib.Add("SAME"), LayerKey(1, 0), 0, 0, 50, 50);
+    AddTriangle(lib.Add("TRI"), changed ? 1 : 0);
+    AddBox(lib.Add(changed ? "NEW" : "GONE"), LayerKey(3, 0), 0, 0, 10, 10);
+    std::string err;
+    CHECK_OK(lib.WriteGDS(file_name, err), err);
+}
+
+void CheckDiffs(const std::vector<CellDiff> &diffs)
+{
+    CHECK_EQ(6u, diffs.size());
+    if (diffs.size() != 6)
+        return;
+    const char *names[] = { "GONE", "LEAF", "MID", "NEW", "TOP", "TRI" };
+    const CELL_CHANGE changes[] = { CELL_REMOVED, CELL_MODIFIED, CELL_UNCHANGED,
+                                    CELL_ADDED, CELL_UNCHANGED, CELL_EQUIVALENT };
+    const bool below[] = { false, false, true, false, true, false };
+    for (size_t i = 0; i < diffs.size(); i++)
+    {
+        CHECK_EQ(std::string(names[i]), diffs[i].Name);
+        CHECK_EQ((int)changes[i], (int)diffs[i].Change);
+        CHECK_EQ(below[i], diffs[i].Below);
+    }
+    CHECK(diffs[1].Layers == std::vector<LayerKey>(1, LayerKey(1, 0)));
+    CHECK(!diffs[1].References);
+}
+
+}
+
+GDS_TEST(DiffGDSIIReportsChanges)
+{
+    std::string old_name = TestFile("_old.gds"), new_name = TestFile("_new.gds");
+    WriteLayout(old_name, false);
+    WriteLayout(new_name, true);
+    std::string err;
+    for (unsigned int threads = 1; threads <= 4; threads *= 2)
+    {
+        std::vector<CellDiff> diffs;
+        CHECK_OK(DiffGDSII(old_name, new_name, diffs, err, threads), err);
+        CheckDiffs(diffs);
+    }
+
+    std::vector<CellDiff> diffs;
+    CHECK_OK(DiffGDSII(old_name, old_name, diffs, err), err);
+    CHECK(diffs.empty());
+    remove(old_name.c_str());
+    remove(new_name.c_str());
+}
+
+GDS_TEST(DiffDatabasesReportsChanges)
+{
+    std::string old_name = TestFile("_old.gds"), new_name = TestFile("_new.gds");
+    std::string old_db = TestFile("_old.db"), new_db = TestFile("_new.db");
+    WriteLayout(old_name, false);
+    WriteLayout(new_name, true);
+    remove(old_db.c_str());
+    remove(new_db.c_str());
+    std::string err;
+    CHECK_OK(ConvertGDSII2DB(old_name, old_db, err), err);
+    CHECK_OK(ConvertGDSII2DB(new_name, new_db, err, CELL_FORMAT_COMPACT), err);
+
+    std::vector<CellDiff> diffs;
+    CHECK_OK(DiffDatabases(old_db, new_db, diffs, err), err);
+    CheckDiffs(diffs);
+
+    remove(old_name.c_str());
+    remove(new_name.c_str());
+    remove(old_db.c_str());
+    remove(new_db.c_str());
+}
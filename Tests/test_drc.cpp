@@ -0,0 +1,154 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_drc.cpp -- The tests of the flat and hierarchical design rule
+ *                 checks.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <vector>
+#include "check.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/drc.h"
+
+using namespace GDS;
+
+namespace {
+
+const LayerKey METAL(1, 0), VIA(2, 0);
+
+/*
+ * A wire 100 wide placed twice 50 apart, in a row of 4 at a pitch of 160,
+ * and a box 40 wide in the top cell: 4 spacing and 1 width violations.
+ */
+Structure *MakeLayout(Library &lib)
+{
+    Structure *wire = lib.Add("WIRE");
+    AddBox(wire, METAL, 0, 0, 100, 1000);
+
+    Structure *top = lib.Add("TOP");
+    AddSRef(top, "WIRE", 0, 0);
+    AddSRef(top, "WIRE", 150, 0);
+
+    AddARef(top, "WIRE", 1000, 0, 4, 1, 160, 2000);
+
+    AddBox(top, METAL, 2000, 0, 40, 1000);
+    return top;
+}
+
+std::vector<DrcRule> Rules()
+{
+    std::vector<DrcRule> rules(2);
+    rules[0].Name = "M1.W";
+    rules[0].Check = DRC_WIDTH;
+    rules[0].Layer = METAL;
+    rules[0].Outer = METAL;
+    rules[0].Value = 60;
+    rules[1].Name = "M1.S";
+    rules[1].Check = DRC_SPACING;
+    rules[1].Layer = METAL;
+    rules[1].Outer = METAL;
+    rules[1].Value = 80;
+    return rules;
+}
+
+size_t CountRule(const std::vector<DrcViolation> &violations, size_t rule)
+{
+    size_t count = 0;
+    for (auto &violation : violations)
+        count += violation.Rule == rule;
+    return count;
+}
+
+}
+
+GDS_TEST(FlatCheckFindsWidthAndSpacing)
+{
+    Library lib;
+    Structure *top = MakeLayout(lib);
+    std::vector<DrcViolation> violations;
+    CheckDrc(top, Rules(), violations, 1);
+    CHECK_EQ(1u, CountRule(violations, 0));
+    CHECK_EQ(4u, CountRule(violations, 1));
+}
+
+GDS_TEST(TouchingShapesAreMerged)
+{
+    // Two boxes 40 wide which overlap are one shape 70 wide, and a box
+    // which touches it is not a spacing violation.
+    Library lib;
+    Structure *top = lib.Add("TOP");
+    AddBox(top, METAL, 0, 0, 40, 1000);
+    AddBox(top, METAL, 30, 0, 40, 1000);
+    AddBox(top, METAL, 70, 500, 100, 100);
+    std::vector<DrcViolation> violations;
+    CheckDrc(top, Rules(), violations, 1);
+    CHECK(violations.empty());
+}
+
+GDS_TEST(EnclosureMeasuresEachSide)
+{
+    // A via enclosed by 10 on the left and bottom and 20 on the right and
+    // top, and a via which crosses the edge of the metal.
+    Library lib;
+    Structure *top = lib.Add("TOP");
+    AddBox(top, METAL, 0, 0, 50, 50);
+    AddBox(top, VIA, 10, 10, 20, 20);
+    AddBox(top, METAL, 0, 1000, 50, 60);
+    AddBox(top, VIA, 40, 1020, 20, 20);
+
+    std::vector<DrcRule> rules(1);
+    rules[0].Name = "V1.EN";
+    rules[0].Check = DRC_ENCLOSURE;
+    rules[0].Layer = VIA;
+    rules[0].Outer = METAL;
+    rules[0].Value = 15;
+    std::vector<DrcViolation> violations;
+    CheckDrc(top, rules, violations, 1);
+
+    size_t crossing = 0, near = 0;
+    for (auto &violation : violations)
+    {
+        if (violation.Distance == 0)
+            crossing++;
+        else if (violation.Distance == 10)
+            near++;
+    }
+    CHECK_EQ(2u, near);
+    CHECK(crossing > 0);
+    CHECK_EQ(violations.size(), near + crossing);
+}
+
+GDS_TEST(HierarchicalCheckMatchesFlatCheck)
+{
+    Library lib;
+    Structure *top = MakeLayout(lib);
+    std::vector<DrcViolation> flat;
+    CheckDrc(top, Rules(), flat, 1);
+
+    for (unsigned int threads = 1; threads <= 4; threads *= 2)
+    {
+        std::vector<DrcCellViolations> cells;
+        CheckDrcHierarchical(top, Rules(), cells, threads);
+        std::vector<DrcViolation> flattened;
+        FlattenViolations(top, cells, flattened);
+        CHECK_EQ(flat.size(), flattened.size());
+        CHECK_EQ(CountRule(flat, 0), CountRule(flattened, 0));
+        CHECK_EQ(CountRule(flat, 1), CountRule(flattened, 1));
+    }
+}
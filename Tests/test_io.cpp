@@ -0,0 +1,490 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_io.cpp -- The tests of reading and writing GDSII files and layout
+ *                databases.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+#include "check.h"
+#include "Bench/generator.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/boundary.h"
+#include "CGDS/path.h"
+#include "CGDS/sref.h"
+#include "CGDS/aref.h"
+#include "CGDS/gdsio.h"
+#include "CGDS/oasis.h"
+
+using namespace GDS;
+
+namespace {
+
+std::vector<char> ReadFile(const std::string &file_name)
+{
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+GeneratorOptions SmallLayout()
+{
+    GeneratorOptions options;
+    options.Cells = 12;
+    options.Depth = 3;
+    options.Shapes = 20;
+    options.ArrayRows = 3;
+    options.ArrayCols = 4;
+    return options;
+}
+
+std::string MakeLayout()
+{
+    std::string file_name = TestFile(".gds");
+    std::string err;
+    CHECK_OK(GenerateGDSII(file_name, SmallLayout(), err), err);
+    return file_name;
+}
+
+void RemoveDatabase(const std::string &db_name)
+{
+    remove(db_name.c_str());
+    remove((db_name + "-wal").c_str());
+    remove((db_name + "-shm").c_str());
+}
+
+/*
+ * The records of each cell of a GDSII file, by name.
+ */
+std::map<std::string, std::vector<char> > CellRecords(const std::vector<char> &data)
+{
+    std::map<std::string, std::vector<char> > cells;
+    std::vector<CellOffset> index;
+    std::string err;
+    CHECK_OK(IndexGDSII(data.data(), data.size(), index, err), err);
+    for (auto &cell : index)
+        cells[cell.Name].assign(data.begin() + cell.Start, data.begin() + cell.End);
+    return cells;
+}
+
+/*
+ * A cell with a BOUNDARY, a TEXT, a NODE and a BOX.
+ */
+std::string MakeTextLayout()
+{
+    Point triangle[4] = { Point(0, 0), Point(100, 0), Point(0, 100), Point(0, 0) };
+    Point square[5] = { Point(0, 0), Point(100, 0), Point(100, 100), Point(0, 100), Point(0, 0) };
+    short dates[12] = { 2015, 1, 1, 0, 0, 0, 2015, 1, 1, 0, 0, 0 };
+    double units[2] = { 0.001, 1e-9 };
+    std::vector<char> data;
+    PutShortRecord(data, HEADER, Integer_2, 600);
+    PutShortRecord(data, BGNLIB, Integer_2, dates, 12);
+    PutStringRecord(data, LIBNAME, "TEXT");
+    PutDoubleRecord(data, UNITS, units, 2);
+    PutShortRecord(data, BGNSTR, Integer_2, dates, 12);
+    PutStringRecord(data, STRNAME, "LABELS");
+    PutRecord(data, BOUNDARY);
+    PutShortRecord(data, LAYER, Integer_2, 1);
+    PutShortRecord(data, DATATYPE, Integer_2, 0);
+    PutXYRecord(data, triangle, 4);
+    PutRecord(data, ENDEL);
+    PutRecord(data, TEXT);
+    PutShortRecord(data, LAYER, Integer_2, 2);
+    PutShortRecord(data, TEXTTYPE, Integer_2, 0);
+    PutShortRecord(data, PRESENTATION, BitArray, 5);
+    PutXYRecord(data, square + 2, 1);
+    PutStringRecord(data, STRING, "VDD");
+    PutRecord(data, ENDEL);
+    PutRecord(data, NODE);
+    PutShortRecord(data, LAYER, Integer_2, 3);
+    PutShortRecord(data, NODETYPE, Integer_2, 0);
+    PutXYRecord(data, square, 1);
+    PutRecord(data, ENDEL);
+    PutRecord(data, BOX);
+    PutShortRecord(data, LAYER, Integer_2, 4);
+    PutShortRecord(data, BOXTYPE, Integer_2, 0);
+    PutXYRecord(data, square, 5);
+    PutRecord(data, ENDEL);
+    PutRecord(data, ENDSTR);
+    PutRecord(data, ENDLIB);
+
+    std::string file_name = TestFile("_text.gds");
+    std::ofstream out(file_name.c_str(), std::ios::binary);
+    out.write(data.data(), data.size());
+    return file_name;
+}
+
+void CheckDatabaseRoundTrip(CELL_FORMAT format, const char *suffix)
+{
+    std::string gds_name = MakeLayout();
+    std::string db_name = TestFile(std::string(suffix) + ".db");
+    std::string out_name = TestFile(std::string(suffix) + "_out.gds");
+    std::string err;
+    RemoveDatabase(db_name);
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err, format), err);
+    CHECK_OK(ConvertDB2GDSII(db_name, out_name, err), err);
+    std::vector<char> original = ReadFile(gds_name);
+    CHECK(!original.empty());
+    CHECK(ReadFile(out_name) == original);
+
+    // Unchanged cells are copied from the database by WriteGDS.
+    Library lib;
+    CHECK_OK(lib.OpenDB(db_name, err), err);
+    CHECK_OK(lib.WriteGDS(out_name, err), err);
+    CHECK(CellRecords(ReadFile(out_name)) == CellRecords(original));
+    lib.CloseDB();
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+    RemoveDatabase(db_name);
+}
+
+}
+
+GDS_TEST(GDSToDBToGDSIsIdentical)
+{
+    CheckDatabaseRoundTrip(CELL_FORMAT_GDSII, "_gdsii");
+}
+
+GDS_TEST(GDSToCompactDBToGDSIsIdentical)
+{
+    CheckDatabaseRoundTrip(CELL_FORMAT_COMPACT, "_compact");
+}
+
+GDS_TEST(CompactEncodingRoundTrips)
+{
+    std::string gds_name = MakeLayout();
+    std::vector<char> data = ReadFile(gds_name);
+    auto cells = CellRecords(data);
+    CHECK(cells.size() > 1);
+    size_t encoded_size = 0, raw_size = 0;
+    std::vector<char> encoded, decoded;
+    for (auto &cell : cells)
+    {
+        EncodeCompactCell(cell.second.data(), cell.second.size(), encoded);
+        CHECK(DecodeCompactCell(encoded.data(), encoded.size(), decoded));
+        CHECK(decoded == cell.second);
+        encoded_size += encoded.size();
+        raw_size += cell.second.size();
+    }
+    CHECK(encoded_size < raw_size);
+
+    // Corrupted data is refused rather than decoded past its end.
+    EncodeCompactCell(cells.begin()->second.data(), cells.begin()->second.size(), encoded);
+    encoded.resize(encoded.size() / 2);
+    CHECK(!DecodeCompactCell(encoded.data(), encoded.size(), decoded));
+    remove(gds_name.c_str());
+}
+
+GDS_TEST(LoadGDSWithAndWithoutOffsets)
+{
+    std::string gds_name = MakeLayout();
+    std::string db_name = TestFile(".db");
+    std::string out_name = TestFile("_out.gds");
+    std::string err;
+    RemoveDatabase(db_name);
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err), err);
+    std::vector<CellOffset> index;
+    CHECK_OK(ReadCellOffsets(db_name, index, err), err);
+
+    Library scanned, indexed;
+    CHECK_OK(scanned.LoadGDS(gds_name, err, 2), err);
+    CHECK_OK(indexed.LoadGDS(gds_name, index, err, 2), err);
+    CHECK_EQ(SmallLayout().Cells + 1, (int)scanned.Size());
+    CHECK_EQ(scanned.Size(), indexed.Size());
+    for (size_t i = 0; i < scanned.Size(); i++)
+    {
+        Structure *cell = scanned.Get(int(i));
+        Structure *other = indexed.Get(cell->Name());
+        CHECK(other != nullptr);
+        if (other == nullptr)
+            continue;
+        std::vector<char> a, b;
+        CHECK(cell->Write(a) && other->Write(b));
+        CHECK(a == b);
+    }
+
+    // The records written from the parsed cells are the ones read.
+    CHECK_OK(scanned.WriteGDS(out_name, err), err);
+    CHECK(CellRecords(ReadFile(out_name)) == CellRecords(ReadFile(gds_name)));
+
+    // A missing file is an error, not an empty library.
+    Library missing;
+    CHECK(!missing.LoadGDS(TestFile("_missing.gds"), err));
+    CHECK(!err.empty());
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+    RemoveDatabase(db_name);
+}
+
+GDS_TEST(LayerFilterRefusesToWriteDroppedShapes)
+{
+    std::string gds_name = MakeLayout();
+    std::string db_name = TestFile(".db");
+    std::string out_name = TestFile("_out.gds");
+    std::string err;
+    RemoveDatabase(db_name);
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err), err);
+
+    LayerFilter filter(std::vector<short>(1, 1));
+    Library lib;
+    lib.SetLayerFilter(filter);
+    CHECK_OK(lib.OpenDB(db_name, err), err);
+    Structure *filtered = nullptr;
+    for (size_t i = 0; i < lib.Size() && filtered == nullptr; i++)
+    {
+        if (lib.Get(int(i))->IsFiltered())
+            filtered = lib.Get(int(i));
+    }
+    CHECK(filtered != nullptr);
+
+    // Unchanged cells are copied whole from the database.
+    CHECK_OK(lib.WriteGDS(out_name, err), err);
+    CHECK(CellRecords(ReadFile(out_name)) == CellRecords(ReadFile(gds_name)));
+
+    // A changed cell would lose the shapes which were not read.
+    if (filtered != nullptr)
+    {
+        filtered->SetChanged(true);
+        CHECK(!lib.WriteGDS(out_name, err));
+        CHECK(err.find(filtered->Name()) != std::string::npos);
+    }
+    lib.CloseDB();
+
+    // Without a database there is nothing to copy the cells from.
+    Library loaded;
+    loaded.SetLayerFilter(filter);
+    CHECK_OK(loaded.LoadGDS(gds_name, err), err);
+    CHECK(!loaded.WriteGDS(out_name, err));
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+    RemoveDatabase(db_name);
+}
+
+GDS_TEST(EditedElementsAreWritten)
+{
+    std::string gds_name = MakeLayout();
+    std::string db_name = TestFile(".db");
+    std::string out_name = TestFile("_out.gds");
+    std::string err;
+    RemoveDatabase(db_name);
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err), err);
+
+    // Move a point of a polygon and an SREF in place, without SetChanged.
+    Library lib;
+    CHECK_OK(lib.OpenDB(db_name, err), err);
+    Boundary *boundary = nullptr;
+    SRef *sref = nullptr;
+    for (size_t i = 0; i < lib.Size(); i++)
+    {
+        Structure *cell = lib.Get(int(i));
+        CHECK(!cell->IsChanged());
+        for (size_t k = 0; k < cell->Size(); k++)
+        {
+            Element *e = cell->Get(int(k));
+            if (boundary == nullptr && e->Tag() == BOUNDARY)
+                boundary = static_cast<Boundary*>(e);
+            if (sref == nullptr && e->Tag() == SREF && (boundary == nullptr || boundary->Parent() != cell))
+                sref = static_cast<SRef*>(e);
+        }
+    }
+    CHECK(boundary != nullptr && sref != nullptr);
+    if (boundary == nullptr || sref == nullptr)
+        return;
+    Point moved(boundary->XY()[1].X + 7, boundary->XY()[1].Y - 3);
+    CHECK(boundary->SetPoint(1, moved));
+    CHECK(boundary->Parent()->IsChanged());
+    Point origin(sref->XY().X + 11, sref->XY().Y);
+    sref->SetXY(origin);
+    CHECK(sref->Parent()->IsChanged());
+    std::string polygon_cell = boundary->Parent()->Name();
+    std::string sref_cell = sref->Parent()->Name();
+    CHECK_OK(lib.WriteGDS(out_name, err), err);
+    lib.CloseDB();
+
+    auto old_cells = CellRecords(ReadFile(gds_name));
+    auto new_cells = CellRecords(ReadFile(out_name));
+    CHECK(old_cells[polygon_cell] != new_cells[polygon_cell]);
+    CHECK(old_cells[sref_cell] != new_cells[sref_cell]);
+    for (auto &cell : old_cells)
+    {
+        if (cell.first != polygon_cell && cell.first != sref_cell)
+            CHECK(cell.second == new_cells[cell.first]);
+    }
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+    RemoveDatabase(db_name);
+}
+
+GDS_TEST(NewCellReplacesTheOneInTheDatabase)
+{
+    std::string gds_name = MakeLayout();
+    std::string db_name = TestFile(".db");
+    std::string out_name = TestFile("_out.gds");
+    std::string err;
+    RemoveDatabase(db_name);
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err), err);
+
+    // An empty cell added under the name of a deleted one is written empty.
+    Library lib;
+    CHECK_OK(lib.OpenDB(db_name, err), err);
+    std::string name = lib.Get(0)->Name();
+    lib.Del(name);
+    Structure *cell = lib.Add(name);
+    CHECK(cell->IsChanged());
+    std::vector<char> empty;
+    CHECK(cell->Write(empty));
+    CHECK_OK(lib.WriteGDS(out_name, err), err);
+    lib.CloseDB();
+    CHECK(CellRecords(ReadFile(out_name))[name] == empty);
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+    RemoveDatabase(db_name);
+}
+
+GDS_TEST(EflagsAreKept)
+{
+    // A rectangle with EFLAGS stays a BOUNDARY, and every element writes
+    // back the flags it was read with.
+    Library lib;
+    lib.SetLibName("EFLAGS");
+    lib.SetUnits(0.001, 1e-9);
+    Structure *leaf = lib.Add("LEAF");
+    std::vector<Point> pts;
+    pts.push_back(Point(0, 0));
+    pts.push_back(Point(100, 0));
+    pts.push_back(Point(100, 100));
+    pts.push_back(Point(0, 100));
+    pts.push_back(Point(0, 0));
+    Boundary *boundary = new Boundary;
+    boundary->SetEflags(1);
+    boundary->SetLayer(1);
+    boundary->SetDataType(0);
+    boundary->SetXY(pts);
+    leaf->Add(boundary);
+    Path *path = new Path;
+    path->SetEflags(2);
+    path->SetLayer(1);
+    path->SetDataType(0);
+    path->SetWidth(10);
+    path->SetXY(std::vector<Point>(pts.begin(), pts.begin() + 2));
+    leaf->Add(path);
+
+    Structure *top = lib.Add("TOP");
+    SRef *sref = new SRef;
+    sref->SetEflags(1);
+    sref->SetSName("LEAF");
+    top->Add(sref);
+    ARef *aref = new ARef;
+    aref->SetEflags(2);
+    aref->SetSName("LEAF");
+    aref->SetRowCol(1, 2);
+    aref->SetXY(std::vector<Point>(pts.begin(), pts.begin() + 3));
+    top->Add(aref);
+
+    std::string gds_name = TestFile(".gds");
+    std::string out_name = TestFile("_out.gds");
+    std::string err;
+    CHECK_OK(lib.WriteGDS(gds_name, err), err);
+    Library loaded;
+    CHECK_OK(loaded.LoadGDS(gds_name, err), err);
+    const Structure *read_leaf = loaded.Get("LEAF");
+    const Structure *read_top = loaded.Get("TOP");
+    CHECK(read_leaf != nullptr && read_leaf->Size() == 2);
+    CHECK(read_top != nullptr && read_top->Size() == 2);
+    if (read_leaf == nullptr || read_leaf->Size() != 2 || read_top == nullptr || read_top->Size() != 2)
+        return;
+    CHECK_EQ((int)BOUNDARY, (int)read_leaf->Get(0)->Tag());
+    if (read_leaf->Get(0)->Tag() == BOUNDARY)
+        CHECK_EQ(1, static_cast<const Boundary*>(read_leaf->Get(0))->Eflags());
+    CHECK_EQ(2, static_cast<const Path*>(read_leaf->Get(1))->Eflags());
+    CHECK_EQ(1, static_cast<const SRef*>(read_top->Get(0))->Eflags());
+    CHECK_EQ(2, static_cast<const ARef*>(read_top->Get(1))->Eflags());
+
+    CHECK_OK(loaded.WriteGDS(out_name, err), err);
+    CHECK(CellRecords(ReadFile(out_name)) == CellRecords(ReadFile(gds_name)));
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+}
+
+GDS_TEST(TextNodeAndBoxAreWritten)
+{
+    std::string gds_name = MakeTextLayout();
+    std::string db_name = TestFile(".db");
+    std::string out_name = TestFile("_out.gds");
+    std::string err;
+    const Record_type tags[] = { BOUNDARY, TEXT, NODE, BOX };
+
+    // A loaded cell is written from its elements.
+    {
+        Library lib;
+        CHECK_OK(lib.LoadGDS(gds_name, err), err);
+        Structure *cell = lib.Get("LABELS");
+        CHECK(cell != nullptr && cell->Size() == 4);
+        if (cell == nullptr || cell->Size() != 4)
+            return;
+        for (int i = 0; i < 4; i++)
+            CHECK_EQ((int)tags[i], (int)cell->Get(i)->Tag());
+        CHECK_OK(lib.WriteGDS(out_name, err), err);
+        CHECK(CellRecords(ReadFile(out_name)) == CellRecords(ReadFile(gds_name)));
+
+        // OASIS has no place for them.
+        std::string oas_name = TestFile(".oas");
+        CHECK(WriteOASIS(oas_name, lib, err) != 0);
+        CHECK(!err.empty());
+        remove(oas_name.c_str());
+    }
+
+    // An edited cell of a database keeps them too.
+    RemoveDatabase(db_name);
+    CHECK_OK(ConvertGDSII2DB(gds_name, db_name, err), err);
+    {
+        Library lib;
+        CHECK_OK(lib.OpenDB(db_name, err), err);
+        Structure *cell = lib.Get("LABELS");
+        CHECK(cell != nullptr && cell->Size() == 4);
+        if (cell == nullptr || cell->Size() != 4)
+            return;
+        static_cast<Boundary*>(cell->Get(0))->SetLayer(5);
+        CHECK_OK(lib.WriteGDS(out_name, err), err);
+        lib.CloseDB();
+    }
+    Library written;
+    CHECK_OK(written.LoadGDS(out_name, err), err);
+    Structure *cell = written.Get("LABELS");
+    CHECK(cell != nullptr && cell->Size() == 4);
+    if (cell != nullptr && cell->Size() == 4)
+    {
+        CHECK_EQ(5, static_cast<Boundary*>(cell->Get(0))->Layer());
+        for (int i = 1; i < 4; i++)
+            CHECK_EQ((int)tags[i], (int)cell->Get(i)->Tag());
+    }
+
+    remove(gds_name.c_str());
+    remove(out_name.c_str());
+    RemoveDatabase(db_name);
+}
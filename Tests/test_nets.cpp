@@ -0,0 +1,129 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_nets.cpp -- The tests of the net extraction.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <vector>
+#include "check.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/nets.h"
+
+using namespace GDS;
+
+namespace {
+
+const LayerKey METAL1(1, 0), VIA(2, 0), METAL2(3, 0);
+
+/*
+ * A row of 5 segments which touch end to end, joined by a via to a
+ * vertical wire; a lone segment and a lone wire. The elements of TOP are
+ * the AREF, the via, the wire, the lone SREF and the lone wire.
+ */
+Structure *MakeLayout(Library &lib)
+{
+    Structure *segment = lib.Add("SEG");
+    AddBox(segment, METAL1, 0, 0, 100, 20);
+
+    Structure *top = lib.Add("TOP");
+    AddARef(top, "SEG", 0, 0, 5, 1, 100, 100);
+    AddBox(top, VIA, 450, 0, 20, 20);
+    AddBox(top, METAL2, 450, 0, 20, 500);
+
+    AddSRef(top, "SEG", 2000, 0);
+    AddBox(top, METAL2, 3000, 0, 20, 500);
+    return top;
+}
+
+std::vector<LayerConnection> Connections()
+{
+    std::vector<LayerConnection> connections;
+    connections.push_back(LayerConnection(METAL1, VIA));
+    connections.push_back(LayerConnection(VIA, METAL2));
+    return connections;
+}
+
+const CellNets *Find(const std::vector<CellNets> &cells, const Structure *cell)
+{
+    for (auto &nets : cells)
+        if (nets.Cell == cell)
+            return &nets;
+    return nullptr;
+}
+
+}
+
+GDS_TEST(InstancesAndLayersJoinNets)
+{
+    Library lib;
+    Structure *top = MakeLayout(lib);
+    for (unsigned int threads = 1; threads <= 4; threads *= 2)
+    {
+        std::vector<CellNets> cells;
+        ExtractNets(top, Connections(), cells, threads);
+        CHECK_EQ(2u, cells.size());
+        CHECK(cells.back().Cell == top);
+
+        const CellNets *segment = Find(cells, lib.Get("SEG"));
+        CHECK(segment != nullptr);
+        CHECK_EQ(1u, segment->NetCount);
+
+        const CellNets &nets = cells.back();
+        CHECK_EQ(2u, nets.NetCount);
+        CHECK_EQ(5u, nets.ShapeNets.size());
+        CHECK_EQ(-1, nets.ShapeNets[0]);
+        CHECK_EQ(-1, nets.ShapeNets[3]);
+        int wire = nets.ShapeNets[1];
+        CHECK_EQ(wire, nets.ShapeNets[2]);
+        CHECK(nets.ShapeNets[4] >= 0 && nets.ShapeNets[4] != wire);
+
+        // Every instance of the row joins the wire; the lone SREF joins nothing.
+        CHECK_EQ(5u, nets.Joins.size());
+        for (size_t i = 0; i < nets.Joins.size(); i++)
+        {
+            CHECK_EQ(0u, nets.Joins[i].Element);
+            CHECK_EQ((int)i, nets.Joins[i].Col);
+            CHECK_EQ((unsigned int)wire, nets.Joins[i].Net);
+        }
+
+        std::vector<Polygon> polygons;
+        std::vector<LayerKey> layers;
+        CollectNet(top, cells, (unsigned int)wire, polygons, &layers);
+        CHECK_EQ(7u, polygons.size());
+        CHECK_EQ(polygons.size(), layers.size());
+    }
+}
+
+GDS_TEST(UnconnectedLayersStayApart)
+{
+    Library lib;
+    Structure *top = MakeLayout(lib);
+    std::vector<LayerConnection> connections(1, LayerConnection(METAL1, VIA));
+    std::vector<CellNets> cells;
+    ExtractNets(top, connections, cells, 1);
+
+    // Without the via to the wire, the wires are ignored.
+    const CellNets &nets = cells.back();
+    CHECK_EQ(1u, nets.NetCount);
+    CHECK_EQ(-1, nets.ShapeNets[2]);
+    CHECK_EQ(-1, nets.ShapeNets[4]);
+    CHECK_EQ(5u, nets.Joins.size());
+    for (auto &join : nets.Joins)
+        CHECK_EQ(nets.ShapeNets[1], (int)join.Net);
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_oasis.cpp -- The tests of writing and reading OASIS files.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "check.h"
+#include "CGDS/library.h"
+#include "CGDS/structures.h"
+#include "CGDS/path.h"
+#include "CGDS/boolean.h"
+#include "CGDS/oasis.h"
+
+using namespace GDS;
+
+namespace {
+
+void AddPath(Structure *cell, short layer, int width, short path_type, int bgn_extn = 0, int end_extn = 0)
+{
+    std::vector<Point> pts;
+    pts.push_back(Point(0, 0));
+    pts.push_back(Point(1000, 0));
+    pts.push_back(Point(1000, 700));
+    pts.push_back(Point(1400, 300));
+    Path *path = new Path;
+    path->SetLayer(layer);
+    path->SetDataType(0);
+    path->SetWidth(width);
+    path->SetPathType(path_type);
+    path->SetBgnExtn(bgn_extn);
+    path->SetEndExtn(end_extn);
+    path->SetXY(std::move(pts));
+    cell->Add(path);
+}
+
+double Area(const Structure *cell, short layer)
+{
+    std::vector<Polygon> polygons;
+    CollectPolygons(cell, std::vector<LayerKey>(1, LayerKey(layer, 0)), polygons);
+    double total = 0;
+    for (auto &polygon : polygons)
+    {
+        double twice = 0;
+        for (size_t i = 0; i < polygon.size(); i++)
+        {
+            const Point &p = polygon[i];
+            const Point &q = polygon[(i + 1) % polygon.size()];
+            twice += (double)p.X * q.Y - (double)q.X * p.Y;
+        }
+        total += std::fabs(twice) / 2;
+    }
+    return total;
+}
+
+}
+
+GDS_TEST(PathsKeepTheirOutlines)
+{
+    Library lib;
+    lib.SetLibName("OASIS");
+    lib.SetUnits(0.001, 1e-9);
+    Structure *cell = lib.Add("PATHS");
+    AddPath(cell, 1, 20, 0);
+    AddPath(cell, 2, 20, 2);
+    AddPath(cell, 3, 20, 4, 15, -5);
+    AddPath(cell, 4, 21, 0);       // Odd width.
+    AddPath(cell, 5, 21, 2);
+    AddPath(cell, 6, 20, 1);       // Round ends.
+
+    std::string file_name = TestFile(".oas");
+    std::string err;
+    for (int compress = 0; compress < 2; compress++)
+    {
+        CHECK_OK(WriteOASIS(file_name, lib, err, compress != 0, 1), err);
+        Library copy;
+        CHECK_OK(ReadOASIS(file_name, copy, err), err);
+        const Structure *read = copy.Get("PATHS");
+        CHECK(read != nullptr && read->Size() == cell->Size());
+        if (read == nullptr || read->Size() != cell->Size())
+            continue;
+
+        // The paths OASIS can hold stay paths, the others become polygons.
+        const Record_type tags[] = { PATH, PATH, PATH, BOUNDARY, BOUNDARY, BOUNDARY };
+        for (int i = 0; i < 6; i++)
+        {
+            CHECK_EQ((int)tags[i], (int)read->Get(i)->Tag());
+            CHECK_EQ(Area(cell, short(i + 1)), Area(read, short(i + 1)));
+        }
+    }
+    remove(file_name.c_str());
+}
@@ -0,0 +1,164 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_outline.cpp -- The tests of the outlines of paths.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <random>
+#include <vector>
+#include "check.h"
+#include "CGDS/structures.h"
+#include "CGDS/path.h"
+#include "CGDS/outline.h"
+
+using namespace GDS;
+
+namespace {
+
+Path MakePath(int width, short path_type, const std::vector<Point> &pts)
+{
+    Path path;
+    path.SetLayer(1);
+    path.SetDataType(0);
+    path.SetWidth(width);
+    path.SetPathType(path_type);
+    path.SetBgnExtn(path_type == 4 ? 25 : 0);
+    path.SetEndExtn(path_type == 4 ? -5 : 0);
+    path.SetXY(pts);
+    return path;
+}
+
+/*
+ * Check that the bounding box of a path is the one of its outline.
+ */
+void CheckBounds(const Path &path)
+{
+    std::vector<Point> outline;
+    int x = 0, y = 0, w = 0, h = 0;
+    bool has_outline = OutlinePath(&path, outline);
+    CHECK_EQ(has_outline, path.BBox(x, y, w, h));
+    if (!has_outline)
+        return;
+
+    int left = outline[0].X, bottom = outline[0].Y, right = left, top = bottom;
+    for (auto &pt : outline)
+    {
+        left = pt.X < left ? pt.X : left;
+        bottom = pt.Y < bottom ? pt.Y : bottom;
+        right = pt.X > right ? pt.X : right;
+        top = pt.Y > top ? pt.Y : top;
+    }
+    CHECK_EQ(left, x);
+    CHECK_EQ(bottom, y);
+    CHECK_EQ(right - left, w);
+    CHECK_EQ(top - bottom, h);
+}
+
+}
+
+GDS_TEST(BBoxIsTheBoundsOfTheOutline)
+{
+    const short types[] = { 0, 1, 2, 4 };
+    std::mt19937 random(11);
+    for (int round = 0; round < 400; round++)
+    {
+        // Manhattan paths, paths at any angle with acute bends, and
+        // repeated points.
+        bool manhattan = round % 2 == 0;
+        std::vector<Point> pts(1, Point(0, 0));
+        int count = 2 + (int)(random() % 5);
+        for (int i = 1; i < count; i++)
+        {
+            Point p = pts.back();
+            int dx = (int)(random() % 401) - 200, dy = (int)(random() % 401) - 200;
+            if (random() % 8 == 0)
+                dx = dy = 0;
+            else if (manhattan && i % 2 == 0)
+                dx = 0;
+            else if (manhattan)
+                dy = 0;
+            pts.push_back(Point(p.X + dx, p.Y + dy));
+        }
+        int width = 1 + (int)(random() % 60);
+        for (auto type : types)
+            CheckBounds(MakePath(width, type, pts));
+    }
+
+    // A path without area has no bounding box.
+    CheckBounds(MakePath(10, 0, std::vector<Point>(2, Point(5, 5))));
+    CheckBounds(MakePath(0, 0, std::vector<Point>(2, Point(5, 5))));
+}
+
+GDS_TEST(SharpBendsAreSquaredOff)
+{
+    // The miter of a bend of about 1 degree would reach 115 half widths.
+    std::vector<Point> pts;
+    pts.push_back(Point(0, 0));
+    pts.push_back(Point(10000, 0));
+    pts.push_back(Point(0, 170));
+    Path path = MakePath(20, 0, pts);
+    int x, y, w, h;
+    CHECK(path.BBox(x, y, w, h));
+    CHECK_EQ(10010, x + w);
+    CheckBounds(path);
+}
+
+GDS_TEST(CensusExtentsAreTheOutline)
+{
+    // A mitered acute bend reaches past half the width, and so does an
+    // extension longer than half the width.
+    std::vector<Point> pts;
+    pts.push_back(Point(0, 0));
+    pts.push_back(Point(1000, 0));
+    pts.push_back(Point(0, 200));
+    Structure cell("PATHS");
+    Path *acute = new Path;
+    acute->SetLayer(1);
+    acute->SetDataType(0);
+    acute->SetWidth(20);
+    acute->SetXY(pts);
+    cell.Add(acute);
+    Path *extended = new Path;
+    extended->SetLayer(2);
+    extended->SetDataType(0);
+    extended->SetWidth(20);
+    extended->SetPathType(4);
+    extended->SetBgnExtn(300);
+    extended->SetXY(pts);
+    cell.Add(extended);
+
+    const LayerCensus &census = cell.Census();
+    const Path *paths[] = { acute, extended };
+    for (short layer = 1; layer <= 2; layer++)
+    {
+        auto found = census.find(LayerKey(layer, 0));
+        CHECK(found != census.end());
+        if (found == census.end())
+            continue;
+        int x, y, w, h;
+        CHECK(paths[layer - 1]->BBox(x, y, w, h));
+        CHECK_EQ(x, found->second.Left);
+        CHECK_EQ(y, found->second.Bottom);
+        CHECK_EQ(x + w, found->second.Right);
+        CHECK_EQ(y + h, found->second.Top);
+        if (layer == 1)
+            CHECK(found->second.Right > 1000 + 10);
+        else
+            CHECK(found->second.Left < -10);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of GDSII.
+ *
+ * test_strtable.cpp -- The tests of the table of interned strings.
+ *
+ * Copyright (c) 2015 Kangpeng Shao <billowen035@gmail.com>
+ *
+ * GDSII is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at you option) any later version.
+ *
+ * GDSII is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABLILTY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "CGDS/strtable.h"
+
+using namespace GDS;
+
+GDS_TEST(InternedStringsKeepTheirIds)
+{
+    StringTable &table = StringTable::Instance();
+    CHECK_EQ(StringTable::EMPTY, table.Intern(std::string()));
+
+    // Enough strings to fill several chunks and grow the index.
+    std::vector<StringTable::Id> ids;
+    for (int i = 0; i < 20000; i++)
+        ids.push_back(table.Intern("CELL_" + std::to_string(i)));
+    for (int i = 0; i < 20000; i++)
+    {
+        std::string name = "CELL_" + std::to_string(i);
+        StringTable::Id id = 0;
+        CHECK(table.Find(name, id));
+        CHECK_EQ(ids[i], id);
+        CHECK_EQ(name, table.Str(id));
+        CHECK_EQ(ids[i], table.Intern(name.data(), name.size()));
+    }
+    StringTable::Id id;
+    CHECK(!table.Find("NOT_A_CELL", id));
+}
+
+GDS_TEST(ThreadsAgreeOnIds)
+{
+    // Every thread interns the same names in another order while the others
+    // look them up.
+    StringTable &table = StringTable::Instance();
+    const int count = 5000, thread_count = 4;
+    const int steps[thread_count] = { 1, 3, 7, 11 };
+    std::vector<std::vector<StringTable::Id> > ids(thread_count, std::vector<StringTable::Id>(count));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++)
+        threads.push_back(std::thread([&table, &ids, &steps, t, count]() {
+            for (int i = 0; i < count; i++)
+            {
+                int n = (i * steps[t]) % count;
+                ids[t][n] = table.Intern("SHARED_" + std::to_string(n));
+                StringTable::Id id;
+                if (table.Find("SHARED_" + std::to_string(n), id))
+                    ids[t][n] = id == ids[t][n] ? id : StringTable::EMPTY;
+            }
+        }));
+    for (auto &thread : threads)
+        thread.join();
+    for (int t = 0; t < thread_count; t++)
+        for (int i = 0; i < count; i++)
+        {
+            CHECK_EQ(ids[0][i], ids[t][i]);
+            CHECK_EQ("SHARED_" + std::to_string(i), table.Str(ids[t][i]));
+        }
+}
+
+GDS_TEST(ResetReleasesTheStrings)
+{
+    StringTable &table = StringTable::Instance();
+    table.Intern(std::string("BEFORE_RESET"));
+    table.Reset();
+    CHECK_EQ(1u, table.Size());
+    StringTable::Id id;
+    CHECK(!table.Find("BEFORE_RESET", id));
+    CHECK(table.Find(std::string(), id));
+    CHECK_EQ(StringTable::EMPTY, id);
+    CHECK_EQ(std::string("AFTER_RESET"), table.Str(table.Intern(std::string("AFTER_RESET"))));
+}